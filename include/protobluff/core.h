@@ -26,9 +26,14 @@
 #include <protobluff/core/allocator.h>
 #include <protobluff/core/buffer.h>
 #include <protobluff/core/common.h>
+#include <protobluff/core/container.h>
 #include <protobluff/core/decoder.h>
 #include <protobluff/core/descriptor.h>
+#include <protobluff/core/iovec.h>
 #include <protobluff/core/encoder.h>
+#include <protobluff/core/parser.h>
+#include <protobluff/core/record.h>
+#include <protobluff/core/rewriter.h>
 #include <protobluff/core/string.h>
 
 #endif /* PB_INCLUDE_CORE_H */
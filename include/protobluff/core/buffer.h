@@ -72,6 +72,11 @@ pb_buffer_create_zero_copy(
   uint8_t data[],                      /* Raw data */
   size_t size);                        /* Raw data size */
 
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_buffer_t
+pb_buffer_create_mmap(
+  const char *path);                   /* Path */
+
 PB_EXPORT void
 pb_buffer_destroy(
   pb_buffer_t *buffer);                /* Buffer */
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_CONTAINER_H
+#define PB_INCLUDE_CORE_CONTAINER_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/descriptor.h>
+#include <protobluff/core/record.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_container_writer_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor */
+  const pb_field_descriptor_t *key;    /*!< Key field descriptor */
+  size_t block;                        /*!< Records per block */
+  size_t records;                      /*!< Record count */
+  pb_buffer_t buffer;                  /*!< Buffer */
+  pb_buffer_t index;                   /*!< Block index */
+} pb_container_writer_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct pb_container_reader_t {
+  const pb_buffer_t *buffer;           /*!< Buffer */
+  size_t offset;                       /*!< Block index offset */
+  size_t records;                      /*!< Record count */
+  size_t blocks;                       /*!< Block count */
+  size_t block;                        /*!< Records per block */
+  pb_type_t type;                      /*!< Key type */
+  pb_tag_t tag;                        /*!< Key tag */
+  pb_error_t error;                    /*!< Error code */
+} pb_container_reader_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_container_writer_t
+pb_container_writer_create(
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  pb_tag_t key,                        /* Key tag */
+  size_t block);                       /* Records per block */
+
+PB_EXPORT void
+pb_container_writer_destroy(
+  pb_container_writer_t *writer);      /* Container writer */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_container_writer_write(
+  pb_container_writer_t *writer,       /* Container writer */
+  const pb_buffer_t *record);          /* Record */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_container_writer_finish(
+  pb_container_writer_t *writer);      /* Container writer */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_container_reader_t
+pb_container_reader_create(
+  const pb_buffer_t *buffer);          /* Buffer */
+
+PB_EXPORT void
+pb_container_reader_destroy(
+  pb_container_reader_t *reader);      /* Container reader */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_record_iter_t
+pb_container_reader_block(
+  const pb_container_reader_t *reader, /* Container reader */
+  size_t index);                       /* Block index */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_record_iter_t
+pb_container_reader_seek(
+  const pb_container_reader_t *reader, /* Container reader */
+  size_t record);                      /* Record number */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT int
+pb_container_reader_match(
+  const pb_container_reader_t *reader, /* Container reader */
+  size_t index,                        /* Block index */
+  const void *min,                     /* Pointer holding minimum key */
+  const void *max);                    /* Pointer holding maximum key */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT size_t
+pb_container_reader_find(
+  const pb_container_reader_t *reader, /* Container reader */
+  size_t index,                        /* Block index to start from */
+  const void *min,                     /* Pointer holding minimum key */
+  const void *max);                    /* Pointer holding maximum key */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the buffer of a container writer.
+ *
+ * \param[in] writer Container writer
+ * \return           Buffer
+ */
+PB_INLINE const pb_buffer_t *
+pb_container_writer_buffer(const pb_container_writer_t *writer) {
+  assert(writer);
+  return &(writer->buffer);
+}
+
+/*!
+ * Retrieve the number of records written to a container writer.
+ *
+ * \param[in] writer Container writer
+ * \return           Record count
+ */
+PB_INLINE size_t
+pb_container_writer_records(const pb_container_writer_t *writer) {
+  assert(writer);
+  return writer->records;
+}
+
+/*!
+ * Retrieve the internal error state of a container writer.
+ *
+ * \param[in] writer Container writer
+ * \return           Error code
+ */
+PB_INLINE pb_error_t
+pb_container_writer_error(const pb_container_writer_t *writer) {
+  assert(writer);
+  return pb_buffer_error(&(writer->buffer));
+}
+
+/*!
+ * Test whether a container writer is valid.
+ *
+ * \param[in] writer Container writer
+ * \return           Test result
+ */
+PB_INLINE int
+pb_container_writer_valid(const pb_container_writer_t *writer) {
+  assert(writer);
+  return !pb_container_writer_error(writer);
+}
+
+/*!
+ * Retrieve the number of records of a container reader.
+ *
+ * \param[in] reader Container reader
+ * \return           Record count
+ */
+PB_INLINE size_t
+pb_container_reader_records(const pb_container_reader_t *reader) {
+  assert(reader);
+  return reader->records;
+}
+
+/*!
+ * Retrieve the number of blocks of a container reader.
+ *
+ * \param[in] reader Container reader
+ * \return           Block count
+ */
+PB_INLINE size_t
+pb_container_reader_blocks(const pb_container_reader_t *reader) {
+  assert(reader);
+  return reader->blocks;
+}
+
+/*!
+ * Retrieve the range of blocks assigned to one of multiple workers.
+ *
+ * A container reader is never altered after creation, so blocks can be
+ * iterated from multiple threads at the same time. This function splits the
+ * blocks into contiguous ranges of almost equal size, one for each worker.
+ *
+ * \param[in]  reader  Container reader
+ * \param[in]  worker  Worker
+ * \param[in]  workers Worker count
+ * \param[out] start   Index of first block
+ * \param[out] end     Index after last block
+ */
+PB_INLINE void
+pb_container_reader_partition(
+    const pb_container_reader_t *reader, size_t worker, size_t workers,
+    size_t *start, size_t *end) {
+  assert(reader && worker < workers && start && end);
+  *start = reader->blocks *  worker      / workers;
+  *end   = reader->blocks * (worker + 1) / workers;
+}
+
+/*!
+ * Retrieve the internal error state of a container reader.
+ *
+ * \param[in] reader Container reader
+ * \return           Error code
+ */
+PB_INLINE pb_error_t
+pb_container_reader_error(const pb_container_reader_t *reader) {
+  assert(reader);
+  return reader->error;
+}
+
+/*!
+ * Test whether a container reader is valid.
+ *
+ * \param[in] reader Container reader
+ * \return           Test result
+ */
+PB_INLINE int
+pb_container_reader_valid(const pb_container_reader_t *reader) {
+  assert(reader);
+  return !pb_container_reader_error(reader);
+}
+
+#endif /* PB_INCLUDE_CORE_CONTAINER_H */
@@ -28,6 +28,7 @@
 #include <protobluff/core/buffer.h>
 #include <protobluff/core/common.h>
 #include <protobluff/core/descriptor.h>
+#include <protobluff/core/iovec.h>
 
 /* ----------------------------------------------------------------------------
  * Type definitions
@@ -45,8 +46,17 @@ typedef pb_error_t
 typedef struct pb_decoder_t {
   const pb_descriptor_t *descriptor;   /*!< Descriptor */
   const pb_buffer_t *buffer;           /*!< Buffer */
+  const pb_iovec_t *iovec;             /*!< Segmented buffer */
+  unsigned int flags;                  /*!< Flags */
 } pb_decoder_t;
 
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+#define PB_DECODER_VALIDATE      1     /*!< Flag: required fields, wiretypes */
+#define PB_DECODER_VALIDATE_ENUM 2     /*!< Flag: enum values */
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -58,6 +68,13 @@ pb_decoder_create(
     *descriptor,                       /* Descriptor */
   const pb_buffer_t *buffer);          /* Buffer */
 
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_decoder_t
+pb_decoder_create_from_iovec(
+  const pb_descriptor_t
+    *descriptor,                       /* Descriptor */
+  const pb_iovec_t *iovec);            /* Segmented buffer */
+
 PB_EXPORT void
 pb_decoder_destroy(
   pb_decoder_t *decoder);              /* Decoder */
@@ -97,6 +114,42 @@ pb_decoder_buffer(const pb_decoder_t *decoder) {
   return decoder->buffer;
 }
 
+/*!
+ * Retrieve the segmented buffer of a decoder.
+ *
+ * \param[in] decoder Decoder
+ * \return            Segmented buffer
+ */
+PB_INLINE const pb_iovec_t *
+pb_decoder_iovec(const pb_decoder_t *decoder) {
+  assert(decoder);
+  return decoder->iovec;
+}
+
+/*!
+ * Retrieve the flags of a decoder.
+ *
+ * \param[in] decoder Decoder
+ * \return            Flags
+ */
+PB_INLINE unsigned int
+pb_decoder_flags(const pb_decoder_t *decoder) {
+  assert(decoder);
+  return decoder->flags;
+}
+
+/*!
+ * Set the flags of a decoder, which are passed on to nested decoders.
+ *
+ * \param[in,out] decoder Decoder
+ * \param[in]     flags   Flags
+ */
+PB_INLINE void
+pb_decoder_set_flags(pb_decoder_t *decoder, unsigned int flags) {
+  assert(decoder);
+  decoder->flags = flags;
+}
+
 /*!
  * Retrieve the internal error state of a decoder.
  *
@@ -106,7 +159,9 @@ pb_decoder_buffer(const pb_decoder_t *decoder) {
 PB_INLINE pb_error_t
 pb_decoder_error(const pb_decoder_t *decoder) {
   assert(decoder);
-  return pb_buffer_error(decoder->buffer);
+  return decoder->iovec
+    ? pb_iovec_error(decoder->iovec)
+    : pb_buffer_error(decoder->buffer);
 }
 
 /*!
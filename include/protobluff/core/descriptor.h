@@ -45,6 +45,14 @@ typedef struct pb_field_descriptor_t {
 
 /* ------------------------------------------------------------------------- */
 
+typedef struct pb_name_table_t {
+  const uint32_t seed;                 /*!< Hash seed */
+  const size_t size;                   /*!< Slot count, power of two */
+  const uint32_t *const slot;          /*!< Slots holding index + 1 or 0 */
+} pb_name_table_t;
+
+/* ------------------------------------------------------------------------- */
+
 typedef struct pb_descriptor_t {
   struct {
     const pb_field_descriptor_t
@@ -53,6 +61,10 @@ typedef struct pb_descriptor_t {
   } field;
   struct pb_descriptor_t
     *extension;                        /*!< Descriptor extension */
+  const struct pb_descriptor_table_t
+    *table;                            /*!< Merged field descriptors */
+  const uint64_t *required;            /*!< Bitmask of required fields */
+  const pb_name_table_t *names;        /*!< Field names by hash */
 } pb_descriptor_t;
 
 typedef struct pb_descriptor_iter_t {
@@ -74,6 +86,7 @@ typedef struct pb_enum_descriptor_t {
       *const data;                     /*!< Enum value descriptors */
     const size_t size;                 /*!< Enum value descriptor count */
   } value;
+  const pb_name_table_t *names;        /*!< Enum value names by hash */
 } pb_enum_descriptor_t;
 
 typedef struct pb_enum_descriptor_iter_t {
@@ -91,6 +104,11 @@ typedef struct pb_oneof_descriptor_t {
     const size_t *const data;          /*!< Indexes */
     const size_t size;                 /*!< Index count */
   } index;
+  struct {
+    const uint8_t *const data;         /*!< Member tag bitmap */
+    const pb_tag_t base;               /*!< Lowest member tag */
+    const size_t size;                 /*!< Bitmap size in bits */
+  } member;
 } pb_oneof_descriptor_t;
 
 typedef struct pb_oneof_descriptor_iter_t {
@@ -629,6 +647,34 @@ pb_oneof_descriptor_empty(const pb_oneof_descriptor_t *descriptor) {
   return !pb_oneof_descriptor_size(descriptor);
 }
 
+/*!
+ * Test whether a tag is a member of a oneof.
+ *
+ * If the oneof descriptor provides a member tag bitmap, the test is a single
+ * bit lookup. Otherwise, the field descriptors of the members are compared,
+ * which is still cheaper than looking up the tag in the message descriptor.
+ *
+ * \param[in] descriptor Oneof descriptor
+ * \param[in] tag        Tag
+ * \return               Test result
+ */
+PB_INLINE int
+pb_oneof_descriptor_member(
+    const pb_oneof_descriptor_t *descriptor, pb_tag_t tag) {
+  assert(descriptor);
+  if (descriptor->member.data) {
+    const size_t bit = (size_t)tag - descriptor->member.base;
+    return tag >= descriptor->member.base && bit < descriptor->member.size
+      ? (descriptor->member.data[bit >> 3] >> (bit & 7)) & 1
+      : 0;
+  }
+  for (size_t i = 0; i < descriptor->index.size; i++)
+    if (descriptor->descriptor->field.data[
+        descriptor->index.data[i]].tag == tag)
+      return 1;
+  return 0;
+}
+
 /* ------------------------------------------------------------------------- */
 
 /*!
@@ -39,6 +39,9 @@
 typedef struct pb_encoder_t {
   const pb_descriptor_t *descriptor;   /*!< Descriptor */
   pb_buffer_t buffer;                  /*!< Buffer */
+  pb_buffer_t references;              /*!< Referenced strings */
+  size_t threshold;                    /*!< Reference threshold */
+  size_t referenced;                   /*!< Referenced bytes */
 } pb_encoder_t;
 
 /* ----------------------------------------------------------------------------
@@ -56,6 +59,19 @@ pb_encoder_create_with_allocator(
   pb_allocator_t *allocator,           /* Allocator */
   const pb_descriptor_t *descriptor);  /* Descriptor */
 
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_encoder_t
+pb_encoder_create_iovec(
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  size_t threshold);                   /* Reference threshold */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_encoder_t
+pb_encoder_create_iovec_with_allocator(
+  pb_allocator_t *allocator,           /* Allocator */
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  size_t threshold);                   /* Reference threshold */
+
 PB_EXPORT void
 pb_encoder_destroy(
   pb_encoder_t *encoder);              /* Encoder */
@@ -96,6 +112,21 @@ pb_encoder_buffer(const pb_encoder_t *encoder) {
   return &(encoder->buffer);
 }
 
+/*!
+ * Retrieve the size of the message encoded by an encoder.
+ *
+ * For encoders in scatter-gather mode, this includes the size of all strings
+ * which are referenced in place and not part of the buffer.
+ *
+ * \param[in] encoder Encoder
+ * \return            Message size
+ */
+PB_INLINE size_t
+pb_encoder_size(const pb_encoder_t *encoder) {
+  assert(encoder);
+  return pb_buffer_size(&(encoder->buffer)) + encoder->referenced;
+}
+
 /*!
  * Retrieve the internal error state of an encoder.
  *
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_IOVEC_H
+#define PB_INCLUDE_CORE_IOVEC_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <protobluff/core/allocator.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/encoder.h>
+#include <protobluff/core/rewriter.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_iovec_t {
+  pb_allocator_t *allocator;           /*!< Allocator */
+  struct iovec *segments;              /*!< Segments */
+  size_t count;                        /*!< Segment count */
+  size_t size;                         /*!< Total size */
+} pb_iovec_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_iovec_t
+pb_iovec_create(
+  const struct iovec segments[],       /* Segments */
+  size_t count);                       /* Segment count */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_iovec_t
+pb_iovec_create_with_allocator(
+  pb_allocator_t *allocator,           /* Allocator */
+  const struct iovec segments[],       /* Segments */
+  size_t count);                       /* Segment count */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_iovec_t
+pb_iovec_create_from_encoder(
+  const pb_encoder_t *encoder);        /* Encoder */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_iovec_t
+pb_iovec_create_from_rewriter(
+  const pb_rewriter_t *rewriter);      /* Rewriter */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_iovec_t
+pb_iovec_create_range(
+  const pb_iovec_t *iovec,             /* Segmented buffer */
+  size_t offset,                       /* Offset */
+  size_t size);                        /* Size */
+
+PB_EXPORT void
+pb_iovec_destroy(
+  pb_iovec_t *iovec);                  /* Segmented buffer */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_iovec_read(
+  const pb_iovec_t *iovec,             /* Segmented buffer */
+  size_t offset,                       /* Offset */
+  uint8_t data[],                      /* Target buffer */
+  size_t size);                        /* Bytes to read */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the allocator of a segmented buffer.
+ *
+ * \param[in] iovec Segmented buffer
+ * \return          Allocator
+ */
+PB_INLINE pb_allocator_t *
+pb_iovec_allocator(const pb_iovec_t *iovec) {
+  assert(iovec);
+  return iovec->allocator;
+}
+
+/*!
+ * Retrieve the segments of a segmented buffer.
+ *
+ * \param[in] iovec Segmented buffer
+ * \return          Segments
+ */
+PB_INLINE const struct iovec *
+pb_iovec_segments(const pb_iovec_t *iovec) {
+  assert(iovec);
+  return iovec->segments;
+}
+
+/*!
+ * Retrieve the number of segments of a segmented buffer.
+ *
+ * \param[in] iovec Segmented buffer
+ * \return          Segment count
+ */
+PB_INLINE size_t
+pb_iovec_count(const pb_iovec_t *iovec) {
+  assert(iovec);
+  return iovec->count;
+}
+
+/*!
+ * Retrieve the total size of a segmented buffer.
+ *
+ * \param[in] iovec Segmented buffer
+ * \return          Total size
+ */
+PB_INLINE size_t
+pb_iovec_size(const pb_iovec_t *iovec) {
+  assert(iovec);
+  return iovec->size;
+}
+
+/*!
+ * Test whether a segmented buffer is empty.
+ *
+ * \param[in] iovec Segmented buffer
+ * \return          Test result
+ */
+PB_INLINE int
+pb_iovec_empty(const pb_iovec_t *iovec) {
+  assert(iovec);
+  return !pb_iovec_size(iovec);
+}
+
+/*!
+ * Retrieve the internal error state of a segmented buffer.
+ *
+ * \param[in] iovec Segmented buffer
+ * \return          Error code
+ */
+PB_INLINE pb_error_t
+pb_iovec_error(const pb_iovec_t *iovec) {
+  assert(iovec);
+  return iovec->allocator
+    ? PB_ERROR_NONE
+    : PB_ERROR_ALLOC;
+}
+
+/*!
+ * Test whether a segmented buffer is valid.
+ *
+ * \param[in] iovec Segmented buffer
+ * \return          Test result
+ */
+PB_INLINE int
+pb_iovec_valid(const pb_iovec_t *iovec) {
+  assert(iovec);
+  return !pb_iovec_error(iovec);
+}
+
+#endif /* PB_INCLUDE_CORE_IOVEC_H */
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_PARSER_H
+#define PB_INCLUDE_CORE_PARSER_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/allocator.h>
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/descriptor.h>
+
+/* ----------------------------------------------------------------------------
+ * Forward declarations
+ * ------------------------------------------------------------------------- */
+
+struct pb_parser_frame_t;
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef enum pb_parser_event_t {
+  PB_PARSER_EVENT_VALUE,               /*!< Value of a field */
+  PB_PARSER_EVENT_ENTER,               /*!< Start of a nested message */
+  PB_PARSER_EVENT_LEAVE                /*!< End of a nested message */
+} pb_parser_event_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef pb_error_t
+(*pb_parser_handler_f)(
+  pb_parser_event_t event,             /*!< Event */
+  const pb_field_descriptor_t
+    *descriptor,                       /*!< Field descriptor */
+  const void *value,                   /*!< Pointer holding value */
+  void *user);                         /*!< User data */
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct pb_parser_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor */
+  pb_parser_handler_f handler;         /*!< Handler */
+  void *user;                          /*!< User data */
+  pb_allocator_t *allocator;           /*!< Allocator */
+  struct {
+    struct pb_parser_frame_t *data;    /*!< Nesting stack frames */
+    size_t size;                       /*!< Nesting depth */
+    size_t capacity;                   /*!< Nesting stack capacity */
+  } frame;
+  const pb_field_descriptor_t *field;  /*!< Current field descriptor */
+  unsigned int state;                  /*!< Current state */
+  pb_wiretype_t wiretype;              /*!< Current wiretype */
+  size_t offset;                       /*!< Bytes consumed */
+  size_t left;                         /*!< Bytes left of current value */
+  size_t packed;                       /*!< End offset of packed field */
+  struct {
+    uint8_t data[10];                  /*!< Partial value */
+    size_t size;                       /*!< Partial value size */
+  } partial;
+  pb_buffer_t string;                  /*!< Partial string */
+  pb_error_t error;                    /*!< Error code */
+} pb_parser_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_parser_t
+pb_parser_create(
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  pb_parser_handler_f handler,         /* Handler */
+  void *user);                         /* User data */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_parser_t
+pb_parser_create_with_allocator(
+  pb_allocator_t *allocator,           /* Allocator */
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  pb_parser_handler_f handler,         /* Handler */
+  void *user);                         /* User data */
+
+PB_EXPORT void
+pb_parser_destroy(
+  pb_parser_t *parser);                /* Parser */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_parser_feed(
+  pb_parser_t *parser,                 /* Parser */
+  const uint8_t data[],                /* Raw data */
+  size_t size);                        /* Raw data size */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_parser_finish(
+  pb_parser_t *parser);                /* Parser */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the descriptor of a parser.
+ *
+ * \param[in] parser Parser
+ * \return           Descriptor
+ */
+PB_INLINE const pb_descriptor_t *
+pb_parser_descriptor(const pb_parser_t *parser) {
+  assert(parser);
+  return parser->descriptor;
+}
+
+/*!
+ * Retrieve the number of bytes consumed by a parser.
+ *
+ * \param[in] parser Parser
+ * \return           Bytes consumed
+ */
+PB_INLINE size_t
+pb_parser_offset(const pb_parser_t *parser) {
+  assert(parser);
+  return parser->offset;
+}
+
+/*!
+ * Retrieve the current nesting depth of a parser.
+ *
+ * \param[in] parser Parser
+ * \return           Nesting depth
+ */
+PB_INLINE size_t
+pb_parser_depth(const pb_parser_t *parser) {
+  assert(parser);
+  return parser->frame.size;
+}
+
+/*!
+ * Retrieve the internal error state of a parser.
+ *
+ * \param[in] parser Parser
+ * \return           Error code
+ */
+PB_INLINE pb_error_t
+pb_parser_error(const pb_parser_t *parser) {
+  assert(parser);
+  return parser->error;
+}
+
+/*!
+ * Test whether a parser is valid.
+ *
+ * \param[in] parser Parser
+ * \return           Test result
+ */
+PB_INLINE int
+pb_parser_valid(const pb_parser_t *parser) {
+  assert(parser);
+  return !pb_parser_error(parser);
+}
+
+#endif /* PB_INCLUDE_CORE_PARSER_H */
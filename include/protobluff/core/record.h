@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_RECORD_H
+#define PB_INCLUDE_CORE_RECORD_H
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/decoder.h>
+#include <protobluff/core/descriptor.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_record_iter_t {
+  const pb_buffer_t *buffer;           /*!< Buffer */
+  size_t offset;                       /*!< Current offset */
+  size_t next;                         /*!< Offset of next record */
+  size_t end;                          /*!< End offset */
+  pb_buffer_t record;                  /*!< Current record */
+  pb_error_t error;                    /*!< Error code */
+} pb_record_iter_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_record_iter_t
+pb_record_iter_create(
+  const pb_buffer_t *buffer);          /* Buffer */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_record_iter_t
+pb_record_iter_create_at(
+  const pb_buffer_t *buffer,           /* Buffer */
+  size_t offset);                      /* Offset */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_record_iter_t
+pb_record_iter_create_range(
+  const pb_buffer_t *buffer,           /* Buffer */
+  size_t start,                        /* Start offset */
+  size_t end);                         /* End offset */
+
+PB_EXPORT void
+pb_record_iter_destroy(
+  pb_record_iter_t *iter);             /* Record iterator */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT int
+pb_record_iter_next(
+  pb_record_iter_t *iter);             /* Record iterator */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the current record of a record iterator.
+ *
+ * The returned buffer is a zero-copy buffer pointing into the underlying
+ * buffer, and is only valid until the record iterator is advanced.
+ *
+ * \param[in] iter Record iterator
+ * \return         Buffer
+ */
+PB_INLINE const pb_buffer_t *
+pb_record_iter_buffer(const pb_record_iter_t *iter) {
+  assert(iter);
+  return &(iter->record);
+}
+
+/*!
+ * Retrieve the offset of the current record of a record iterator.
+ *
+ * The offset points to the length prefix of the record within the underlying
+ * buffer, so it can be used to resume iteration at this record.
+ *
+ * \param[in] iter Record iterator
+ * \return         Offset
+ */
+PB_INLINE size_t
+pb_record_iter_offset(const pb_record_iter_t *iter) {
+  assert(iter);
+  return iter->offset;
+}
+
+/*!
+ * Create a decoder for the current record of a record iterator.
+ *
+ * \warning The decoder refers to the current record, so it must not be used
+ * after the record iterator was advanced.
+ *
+ * \param[in] iter       Record iterator
+ * \param[in] descriptor Descriptor
+ * \return               Decoder
+ */
+PB_WARN_UNUSED_RESULT
+PB_INLINE pb_decoder_t
+pb_record_iter_decoder(
+    const pb_record_iter_t *iter, const pb_descriptor_t *descriptor) {
+  assert(iter && descriptor);
+  return pb_decoder_create(descriptor, &(iter->record));
+}
+
+/*!
+ * Retrieve the internal error state of a record iterator.
+ *
+ * \param[in] iter Record iterator
+ * \return         Error code
+ */
+PB_INLINE pb_error_t
+pb_record_iter_error(const pb_record_iter_t *iter) {
+  assert(iter);
+  return iter->error;
+}
+
+/*!
+ * Test whether a record iterator is valid.
+ *
+ * \param[in] iter Record iterator
+ * \return         Test result
+ */
+PB_INLINE int
+pb_record_iter_valid(const pb_record_iter_t *iter) {
+  assert(iter);
+  return !pb_record_iter_error(iter);
+}
+
+#endif /* PB_INCLUDE_CORE_RECORD_H */
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_REWRITER_H
+#define PB_INCLUDE_CORE_REWRITER_H
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <protobluff/core/allocator.h>
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/descriptor.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_rewriter_edit_t {
+  struct {
+    const pb_tag_t *const data;        /*!< Tags */
+    const size_t size;                 /*!< Tag count */
+  } path;
+  const void *value;                   /*!< Pointer holding value or NULL */
+} pb_rewriter_edit_t;
+
+typedef struct pb_rewriter_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor */
+  pb_buffer_t buffer;                  /*!< Buffer */
+  pb_buffer_t references;              /*!< Referenced regions */
+  size_t referenced;                   /*!< Referenced bytes */
+} pb_rewriter_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_rewriter_t
+pb_rewriter_create(
+  const pb_descriptor_t *descriptor);  /* Descriptor */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_rewriter_t
+pb_rewriter_create_with_allocator(
+  pb_allocator_t *allocator,           /* Allocator */
+  const pb_descriptor_t *descriptor);  /* Descriptor */
+
+PB_EXPORT void
+pb_rewriter_destroy(
+  pb_rewriter_t *rewriter);            /* Rewriter */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_rewriter_rewrite(
+  pb_rewriter_t *rewriter,             /* Rewriter */
+  const pb_buffer_t *buffer,           /* Buffer */
+  const pb_rewriter_edit_t edits[],    /* Edits */
+  size_t size);                        /* Edit count */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the descriptor of a rewriter.
+ *
+ * \param[in] rewriter Rewriter
+ * \return             Descriptor
+ */
+PB_INLINE const pb_descriptor_t *
+pb_rewriter_descriptor(const pb_rewriter_t *rewriter) {
+  assert(rewriter);
+  return rewriter->descriptor;
+}
+
+/*!
+ * Retrieve the buffer of a rewriter.
+ *
+ * \param[in] rewriter Rewriter
+ * \return             Buffer
+ */
+PB_INLINE const pb_buffer_t *
+pb_rewriter_buffer(const pb_rewriter_t *rewriter) {
+  assert(rewriter);
+  return &(rewriter->buffer);
+}
+
+/*!
+ * Retrieve the size of the message rewritten by a rewriter.
+ *
+ * This includes the size of all regions which are referenced in place and
+ * not part of the buffer.
+ *
+ * \param[in] rewriter Rewriter
+ * \return             Message size
+ */
+PB_INLINE size_t
+pb_rewriter_size(const pb_rewriter_t *rewriter) {
+  assert(rewriter);
+  return pb_buffer_size(&(rewriter->buffer)) + rewriter->referenced;
+}
+
+/*!
+ * Retrieve the internal error state of a rewriter.
+ *
+ * \param[in] rewriter Rewriter
+ * \return             Error code
+ */
+PB_INLINE pb_error_t
+pb_rewriter_error(const pb_rewriter_t *rewriter) {
+  assert(rewriter);
+  return pb_buffer_error(&(rewriter->buffer));
+}
+
+/*!
+ * Test whether a rewriter is valid.
+ *
+ * \param[in] rewriter Rewriter
+ * \return             Test result
+ */
+PB_INLINE int
+pb_rewriter_valid(const pb_rewriter_t *rewriter) {
+  assert(rewriter);
+  return !pb_rewriter_error(rewriter);
+}
+
+#endif /* PB_INCLUDE_CORE_REWRITER_H */
@@ -27,6 +27,7 @@
 #include <protobluff/message/common.h>
 #include <protobluff/message/cursor.h>
 #include <protobluff/message/field.h>
+#include <protobluff/message/index.h>
 #include <protobluff/message/journal.h>
 #include <protobluff/message/message.h>
 #include <protobluff/message/nested.h>
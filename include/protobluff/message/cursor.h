@@ -90,6 +90,18 @@ pb_cursor_match(
   pb_cursor_t *cursor,                 /* Cursor */
   const void *value);                  /* Pointer holding value */
 
+PB_EXPORT size_t
+pb_cursor_find_all(
+  pb_cursor_t *cursor,                 /* Cursor */
+  const void *value,                   /* Pointer holding value */
+  size_t pos[],                        /* Positions */
+  size_t size);                        /* Position count */
+
+PB_EXPORT int
+pb_cursor_lower_bound(
+  pb_cursor_t *cursor,                 /* Cursor */
+  const void *value);                  /* Pointer holding value */
+
 PB_WARN_UNUSED_RESULT
 PB_EXPORT pb_error_t
 pb_cursor_get(
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_MESSAGE_INDEX_H
+#define PB_INCLUDE_MESSAGE_INDEX_H
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <protobluff/core/allocator.h>
+#include <protobluff/core/descriptor.h>
+#include <protobluff/message/common.h>
+#include <protobluff/message/cursor.h>
+#include <protobluff/message/message.h>
+
+/* ----------------------------------------------------------------------------
+ * Forward declarations
+ * ------------------------------------------------------------------------- */
+
+struct pb_index_entry_t;
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_index_t {
+  pb_allocator_t *allocator;           /*!< Allocator */
+  pb_message_t message;                /*!< Message */
+  const pb_field_descriptor_t
+    *descriptor;                       /*!< Field descriptor */
+  size_t revision;                     /*!< Journal revision */
+  struct {
+    struct pb_index_entry_t *data;     /*!< Index entries */
+    size_t size;                       /*!< Index entry count */
+  } entry;
+  struct {
+    size_t *data;                      /*!< Bucket heads */
+    size_t size;                       /*!< Bucket count */
+  } bucket;
+  pb_error_t error;                    /*!< Error code */
+} pb_index_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_index_t
+pb_index_create(
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag);                       /* Tag */
+
+PB_EXPORT void
+pb_index_destroy(
+  pb_index_t *index);                  /* Index */
+
+PB_EXPORT int
+pb_index_seek(
+  pb_index_t *index,                   /* Index */
+  pb_cursor_t *cursor,                 /* Cursor */
+  const void *value);                  /* Pointer holding value */
+
+PB_EXPORT int
+pb_index_lower_bound(
+  pb_index_t *index,                   /* Index */
+  pb_cursor_t *cursor,                 /* Cursor */
+  const void *value);                  /* Pointer holding value */
+
+PB_EXPORT int
+pb_index_match(
+  pb_index_t *index,                   /* Index */
+  const void *value);                  /* Pointer holding value */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the underlying message of an index.
+ *
+ * \param[in] index Index
+ * \return          Message
+ */
+PB_INLINE const pb_message_t *
+pb_index_message(const pb_index_t *index) {
+  assert(index);
+  return &(index->message);
+}
+
+/*!
+ * Retrieve the field descriptor of an index.
+ *
+ * \param[in] index Index
+ * \return          Field descriptor
+ */
+PB_INLINE const pb_field_descriptor_t *
+pb_index_descriptor(const pb_index_t *index) {
+  assert(index);
+  return index->descriptor;
+}
+
+/*!
+ * Retrieve the number of values of an index.
+ *
+ * \param[in] index Index
+ * \return          Value count
+ */
+PB_INLINE size_t
+pb_index_size(const pb_index_t *index) {
+  assert(index);
+  return index->entry.size;
+}
+
+/*!
+ * Retrieve the internal error state of an index.
+ *
+ * \param[in] index Index
+ * \return          Error code
+ */
+PB_INLINE pb_error_t
+pb_index_error(const pb_index_t *index) {
+  assert(index);
+  return index->error;
+}
+
+/*!
+ * Test whether an index is valid.
+ *
+ * \param[in] index Index
+ * \return          Test result
+ */
+PB_INLINE int
+pb_index_valid(const pb_index_t *index) {
+  assert(index);
+  return !pb_index_error(index);
+}
+
+#endif /* PB_INCLUDE_MESSAGE_INDEX_H */
@@ -28,6 +28,8 @@
 #include <stdint.h>
 
 #include <protobluff/core/allocator.h>
+#include <protobluff/core/descriptor.h>
+#include <protobluff/core/record.h>
 #include <protobluff/message/buffer.h>
 #include <protobluff/message/common.h>
 
@@ -47,6 +49,17 @@ typedef struct pb_journal_t {
     struct pb_journal_entry_t *data;   /*!< Journal entries */
     size_t size;                       /*!< Journal entry count */
   } entry;
+  size_t revision;                     /*!< Write count */
+  size_t *refs;                        /*!< Buffer references, if shared */
+  struct {
+    int enabled;                       /*!< Whether readers are concurrent */
+    size_t sequence;                   /*!< Sequence, odd while writing */
+    size_t depth;                      /*!< Write section nesting depth */
+    struct {
+      void **data;                     /*!< Retired allocations */
+      size_t size;                     /*!< Retired allocation count */
+    } retired;
+  } shared;
 } pb_journal_t;
 
 /* ----------------------------------------------------------------------------
@@ -81,10 +94,59 @@ pb_journal_create_zero_copy(
   uint8_t data[],                      /* Raw data */
   size_t size);                        /* Raw data size */
 
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_journal_t
+pb_journal_create_from_record(
+  const pb_record_iter_t *iter);       /* Record iterator */
+
 PB_EXPORT void
 pb_journal_destroy(
   pb_journal_t *journal);              /* Journal */
 
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_journal_t
+pb_journal_snapshot(
+  pb_journal_t *journal);              /* Journal */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_journal_share(
+  pb_journal_t *journal);              /* Journal */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_journal_t
+pb_journal_view(
+  const pb_journal_t *journal);        /* Journal */
+
+PB_EXPORT void
+pb_journal_reclaim(
+  pb_journal_t *journal);              /* Journal */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT size_t
+pb_journal_read_begin(
+  const pb_journal_t *journal);        /* Journal */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT int
+pb_journal_read_retry(
+  const pb_journal_t *journal,         /* Journal */
+  size_t sequence);                    /* Sequence */
+
+PB_EXPORT void
+pb_journal_write_begin(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT void
+pb_journal_write_end(
+  pb_journal_t *journal);              /* Journal */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_journal_canonicalize(
+  pb_journal_t *journal,               /* Journal */
+  const pb_descriptor_t *descriptor);  /* Descriptor */
+
 /* ----------------------------------------------------------------------------
  * Macros
  * ------------------------------------------------------------------------- */
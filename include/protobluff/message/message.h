@@ -25,8 +25,10 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include <protobluff/core/descriptor.h>
+#include <protobluff/message/buffer.h>
 #include <protobluff/message/common.h>
 #include <protobluff/message/journal.h>
 #include <protobluff/message/part.h>
@@ -107,6 +109,15 @@ pb_message_get(
   pb_tag_t tag,                        /* Tag */
   void *value);                        /* Pointer receiving value */
 
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_message_get_repeated(
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag,                        /* Tag */
+  void *values,                        /* Pointer receiving values */
+  size_t size,                         /* Value count */
+  size_t *count);                      /* Total value count */
+
 PB_WARN_UNUSED_RESULT
 PB_EXPORT pb_error_t
 pb_message_put(
@@ -114,6 +125,43 @@ pb_message_put(
   pb_tag_t tag,                        /* Tag */
   const void *value);                  /* Pointer holding value */
 
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_message_put_repeated(
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag,                        /* Tag */
+  const void *values,                  /* Pointer holding values */
+  size_t size);                        /* Value count */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_message_merge(
+  pb_message_t *message,               /* Message */
+  const pb_message_t *source);         /* Message to merge */
+
+PB_EXPORT int
+pb_message_equals(
+  const pb_message_t *x,               /* Message */
+  const pb_message_t *y);              /* Message */
+
+PB_EXPORT uint64_t
+pb_message_hash(
+  const pb_message_t *message,         /* Message */
+  uint64_t seed);                      /* Seed */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_message_diff(
+  pb_buffer_t *patch,                  /* Buffer receiving patch */
+  const pb_message_t *from,            /* Original message */
+  const pb_message_t *to);             /* Changed message */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_message_patch(
+  pb_message_t *message,               /* Message */
+  const pb_buffer_t *patch);           /* Patch */
+
 PB_WARN_UNUSED_RESULT
 PB_EXPORT pb_error_t
 pb_message_erase(
@@ -125,6 +173,11 @@ PB_EXPORT pb_error_t
 pb_message_clear(
   pb_message_t *message);              /* Message */
 
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_message_squash(
+  pb_message_t *message);              /* Message */
+
 /* ----------------------------------------------------------------------------
  * Inline functions
  * ------------------------------------------------------------------------- */
@@ -43,6 +43,10 @@ typedef struct pb_oneof_t {
   const pb_oneof_descriptor_t
     *descriptor;                       /*!< Oneof descriptor */
   pb_cursor_t cursor;                  /*!< Cursor */
+  struct {
+    pb_tag_t tag;                      /*!< Active tag */
+    size_t revision;                   /*!< Journal revision */
+  } cache;
 } pb_oneof_t;
 
 /* ----------------------------------------------------------------------------
@@ -24,7 +24,9 @@
 #define PB_INCLUDE_UTIL_H
 
 #include <protobluff/util/chunk_allocator.h>
+#include <protobluff/util/decoder.h>
 #include <protobluff/util/descriptor.h>
+#include <protobluff/util/prune.h>
 #include <protobluff/util/validator.h>
 
 #endif /* PB_INCLUDE_UTIL_H */
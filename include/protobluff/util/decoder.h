@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_UTIL_DECODER_H
+#define PB_INCLUDE_UTIL_DECODER_H
+
+#include <stddef.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/decoder.h>
+#include <protobluff/core/descriptor.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef pb_error_t
+(*pb_decoder_chunk_f)(
+  size_t offset,                       /*!< Index of first submessage */
+  size_t size,                         /*!< Submessage count */
+  void *user);                         /*!< User data */
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_decoder_decode_batch(
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  const pb_buffer_t buffers[],         /* Buffers */
+  size_t size,                         /* Buffer count */
+  pb_decoder_handler_f handler,        /* Handler */
+  void *user[],                        /* User data per thread */
+  size_t threads,                      /* Thread count */
+  pb_error_t errors[]);                /* Error codes per buffer */
+
+/* ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_decoder_decode_repeated(
+  const pb_decoder_t *decoder,         /* Decoder */
+  pb_tag_t tag,                        /* Tag of repeated message field */
+  pb_decoder_handler_f handler,        /* Handler */
+  pb_decoder_chunk_f deliver,          /* Chunk handler */
+  void *user[],                        /* User data per thread */
+  size_t threads,                      /* Thread count */
+  size_t chunk);                       /* Submessages per chunk */
+
+#endif /* PB_INCLUDE_UTIL_DECODER_H */
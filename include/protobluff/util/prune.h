@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_UTIL_PRUNE_H
+#define PB_INCLUDE_UTIL_PRUNE_H
+
+#include <stddef.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/descriptor.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_mask_field_t {
+  const pb_tag_t tag;                  /*!< Tag */
+  const struct pb_mask_t
+    *const nested;                     /*!< Mask for submessage or NULL */
+} pb_mask_field_t;
+
+typedef struct pb_mask_t {
+  struct {
+    const pb_mask_field_t
+      *const data;                     /*!< Masked fields */
+    const size_t size;                 /*!< Masked field count */
+  } field;
+} pb_mask_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+PB_EXPORT pb_error_t
+pb_prune(
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  const pb_mask_t *mask,               /* Mask */
+  const pb_buffer_t *in,               /* Input buffer */
+  pb_buffer_t *out);                   /* Output buffer */
+
+#endif /* PB_INCLUDE_UTIL_PRUNE_H */
@@ -86,3 +86,11 @@ allocator_default = {
 /*! Zero-copy fake-allocator */
 pb_allocator_t
 allocator_zero_copy = {};
+
+/*! Memory-mapped fake-allocator */
+pb_allocator_t
+allocator_mmap = {};
+
+/*! Read-only fake-allocator */
+pb_allocator_t
+allocator_read_only = {};
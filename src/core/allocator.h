@@ -37,4 +37,12 @@ allocator_default;
 extern pb_allocator_t
 allocator_zero_copy;
 
+/*! Memory-mapped fake-allocator */
+extern pb_allocator_t
+allocator_mmap;
+
+/*! Read-only fake-allocator */
+extern pb_allocator_t
+allocator_read_only;
+
 #endif /* PB_CORE_ALLOCATOR_H */
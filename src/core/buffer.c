@@ -20,10 +20,16 @@
  * IN THE SOFTWARE.
  */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <assert.h>
+#include <fcntl.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "core/allocator.h"
 #include "core/buffer.h"
@@ -121,6 +127,56 @@ pb_buffer_create_zero_copy(uint8_t data[], size_t size) {
   return pb_buffer_create_zero_copy_internal(data, size);
 }
 
+/*!
+ * Create a memory-mapped buffer from a file.
+ *
+ * The file is mapped read-only, so pages are shared with the page cache and
+ * never copied. The kernel is advised that the mapping will be read
+ * sequentially, which is the case when scanning record files.
+ *
+ * \warning Memory-mapped buffers cannot be altered at all, so growing or
+ * shrinking them as well as writing to them in place will always fail. The
+ * same holds for records and journals referring to them.
+ *
+ * \param[in] path Path
+ * \return         Buffer
+ */
+extern pb_buffer_t
+pb_buffer_create_mmap(const char *path) {
+  assert(path);
+  pb_buffer_t buffer = pb_buffer_create_invalid();
+  int fd = open(path, O_RDONLY);
+  if (unlikely_(fd == -1))
+    return buffer;
+
+  /* Determine file size, empty files cannot be mapped */
+  struct stat info;
+  if (likely_(!fstat(fd, &info))) {
+    if (info.st_size) {
+      void *data = mmap(NULL, info.st_size,
+        PROT_READ, MAP_PRIVATE, fd, 0);
+      if (likely_(data != MAP_FAILED)) {
+        posix_madvise(data, info.st_size, POSIX_MADV_SEQUENTIAL);
+        buffer = (pb_buffer_t){
+          .allocator = &allocator_mmap,
+          .data      = data,
+          .size      = info.st_size
+        };
+      }
+    } else {
+      buffer = (pb_buffer_t){
+        .allocator = &allocator_mmap,
+        .data      = NULL,
+        .size      = 0
+      };
+    }
+  }
+
+  /* The mapping stays valid after closing the file */
+  close(fd);
+  return buffer;
+}
+
 /*!
  * Destroy a buffer.
  *
@@ -129,8 +185,13 @@ pb_buffer_create_zero_copy(uint8_t data[], size_t size) {
 extern void
 pb_buffer_destroy(pb_buffer_t *buffer) {
   assert(buffer);
-  if (buffer->allocator &&
-      buffer->allocator != &allocator_zero_copy) {
+  if (buffer->allocator == &allocator_mmap) {
+    if (buffer->data) {
+      munmap(buffer->data, buffer->size);
+      buffer->data = NULL;
+    }
+    buffer->allocator = NULL;
+  } else if (buffer->allocator && !pb_buffer_zero_copy(buffer)) {
     if (buffer->data) {
       pb_allocator_free(buffer->allocator, buffer->data);
       buffer->data = NULL;
@@ -153,7 +214,7 @@ extern uint8_t *
 pb_buffer_grow(pb_buffer_t *buffer, size_t size) {
   assert(buffer && size);
   if (likely_(pb_buffer_valid(buffer))) {
-    if (unlikely_(buffer->allocator == &allocator_zero_copy))
+    if (unlikely_(pb_buffer_zero_copy(buffer)))
       return NULL;
 
     /* Grow buffer and adjust size */
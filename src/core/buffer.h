@@ -67,6 +67,33 @@ pb_buffer_create_zero_copy_internal(uint8_t data[], size_t size) {
   return buffer;
 }
 
+/*!
+ * Create a zero-copy buffer referring to a part of another buffer.
+ *
+ * If the other buffer is read-only, e.g. because it is memory-mapped, the
+ * resulting buffer is read-only as well.
+ *
+ * \param[in] buffer Buffer
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \return           Buffer
+ */
+PB_WARN_UNUSED_RESULT
+PB_INLINE pb_buffer_t
+pb_buffer_create_view_internal(
+    const pb_buffer_t *buffer, uint8_t data[], size_t size) {
+  assert(buffer);
+  pb_buffer_t view = {
+    .allocator = buffer->allocator == &allocator_mmap ||
+                 buffer->allocator == &allocator_read_only
+      ? &allocator_read_only
+      : &allocator_zero_copy,
+    .data      = data,
+    .size      = size
+  };
+  return view;
+}
+
 /*!
  * Create an invalid buffer.
  *
@@ -79,6 +106,39 @@ pb_buffer_create_invalid(void) {
   return buffer;
 }
 
+/*!
+ * Test whether a buffer is a zero-copy buffer.
+ *
+ * Zero-copy and memory-mapped buffers don't own their data, so they cannot
+ * change in size, and growing or shrinking them must fail.
+ *
+ * \param[in] buffer Buffer
+ * \return           Test result
+ */
+PB_INLINE int
+pb_buffer_zero_copy(const pb_buffer_t *buffer) {
+  assert(buffer);
+  return buffer->allocator == &allocator_zero_copy
+      || buffer->allocator == &allocator_mmap
+      || buffer->allocator == &allocator_read_only;
+}
+
+/*!
+ * Test whether a buffer is read-only.
+ *
+ * Memory-mapped buffers and buffers referring to them are mapped read-only,
+ * so they cannot be altered at all, not even in place.
+ *
+ * \param[in] buffer Buffer
+ * \return           Test result
+ */
+PB_INLINE int
+pb_buffer_read_only(const pb_buffer_t *buffer) {
+  assert(buffer);
+  return buffer->allocator == &allocator_mmap
+      || buffer->allocator == &allocator_read_only;
+}
+
 /*!
  * Retrieve the raw data of a buffer from a given offset.
  *
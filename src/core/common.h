@@ -36,4 +36,38 @@
 #define   likely_(condition) __builtin_expect((condition), 1)
 #define unlikely_(condition) __builtin_expect((condition), 0)
 
+/* ----------------------------------------------------------------------------
+ * Atomics
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Loads with acquire and stores with release semantics, so data written before
+ * publishing a pointer is visible to everyone who observes the pointer.
+ */
+#define atomic_load_(pointer) \
+  __atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+#define atomic_store_(pointer, value) \
+  __atomic_store_n((pointer), (value), __ATOMIC_RELEASE)
+
+/*
+ * Compare-and-swap, updating the expected value on failure.
+ */
+#define atomic_cas_(pointer, expected, desired) \
+  __atomic_compare_exchange_n((pointer), (expected), (desired), 0, \
+    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+/*
+ * Fetch-and-add, returning the value before the addition.
+ */
+#define atomic_add_(pointer, value) \
+  __atomic_fetch_add((pointer), (value), __ATOMIC_ACQ_REL)
+
+/*
+ * Fences ordering plain accesses against a sequence, as used by seqlocks.
+ */
+#define atomic_acquire_fence_() \
+  __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define atomic_release_fence_() \
+  __atomic_thread_fence(__ATOMIC_RELEASE)
+
 #endif /* PB_CORE_COMMON_H */
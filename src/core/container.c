@@ -0,0 +1,526 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/container.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/record.h"
+#include "core/varint.h"
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_container_key_t {
+  const pb_field_descriptor_t
+    *descriptor;                       /*!< Key field descriptor */
+  uint64_t value;                      /*!< Ordered key */
+  int present;                         /*!< Whether the key is present */
+} pb_container_key_t;
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * A container consists of a sequence of blocks, each holding a fixed number of
+ * length-delimited records, followed by the block index and the footer. Each
+ * entry of the block index holds the offset of the block and, if the container
+ * was written with a key field, the minimum and maximum key of the block. The
+ * footer is of fixed size, holding the offset of the block index, the record
+ * count, the number of records per block, the type and tag of the key field
+ * and a magic number. All values are 32- or 64-bit fixed-sized integers.
+ */
+#define CONTAINER_FOOTER 32
+#define CONTAINER_MAGIC  0x31434250
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Map a key value onto an unsigned 64-bit integer preserving its order.
+ *
+ * \param[in] type  Type
+ * \param[in] value Pointer holding value
+ * \return          Ordered key
+ */
+static uint64_t
+order(pb_type_t type, const void *value) {
+  assert(value);
+  switch (type) {
+
+    /* Signed integers are shifted into the unsigned range */
+    case PB_TYPE_INT32:
+    case PB_TYPE_SINT32:
+    case PB_TYPE_SFIXED32:
+    case PB_TYPE_ENUM:
+      return (uint64_t)(int64_t)*(const int32_t *)value ^ (1ULL << 63);
+    case PB_TYPE_INT64:
+    case PB_TYPE_SINT64:
+    case PB_TYPE_SFIXED64:
+      return (uint64_t)*(const int64_t *)value ^ (1ULL << 63);
+
+    /* Unsigned integers and booleans preserve their order */
+    case PB_TYPE_UINT32:
+    case PB_TYPE_FIXED32:
+      return *(const uint32_t *)value;
+    case PB_TYPE_UINT64:
+    case PB_TYPE_FIXED64:
+      return *(const uint64_t *)value;
+    case PB_TYPE_BOOL:
+      return *(const uint8_t *)value;
+
+    /* Negative floating point values are inverted, positive ones flagged */
+    case PB_TYPE_FLOAT: {
+      uint32_t bits;
+      memcpy(&bits, value, sizeof(uint32_t));
+      return bits & (1U << 31) ? ~bits : bits | (1U << 31);
+    }
+    case PB_TYPE_DOUBLE: {
+      uint64_t bits;
+      memcpy(&bits, value, sizeof(uint64_t));
+      return bits & (1ULL << 63) ? ~bits : bits | (1ULL << 63);
+    }
+
+    /* Keys must be scalar */
+    default:                                               /* LCOV_EXCL_LINE */
+      return 0;                                            /* LCOV_EXCL_LINE */
+  }
+}
+
+/*!
+ * Retrieve the size of a block index entry.
+ *
+ * \param[in] type Key type
+ * \return         Entry size
+ */
+static size_t
+entry_size(pb_type_t type) {
+  return type != PB_TYPE_UNDEFINED
+    ? 3 * sizeof(uint64_t)
+    : sizeof(uint64_t);
+}
+
+/*!
+ * Read a value of the block index entry of a container reader.
+ *
+ * \param[in] reader Container reader
+ * \param[in] index  Block index
+ * \param[in] value  Value of entry: 0 = offset, 1 = minimum, 2 = maximum
+ * \return           Value
+ */
+static uint64_t
+entry_value(const pb_container_reader_t *reader, size_t index, size_t value) {
+  assert(reader && index < reader->blocks);
+  uint64_t data;
+  memcpy(&data, pb_buffer_data_from(reader->buffer, reader->offset +
+    index * entry_size(reader->type) + value * sizeof(uint64_t)),
+      sizeof(uint64_t));
+  return data;
+}
+
+/*!
+ * Retrieve the end offset of a block of a container reader.
+ *
+ * \param[in] reader Container reader
+ * \param[in] index  Block index
+ * \return           End offset
+ */
+static size_t
+block_end(const pb_container_reader_t *reader, size_t index) {
+  assert(reader && index < reader->blocks);
+  return index + 1 < reader->blocks
+    ? entry_value(reader, index + 1, 0)
+    : reader->offset;
+}
+
+/*!
+ * Handler that extracts the value of the key field from a record.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       Key
+ * \return                   Error code
+ */
+static pb_error_t
+extract(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  assert(descriptor && value && user);
+  pb_container_key_t *key = user;
+  if (descriptor == key->descriptor) {
+    key->value   = order(pb_field_descriptor_type(descriptor), value);
+    key->present = 1;
+  }
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a container writer.
+ *
+ * Records are grouped into blocks of a fixed number of records, so the block
+ * holding a specific record can be determined in constant time. If a key tag
+ * is given, the minimum and maximum key of every block are recorded in the
+ * block index, so readers can skip blocks that don't match a range of keys.
+ * The key field must be a non-repeated scalar field. A key tag of zero
+ * disables the extraction of keys.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] key        Key tag
+ * \param[in] block      Records per block
+ * \return               Container writer
+ */
+extern pb_container_writer_t
+pb_container_writer_create(
+    const pb_descriptor_t *descriptor, pb_tag_t key, size_t block) {
+  assert(descriptor && block);
+  const pb_field_descriptor_t *field = NULL;
+  if (key) {
+    field = pb_descriptor_field_by_tag(descriptor, key);
+    if (unlikely_(!field ||
+        pb_field_descriptor_label(field) == PB_LABEL_REPEATED ||
+        pb_field_descriptor_type(field)  >= PB_TYPE_STRING))
+      return pb_container_writer_create_invalid();
+  }
+  pb_container_writer_t writer = {
+    .descriptor = descriptor,
+    .key        = field,
+    .block      = block,
+    .records    = 0,
+    .buffer     = pb_buffer_create_empty(),
+    .index      = pb_buffer_create_empty()
+  };
+  return writer;
+}
+
+/*!
+ * Destroy a container writer.
+ *
+ * \param[in,out] writer Container writer
+ */
+extern void
+pb_container_writer_destroy(pb_container_writer_t *writer) {
+  assert(writer);
+  pb_buffer_destroy(&(writer->index));
+  pb_buffer_destroy(&(writer->buffer));
+}
+
+/*!
+ * Write a record to a container writer.
+ *
+ * The record is appended to the current block, and the key of the record is
+ * extracted with a decoder in order to update the key range of the block. If
+ * the record doesn't contain the key field, the default value is assumed.
+ *
+ * \param[in,out] writer Container writer
+ * \param[in]     record Record
+ * \return               Error code
+ */
+extern pb_error_t
+pb_container_writer_write(
+    pb_container_writer_t *writer, const pb_buffer_t *record) {
+  assert(writer && record);
+  if (unlikely_(!pb_container_writer_valid(writer) ||
+                !pb_buffer_valid(&(writer->index)) ||
+                !pb_buffer_valid(record)))
+    return PB_ERROR_INVALID;
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Extract key from record, falling back to the default value */
+  pb_container_key_t key = { writer->key, 0, 0 };
+  if (writer->key) {
+    pb_decoder_t decoder = pb_decoder_create(writer->descriptor, record);
+    error = pb_decoder_decode(&decoder, extract, &key);
+    pb_decoder_destroy(&decoder);
+    if (unlikely_(error))
+      return error;
+    if (!key.present) {
+      const void *value = pb_field_descriptor_default(writer->key);
+      key.value = order(pb_field_descriptor_type(writer->key),
+        value ? value : &(const uint64_t){ 0 });
+    }
+  }
+
+  /* Start a new block, if the current one is full */
+  size_t size = 0;
+  if (!(writer->records % writer->block)) {
+    size = entry_size(writer->key
+      ? pb_field_descriptor_type(writer->key)
+      : PB_TYPE_UNDEFINED);
+    uint64_t entry[3] = {
+      pb_buffer_size(&(writer->buffer)), key.value, key.value
+    };
+    uint8_t *target = pb_buffer_grow(&(writer->index), size);
+    if (unlikely_(!target))
+      return PB_ERROR_ALLOC;
+    memcpy(target, entry, size);
+  }
+
+  /* Append length prefix and record */
+  uint8_t prefix[10];
+  uint32_t length = pb_buffer_size(record);
+  size_t bytes = pb_varint_pack_uint32(prefix, &length);
+  uint8_t *target = pb_buffer_grow(&(writer->buffer), bytes + length);
+  if (unlikely_(!target)) {
+    writer->index.size -= size;
+    return PB_ERROR_ALLOC;
+  }
+  memcpy(target, prefix, bytes);
+  if (length)
+    memcpy(&(target[bytes]), pb_buffer_data(record), length);
+
+  /* Update key range of current block */
+  if (writer->key) {
+    uint8_t *range = pb_buffer_data_from(&(writer->index),
+      pb_buffer_size(&(writer->index)) - 2 * sizeof(uint64_t));
+    uint64_t min, max;
+    memcpy(&min, &(range[0]), sizeof(uint64_t));
+    memcpy(&max, &(range[8]), sizeof(uint64_t));
+    if (key.value < min)
+      memcpy(&(range[0]), &(key.value), sizeof(uint64_t));
+    if (key.value > max)
+      memcpy(&(range[8]), &(key.value), sizeof(uint64_t));
+  }
+  writer->records++;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Finish a container writer by appending the block index and footer.
+ *
+ * After finishing, no more records can be written, but the buffer of the
+ * container writer can be retrieved and persisted.
+ *
+ * \param[in,out] writer Container writer
+ * \return               Error code
+ */
+extern pb_error_t
+pb_container_writer_finish(pb_container_writer_t *writer) {
+  assert(writer);
+  if (unlikely_(!pb_container_writer_valid(writer) ||
+                !pb_buffer_valid(&(writer->index))))
+    return PB_ERROR_INVALID;
+
+  /* Assemble footer */
+  uint8_t footer[CONTAINER_FOOTER];
+  uint64_t offset  = pb_buffer_size(&(writer->buffer)),
+           records = writer->records;
+  uint32_t block   = writer->block,
+           type    = writer->key ? pb_field_descriptor_type(writer->key) : 0,
+           tag     = writer->key ? pb_field_descriptor_tag(writer->key)  : 0,
+           magic   = CONTAINER_MAGIC;
+  memcpy(&(footer[ 0]), &offset,  sizeof(uint64_t));
+  memcpy(&(footer[ 8]), &records, sizeof(uint64_t));
+  memcpy(&(footer[16]), &block,   sizeof(uint32_t));
+  memcpy(&(footer[20]), &type,    sizeof(uint32_t));
+  memcpy(&(footer[24]), &tag,     sizeof(uint32_t));
+  memcpy(&(footer[28]), &magic,   sizeof(uint32_t));
+
+  /* Append block index and footer */
+  size_t size = pb_buffer_size(&(writer->index));
+  uint8_t *target = pb_buffer_grow(&(writer->buffer), size + CONTAINER_FOOTER);
+  if (unlikely_(!target))
+    return PB_ERROR_ALLOC;
+  if (size)
+    memcpy(target, pb_buffer_data(&(writer->index)), size);
+  memcpy(&(target[size]), footer, CONTAINER_FOOTER);
+
+  /* Block index is not needed anymore */
+  pb_buffer_destroy(&(writer->index));
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Create a container reader over a buffer.
+ *
+ * The footer and block index are validated, but the records are not touched
+ * until they are iterated. The buffer is usually a memory-mapped buffer.
+ *
+ * \warning A container reader does not take ownership of the provided buffer,
+ * so the caller must ensure that the buffer is not freed during operations.
+ *
+ * \param[in] buffer Buffer
+ * \return           Container reader
+ */
+extern pb_container_reader_t
+pb_container_reader_create(const pb_buffer_t *buffer) {
+  assert(buffer);
+  if (unlikely_(!pb_buffer_valid(buffer) ||
+                pb_buffer_size(buffer) < CONTAINER_FOOTER))
+    return pb_container_reader_create_invalid();
+
+  /* Read footer */
+  const uint8_t *footer = pb_buffer_data_from(buffer,
+    pb_buffer_size(buffer) - CONTAINER_FOOTER);
+  uint64_t offset, records;
+  uint32_t block, type, tag, magic;
+  memcpy(&offset,  &(footer[ 0]), sizeof(uint64_t));
+  memcpy(&records, &(footer[ 8]), sizeof(uint64_t));
+  memcpy(&block,   &(footer[16]), sizeof(uint32_t));
+  memcpy(&type,    &(footer[20]), sizeof(uint32_t));
+  memcpy(&tag,     &(footer[24]), sizeof(uint32_t));
+  memcpy(&magic,   &(footer[28]), sizeof(uint32_t));
+
+  /* Validate footer against size of block index without overflowing */
+  if (unlikely_(magic != CONTAINER_MAGIC || !block ||
+                type >= PB_TYPE_STRING ||
+                offset > pb_buffer_size(buffer) - CONTAINER_FOOTER))
+    return pb_container_reader_create_invalid();
+  uint64_t blocks = records / block + !!(records % block),
+           length = pb_buffer_size(buffer) - CONTAINER_FOOTER - offset;
+  if (unlikely_(blocks > length / entry_size(type) ||
+                blocks * entry_size(type) != length))
+    return pb_container_reader_create_invalid();
+
+  /* Create container reader */
+  pb_container_reader_t reader = {
+    .buffer  = buffer,
+    .offset  = offset,
+    .records = records,
+    .blocks  = blocks,
+    .block   = block,
+    .type    = type,
+    .tag     = tag,
+    .error   = PB_ERROR_NONE
+  };
+
+  /* Ensure block offsets are ascending and within bounds */
+  for (size_t b = 0; b < blocks; b++)
+    if (unlikely_(entry_value(&reader, b, 0) > block_end(&reader, b)))
+      return pb_container_reader_create_invalid();
+  return reader;
+}
+
+/*!
+ * Destroy a container reader.
+ *
+ * \param[in,out] reader Container reader
+ */
+extern void
+pb_container_reader_destroy(pb_container_reader_t *reader) {
+  assert(reader); /* Nothing to be done */
+}
+
+/*!
+ * Create a record iterator over a block of a container reader.
+ *
+ * \param[in] reader Container reader
+ * \param[in] index  Block index
+ * \return           Record iterator
+ */
+extern pb_record_iter_t
+pb_container_reader_block(const pb_container_reader_t *reader, size_t index) {
+  assert(reader);
+  if (unlikely_(!pb_container_reader_valid(reader) ||
+                index >= reader->blocks))
+    return pb_record_iter_create_invalid();
+  return pb_record_iter_create_range(reader->buffer,
+    entry_value(reader, index, 0), block_end(reader, index));
+}
+
+/*!
+ * Create a record iterator positioned on a given record of a container reader.
+ *
+ * The block holding the record is looked up directly, so at most one block
+ * worth of length prefixes must be skipped. The record iterator continues
+ * into the subsequent blocks until the last record is reached.
+ *
+ * \param[in] reader Container reader
+ * \param[in] record Record number
+ * \return           Record iterator
+ */
+extern pb_record_iter_t
+pb_container_reader_seek(const pb_container_reader_t *reader, size_t record) {
+  assert(reader);
+  if (unlikely_(!pb_container_reader_valid(reader) ||
+                record >= reader->records))
+    return pb_record_iter_create_invalid();
+
+  /* Move to block and skip preceding records */
+  pb_record_iter_t iter = pb_record_iter_create_range(reader->buffer,
+    entry_value(reader, record / reader->block, 0), reader->offset);
+  for (size_t r = record % reader->block; r; r--)
+    if (unlikely_(!pb_record_iter_next(&iter)))
+      break;
+  return iter;
+}
+
+/*!
+ * Test whether a block of a container reader may hold keys within a range.
+ *
+ * If the container was written without a key field, every block matches.
+ *
+ * \warning The caller has to ensure that the space pointed to by the minimum
+ * and maximum key pointers is appropriately sized for the type of key.
+ *
+ * \param[in] reader Container reader
+ * \param[in] index  Block index
+ * \param[in] min    Pointer holding minimum key
+ * \param[in] max    Pointer holding maximum key
+ * \return           Test result
+ */
+extern int
+pb_container_reader_match(
+    const pb_container_reader_t *reader, size_t index,
+    const void *min, const void *max) {
+  assert(reader && min && max);
+  if (unlikely_(!pb_container_reader_valid(reader) ||
+                index >= reader->blocks))
+    return 0;
+  if (reader->type == PB_TYPE_UNDEFINED)
+    return 1;
+  return entry_value(reader, index, 1) <= order(reader->type, max)
+      && entry_value(reader, index, 2) >= order(reader->type, min);
+}
+
+/*!
+ * Find the next block of a container reader that may hold keys within a range.
+ *
+ * \param[in] reader Container reader
+ * \param[in] index  Block index to start from
+ * \param[in] min    Pointer holding minimum key
+ * \param[in] max    Pointer holding maximum key
+ * \return           Block index or block count if no block matches
+ */
+extern size_t
+pb_container_reader_find(
+    const pb_container_reader_t *reader, size_t index,
+    const void *min, const void *max) {
+  assert(reader && min && max);
+  while (index < reader->blocks &&
+         !pb_container_reader_match(reader, index, min, max))
+    index++;
+  return index < reader->blocks
+    ? index
+    : reader->blocks;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_CORE_CONTAINER_H
+#define PB_CORE_CONTAINER_H
+
+#include <protobluff/core/container.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create an invalid container writer.
+ *
+ * \return Container writer
+ */
+PB_WARN_UNUSED_RESULT
+PB_INLINE pb_container_writer_t
+pb_container_writer_create_invalid(void) {
+  pb_container_writer_t writer = {
+    .descriptor = NULL,
+    .key        = NULL,
+    .block      = 0,
+    .records    = 0,
+    .buffer     = pb_buffer_create_invalid(),
+    .index      = pb_buffer_create_invalid()
+  };
+  return writer;
+}
+
+/*!
+ * Create an invalid container reader.
+ *
+ * \return Container reader
+ */
+PB_WARN_UNUSED_RESULT
+PB_INLINE pb_container_reader_t
+pb_container_reader_create_invalid(void) {
+  pb_container_reader_t reader = {
+    .buffer  = NULL,
+    .offset  = 0,
+    .records = 0,
+    .blocks  = 0,
+    .block   = 0,
+    .type    = PB_TYPE_UNDEFINED,
+    .tag     = 0,
+    .error   = PB_ERROR_INVALID
+  };
+  return reader;
+}
+
+#endif /* PB_CORE_CONTAINER_H */
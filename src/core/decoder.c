@@ -30,8 +30,122 @@
 #include "core/common.h"
 #include "core/decoder.h"
 #include "core/descriptor.h"
+#include "core/iovec.h"
 #include "core/stream.h"
 
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Decode a nested message and pass a decoder for it to the handler.
+ *
+ * Nested messages which are contiguous are decoded in place. For segmented
+ * buffers, nested messages straddling segments are decoded from a range of
+ * the segmented buffer, so they are never copied.
+ *
+ * \param[in]     decoder    Decoder
+ * \param[in,out] stream     Stream
+ * \param[in]     read[]     Jump table for reads
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     handler    Handler
+ * \param[in,out] user       User data
+ * \return                   Error code
+ */
+static pb_error_t
+decode_nested(
+    const pb_decoder_t *decoder, pb_stream_t *stream,
+    const pb_stream_read_f read[], const pb_field_descriptor_t *descriptor,
+    pb_decoder_handler_f handler, void *user) {
+  assert(decoder && stream && read && descriptor && handler);
+  uint32_t length; pb_error_t error;
+  if (unlikely_(error = read[PB_TYPE_UINT32](stream, PB_TYPE_UINT32, &length)))
+    return error;
+  if (unlikely_(pb_stream_left(stream) < length))
+    return PB_ERROR_OFFSET;
+
+  /* Create decoder for contiguous nested message and invoke handler */
+  const uint8_t *data = decoder->iovec
+    ? pb_stream_data_iovec(stream, length)
+    : pb_stream_data(stream, length);
+  if (likely_(data != NULL)) {
+    pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+      (uint8_t *)data, length);
+    pb_decoder_t subdecoder = pb_decoder_create(
+      pb_field_descriptor_nested(descriptor), &buffer);
+    pb_decoder_set_flags(&subdecoder, decoder->flags);
+    error = handler(descriptor, &subdecoder, user);
+
+    /* Free all allocated memory */
+    pb_decoder_destroy(&subdecoder);
+    pb_buffer_destroy(&buffer);
+
+  /* Create decoder for range of segmented buffer and invoke handler */
+  } else {
+    assert(decoder->iovec);
+    pb_iovec_t iovec = pb_iovec_create_range(
+      decoder->iovec, pb_stream_offset(stream), length);
+    if (likely_(pb_iovec_valid(&iovec))) {
+      pb_decoder_t subdecoder = pb_decoder_create_from_iovec(
+        pb_field_descriptor_nested(descriptor), &iovec);
+      pb_decoder_set_flags(&subdecoder, decoder->flags);
+      error = handler(descriptor, &subdecoder, user);
+
+      /* Free all allocated memory */
+      pb_decoder_destroy(&subdecoder);
+      pb_iovec_destroy(&iovec);
+    } else {
+      error = PB_ERROR_ALLOC;                              /* LCOV_EXCL_LINE */
+    }
+  }
+  return likely_(!error)
+    ? pb_stream_advance(stream, length)
+    : error;
+}
+
+/*!
+ * Check whether a decoded value is a known value of the field's enum.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] value      Pointer holding value
+ * \return               Error code
+ */
+static pb_error_t
+check_enum(const pb_field_descriptor_t *descriptor, const void *value) {
+  assert(descriptor && value);
+  return pb_enum_descriptor_value_by_number(
+    pb_field_descriptor_enum(descriptor), *(const pb_enum_t *)value)
+      ? PB_ERROR_NONE
+      : PB_ERROR_INVALID;
+}
+
+/*!
+ * Check whether all required fields of a descriptor have been seen.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] seen[]     Bitmap of occurred fields
+ * \return               Error code
+ */
+static pb_error_t
+check_required(const pb_descriptor_t *descriptor, const uint64_t seen[]) {
+  assert(descriptor && seen);
+  const size_t size = (pb_descriptor_size(descriptor) + 63) / 64;
+
+  /* Retrieve bitmask of required fields, or compute it on the fly */
+  const uint64_t *mask = pb_descriptor_required(descriptor);
+  if (unlikely_(!mask)) {
+    uint64_t *temp = alloca(size * sizeof(uint64_t));
+    pb_descriptor_required_init(descriptor, temp);
+    mask = temp;
+  }
+
+  /* Compare occurrences against required fields */
+  for (size_t w = 0; w < size; ++w)
+    if ((seen[w] & mask[w]) != mask[w])
+      return PB_ERROR_ABSENT;
+  return PB_ERROR_NONE;
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -52,7 +166,32 @@ pb_decoder_create(
   assert(descriptor && buffer);
   pb_decoder_t decoder = {
     .descriptor = descriptor,
-    .buffer     = buffer
+    .buffer     = buffer,
+    .iovec      = NULL,
+    .flags      = 0
+  };
+  return decoder;
+}
+
+/*!
+ * Create a decoder over a segmented buffer.
+ *
+ * \warning A decoder does not take ownership of the provided segmented
+ * buffer, so the caller must ensure that it is not freed during operations.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] iovec      Segmented buffer
+ * \return               Decoder
+ */
+extern pb_decoder_t
+pb_decoder_create_from_iovec(
+    const pb_descriptor_t *descriptor, const pb_iovec_t *iovec) {
+  assert(descriptor && iovec);
+  pb_decoder_t decoder = {
+    .descriptor = descriptor,
+    .buffer     = NULL,
+    .iovec      = iovec,
+    .flags      = 0
   };
   return decoder;
 }
@@ -70,7 +209,13 @@ pb_decoder_destroy(pb_decoder_t *decoder) {
 /*!
  * Decode a buffer using a handler.
  *
- * The decoder
+ * If the decoder is flagged to validate, the occurrences of fields are
+ * recorded in a bitmap while decoding, which is compared against the bitmask
+ * of required fields in the end. Furthermore, fields must be encoded with the
+ * wiretype of their type (or in packed encoding), and packed fields must end
+ * exactly at their length. If the decoder is flagged to validate enums, every
+ * enum value must be defined by the field's enum descriptor. Flags are passed
+ * on to nested decoders, so validation happens in the same pass.
  *
  * \param[in]     decoder Decoder
  * \param[in]     handler Handler
@@ -85,25 +230,58 @@ pb_decoder_decode(
     return PB_ERROR_INVALID;
   pb_error_t error = PB_ERROR_NONE;
 
+  /* Initialize occurrence bitmap, if validating */
+  const pb_descriptor_t *base = decoder->descriptor;
+  const int validate = decoder->flags & PB_DECODER_VALIDATE;
+  uint64_t *seen = NULL;
+  if (unlikely_(validate && !pb_descriptor_empty(base))) {
+    const size_t size = (pb_descriptor_size(base) + 63) / 64;
+    seen = memset(alloca(size * sizeof(uint64_t)), 0,
+      size * sizeof(uint64_t));
+  }
+
+  /* Select jump tables once, so reads don't check for segmented buffers */
+  pb_stream_iovec_t state;
+  if (unlikely_(decoder->iovec != NULL))
+    state = pb_stream_iovec_create(decoder->iovec);
+  pb_stream_t stream = decoder->iovec
+    ? pb_stream_create_from_iovec(&state)
+    : pb_stream_create(decoder->buffer);
+  const pb_stream_read_f *read = decoder->iovec
+    ? pb_stream_read_iovec_jump
+    : pb_stream_read_jump;
+  const pb_stream_skip_f *skip = decoder->iovec
+    ? pb_stream_skip_iovec_jump
+    : pb_stream_skip_jump;
+
   /* Iterate tag-value pairs */
-  pb_stream_t stream = pb_stream_create(decoder->buffer);
   while (!error && pb_stream_left(&stream)) {
     pb_tag_t tag;
-    if (unlikely_(error = pb_stream_read(&stream, PB_TYPE_UINT32, &tag)))
+    if (unlikely_(error = read[PB_TYPE_UINT32](&stream, PB_TYPE_UINT32, &tag)))
       break;
 
     /* Extract wiretype and tag */
     pb_wiretype_t wiretype = tag & 7;
     tag >>= 3;
 
-    /* Check descriptor and skip field if unknown */
+    /* Check descriptor and skip field if unknown and wiretype is valid */
     const pb_field_descriptor_t *descriptor =
       pb_descriptor_field_by_tag(decoder->descriptor, tag);
     if (unlikely_(!descriptor)) {
-      error = pb_stream_skip(&stream, wiretype);
+      error = unlikely_(wiretype > PB_WIRETYPE_32BIT || !skip[wiretype])
+        ? PB_ERROR_INVALID
+        : skip[wiretype](&stream);
       continue;
     }
 
+    /* Record field occurrence, if validating */
+    if (unlikely_(seen != NULL)) {
+      size_t f = ((uintptr_t)descriptor - (uintptr_t)base->field.data)
+               / sizeof(pb_field_descriptor_t);
+      if (f < base->field.size && &(base->field.data[f]) == descriptor)
+        seen[f >> 6] |= UINT64_C(1) << (f & 63);
+    }
+
     /* Allocate temporary space for type-agnostic decoding */
     size_t item = pb_field_descriptor_type_size(descriptor);
     void *value = alloca(item);
@@ -113,42 +291,53 @@ pb_decoder_decode(
     if (wiretype != pb_field_descriptor_wiretype(descriptor) &&
         wiretype == PB_WIRETYPE_LENGTH) {
       uint32_t length;
-      if (unlikely_(error = pb_stream_read(&stream, PB_TYPE_UINT32, &length)))
+      if (unlikely_(error =
+          read[PB_TYPE_UINT32](&stream, PB_TYPE_UINT32, &length)))
         break;
 
       /* Ensure we're within the stream's boundaries */
       size_t offset = pb_stream_offset(&stream);
-      if (pb_stream_offset(&stream) + length > pb_buffer_size(decoder->buffer))
+      if (pb_stream_offset(&stream) + length > pb_stream_size(&stream))
         error = PB_ERROR_OFFSET;
 
       /* Iterate values of packed field */
       while (!error && pb_stream_offset(&stream) < offset + length)
-        if (likely_(!(error = pb_stream_read(&stream, type, value))))
-          error = handler(descriptor, value, user);
+        if (likely_(!(error = read[type](&stream, type, value))))
+          error = unlikely_(decoder->flags & PB_DECODER_VALIDATE_ENUM &&
+              type == PB_TYPE_ENUM && check_enum(descriptor, value))
+            ? PB_ERROR_INVALID
+            : handler(descriptor, value, user);
 
-    /* Read value of given type from stream */
+      /* Packed fields must end exactly at their length, if validating */
+      if (unlikely_(!error && validate &&
+          pb_stream_offset(&stream) != offset + length))
+        error = PB_ERROR_OFFSET;
+
+    /* Fields must be encoded with the wiretype of their type */
+    } else if (unlikely_(validate &&
+        wiretype != pb_field_descriptor_wiretype(descriptor))) {
+      error = PB_ERROR_INVALID;
+
+    /* Decode nested message */
+    } else if (type == PB_TYPE_MESSAGE) {
+      error = decode_nested(decoder, &stream, read, descriptor, handler, user);
+
+    /* Read value of given type from stream and invoke handler */
     } else {
-      if (unlikely_(error = pb_stream_read(&stream, type, value)))
+      if (unlikely_(error = read[type](&stream, type, value)))
         break;
-
-      /* Invoke handler */
-      if (pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE) {
-        pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
-          pb_string_data(value), pb_string_size(value));
-
-        /* Create decoder for nested message and invoke handler */
-        pb_decoder_t subdecoder = pb_decoder_create(
-          pb_field_descriptor_nested(descriptor), &buffer);
-        error = handler(descriptor, &subdecoder, user);
-
-        /* Free all allocated memory */
-        pb_decoder_destroy(&subdecoder);
-        pb_buffer_destroy(&buffer);
-      } else {
-        error = handler(descriptor, value, user);
-      }
+      error = unlikely_(decoder->flags & PB_DECODER_VALIDATE_ENUM &&
+          type == PB_TYPE_ENUM && check_enum(descriptor, value))
+        ? PB_ERROR_INVALID
+        : handler(descriptor, value, user);
     }
   }
   pb_stream_destroy(&stream);
+  if (unlikely_(decoder->iovec != NULL))
+    pb_stream_iovec_destroy(&state);
+
+  /* Check for absent required fields, if validating */
+  if (unlikely_(!error && seen))
+    error = check_required(base, seen);
   return error;
 }
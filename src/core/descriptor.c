@@ -23,7 +23,11 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <protobluff/core/allocator.h>
+
+#include "core/allocator.h"
 #include "core/common.h"
 #include "core/descriptor.h"
 
@@ -41,6 +45,35 @@
 #define min(x, y) \
   ((x) < (y) ? (x) : (y))
 
+/*!
+ * Compare two values, yielding -1, 0 or 1.
+ *
+ * \param[in] x Value to compare
+ * \param[in] y Value to compare
+ * \return      Comparison result
+ */
+#define order(x, y) \
+  (((x) > (y)) - ((x) < (y)))
+
+/*!
+ * Number of lazily built structures that can be cached.
+ */
+#define CACHE_SIZE 1024
+
+/*!
+ * Number of entries probed before a cache lookup is given up.
+ */
+#define CACHE_PROBE 16
+
+/*!
+ * Compute the number of 64-bit words needed for a bitmap of a descriptor.
+ *
+ * \param[in] descriptor Descriptor
+ * \return               Word count
+ */
+#define words(descriptor) \
+  ((pb_descriptor_size(descriptor) + 63) / 64)
+
 /* ----------------------------------------------------------------------------
  * Mappings
  * ------------------------------------------------------------------------- */
@@ -89,6 +122,126 @@ pb_field_descriptor_wiretype_map[] = {
   [PB_TYPE_MESSAGE]  = PB_WIRETYPE_LENGTH
 };
 
+/* ----------------------------------------------------------------------------
+ * Variables
+ * ------------------------------------------------------------------------- */
+
+/*! Lazily built structures by descriptor and constructor */
+static struct {
+  const void *descriptor;              /*!< Descriptor or enum descriptor */
+  pb_descriptor_cache_f create;        /*!< Constructor */
+  const void *value;                   /*!< Structure */
+} cache[CACHE_SIZE];
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the field descriptor for a given tag from a descriptor's own fields.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] tag        Tag
+ * \return               Field descriptor
+ */
+static const pb_field_descriptor_t *
+field_by_tag(const pb_descriptor_t *descriptor, pb_tag_t tag) {
+  assert(descriptor && tag);
+  for (size_t f = min(tag, descriptor->field.size); f > 0; ) {
+    if (pb_field_descriptor_tag(
+        &(descriptor->field.data[--f])) == tag) {
+      return &(descriptor->field.data[f]);
+    } else if (pb_field_descriptor_tag(
+        &(descriptor->field.data[f])) < tag) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * Retrieve the field descriptor for a given tag from a merged table.
+ *
+ * \param[in] table Merged field descriptors
+ * \param[in] tag   Tag
+ * \return          Field descriptor
+ */
+static const pb_field_descriptor_t *
+table_field_by_tag(const pb_descriptor_table_t *table, pb_tag_t tag) {
+  assert(table && tag);
+  size_t l = 0, r = table->size;
+  while (l < r) {
+    size_t m = l + (r - l) / 2;
+    if (pb_field_descriptor_tag(table->data[m]) < tag) {
+      l = m + 1;
+    } else {
+      r = m;
+    }
+  }
+  return l < table->size && pb_field_descriptor_tag(table->data[l]) == tag
+    ? table->data[l]
+    : NULL;
+}
+
+/*!
+ * Merge the fields of a descriptor and all of its extensions into a table.
+ *
+ * The fields are sorted by tag with a stable insertion sort, so that a field
+ * of the descriptor takes precedence over an extension field with the same
+ * tag, as well as earlier over later extensions, and duplicates are dropped.
+ * This only happens at registration time, so it is not worth optimizing.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] previous   Superseded table
+ * \return               Merged field descriptors
+ */
+static pb_descriptor_table_t *
+table_create(
+    const pb_descriptor_t *descriptor,
+    const pb_descriptor_table_t *previous) {
+  assert(descriptor);
+
+  /* Determine the number of fields and the last extension to be merged */
+  const pb_descriptor_t *last = descriptor;
+  size_t size = descriptor->field.size;
+  for (const pb_descriptor_t *extension = atomic_load_(&(last->extension));
+      extension; extension = atomic_load_(&(last->extension))) {
+    size += extension->field.size;
+    last  = extension;
+  }
+
+  /* Allocate table */
+  pb_descriptor_table_t *table = pb_allocator_allocate(&allocator_default,
+    sizeof(pb_descriptor_table_t) + size * sizeof(pb_field_descriptor_t *));
+  if (unlikely_(!table))
+    return NULL;                                           /* LCOV_EXCL_LINE */
+
+  /* Insert fields of the descriptor and extensions, ordered by tag */
+  table->previous = previous;
+  table->last     = last;
+  table->size     = 0;
+  for (const pb_descriptor_t *current = descriptor;;
+      current = current->extension) {
+    for (size_t f = 0; f < current->field.size; ++f) {
+      const pb_field_descriptor_t *field = &(current->field.data[f]);
+      pb_tag_t tag = pb_field_descriptor_tag(field);
+
+      /* Find insertion point and skip duplicates */
+      size_t p = table->size;
+      while (p > 0 && pb_field_descriptor_tag(table->data[p - 1]) > tag)
+        p--;
+      if (p > 0 && pb_field_descriptor_tag(table->data[p - 1]) == tag)
+        continue;
+      memmove(&(table->data[p + 1]), &(table->data[p]),
+        (table->size++ - p) * sizeof(pb_field_descriptor_t *));
+      table->data[p] = field;
+    }
+    if (current == last)
+      break;
+  }
+  return table;
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -107,6 +260,12 @@ pb_field_descriptor_wiretype_map[] = {
  * -# The tag number found at the array index is larger than the tag number
  *    we're looking for. In this case, we can abort the search.
  *
+ * If the descriptor was extended, the lookup falls back to a binary search on
+ * the merged field descriptors, which are published atomically, so readers
+ * never need to take a lock or walk the extension chain. Only extensions that
+ * are not yet covered by the merged table, which may only happen during their
+ * registration or if the table could not be allocated, are checked one by one.
+ *
  * \warning The fields actually need to be in ascending order, so you better
  * ensure that or be pleasantly surprised by undefined behaviour.
  *
@@ -118,18 +277,23 @@ extern const pb_field_descriptor_t *
 pb_descriptor_field_by_tag(
     const pb_descriptor_t *descriptor, pb_tag_t tag) {
   assert(descriptor && tag);
-  for (size_t f = min(tag, descriptor->field.size); f > 0; ) {
-    if (pb_field_descriptor_tag(
-        &(descriptor->field.data[--f])) == tag) {
-      return &(descriptor->field.data[f]);
-    } else if (pb_field_descriptor_tag(
-        &(descriptor->field.data[f])) < tag) {
-      break;
-    }
+  const pb_field_descriptor_t *field = field_by_tag(descriptor, tag);
+  if (likely_(field || !atomic_load_(&(descriptor->extension))))
+    return field;
+
+  /* Search merged field descriptors */
+  const pb_descriptor_table_t *table = atomic_load_(&(descriptor->table));
+  const pb_descriptor_t *extension = descriptor;
+  if (table) {
+    if ((field = table_field_by_tag(table, tag)))
+      return field;
+    extension = table->last;
   }
-  return pb_descriptor_extension(descriptor) ?
-    pb_descriptor_field_by_tag(
-      pb_descriptor_extension(descriptor), tag) : NULL;
+
+  /* Search extensions not covered by the merged field descriptors */
+  while (!field && (extension = atomic_load_(&(extension->extension))))
+    field = field_by_tag(extension, tag);
+  return field;
 }
 
 /*!
@@ -140,6 +304,11 @@ pb_descriptor_field_by_tag(
  * Before registering an extension, it is checked that the extension is not
  * already registered.
  *
+ * After registration, the fields of the descriptor and all of its extensions
+ * are merged into an immutable table ordered by tag, which is published with
+ * a compare-and-swap in RCU-style. Superseded tables are retained, as readers
+ * may still hold them, which is bounded by the number of registrations.
+ *
  * \param[in,out] descriptor Descriptor
  * \param[in,out] extension  Descriptor extension
  */
@@ -147,12 +316,196 @@ extern void
 pb_descriptor_extend(
     pb_descriptor_t *descriptor, pb_descriptor_t *extension) {
   assert(descriptor && extension);
-  while (descriptor->extension) {
-    if (descriptor->extension == extension)
+
+  /* Append extension to the chain, unless already registered */
+  pb_descriptor_t *current = descriptor, *next = NULL;
+  while (!atomic_cas_(&(current->extension), &next, extension)) {
+    if (next == extension)
+      return;
+    current = next;
+    next    = NULL;
+  }
+
+  /* Merge field descriptors and publish the table */
+  const pb_descriptor_table_t *table = atomic_load_(&(descriptor->table));
+  do {
+    pb_descriptor_table_t *merged = table_create(descriptor, table);
+    if (unlikely_(!merged))
+      return;                                              /* LCOV_EXCL_LINE */
+    if (atomic_cas_(&(descriptor->table), &table, merged))
       return;
-    descriptor = descriptor->extension;
+    pb_allocator_free(&allocator_default, merged);
+  } while (1);
+}
+
+/*!
+ * Initialize the bitmask of required fields of a descriptor.
+ *
+ * Bits are indexed by the position of the field descriptor within the
+ * descriptor, so the bitmask spans one bit per field, rounded up to words.
+ *
+ * \param[in]  descriptor Descriptor
+ * \param[out] mask[]     Bitmask of required fields
+ */
+extern void
+pb_descriptor_required_init(
+    const pb_descriptor_t *descriptor, uint64_t mask[]) {
+  assert(descriptor && mask);
+  memset(mask, 0, words(descriptor) * sizeof(uint64_t));
+  for (size_t f = 0; f < descriptor->field.size; ++f)
+    if (pb_field_descriptor_label(
+        &(descriptor->field.data[f])) == PB_LABEL_REQUIRED)
+      mask[f >> 6] |= UINT64_C(1) << (f & 63);
+}
+
+/*!
+ * Retrieve the bitmask of required fields of a descriptor.
+ *
+ * The bitmask is built once per descriptor upon first use and published on
+ * the descriptor with a compare-and-swap, like the merged field descriptors,
+ * so lookups never take a lock. If it could not be allocated, NULL is returned
+ * and the caller should fall back to pb_descriptor_required_init().
+ *
+ * \param[in] descriptor Descriptor
+ * \return               Bitmask of required fields
+ */
+extern const uint64_t *
+pb_descriptor_required(const pb_descriptor_t *descriptor) {
+  assert(descriptor && !pb_descriptor_empty(descriptor));
+  const uint64_t **required = &(((pb_descriptor_t *)descriptor)->required);
+  const uint64_t *mask = atomic_load_(required);
+  if (likely_(mask != NULL))
+    return mask;
+
+  /* Build bitmask and publish it, unless another thread was faster */
+  uint64_t *created = pb_allocator_allocate(&allocator_default,
+    words(descriptor) * sizeof(uint64_t));
+  if (unlikely_(!created))
+    return NULL;                                           /* LCOV_EXCL_LINE */
+  pb_descriptor_required_init(descriptor, created);
+  if (atomic_cas_(required, &mask, created))
+    return created;
+  pb_allocator_free(&allocator_default, created);          /* LCOV_EXCL_LINE */
+  return mask;                                             /* LCOV_EXCL_LINE */
+}
+
+/*!
+ * Retrieve a lazily built structure for a descriptor.
+ *
+ * Structures derived from descriptors, e.g. name tables, are kept in a
+ * fixed-size, open-addressed cache, keyed by descriptor and constructor, as
+ * enum descriptors reside in read-only memory. An entry is claimed with a
+ * compare-and-swap, after which the structure is built and published, so
+ * lookups never take a lock. Structures are never freed.
+ *
+ * Probing is bounded, so a lookup inspects at most a few entries, even if the
+ * cache is full. If the structure is still being built by another thread,
+ * could not be built or no entry is left in reach, NULL is returned and the
+ * caller must fall back to computing the information on the fly.
+ *
+ * \param[in] descriptor Descriptor or enum descriptor
+ * \param[in] create     Constructor
+ * \return               Structure
+ */
+extern const void *
+pb_descriptor_cache(const void *descriptor, pb_descriptor_cache_f create) {
+  assert(descriptor && create);
+  size_t c = ((uintptr_t)descriptor >> 4) & (CACHE_SIZE - 1);
+  for (size_t probe = 0; probe < CACHE_PROBE; ++probe) {
+    const void *current = atomic_load_(&(cache[c].descriptor));
+
+    /* Claim empty entry and publish structure */
+    if (!current && atomic_cas_(&(cache[c].descriptor), &current, descriptor)) {
+      atomic_store_(&(cache[c].create), create);
+      const void *value = create(descriptor);
+      if (value)
+        atomic_store_(&(cache[c].value), value);
+      return value;
+    }
+
+    /* Return structure if built by the given constructor */
+    if (current == descriptor) {
+      pb_descriptor_cache_f other = atomic_load_(&(cache[c].create));
+      if (!other)
+        return NULL;
+      if (other == create)
+        return atomic_load_(&(cache[c].value));
+    }
+    c = (c + 1) & (CACHE_SIZE - 1);
+  }
+  return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Compare two values of the type of a field descriptor.
+ *
+ * Scalar values are ordered numerically, strings and bytes lexicographically.
+ * Scalar values need not be aligned, so packed fixed-sized values may be
+ * compared directly on the wire, given a little-endian host.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] x          Pointer holding value
+ * \param[in] y          Pointer holding value
+ * \return               Comparison result
+ */
+extern int
+pb_field_descriptor_compare(
+    const pb_field_descriptor_t *descriptor, const void *x, const void *y) {
+  assert(descriptor && x && y);
+  union {
+    int32_t  int32;
+    int64_t  int64;
+    uint32_t uint32;
+    uint64_t uint64;
+    uint8_t  boolean;
+    float    float32;
+    double   float64;
+  } a, b;
+
+  /* Compare strings and bytes lexicographically */
+  pb_type_t type = pb_field_descriptor_type(descriptor);
+  if (type == PB_TYPE_STRING || type == PB_TYPE_BYTES) {
+    size_t size = min(pb_string_size(x), pb_string_size(y));
+    int result = size
+      ? memcmp(pb_string_data(x), pb_string_data(y), size)
+      : 0;
+    return result
+      ? order(result, 0)
+      : order(pb_string_size(x), pb_string_size(y));
+  }
+
+  /* Copy values, as they may not be aligned */
+  memcpy(&a, x, pb_field_descriptor_type_size(descriptor));
+  memcpy(&b, y, pb_field_descriptor_type_size(descriptor));
+
+  /* Compare values according to type */
+  switch (type) {
+    case PB_TYPE_INT32:
+    case PB_TYPE_SINT32:
+    case PB_TYPE_SFIXED32:
+    case PB_TYPE_ENUM:
+      return order(a.int32, b.int32);
+    case PB_TYPE_INT64:
+    case PB_TYPE_SINT64:
+    case PB_TYPE_SFIXED64:
+      return order(a.int64, b.int64);
+    case PB_TYPE_UINT32:
+    case PB_TYPE_FIXED32:
+      return order(a.uint32, b.uint32);
+    case PB_TYPE_UINT64:
+    case PB_TYPE_FIXED64:
+      return order(a.uint64, b.uint64);
+    case PB_TYPE_BOOL:
+      return order(a.boolean, b.boolean);
+    case PB_TYPE_FLOAT:
+      return order(a.float32, b.float32);
+    case PB_TYPE_DOUBLE:
+      return order(a.float64, b.float64);
+    default:
+      return 0;
   }
-  descriptor->extension = extension;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -24,27 +24,84 @@
 #define PB_CORE_DESCRIPTOR_H
 
 #include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
 
+#include <protobluff/core/allocator.h>
 #include <protobluff/core/descriptor.h>
 
+#include "core/allocator.h"
 #include "core/common.h"
 
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_descriptor_table_t {
+  const struct pb_descriptor_table_t
+    *previous;                         /*!< Superseded table */
+  const pb_descriptor_t *last;         /*!< Last merged extension */
+  size_t size;                         /*!< Field descriptor count */
+  const pb_field_descriptor_t
+    *data[];                           /*!< Field descriptors by tag */
+} pb_descriptor_table_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef const void *
+(*pb_descriptor_cache_f)(
+  const void *descriptor);             /* Descriptor or enum descriptor */
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
 
+extern void
+pb_descriptor_required_init(
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  uint64_t mask[]);                    /* Bitmask of required fields */
+
+extern const uint64_t *
+pb_descriptor_required(
+  const pb_descriptor_t *descriptor);  /* Descriptor */
+
+extern const void *
+pb_descriptor_cache(
+  const void *descriptor,              /* Descriptor or enum descriptor */
+  pb_descriptor_cache_f create);       /* Constructor */
+
+/* ------------------------------------------------------------------------- */
+
+extern int
+pb_field_descriptor_compare(
+  const pb_field_descriptor_t *descriptor, /* Field descriptor */
+  const void *x,                       /* Pointer holding value */
+  const void *y);                      /* Pointer holding value */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
 /*!
- * Reset a descriptor's extension.
+ * Reset a descriptor's extension and merged field descriptors.
  *
  * This function is defined as an inline function, as it is only needed for
- * testing purposes and doesn't need to be exported.
+ * testing purposes and doesn't need to be exported. It must not be called
+ * while the descriptor is concurrently in use.
  *
  * \param[in,out] descriptor Descriptor
  */
 PB_INLINE void
 pb_descriptor_reset(pb_descriptor_t *descriptor) {
   assert(descriptor);
+  const pb_descriptor_table_t *table = descriptor->table;
+  while (table) {
+    const pb_descriptor_table_t *previous = table->previous;
+    pb_allocator_free(&allocator_default, (void *)table);
+    table = previous;
+  }
   descriptor->extension = NULL;
+  descriptor->table     = NULL;
 }
 
 #endif /* PB_CORE_DESCRIPTOR_H */
@@ -254,20 +254,114 @@ encode_packed(
   return PB_ERROR_ALLOC;
 }
 
+/*!
+ * Append a reference to a string to an encoder.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in]     offset  Offset in buffer
+ * \param[in]     data[]  Referenced data
+ * \param[in]     size    Referenced data size
+ * \return                Error code
+ */
+static pb_error_t
+reference(
+    pb_encoder_t *encoder, size_t offset, const uint8_t data[], size_t size) {
+  assert(encoder && data && size);
+  pb_encoder_reference_t *reference = (pb_encoder_reference_t *)
+    pb_buffer_grow(&(encoder->references), sizeof(pb_encoder_reference_t));
+  if (unlikely_(!reference))
+    return PB_ERROR_ALLOC;
+  reference->offset = offset;
+  reference->data   = data;
+  reference->size   = size;
+  encoder->referenced += size;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Encode a length-prefixed value by reference.
+ *
+ * Strings are referenced in place. Nested messages which contain references
+ * are spliced into encoders in scatter-gather mode, taking over references,
+ * and flattened into all other encoders.
+ *
+ * \param[in,out] encoder    Encoder
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \return                   Error code
+ */
+static pb_error_t
+encode_reference(
+    pb_encoder_t *encoder, const pb_field_descriptor_t *descriptor,
+    const void *value) {
+  assert(encoder && descriptor && value);
+  pb_buffer_t *buffer = &(encoder->buffer);
+
+  /* Encode length prefix */
+  const pb_encoder_t *subencoder = NULL; uint32_t length;
+  if (pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE) {
+    subencoder = value;
+    length = pb_encoder_size(subencoder);
+  } else {
+    length = pb_string_size(value);
+  }
+  uint8_t *data = pb_buffer_grow(buffer, pb_varint_size_uint32(&length));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  pb_varint_pack_uint32(data, &length);
+
+  /* Reference string in place */
+  if (!subencoder)
+    return reference(encoder,
+      pb_buffer_size(buffer), pb_string_data(value), length);
+
+  /* Copy buffer of nested message and splice or flatten references */
+  const pb_buffer_t *subbuffer = pb_encoder_buffer(subencoder);
+  const pb_encoder_reference_t *references =
+    pb_encoder_references(subencoder);
+  size_t offset = pb_buffer_size(buffer), start = 0;
+  if (unlikely_(!(data = pb_buffer_grow(buffer, encoder->threshold
+      ? pb_buffer_size(subbuffer)
+      : length))))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  for (size_t r = 0; r < pb_encoder_references_count(subencoder); r++) {
+    size_t end = references[r].offset;
+    memcpy(data, pb_buffer_data_from(subbuffer, start), end - start);
+    data += end - start;
+
+    /* Splice reference, adjusted to the offset of the nested message */
+    if (encoder->threshold) {
+      pb_error_t error = reference(encoder, offset + end,
+        references[r].data, references[r].size);
+      if (unlikely_(error))
+        return error;                                      /* LCOV_EXCL_LINE */
+
+    /* Flatten reference */
+    } else {
+      memcpy(data, references[r].data, references[r].size);
+      data += references[r].size;
+    }
+    start = end;
+  }
+  memcpy(data, pb_buffer_data_from(subbuffer, start),
+    pb_buffer_size(subbuffer) - start);
+  return PB_ERROR_NONE;
+}
+
 /*!
  * Encode a value.
  *
- * \param[in,out] buffer     Buffer
+ * \param[in,out] encoder    Encoder
  * \param[in]     descriptor Field descriptor
  * \param[in]     value      Pointer holding value
  * \return                   Error code
  */
 static pb_error_t
 encode(
-    pb_buffer_t *buffer, const pb_field_descriptor_t *descriptor,
+    pb_encoder_t *encoder, const pb_field_descriptor_t *descriptor,
     const void *value) {
-  assert(buffer && descriptor && value);
-  assert(pb_buffer_valid(buffer));
+  assert(encoder && descriptor && value);
+  assert(pb_encoder_valid(encoder));
 
   /* Pack wiretype into tag */
   pb_wiretype_t wiretype = pb_field_descriptor_wiretype(descriptor);
@@ -275,13 +369,22 @@ encode(
 
   /* Encode tag and value */
   uint8_t *data = pb_buffer_grow(
-    buffer, pb_varint_size_uint32(&tag));
+    &(encoder->buffer), pb_varint_size_uint32(&tag));
   if (data) {
     pb_varint_pack_uint32(data, &tag);
 
+    /* Encode large strings and messages containing references by reference */
+    if (wiretype == PB_WIRETYPE_LENGTH) {
+      if (pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE
+          ? ((const pb_encoder_t *)value)->referenced != 0
+          : encoder->threshold &&
+            pb_string_size(value) >= encoder->threshold)
+        return encode_reference(encoder, descriptor, value);
+    }
+
     /* Encode value */
     assert(encode_jump[wiretype]);
-    return encode_jump[wiretype](buffer, descriptor, value);
+    return encode_jump[wiretype](&(encoder->buffer), descriptor, value);
   }
   return PB_ERROR_ALLOC;
 }
@@ -317,11 +420,55 @@ pb_encoder_create_with_allocator(
   assert(allocator && descriptor);
   pb_encoder_t encoder = {
     .descriptor = descriptor,
-    .buffer     = pb_buffer_create_empty_with_allocator(allocator)
+    .buffer     = pb_buffer_create_empty_with_allocator(allocator),
+    .references = pb_buffer_create_empty_with_allocator(allocator),
+    .threshold  = 0,
+    .referenced = 0
   };
   return encoder;
 }
 
+/*!
+ * Create an encoder in scatter-gather mode.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] threshold  Reference threshold
+ * \return               Encoder
+ */
+extern pb_encoder_t
+pb_encoder_create_iovec(const pb_descriptor_t *descriptor, size_t threshold) {
+  return pb_encoder_create_iovec_with_allocator(
+    &allocator_default, descriptor, threshold);
+}
+
+/*!
+ * Create an encoder in scatter-gather mode using a custom allocator.
+ *
+ * Strings and bytes of at least the given threshold size are not copied into
+ * the buffer of the encoder, but referenced in place. All other fields and
+ * headers are coalesced in the buffer. The encoded message can be obtained
+ * with pb_iovec_create_from_encoder(), and written with writev() or sendmsg().
+ *
+ * \warning An encoder does not take ownership of referenced strings, so the
+ * caller must ensure that they are not freed or altered before the encoded
+ * message was written. The same holds for the allocator.
+ *
+ * \param[in,out] allocator  Allocator
+ * \param[in]     descriptor Descriptor
+ * \param[in]     threshold  Reference threshold
+ * \return                   Encoder
+ */
+extern pb_encoder_t
+pb_encoder_create_iovec_with_allocator(
+    pb_allocator_t *allocator, const pb_descriptor_t *descriptor,
+    size_t threshold) {
+  assert(allocator && descriptor && threshold);
+  pb_encoder_t encoder =
+    pb_encoder_create_with_allocator(allocator, descriptor);
+  encoder.threshold = threshold;
+  return encoder;
+}
+
 /*!
  * Destroy an encoder.
  *
@@ -330,8 +477,10 @@ pb_encoder_create_with_allocator(
 extern void
 pb_encoder_destroy(pb_encoder_t *encoder) {
   assert(encoder);
-  if (pb_encoder_valid(encoder))
+  if (pb_encoder_valid(encoder)) {
+    pb_buffer_destroy(&(encoder->references));
     pb_buffer_destroy(&(encoder->buffer));
+  }
 }
 
 /*!
@@ -384,7 +533,7 @@ pb_encoder_encode(
     const uint8_t *temp = values;
     for (size_t v = 0; v < size; v++) {
       assert(encoder != (void *)temp);
-      error = encode(&(encoder->buffer), descriptor, temp);
+      error = encode(encoder, descriptor, temp);
       temp += type_size;
     }
   }
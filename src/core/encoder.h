@@ -23,11 +23,24 @@
 #ifndef PB_CORE_ENCODER_H
 #define PB_CORE_ENCODER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <protobluff/core/encoder.h>
 
 #include "core/buffer.h"
 #include "core/common.h"
 
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_encoder_reference_t {
+  size_t offset;                       /*!< Offset in buffer */
+  const uint8_t *data;                 /*!< Referenced data */
+  size_t size;                         /*!< Referenced data size */
+} pb_encoder_reference_t;
+
 /* ----------------------------------------------------------------------------
  * Inline functions
  * ------------------------------------------------------------------------- */
@@ -42,9 +55,38 @@ PB_INLINE pb_encoder_t
 pb_encoder_create_invalid(void) {
   pb_encoder_t encoder = {
     .descriptor = NULL,
-    .buffer     = pb_buffer_create_invalid()
+    .buffer     = pb_buffer_create_invalid(),
+    .references = pb_buffer_create_invalid(),
+    .threshold  = 0,
+    .referenced = 0
   };
   return encoder;
 }
 
+/*!
+ * Retrieve the strings referenced by an encoder in scatter-gather mode.
+ *
+ * \param[in] encoder Encoder
+ * \return            References
+ */
+PB_INLINE const pb_encoder_reference_t *
+pb_encoder_references(const pb_encoder_t *encoder) {
+  assert(encoder);
+  return (const pb_encoder_reference_t *)
+    pb_buffer_data(&(encoder->references));
+}
+
+/*!
+ * Retrieve the number of strings referenced by an encoder.
+ *
+ * \param[in] encoder Encoder
+ * \return            Reference count
+ */
+PB_INLINE size_t
+pb_encoder_references_count(const pb_encoder_t *encoder) {
+  assert(encoder);
+  return pb_buffer_size(&(encoder->references)) /
+    sizeof(pb_encoder_reference_t);
+}
+
 #endif /* PB_CORE_ENCODER_H */
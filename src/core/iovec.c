@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/encoder.h"
+#include "core/iovec.h"
+#include "core/rewriter.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a segmented buffer interleaving a buffer with referenced regions.
+ *
+ * Every reference denotes a region which is inserted at the given offset of
+ * the buffer, so slices of the buffer and references alternate.
+ *
+ * \param[in] buffer       Buffer
+ * \param[in] references[] References
+ * \param[in] count        Reference count
+ * \param[in] size         Total size
+ * \return                 Segmented buffer
+ */
+static pb_iovec_t
+interleave(
+    const pb_buffer_t *buffer, const pb_encoder_reference_t references[],
+    size_t count, size_t size) {
+  assert(buffer && (references || !count));
+  pb_iovec_t iovec = {
+    .allocator = pb_buffer_allocator(buffer),
+    .segments  = NULL,
+    .count     = 0,
+    .size      = size
+  };
+  if (!iovec.size)
+    return iovec;
+
+  /* Allocate segments for buffer slices and references */
+  iovec.segments = pb_allocator_allocate(iovec.allocator,
+    sizeof(struct iovec) * (2 * count + 1));
+  if (unlikely_(!iovec.segments))
+    return pb_iovec_create_invalid();                      /* LCOV_EXCL_LINE */
+
+  /* Interleave buffer slices and references */
+  size_t start = 0;
+  for (size_t r = 0; r < count; r++) {
+    if (references[r].offset > start)
+      iovec.segments[iovec.count++] = (struct iovec){
+        .iov_base = (uint8_t *)pb_buffer_data_from(buffer, start),
+        .iov_len  = references[r].offset - start
+      };
+    iovec.segments[iovec.count++] = (struct iovec){
+      .iov_base = (uint8_t *)references[r].data,
+      .iov_len  = references[r].size
+    };
+    start = references[r].offset;
+  }
+  if (pb_buffer_size(buffer) > start)
+    iovec.segments[iovec.count++] = (struct iovec){
+      .iov_base = (uint8_t *)pb_buffer_data_from(buffer, start),
+      .iov_len  = pb_buffer_size(buffer) - start
+    };
+  return iovec;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a segmented buffer.
+ *
+ * \param[in] segments[] Segments
+ * \param[in] count      Segment count
+ * \return               Segmented buffer
+ */
+extern pb_iovec_t
+pb_iovec_create(const struct iovec segments[], size_t count) {
+  return pb_iovec_create_with_allocator(&allocator_default, segments, count);
+}
+
+/*!
+ * Create a segmented buffer using a custom allocator.
+ *
+ * Only the segment table is copied, the segments themselves are referenced in
+ * place. Empty segments are dropped, so every segment holds at least one byte.
+ *
+ * \warning A segmented buffer does not take ownership of the provided
+ * segments, so the caller must ensure that they are not freed during
+ * operations. The same holds for the allocator.
+ *
+ * \param[in,out] allocator  Allocator
+ * \param[in]     segments[] Segments
+ * \param[in]     count      Segment count
+ * \return                   Segmented buffer
+ */
+extern pb_iovec_t
+pb_iovec_create_with_allocator(
+    pb_allocator_t *allocator, const struct iovec segments[], size_t count) {
+  assert(allocator && (segments || !count));
+  pb_iovec_t iovec = {
+    .allocator = allocator,
+    .segments  = NULL,
+    .count     = 0,
+    .size      = 0
+  };
+
+  /* Count non-empty segments */
+  size_t used = 0;
+  for (size_t s = 0; s < count; s++)
+    if (segments[s].iov_len)
+      used++;
+
+  /* Copy segment table, if not empty */
+  if (used) {
+    iovec.segments = pb_allocator_allocate(allocator,
+      sizeof(struct iovec) * used);
+    if (unlikely_(!iovec.segments))
+      return pb_iovec_create_invalid();
+    for (size_t s = 0; s < count; s++) {
+      if (segments[s].iov_len) {
+        iovec.segments[iovec.count++] = segments[s];
+        iovec.size += segments[s].iov_len;
+      }
+    }
+  }
+  return iovec;
+}
+
+/*!
+ * Create a segmented buffer from the message encoded by an encoder.
+ *
+ * The segments alternate between the buffer of the encoder, which contains
+ * all coalesced fields and headers, and the strings that were referenced in
+ * place by an encoder in scatter-gather mode. The segments can be passed to
+ * writev() or sendmsg() directly.
+ *
+ * \warning The segmented buffer references the buffer of the encoder, so the
+ * caller must ensure that the encoder is neither altered nor destroyed during
+ * operations. As every referenced string adds up to two segments, the caller
+ * may have to split the segments if IOV_MAX is exceeded.
+ *
+ * \param[in] encoder Encoder
+ * \return            Segmented buffer
+ */
+extern pb_iovec_t
+pb_iovec_create_from_encoder(const pb_encoder_t *encoder) {
+  assert(encoder);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return pb_iovec_create_invalid();
+  return interleave(pb_encoder_buffer(encoder), pb_encoder_references(encoder),
+    pb_encoder_references_count(encoder), pb_encoder_size(encoder));
+}
+
+/*!
+ * Create a segmented buffer from the message rewritten by a rewriter.
+ *
+ * The segments alternate between the buffer of the rewriter, which contains
+ * all regenerated fields and length prefixes, and the untouched regions of
+ * the original message, which are referenced in place. The segments can be
+ * passed to writev() or sendmsg() directly.
+ *
+ * \warning The segmented buffer references the buffer of the rewriter and the
+ * original message, so the caller must ensure that neither is altered nor
+ * destroyed during operations.
+ *
+ * \param[in] rewriter Rewriter
+ * \return             Segmented buffer
+ */
+extern pb_iovec_t
+pb_iovec_create_from_rewriter(const pb_rewriter_t *rewriter) {
+  assert(rewriter);
+  if (unlikely_(!pb_rewriter_valid(rewriter)))
+    return pb_iovec_create_invalid();
+  return interleave(pb_rewriter_buffer(rewriter),
+    pb_rewriter_references(rewriter),
+    pb_rewriter_references_count(rewriter), pb_rewriter_size(rewriter));
+}
+
+/*!
+ * Create a segmented buffer over a range of another segmented buffer.
+ *
+ * The resulting segmented buffer references the same segments, trimmed to
+ * the given range, and uses the same allocator.
+ *
+ * \param[in] iovec  Segmented buffer
+ * \param[in] offset Offset
+ * \param[in] size   Size
+ * \return           Segmented buffer
+ */
+extern pb_iovec_t
+pb_iovec_create_range(const pb_iovec_t *iovec, size_t offset, size_t size) {
+  assert(iovec);
+  if (unlikely_(!pb_iovec_valid(iovec) || offset + size > iovec->size))
+    return pb_iovec_create_invalid();
+
+  /* Skip segments before the range, empty ranges have no segments */
+  size_t first = 0;
+  if (!size)
+    offset = 0;
+  while (size && offset >= iovec->segments[first].iov_len)
+    offset -= iovec->segments[first++].iov_len;
+
+  /* Count segments covering the range */
+  size_t count = 0;
+  for (size_t left = size + offset; left; count++)
+    left -= left < iovec->segments[first + count].iov_len
+      ? left
+      : iovec->segments[first + count].iov_len;
+
+  /* Copy and trim segment table, if not empty */
+  pb_iovec_t range = {
+    .allocator = iovec->allocator,
+    .segments  = NULL,
+    .count     = count,
+    .size      = size
+  };
+  if (count) {
+    range.segments = pb_allocator_allocate(range.allocator,
+      sizeof(struct iovec) * count);
+    if (unlikely_(!range.segments))
+      return pb_iovec_create_invalid();
+    memcpy(range.segments, &(iovec->segments[first]),
+      sizeof(struct iovec) * count);
+
+    /* Trim first and last segment to the range */
+    range.segments[0].iov_base =
+      (uint8_t *)range.segments[0].iov_base + offset;
+    range.segments[0].iov_len -= offset;
+    for (size_t s = 0; s < count - 1; s++)
+      size -= range.segments[s].iov_len;
+    range.segments[count - 1].iov_len = size;
+  }
+  return range;
+}
+
+/*!
+ * Destroy a segmented buffer.
+ *
+ * \param[in,out] iovec Segmented buffer
+ */
+extern void
+pb_iovec_destroy(pb_iovec_t *iovec) {
+  assert(iovec);
+  if (iovec->allocator) {
+    if (iovec->segments) {
+      pb_allocator_free(iovec->allocator, iovec->segments);
+      iovec->segments = NULL;
+    }
+    iovec->allocator = NULL;
+  }
+}
+
+/*!
+ * Copy a range of a segmented buffer into a contiguous buffer.
+ *
+ * \param[in]  iovec  Segmented buffer
+ * \param[in]  offset Offset
+ * \param[out] data[] Target buffer
+ * \param[in]  size   Bytes to read
+ * \return            Error code
+ */
+extern pb_error_t
+pb_iovec_read(
+    const pb_iovec_t *iovec, size_t offset, uint8_t data[], size_t size) {
+  assert(iovec && (data || !size));
+  if (unlikely_(!pb_iovec_valid(iovec)))
+    return PB_ERROR_INVALID;
+  if (unlikely_(offset + size > iovec->size))
+    return PB_ERROR_OFFSET;
+
+  /* Copy all segments overlapping the range */
+  for (size_t s = 0; size; s++) {
+    const struct iovec *segment = &(iovec->segments[s]);
+    if (offset >= segment->iov_len) {
+      offset -= segment->iov_len;
+      continue;
+    }
+    size_t bytes = segment->iov_len - offset;
+    if (bytes > size)
+      bytes = size;
+    memcpy(data, (const uint8_t *)segment->iov_base + offset, bytes);
+    data += bytes; size -= bytes; offset = 0;
+  }
+  return PB_ERROR_NONE;
+}
@@ -0,0 +1,563 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/parser.h"
+#include "core/varint.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the size of a fixed-sized value of a given wiretype.
+ *
+ * \param[in] wiretype Wiretype
+ * \return             Value size
+ */
+static size_t
+fixed_size(pb_wiretype_t wiretype) {
+  return wiretype == PB_WIRETYPE_64BIT ? 8 :
+         wiretype == PB_WIRETYPE_32BIT ? 4 : 0;
+}
+
+/*!
+ * Retrieve the offset at which the current message or packed field ends.
+ *
+ * \param[in] parser Parser
+ * \return           End offset
+ */
+static size_t
+limit(const pb_parser_t *parser) {
+  assert(parser);
+  if (parser->packed)
+    return parser->packed;
+  return parser->frame.size
+    ? parser->frame.data[parser->frame.size - 1].end
+    : SIZE_MAX;
+}
+
+/*!
+ * Consume bytes from a chunk.
+ *
+ * \param[in,out] parser Parser
+ * \param[in,out] data   Raw data
+ * \param[in,out] size   Raw data size
+ * \param[in]     bytes  Bytes to consume
+ */
+static void
+consume(
+    pb_parser_t *parser, const uint8_t **data, size_t *size, size_t bytes) {
+  assert(parser && data && size && bytes <= *size);
+  *data += bytes;
+  *size -= bytes;
+  parser->offset += bytes;
+}
+
+/*!
+ * Gather a variable-sized integer from a chunk.
+ *
+ * If the variable-sized integer is entirely contained in the chunk, a pointer
+ * into the chunk is returned. Otherwise, the bytes are collected in the parser
+ * until the variable-sized integer is complete. If more data is needed, the
+ * pointer receiving the variable-sized integer is set to NULL.
+ *
+ * \param[in,out] parser Parser
+ * \param[in,out] data   Raw data
+ * \param[in,out] size   Raw data size
+ * \param[out]    varint Pointer receiving variable-sized integer
+ * \param[out]    length Pointer receiving length of variable-sized integer
+ * \return               Error code
+ */
+static pb_error_t
+gather_varint(
+    pb_parser_t *parser, const uint8_t **data, size_t *size,
+    const uint8_t **varint, size_t *length) {
+  assert(parser && data && size && varint && length);
+  *varint = NULL;
+
+  /* Fast path: variable-sized integer is contained in chunk */
+  if (!parser->partial.size) {
+    size_t left = *size > 10 ? 10 : *size;
+    for (size_t v = 0; v < left; v++) {
+      if (!((*data)[v] & 0x80)) {
+        *varint = *data;
+        *length = v + 1;
+        consume(parser, data, size, v + 1);
+        return PB_ERROR_NONE;
+      }
+    }
+    if (unlikely_(left == 10))
+      return PB_ERROR_VARINT;
+  }
+
+  /* Slow path: variable-sized integer straddles chunks */
+  while (*size) {
+    uint8_t byte = **data;
+    consume(parser, data, size, 1);
+    parser->partial.data[parser->partial.size++] = byte;
+    if (!(byte & 0x80)) {
+      *varint = parser->partial.data;
+      *length = parser->partial.size;
+      parser->partial.size = 0;
+      return PB_ERROR_NONE;
+    }
+    if (unlikely_(parser->partial.size == 10))
+      return PB_ERROR_VARINT;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Gather a fixed-sized value from a chunk.
+ *
+ * \param[in,out] parser Parser
+ * \param[in,out] data   Raw data
+ * \param[in,out] size   Raw data size
+ * \param[in]     length Length of value
+ * \return               Value or NULL if more data is needed
+ */
+static const uint8_t *
+gather_fixed(
+    pb_parser_t *parser, const uint8_t **data, size_t *size, size_t length) {
+  assert(parser && data && size && length <= 8);
+  const uint8_t *value = NULL;
+
+  /* Fast path: value is contained in chunk */
+  if (!parser->partial.size && *size >= length) {
+    value = *data;
+    consume(parser, data, size, length);
+    return value;
+  }
+
+  /* Slow path: value straddles chunks */
+  size_t bytes = length - parser->partial.size;
+  if (bytes > *size)
+    bytes = *size;
+  memcpy(&(parser->partial.data[parser->partial.size]), *data, bytes);
+  consume(parser, data, size, bytes);
+  if ((parser->partial.size += bytes) == length) {
+    parser->partial.size = 0;
+    value = parser->partial.data;
+  }
+  return value;
+}
+
+/*!
+ * Push a nested message onto the nesting stack.
+ *
+ * \param[in,out] parser Parser
+ * \param[in]     field  Field descriptor
+ * \param[in]     end    End offset
+ * \return               Error code
+ */
+static pb_error_t
+push(pb_parser_t *parser, const pb_field_descriptor_t *field, size_t end) {
+  assert(parser && field);
+  if (parser->frame.size == parser->frame.capacity) {
+    size_t capacity = parser->frame.capacity
+      ? parser->frame.capacity * 2
+      : 8;
+    pb_parser_frame_t *data = pb_allocator_resize(parser->allocator,
+      parser->frame.data, sizeof(pb_parser_frame_t) * capacity);
+    if (unlikely_(!data))
+      return PB_ERROR_ALLOC;
+    parser->frame.data     = data;
+    parser->frame.capacity = capacity;
+  }
+  parser->frame.data[parser->frame.size++] = (pb_parser_frame_t){
+    .descriptor = pb_field_descriptor_nested(field),
+    .field      = field,
+    .end        = end
+  };
+  return parser->handler(PB_PARSER_EVENT_ENTER, field, NULL, parser->user);
+}
+
+/*!
+ * Complete the current field and leave all nested messages that ended.
+ *
+ * \param[in,out] parser Parser
+ * \return               Error code
+ */
+static pb_error_t
+complete(pb_parser_t *parser) {
+  assert(parser);
+
+  /* Continue with next value of packed field, if any */
+  if (parser->packed) {
+    if (parser->offset < parser->packed) {
+      parser->state = PB_PARSER_STATE_VALUE;
+      parser->left  = fixed_size(parser->wiretype);
+      return PB_ERROR_NONE;
+    }
+    if (unlikely_(parser->offset > parser->packed))
+      return PB_ERROR_OFFSET;
+    parser->packed = 0;
+  }
+
+  /* Leave all nested messages that ended */
+  parser->state = PB_PARSER_STATE_TAG;
+  while (parser->frame.size) {
+    const pb_parser_frame_t *frame =
+      &(parser->frame.data[parser->frame.size - 1]);
+    if (parser->offset < frame->end)
+      break;
+    if (unlikely_(parser->offset > frame->end))
+      return PB_ERROR_OFFSET;
+    parser->frame.size--;
+
+    /* Invoke handler */
+    pb_error_t error = parser->handler(
+      PB_PARSER_EVENT_LEAVE, frame->field, NULL, parser->user);
+    if (unlikely_(error))
+      return error;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Process a tag.
+ *
+ * \param[in,out] parser Parser
+ * \param[in]     varint Variable-sized integer
+ * \param[in]     length Length of variable-sized integer
+ * \return               Error code
+ */
+static pb_error_t
+process_tag(pb_parser_t *parser, const uint8_t *varint, size_t length) {
+  assert(parser && varint && length);
+  pb_tag_t tag;
+  if (unlikely_(!pb_varint_unpack_uint32(varint, length, &tag)))
+    return PB_ERROR_VARINT;
+
+  /* Extract wiretype and tag */
+  pb_wiretype_t wiretype = tag & 7;
+  tag >>= 3;
+
+  /* Resolve field, which may also be encoded in packed encoding */
+  const pb_field_descriptor_t *field = pb_descriptor_field_by_tag(
+    parser->frame.size
+      ? parser->frame.data[parser->frame.size - 1].descriptor
+      : parser->descriptor, tag);
+  if (field && wiretype != pb_field_descriptor_wiretype(field) &&
+      wiretype != PB_WIRETYPE_LENGTH)
+    field = NULL;
+  parser->field    = field;
+  parser->wiretype = wiretype;
+
+  /* Determine next state according to wiretype */
+  switch (wiretype) {
+    case PB_WIRETYPE_VARINT:
+    case PB_WIRETYPE_64BIT:
+    case PB_WIRETYPE_32BIT:
+      parser->state = PB_PARSER_STATE_VALUE;
+      parser->left  = fixed_size(wiretype);
+      return PB_ERROR_NONE;
+    case PB_WIRETYPE_LENGTH:
+      parser->state = PB_PARSER_STATE_LENGTH;
+      return PB_ERROR_NONE;
+    default:
+      return PB_ERROR_INVALID;
+  }
+}
+
+/*!
+ * Process a length prefix.
+ *
+ * \param[in,out] parser Parser
+ * \param[in]     varint Variable-sized integer
+ * \param[in]     length Length of variable-sized integer
+ * \return               Error code
+ */
+static pb_error_t
+process_length(pb_parser_t *parser, const uint8_t *varint, size_t length) {
+  assert(parser && varint && length);
+  uint32_t size;
+  if (unlikely_(!pb_varint_unpack_uint32(varint, length, &size)))
+    return PB_ERROR_VARINT;
+
+  /* Ensure we're within the boundaries of the enclosing message */
+  if (unlikely_(size > limit(parser) - parser->offset))
+    return PB_ERROR_OFFSET;
+
+  /* Skip unknown field */
+  const pb_field_descriptor_t *field = parser->field;
+  if (!field) {
+    parser->state = PB_PARSER_STATE_SKIP;
+    parser->left  = size;
+    return size ? PB_ERROR_NONE : complete(parser);
+  }
+
+  /* Enter nested message */
+  if (pb_field_descriptor_type(field) == PB_TYPE_MESSAGE) {
+    pb_error_t error = push(parser, field, parser->offset + size);
+    return error ? error : complete(parser);
+
+  /* Non-packed fields may also be encoded in packed encoding */
+  } else if (pb_field_descriptor_wiretype(field) != PB_WIRETYPE_LENGTH) {
+    parser->wiretype = pb_field_descriptor_wiretype(field);
+    parser->packed   = parser->offset + size;
+    return complete(parser);
+
+  /* Read string or bytes, reporting empty ones immediately */
+  } else if (size) {
+    parser->state = PB_PARSER_STATE_STRING;
+    parser->left  = size;
+    return PB_ERROR_NONE;
+  } else {
+    pb_string_t string = { (uint8_t *)&(varint[length]), 0 };
+    pb_error_t error = parser->handler(
+      PB_PARSER_EVENT_VALUE, field, &string, parser->user);
+    return error ? error : complete(parser);
+  }
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a parser.
+ *
+ * A parser is a push-style decoder which is fed with chunks of a message as
+ * they arrive, e.g. from a socket. The handler is invoked for every field as
+ * soon as it is complete. Nested messages are not buffered, but reported with
+ * an enter and a leave event, between which their fields are reported.
+ *
+ * \param[in]     descriptor Descriptor
+ * \param[in]     handler    Handler
+ * \param[in,out] user       User data
+ * \return                   Parser
+ */
+extern pb_parser_t
+pb_parser_create(
+    const pb_descriptor_t *descriptor, pb_parser_handler_f handler,
+    void *user) {
+  return pb_parser_create_with_allocator(
+    &allocator_default, descriptor, handler, user);
+}
+
+/*!
+ * Create a parser using a custom allocator.
+ *
+ * \warning A parser does not take ownership of the provided allocator, so the
+ * caller must ensure that the allocator is not freed during operations.
+ *
+ * \param[in,out] allocator  Allocator
+ * \param[in]     descriptor Descriptor
+ * \param[in]     handler    Handler
+ * \param[in,out] user       User data
+ * \return                   Parser
+ */
+extern pb_parser_t
+pb_parser_create_with_allocator(
+    pb_allocator_t *allocator, const pb_descriptor_t *descriptor,
+    pb_parser_handler_f handler, void *user) {
+  assert(allocator && descriptor && handler);
+  pb_parser_t parser = {
+    .descriptor = descriptor,
+    .handler    = handler,
+    .user       = user,
+    .allocator  = allocator,
+    .frame      = {
+      .data     = NULL,
+      .size     = 0,
+      .capacity = 0
+    },
+    .field      = NULL,
+    .state      = PB_PARSER_STATE_TAG,
+    .wiretype   = PB_WIRETYPE_VARINT,
+    .offset     = 0,
+    .left       = 0,
+    .packed     = 0,
+    .partial    = {
+      .size     = 0
+    },
+    .string     = pb_buffer_create_empty_with_allocator(allocator),
+    .error      = PB_ERROR_NONE
+  };
+  return parser;
+}
+
+/*!
+ * Destroy a parser.
+ *
+ * \param[in,out] parser Parser
+ */
+extern void
+pb_parser_destroy(pb_parser_t *parser) {
+  assert(parser);
+  if (parser->frame.data) {
+    pb_allocator_free(parser->allocator, parser->frame.data);
+    parser->frame.data     = NULL;
+    parser->frame.size     = 0;
+    parser->frame.capacity = 0;
+  }
+  pb_buffer_destroy(&(parser->string));
+}
+
+/*!
+ * Feed a chunk of data to a parser.
+ *
+ * All fields that are complete after consuming the chunk are reported to the
+ * handler. Strings and bytes that are entirely contained in the chunk point
+ * directly into the chunk, so they are only valid during the invocation of the
+ * handler. Only strings and bytes straddling chunks are copied. After an error
+ * occurred, the parser refuses any further data.
+ *
+ * \param[in,out] parser Parser
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ * \return               Error code
+ */
+extern pb_error_t
+pb_parser_feed(pb_parser_t *parser, const uint8_t data[], size_t size) {
+  assert(parser && (data || !size));
+  if (unlikely_(!pb_parser_valid(parser)))
+    return parser->error;
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Process chunk until it is fully consumed */
+  while (!error && size) {
+    const uint8_t *varint;
+    size_t length;
+    switch (parser->state) {
+
+      /* Read tag and determine wiretype */
+      case PB_PARSER_STATE_TAG:
+        if (!(error = gather_varint(parser, &data, &size, &varint, &length)))
+          if (varint)
+            error = process_tag(parser, varint, length);
+        break;
+
+      /* Read scalar value of known field or skip it */
+      case PB_PARSER_STATE_VALUE: {
+        union {
+          uint64_t integer;            /* Integer value */
+          double number;               /* Floating point value */
+        } value;
+        if (!parser->left) {
+          if ((error = gather_varint(parser, &data, &size, &varint, &length))
+              || !varint)
+            break;
+          if (parser->field && unlikely_(!pb_varint_unpack(
+              pb_field_descriptor_type(parser->field),
+                varint, length, &value))) {
+            error = PB_ERROR_VARINT;
+            break;
+          }
+        } else {
+          if (!(varint = gather_fixed(parser, &data, &size, parser->left)))
+            break;
+          memcpy(&value, varint, parser->left);
+        }
+
+        /* Invoke handler */
+        if (parser->field)
+          error = parser->handler(PB_PARSER_EVENT_VALUE,
+            parser->field, &value, parser->user);
+        if (!error)
+          error = complete(parser);
+        break;
+      }
+
+      /* Read length prefix */
+      case PB_PARSER_STATE_LENGTH:
+        if (!(error = gather_varint(parser, &data, &size, &varint, &length)))
+          if (varint)
+            error = process_length(parser, varint, length);
+        break;
+
+      /* Read string or bytes, only copying if it straddles chunks */
+      case PB_PARSER_STATE_STRING: {
+        pb_string_t string;
+        if (pb_buffer_empty(&(parser->string)) && size >= parser->left) {
+          string = pb_string_init((uint8_t *)data, parser->left);
+          consume(parser, &data, &size, parser->left);
+          parser->left = 0;
+        } else {
+          size_t bytes = parser->left > size ? size : parser->left;
+          uint8_t *target = pb_buffer_grow(&(parser->string), bytes);
+          if (unlikely_(!target)) {
+            error = PB_ERROR_ALLOC;
+            break;
+          }
+          memcpy(target, data, bytes);
+          consume(parser, &data, &size, bytes);
+          if ((parser->left -= bytes))
+            break;
+          string = pb_string_init(parser->string.data,
+            pb_buffer_size(&(parser->string)));
+        }
+
+        /* Invoke handler and release copied string */
+        error = parser->handler(PB_PARSER_EVENT_VALUE,
+          parser->field, &string, parser->user);
+        if (!pb_buffer_empty(&(parser->string))) {
+          pb_allocator_t *allocator = pb_buffer_allocator(&(parser->string));
+          pb_buffer_destroy(&(parser->string));
+          parser->string = pb_buffer_create_empty_with_allocator(allocator);
+        }
+        if (!error)
+          error = complete(parser);
+        break;
+      }
+
+      /* Skip unknown field */
+      case PB_PARSER_STATE_SKIP: {
+        size_t bytes = parser->left > size ? size : parser->left;
+        consume(parser, &data, &size, bytes);
+        if (!(parser->left -= bytes))
+          error = complete(parser);
+        break;
+      }
+    }
+  }
+  return (parser->error = error);
+}
+
+/*!
+ * Finish a parser after the last chunk was fed.
+ *
+ * \param[in,out] parser Parser
+ * \return               Error code
+ */
+extern pb_error_t
+pb_parser_finish(pb_parser_t *parser) {
+  assert(parser);
+  if (unlikely_(!pb_parser_valid(parser)))
+    return parser->error;
+
+  /* Ensure that we're not in the middle of a field or nested message */
+  if (parser->state != PB_PARSER_STATE_TAG ||
+      parser->partial.size || parser->frame.size)
+    parser->error = PB_ERROR_OFFSET;
+  return parser->error;
+}
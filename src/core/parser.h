@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_CORE_PARSER_H
+#define PB_CORE_PARSER_H
+
+#include <stddef.h>
+
+#include <protobluff/core/parser.h>
+
+#include "core/common.h"
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef enum pb_parser_state_t {
+  PB_PARSER_STATE_TAG,                 /*!< Reading tag */
+  PB_PARSER_STATE_VALUE,               /*!< Reading scalar value */
+  PB_PARSER_STATE_LENGTH,              /*!< Reading length prefix */
+  PB_PARSER_STATE_STRING,              /*!< Reading string or bytes */
+  PB_PARSER_STATE_SKIP                 /*!< Skipping unknown field */
+} pb_parser_state_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct pb_parser_frame_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor */
+  const pb_field_descriptor_t *field;  /*!< Field descriptor */
+  size_t end;                          /*!< End offset */
+} pb_parser_frame_t;
+
+#endif /* PB_CORE_PARSER_H */
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/record.h"
+#include "core/stream.h"
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a record iterator over a buffer.
+ *
+ * A record buffer is a sequence of length-delimited records, where each record
+ * is prefixed with its length encoded as a variable-sized integer, which is
+ * exactly what Protocol Buffers' writeDelimitedTo() produces. The iterator is
+ * positioned on the first record, or reports PB_ERROR_EOM if there is none.
+ *
+ * \warning A record iterator does not take ownership of the provided buffer,
+ * so the caller must ensure that the buffer is not freed during operations.
+ *
+ * \param[in] buffer Buffer
+ * \return           Record iterator
+ */
+extern pb_record_iter_t
+pb_record_iter_create(const pb_buffer_t *buffer) {
+  return pb_record_iter_create_at(buffer, 0);
+}
+
+/*!
+ * Create a record iterator over a buffer at a given offset.
+ *
+ * The offset must point to the length prefix of a record, e.g. one that was
+ * obtained from pb_record_iter_offset() during an earlier iteration.
+ *
+ * \param[in] buffer Buffer
+ * \param[in] offset Offset
+ * \return           Record iterator
+ */
+extern pb_record_iter_t
+pb_record_iter_create_at(const pb_buffer_t *buffer, size_t offset) {
+  assert(buffer);
+  return pb_record_iter_create_range(buffer, offset, pb_buffer_size(buffer));
+}
+
+/*!
+ * Create a record iterator over a range of a buffer.
+ *
+ * Iteration stops at the end offset, which must coincide with the end of a
+ * record, so records can be iterated within a part of a larger buffer.
+ *
+ * \param[in] buffer Buffer
+ * \param[in] start  Start offset
+ * \param[in] end    End offset
+ * \return           Record iterator
+ */
+extern pb_record_iter_t
+pb_record_iter_create_range(
+    const pb_buffer_t *buffer, size_t start, size_t end) {
+  assert(buffer);
+  if (unlikely_(!pb_buffer_valid(buffer) ||
+                start > end || end > pb_buffer_size(buffer)))
+    return pb_record_iter_create_invalid();
+
+  /* Create record iterator and move to first record */
+  pb_record_iter_t iter = {
+    .buffer = buffer,
+    .offset = start,
+    .next   = start,
+    .end    = end,
+    .record = pb_buffer_create_zero_copy_internal(NULL, 0),
+    .error  = PB_ERROR_NONE
+  };
+  if (!pb_record_iter_next(&iter))
+    iter.offset = start;
+  return iter;
+}
+
+/*!
+ * Destroy a record iterator.
+ *
+ * \param[in,out] iter Record iterator
+ */
+extern void
+pb_record_iter_destroy(pb_record_iter_t *iter) {
+  assert(iter);
+  pb_buffer_destroy(&(iter->record));
+}
+
+/*!
+ * Move a record iterator to the next record.
+ *
+ * The length prefix is validated against the end of the range, so a record
+ * that is truncated or crosses the end is reported as PB_ERROR_OFFSET.
+ *
+ * \param[in,out] iter Record iterator
+ * \return            Test result
+ */
+extern int
+pb_record_iter_next(pb_record_iter_t *iter) {
+  assert(iter);
+  if (unlikely_(!pb_record_iter_valid(iter)))
+    return 0;
+
+  /* Check whether we reached the end of the range */
+  if (iter->next == iter->end) {
+    iter->error = PB_ERROR_EOM;
+    return 0;
+  }
+
+  /* Read length-prefixed record */
+  pb_stream_t stream = pb_stream_create_at(iter->buffer, iter->next);
+  pb_string_t record;
+  if (!(iter->error = pb_stream_read(&stream, PB_TYPE_BYTES, &record))) {
+    if (likely_(pb_stream_offset(&stream) <= iter->end)) {
+      iter->offset = iter->next;
+      iter->next   = pb_stream_offset(&stream);
+      iter->record = pb_buffer_create_view_internal(iter->buffer,
+        pb_string_data(&record), pb_string_size(&record));
+    } else {
+      iter->error = PB_ERROR_OFFSET;
+    }
+  }
+  pb_stream_destroy(&stream);
+  return !iter->error;
+}
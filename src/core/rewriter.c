@@ -0,0 +1,533 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+#include "core/rewriter.h"
+#include "core/stream.h"
+#include "core/varint.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Compare two edits by their paths.
+ *
+ * \param[in] x Edit
+ * \param[in] y Edit
+ * \return      Comparison result
+ */
+static int
+compare(const void *x, const void *y) {
+  const pb_rewriter_edit_t *a = *(const pb_rewriter_edit_t *const *)x,
+                           *b = *(const pb_rewriter_edit_t *const *)y;
+  for (size_t t = 0; t < a->path.size && t < b->path.size; t++)
+    if (a->path.data[t] != b->path.data[t])
+      return a->path.data[t] < b->path.data[t] ? -1 : 1;
+  return a->path.size < b->path.size ? -1 : a->path.size > b->path.size;
+}
+
+/*!
+ * Find the group of edits for a tag at a given depth.
+ *
+ * \param[in] edits[] Edits, sorted by path
+ * \param[in] count   Edit count
+ * \param[in] depth   Depth
+ * \param[in] tag     Tag
+ * \return            Index of first edit of group or edit count
+ */
+static size_t
+lookup(
+    const pb_rewriter_edit_t *edits[], size_t count, size_t depth,
+    pb_tag_t tag) {
+  assert(edits);
+  size_t lower = 0, upper = count;
+  while (lower < upper) {
+    size_t middle = lower + ((upper - lower) >> 1);
+    if (edits[middle]->path.data[depth] < tag) {
+      lower = middle + 1;
+    } else {
+      upper = middle;
+    }
+  }
+  return lower < count && edits[lower]->path.data[depth] == tag
+    ? lower
+    : count;
+}
+
+/*!
+ * Append regenerated data to a rewriter.
+ *
+ * \param[in,out] rewriter Rewriter
+ * \param[in]     data[]   Raw data
+ * \param[in]     size     Raw data size
+ * \return                 Error code
+ */
+static pb_error_t
+emit(pb_rewriter_t *rewriter, const uint8_t data[], size_t size) {
+  assert(rewriter && data && size);
+  uint8_t *temp = pb_buffer_grow(&(rewriter->buffer), size);
+  if (unlikely_(!temp))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  memcpy(temp, data, size);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Append a reference to a region to a rewriter.
+ *
+ * If the region directly follows the previously referenced region without
+ * any regenerated data in between, both references are coalesced.
+ *
+ * \param[in,out] rewriter Rewriter
+ * \param[in]     data[]   Referenced data
+ * \param[in]     size     Referenced data size
+ * \return                 Error code
+ */
+static pb_error_t
+reference(pb_rewriter_t *rewriter, const uint8_t data[], size_t size) {
+  assert(rewriter && (data || !size));
+  if (!size)
+    return PB_ERROR_NONE;
+
+  /* Coalesce with previous reference, if adjacent */
+  const size_t offset = pb_buffer_size(&(rewriter->buffer)),
+               count  = pb_rewriter_references_count(rewriter);
+  if (count) {
+    pb_encoder_reference_t *last = (pb_encoder_reference_t *)
+      pb_buffer_data(&(rewriter->references)) + count - 1;
+    if (last->offset == offset && last->data + last->size == data) {
+      last->size += size;
+      rewriter->referenced += size;
+      return PB_ERROR_NONE;
+    }
+  }
+
+  /* Otherwise append reference */
+  pb_encoder_reference_t *reference = (pb_encoder_reference_t *)
+    pb_buffer_grow(&(rewriter->references), sizeof(pb_encoder_reference_t));
+  if (unlikely_(!reference))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  reference->offset = offset;
+  reference->data   = data;
+  reference->size   = size;
+  rewriter->referenced += size;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Insert a length prefix or tag into the data of a rewriter.
+ *
+ * The prefix is inserted at the given offset of the buffer, so all references
+ * appended after the given mark are moved accordingly.
+ *
+ * \param[in,out] rewriter Rewriter
+ * \param[in]     offset   Offset in buffer
+ * \param[in]     mark     Index of first reference after offset
+ * \param[in]     value    Length or key
+ * \return                 Error code
+ */
+static pb_error_t
+prefix(pb_rewriter_t *rewriter, size_t offset, size_t mark, uint32_t value) {
+  assert(rewriter);
+  uint8_t data[5]; size_t size = pb_varint_pack_uint32(data, &value);
+  if (unlikely_(!pb_buffer_grow(&(rewriter->buffer), size)))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+
+  /* Move regenerated data and references */
+  uint8_t *base = rewriter->buffer.data;
+  memmove(&(base[offset + size]), &(base[offset]),
+    rewriter->buffer.size - size - offset);
+  memcpy(&(base[offset]), data, size);
+  pb_encoder_reference_t *references = (pb_encoder_reference_t *)
+    pb_buffer_data(&(rewriter->references));
+  for (size_t r = mark; r < pb_rewriter_references_count(rewriter); r++)
+    references[r].offset += size;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Append a field with a new value to a rewriter.
+ *
+ * Scalar values are regenerated, while strings and bytes are referenced in
+ * place. If no value is given, the field is removed, so nothing is appended.
+ *
+ * \param[in,out] rewriter   Rewriter
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value or NULL
+ * \return                   Error code
+ */
+static pb_error_t
+replace(
+    pb_rewriter_t *rewriter, const pb_field_descriptor_t *descriptor,
+    const void *value) {
+  assert(rewriter && descriptor);
+  if (!value)
+    return PB_ERROR_NONE;
+  if (unlikely_(pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED ||
+                pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE))
+    return PB_ERROR_INVALID;
+
+  /* Regenerate tag */
+  pb_wiretype_t wiretype = pb_field_descriptor_wiretype(descriptor);
+  uint8_t data[15]; uint32_t key =
+    pb_field_descriptor_tag(descriptor) << 3 | wiretype;
+  size_t size = pb_varint_pack_uint32(data, &key);
+
+  /* Regenerate value according to wiretype */
+  switch (wiretype) {
+    case PB_WIRETYPE_VARINT:
+      size += pb_varint_pack(pb_field_descriptor_type(descriptor),
+        &(data[size]), value);
+      break;
+    case PB_WIRETYPE_64BIT:
+      memcpy(&(data[size]), value, 8);
+      size += 8;
+      break;
+    case PB_WIRETYPE_32BIT:
+      memcpy(&(data[size]), value, 4);
+      size += 4;
+      break;
+
+    /* Regenerate length prefix and reference string in place */
+    default: {
+      uint32_t length = pb_string_size(value);
+      size += pb_varint_pack_uint32(&(data[size]), &length);
+      pb_error_t error = emit(rewriter, data, size);
+      return error
+        ? error
+        : reference(rewriter, pb_string_data(value), length);
+    }
+  }
+  return emit(rewriter, data, size);
+}
+
+/*!
+ * Rewrite a message according to a set of edits.
+ *
+ * All edits share the same path up to the given depth. The occurrences of all
+ * fields of the message are collected, and the edits are grouped by the tag
+ * at the given depth. If the group consists of a single edit ending at the
+ * given depth, the last occurrence of the field is replaced, and all other
+ * occurrences are dropped. Otherwise, all occurrences of the submessage are
+ * rewritten recursively, as they are merged when decoded, but only the last
+ * occurrence receives the new values, while the edited fields are removed
+ * from all others. Fields which don't occur in the message are appended, and
+ * so are submessages, unless nothing remains to be appended to them. All
+ * untouched regions in between are referenced in place.
+ *
+ * \param[in,out] rewriter   Rewriter
+ * \param[in]     descriptor Descriptor
+ * \param[in]     data[]     Raw data
+ * \param[in]     size       Raw data size
+ * \param[in]     edits[]    Edits, sorted by path
+ * \param[in]     count      Edit count
+ * \param[in]     depth      Depth
+ * \param[in]     remove     Whether to only remove the edited fields
+ * \return                   Error code
+ */
+static pb_error_t
+rewrite(
+    pb_rewriter_t *rewriter, const pb_descriptor_t *descriptor,
+    const uint8_t data[], size_t size,
+    const pb_rewriter_edit_t *edits[], size_t count, size_t depth,
+    int remove) {
+  assert(rewriter && descriptor && (data || !size) && edits && count);
+  pb_stream_field_t *fields = NULL;
+  size_t total = 0, *last = pb_allocator_allocate(
+    &allocator_default, sizeof(size_t) * count);
+  if (unlikely_(!last))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+
+  /* Collect fields of message */
+  pb_error_t error = PB_ERROR_NONE;
+  if (size) {
+    pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+      (uint8_t *)data, size);
+    pb_stream_t stream = pb_stream_create(&buffer);
+    error = pb_stream_scan(&stream, &fields, &total);
+    pb_stream_destroy(&stream);
+  }
+
+  /* Find the last occurrence of every edited tag */
+  for (size_t e = 0, end; !error && e < count; e = end) {
+    const pb_tag_t tag = edits[e]->path.data[depth];
+    for (end = e + 1; end < count; end++)
+      if (edits[end]->path.data[depth] != tag)
+        break;
+    int leaf = edits[e]->path.size == depth + 1;
+    last[e] = SIZE_MAX;
+    for (size_t f = total; f-- > 0; ) {
+      if (fields[f].tag != tag)
+        continue;
+      if (unlikely_(!leaf && fields[f].wiretype != PB_WIRETYPE_LENGTH))
+        error = PB_ERROR_INVALID;
+      if (last[e] == SIZE_MAX)
+        last[e] = f;
+    }
+  }
+
+  /* Reference untouched regions and rewrite edited fields */
+  size_t run = 0;
+  for (size_t f = 0; !error && f <= total; f++) {
+    size_t e = f < total
+      ? lookup(edits, count, depth, fields[f].tag)
+      : count;
+    if (f < total && e == count)
+      continue;
+
+    /* Reference untouched region, including the tag of a submessage */
+    int leaf = f == total || edits[e]->path.size == depth + 1;
+    size_t start = f < total
+      ? (leaf ? fields[f].start : fields[f].header)
+      : size;
+    if (start > run && (error = reference(rewriter, &(data[run]), start - run)))
+      break;
+    if (f == total)
+      break;
+    run = fields[f].end;
+
+    /* Drop all but the last occurrence of an edited field */
+    if (leaf && last[e] != f)
+      continue;
+
+    /* Resolve field descriptor of edited field */
+    const pb_field_descriptor_t *field =
+      pb_descriptor_field_by_tag(descriptor, fields[f].tag);
+    if (unlikely_(!field)) {
+      error = PB_ERROR_INVALID;
+
+    /* Replace field with new value */
+    } else if (leaf) {
+      error = replace(rewriter, field, remove ? NULL : edits[e]->value);
+
+    /* Rewrite submessage and regenerate its length prefix */
+    } else if (unlikely_(
+        pb_field_descriptor_type(field) != PB_TYPE_MESSAGE ||
+        pb_field_descriptor_label(field) == PB_LABEL_REPEATED)) {
+      error = PB_ERROR_INVALID;
+    } else {
+      size_t offset = pb_buffer_size(&(rewriter->buffer)),
+             mark   = pb_rewriter_references_count(rewriter),
+             before = pb_rewriter_size(rewriter), end;
+      for (end = e + 1; end < count; end++)
+        if (edits[end]->path.data[depth] != fields[f].tag)
+          break;
+      if (!(error = rewrite(rewriter, pb_field_descriptor_nested(field),
+          &(data[fields[f].value]), fields[f].end - fields[f].value,
+            &(edits[e]), end - e, depth + 1, remove || last[e] != f)))
+        error = prefix(rewriter, offset, mark,
+          pb_rewriter_size(rewriter) - before);
+    }
+  }
+
+  /* Append fields which don't occur in the message */
+  for (size_t e = 0, end; !error && e < count; e = end) {
+    const pb_tag_t tag = edits[e]->path.data[depth];
+    for (end = e + 1; end < count; end++)
+      if (edits[end]->path.data[depth] != tag)
+        break;
+    if (last[e] != SIZE_MAX)
+      continue;
+
+    /* Resolve field descriptor of edited field */
+    const pb_field_descriptor_t *field =
+      pb_descriptor_field_by_tag(descriptor, tag);
+    if (unlikely_(!field)) {
+      error = PB_ERROR_INVALID;
+
+    /* Append field with new value */
+    } else if (edits[e]->path.size == depth + 1) {
+      error = replace(rewriter, field, remove ? NULL : edits[e]->value);
+
+    /* Append submessage and generate its tag and length prefix */
+    } else if (unlikely_(
+        pb_field_descriptor_type(field) != PB_TYPE_MESSAGE ||
+        pb_field_descriptor_label(field) == PB_LABEL_REPEATED)) {
+      error = PB_ERROR_INVALID;
+    } else {
+      size_t offset = pb_buffer_size(&(rewriter->buffer)),
+             mark   = pb_rewriter_references_count(rewriter),
+             before = pb_rewriter_size(rewriter);
+      if ((error = rewrite(rewriter, pb_field_descriptor_nested(field),
+          NULL, 0, &(edits[e]), end - e, depth + 1, remove)))
+        break;
+
+      /* Omit submessage if only fields were removed from it */
+      size_t length = pb_rewriter_size(rewriter) - before;
+      if (length && !(error = prefix(rewriter, offset, mark, length)))
+        error = prefix(rewriter, offset, mark, tag << 3 | PB_WIRETYPE_LENGTH);
+    }
+  }
+  if (fields)
+    pb_allocator_free(&allocator_default, fields);
+  pb_allocator_free(&allocator_default, last);
+  return error;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a rewriter.
+ *
+ * \param[in] descriptor Descriptor
+ * \return               Rewriter
+ */
+extern pb_rewriter_t
+pb_rewriter_create(const pb_descriptor_t *descriptor) {
+  return pb_rewriter_create_with_allocator(&allocator_default, descriptor);
+}
+
+/*!
+ * Create a rewriter using a custom allocator.
+ *
+ * \warning A rewriter does not take ownership of the provided allocator, so
+ * the caller must ensure that the allocator is not freed during operations.
+ *
+ * \param[in,out] allocator  Allocator
+ * \param[in]     descriptor Descriptor
+ * \return                   Rewriter
+ */
+extern pb_rewriter_t
+pb_rewriter_create_with_allocator(
+    pb_allocator_t *allocator, const pb_descriptor_t *descriptor) {
+  assert(allocator && descriptor);
+  pb_rewriter_t rewriter = {
+    .descriptor = descriptor,
+    .buffer     = pb_buffer_create_empty_with_allocator(allocator),
+    .references = pb_buffer_create_empty_with_allocator(allocator),
+    .referenced = 0
+  };
+  return rewriter;
+}
+
+/*!
+ * Destroy a rewriter.
+ *
+ * \param[in,out] rewriter Rewriter
+ */
+extern void
+pb_rewriter_destroy(pb_rewriter_t *rewriter) {
+  assert(rewriter);
+  if (pb_rewriter_valid(rewriter)) {
+    pb_buffer_destroy(&(rewriter->references));
+    pb_buffer_destroy(&(rewriter->buffer));
+  }
+}
+
+/*!
+ * Rewrite a message, substituting the values of the fields of a set of edits.
+ *
+ * Every edit consists of a path of tags, leading from the message through
+ * non-repeated submessages to a non-repeated scalar, string or bytes field,
+ * and a pointer holding the new value of the field, or NULL to remove it.
+ * Missing fields and submessages are appended, and of fields which occur
+ * more than once, only the last occurrence is rewritten. Submessages which
+ * occur more than once are merged when decoded, so the edited fields are
+ * removed from all but their last occurrence.
+ *
+ * The message is not copied. Instead, the rewriter only regenerates the
+ * edited fields and the length prefixes of their containing submessages, and
+ * references all untouched regions of the message in place, as well as new
+ * strings and bytes. The rewritten message can be obtained with
+ * pb_iovec_create_from_rewriter(), and written with writev() or sendmsg().
+ * Any previously rewritten message is discarded.
+ *
+ * \warning A rewriter does not take ownership of the buffer or the values, so
+ * the caller must ensure that they are not freed or altered before the
+ * rewritten message was written.
+ *
+ * \param[in,out] rewriter Rewriter
+ * \param[in]     buffer   Buffer
+ * \param[in]     edits[]  Edits
+ * \param[in]     size     Edit count
+ * \return                 Error code
+ */
+extern pb_error_t
+pb_rewriter_rewrite(
+    pb_rewriter_t *rewriter, const pb_buffer_t *buffer,
+    const pb_rewriter_edit_t edits[], size_t size) {
+  assert(rewriter && buffer && (edits || !size));
+  if (unlikely_(!pb_rewriter_valid(rewriter) || !pb_buffer_valid(buffer)))
+    return PB_ERROR_INVALID;
+
+  /* Discard previously rewritten message */
+  pb_allocator_t *allocator = pb_buffer_allocator(&(rewriter->buffer));
+  pb_buffer_destroy(&(rewriter->references));
+  pb_buffer_destroy(&(rewriter->buffer));
+  rewriter->buffer     = pb_buffer_create_empty_with_allocator(allocator);
+  rewriter->references = pb_buffer_create_empty_with_allocator(allocator);
+  rewriter->referenced = 0;
+
+  /* Reference the whole message, if there's nothing to edit */
+  if (!size)
+    return reference(rewriter, pb_buffer_data(buffer), pb_buffer_size(buffer));
+
+  /* Sort edits by path */
+  const pb_rewriter_edit_t **sorted = pb_allocator_allocate(
+    &allocator_default, sizeof(pb_rewriter_edit_t *) * size);
+  if (unlikely_(!sorted))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  for (size_t e = 0; e < size; e++)
+    sorted[e] = &(edits[e]);
+  qsort(sorted, size, sizeof(pb_rewriter_edit_t *), compare);
+
+  /* Ensure non-empty paths of which none is a prefix of another */
+  pb_error_t error = PB_ERROR_NONE;
+  for (size_t e = 0; !error && e < size; e++) {
+    const pb_rewriter_edit_t *edit = sorted[e];
+    if (unlikely_(!edit->path.size))
+      error = PB_ERROR_INVALID;
+    for (size_t t = 0; !error && t < edit->path.size; t++)
+      if (unlikely_(!edit->path.data[t]))
+        error = PB_ERROR_INVALID;
+    if (!error && e + 1 < size && edit->path.size <= sorted[e + 1]->path.size &&
+        !memcmp(edit->path.data, sorted[e + 1]->path.data,
+          sizeof(pb_tag_t) * edit->path.size))
+      error = PB_ERROR_INVALID;
+  }
+
+  /* Rewrite message and discard it on error */
+  if (!error)
+    error = rewrite(rewriter, rewriter->descriptor,
+      pb_buffer_data(buffer), pb_buffer_size(buffer), sorted, size, 0, 0);
+  if (unlikely_(error)) {
+    pb_buffer_destroy(&(rewriter->references));
+    pb_buffer_destroy(&(rewriter->buffer));
+    rewriter->buffer     = pb_buffer_create_empty_with_allocator(allocator);
+    rewriter->references = pb_buffer_create_empty_with_allocator(allocator);
+    rewriter->referenced = 0;
+  }
+  pb_allocator_free(&allocator_default, sorted);
+  return error;
+}
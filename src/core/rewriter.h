@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_CORE_REWRITER_H
+#define PB_CORE_REWRITER_H
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <protobluff/core/rewriter.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/encoder.h"
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create an invalid rewriter.
+ *
+ * \return Rewriter
+ */
+PB_WARN_UNUSED_RESULT
+PB_INLINE pb_rewriter_t
+pb_rewriter_create_invalid(void) {
+  pb_rewriter_t rewriter = {
+    .descriptor = NULL,
+    .buffer     = pb_buffer_create_invalid(),
+    .references = pb_buffer_create_invalid(),
+    .referenced = 0
+  };
+  return rewriter;
+}
+
+/*!
+ * Retrieve the regions referenced by a rewriter.
+ *
+ * Regions are referenced in the same way as strings by an encoder in
+ * scatter-gather mode, so both can be turned into segmented buffers alike.
+ *
+ * \param[in] rewriter Rewriter
+ * \return             References
+ */
+PB_INLINE const pb_encoder_reference_t *
+pb_rewriter_references(const pb_rewriter_t *rewriter) {
+  assert(rewriter);
+  return (const pb_encoder_reference_t *)
+    pb_buffer_data(&(rewriter->references));
+}
+
+/*!
+ * Retrieve the number of regions referenced by a rewriter.
+ *
+ * \param[in] rewriter Rewriter
+ * \return             Reference count
+ */
+PB_INLINE size_t
+pb_rewriter_references_count(const pb_rewriter_t *rewriter) {
+  assert(rewriter);
+  return pb_buffer_size(&(rewriter->references)) /
+    sizeof(pb_encoder_reference_t);
+}
+
+#endif /* PB_CORE_REWRITER_H */
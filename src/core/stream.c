@@ -25,8 +25,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "core/allocator.h"
 #include "core/buffer.h"
 #include "core/common.h"
+#include "core/iovec.h"
 #include "core/stream.h"
 #include "core/varint.h"
 
@@ -126,6 +128,8 @@ read_32bit(pb_stream_t *stream, pb_type_t type, void *value) {
 static pb_error_t
 skip_varint(pb_stream_t *stream) {
   assert(stream);
+  if (unlikely_(!pb_stream_left(stream)))
+    return PB_ERROR_VARINT;
   size_t size = pb_varint_scan(
     pb_buffer_data_from(stream->buffer, stream->offset),
     pb_stream_left(stream));
@@ -176,6 +180,246 @@ skip_32bit(pb_stream_t *stream) {
   return pb_stream_advance(stream, 4);
 }
 
+/* ----------------------------------------------------------------------------
+ * Segmented stream helpers
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the state of a segmented stream.
+ *
+ * The buffer of a segmented stream is the extent of its state, which is the
+ * first member of the latter, so the state can be recovered from it.
+ *
+ * \param[in] stream Stream
+ * \return           State
+ */
+static pb_stream_iovec_t *
+state(const pb_stream_t *stream) {
+  assert(stream);
+  return (pb_stream_iovec_t *)stream->buffer;
+}
+
+/*!
+ * Retrieve the contiguous bytes left in the current segment.
+ *
+ * Segments are advanced lazily, so the stream is moved to the segment which
+ * contains the current offset before the remaining bytes are determined.
+ *
+ * \param[in,out] stream Stream
+ * \param[out]    data   Pointer receiving raw data
+ * \return               Contiguous bytes left
+ */
+static size_t
+contiguous(pb_stream_t *stream, const uint8_t **data) {
+  assert(stream && data);
+  pb_stream_iovec_t *iovec = state(stream);
+  const struct iovec *segments = pb_iovec_segments(iovec->iovec);
+  size_t count = pb_iovec_count(iovec->iovec);
+
+  /* Move to segment containing current offset */
+  while (iovec->segment < count && stream->offset - iovec->base >=
+      segments[iovec->segment].iov_len)
+    iovec->base += segments[iovec->segment++].iov_len;
+
+  /* Return remaining bytes of segment, if any */
+  if (unlikely_(iovec->segment == count)) {
+    *data = NULL;
+    return 0;
+  }
+  const struct iovec *segment = &(segments[iovec->segment]);
+  *data = (const uint8_t *)segment->iov_base + stream->offset - iovec->base;
+  return segment->iov_len - (stream->offset - iovec->base);
+}
+
+/*!
+ * Copy bytes straddling segments into a contiguous buffer.
+ *
+ * \warning The caller has to ensure that enough bytes are left.
+ *
+ * \param[in,out] stream Stream
+ * \param[out]    data[] Target buffer
+ * \param[in]     size   Bytes to copy
+ */
+static void
+gather(pb_stream_t *stream, uint8_t data[], size_t size) {
+  assert(stream && data);
+  assert(size <= pb_stream_left(stream));
+  const struct iovec *segments = pb_iovec_segments(state(stream)->iovec);
+  const uint8_t *source;
+  size_t left = contiguous(stream, &source), s = state(stream)->segment;
+  while (size) {
+    size_t bytes = left < size ? left : size;
+    memcpy(data, source, bytes);
+    if (!(size -= bytes))
+      break;
+
+    /* Continue with next segment */
+    data  += bytes;
+    source = segments[++s].iov_base;
+    left   = segments[s].iov_len;
+  }
+}
+
+/* ----------------------------------------------------------------------------
+ * Segmented stream read callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Read a variable-sized integer from a segmented stream.
+ *
+ * If at least 10 contiguous bytes are left in the current segment, which is
+ * the maximum length of a variable-sized integer, the value is unpacked in
+ * place. Otherwise it may straddle segments and is gathered first.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     type   Type
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+static pb_error_t
+read_varint_iovec(pb_stream_t *stream, pb_type_t type, void *value) {
+  assert(stream && value);
+  const uint8_t *data;
+  size_t size, left = contiguous(stream, &data);
+  if (likely_(left >= 10 || (left && left == pb_stream_left(stream)))) {
+    size = pb_varint_unpack(type, data, left, value);
+  } else {
+    uint8_t temp[10];
+    left = pb_stream_left(stream) < 10 ? pb_stream_left(stream) : 10;
+    gather(stream, temp, left);
+    size = pb_varint_unpack(type, temp, left, value);
+  }
+  return likely_(size != 0)
+    ? pb_stream_advance(stream, size)
+    : PB_ERROR_VARINT;
+}
+
+/*!
+ * Read a fixed-sized value from a segmented stream.
+ *
+ * \param[in,out] stream Stream
+ * \param[out]    value  Pointer receiving value
+ * \param[in]     size   Value size
+ * \return               Error code
+ */
+static pb_error_t
+read_fixed_iovec(pb_stream_t *stream, void *value, size_t size) {
+  assert(stream && value);
+  if (unlikely_(pb_stream_left(stream) < size))
+    return PB_ERROR_OFFSET;
+  const uint8_t *data;
+  if (likely_(contiguous(stream, &data) >= size)) {
+    memcpy(value, data, size);
+  } else {
+    gather(stream, value, size);
+  }
+  return pb_stream_advance(stream, size);
+}
+
+/*!
+ * Read a fixed-sized 64-bit value from a segmented stream.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     type   Type
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+static pb_error_t
+read_64bit_iovec(pb_stream_t *stream, pb_type_t type, void *value) {
+  assert(stream && value);
+  return read_fixed_iovec(stream, value, 8);
+}
+
+/*!
+ * Read a length-prefixed value from a segmented stream.
+ *
+ * Values contained in a single segment are returned in place. Values that
+ * straddle segments are copied into the scratch buffer of the stream, which
+ * is only valid until the next straddling value is read.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     type   Type
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+static pb_error_t
+read_length_iovec(pb_stream_t *stream, pb_type_t type, void *value) {
+  assert(stream && value);
+  uint32_t length = 0;
+  pb_error_t error = read_varint_iovec(stream, PB_TYPE_UINT32, &length);
+  if (unlikely_(error))
+    return error;
+  if (unlikely_(pb_stream_left(stream) < length))
+    return PB_ERROR_OFFSET;
+
+  /* Return value in place, if contained in the current segment */
+  const uint8_t *data;
+  if (likely_(contiguous(stream, &data) >= length && data)) {
+    *(pb_string_t *)value = pb_string_init((uint8_t *)data, length);
+
+  /* Otherwise copy value into scratch buffer */
+  } else if (length) {
+    pb_buffer_t *scratch = &(state(stream)->scratch);
+    if (pb_buffer_size(scratch) < length &&
+        !pb_buffer_grow(scratch, length - pb_buffer_size(scratch)))
+      return PB_ERROR_ALLOC;
+    gather(stream, scratch->data, length);
+    *(pb_string_t *)value = pb_string_init(scratch->data, length);
+
+  /* Empty value at the end of the stream */
+  } else {
+    *(pb_string_t *)value = pb_string_init((uint8_t *)"", 0);
+  }
+  return pb_stream_advance(stream, length);
+}
+
+/*!
+ * Read a fixed-sized 32-bit value from a segmented stream.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     type   Type
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+static pb_error_t
+read_32bit_iovec(pb_stream_t *stream, pb_type_t type, void *value) {
+  assert(stream && value);
+  return read_fixed_iovec(stream, value, 4);
+}
+
+/* ----------------------------------------------------------------------------
+ * Segmented stream skip callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Skip a variable-sized integer in a segmented stream.
+ *
+ * \param[in,out] stream Stream
+ * \return               Error code
+ */
+static pb_error_t
+skip_varint_iovec(pb_stream_t *stream) {
+  assert(stream);
+  uint64_t value;
+  return read_varint_iovec(stream, PB_TYPE_UINT64, &value);
+}
+
+/*!
+ * Skip a length-prefixed value in a segmented stream.
+ *
+ * \param[in,out] stream Stream
+ * \return               Error code
+ */
+static pb_error_t
+skip_length_iovec(pb_stream_t *stream) {
+  assert(stream);
+  uint32_t length = 0;
+  pb_error_t error = read_varint_iovec(stream, PB_TYPE_UINT32, &length);
+  return likely_(!error)
+    ? pb_stream_advance(stream, length)
+    : error;
+}
+
 /* ----------------------------------------------------------------------------
  * Jump tables
  * ------------------------------------------------------------------------- */
@@ -211,6 +455,37 @@ pb_stream_skip_jump[7] = {
   [PB_WIRETYPE_32BIT]  = skip_32bit
 };
 
+/*! Jump table: type ==> read method (segmented) */
+const pb_stream_read_f
+pb_stream_read_iovec_jump[] = {
+  [PB_TYPE_INT32]    = read_varint_iovec,
+  [PB_TYPE_INT64]    = read_varint_iovec,
+  [PB_TYPE_UINT32]   = read_varint_iovec,
+  [PB_TYPE_UINT64]   = read_varint_iovec,
+  [PB_TYPE_SINT32]   = read_varint_iovec,
+  [PB_TYPE_SINT64]   = read_varint_iovec,
+  [PB_TYPE_FIXED32]  = read_32bit_iovec,
+  [PB_TYPE_FIXED64]  = read_64bit_iovec,
+  [PB_TYPE_SFIXED32] = read_32bit_iovec,
+  [PB_TYPE_SFIXED64] = read_64bit_iovec,
+  [PB_TYPE_BOOL]     = read_varint_iovec,
+  [PB_TYPE_ENUM]     = read_varint_iovec,
+  [PB_TYPE_FLOAT]    = read_32bit_iovec,
+  [PB_TYPE_DOUBLE]   = read_64bit_iovec,
+  [PB_TYPE_STRING]   = read_length_iovec,
+  [PB_TYPE_BYTES]    = read_length_iovec,
+  [PB_TYPE_MESSAGE]  = read_length_iovec
+};
+
+/*! Jump table: wiretype ==> skip method (segmented) */
+const pb_stream_skip_f
+pb_stream_skip_iovec_jump[7] = {
+  [PB_WIRETYPE_VARINT] = skip_varint_iovec,
+  [PB_WIRETYPE_64BIT]  = skip_64bit,
+  [PB_WIRETYPE_LENGTH] = skip_length_iovec,
+  [PB_WIRETYPE_32BIT]  = skip_32bit
+};
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -230,3 +505,115 @@ pb_stream_advance(pb_stream_t *stream, size_t advance) {
   stream->offset += advance;
   return PB_ERROR_NONE;
 }
+
+/*!
+ * Retrieve a pointer to the given number of contiguous bytes at the current
+ * offset of a stream without advancing it.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     size   Contiguous bytes
+ * \return               Raw data or NULL
+ */
+extern const uint8_t *
+pb_stream_data(pb_stream_t *stream, size_t size) {
+  assert(stream);
+  if (unlikely_(pb_stream_left(stream) < size))
+    return NULL;
+  return pb_buffer_data_from(stream->buffer, stream->offset);
+}
+
+/*!
+ * Retrieve a pointer to the given number of contiguous bytes at the current
+ * offset of a segmented stream without advancing it.
+ *
+ * NULL is returned if the bytes straddle segments.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     size   Contiguous bytes
+ * \return               Raw data or NULL
+ */
+extern const uint8_t *
+pb_stream_data_iovec(pb_stream_t *stream, size_t size) {
+  assert(stream);
+  if (unlikely_(pb_stream_left(stream) < size))
+    return NULL;
+  const uint8_t *data;
+  return contiguous(stream, &data) >= size
+    ? data
+    : NULL;
+}
+
+/*!
+ * Read the next field of a stream, advancing past its value.
+ *
+ * The offsets of the tag and the end of the field are recorded, as well as
+ * the offset of its value, which is located behind the length prefix for
+ * length-prefixed fields, so the value itself is never read.
+ *
+ * \param[in,out] stream Stream
+ * \param[out]    field  Pointer receiving field
+ * \return               Error code
+ */
+extern pb_error_t
+pb_stream_next(pb_stream_t *stream, pb_stream_field_t *field) {
+  assert(stream && field);
+  field->start = stream->offset;
+  uint32_t key; pb_error_t error;
+  if (unlikely_(error = pb_stream_read(stream, PB_TYPE_UINT32, &key)))
+    return error;
+  field->tag      = key >> 3;
+  field->wiretype = key & 7;
+  field->header   = stream->offset;
+  if (unlikely_(!field->tag || field->wiretype > PB_WIRETYPE_32BIT ||
+      !pb_stream_skip_jump[field->wiretype]))
+    return PB_ERROR_INVALID;
+
+  /* Skip value, stripping the length prefix */
+  if (field->wiretype == PB_WIRETYPE_LENGTH) {
+    uint32_t length;
+    if (unlikely_(error = pb_stream_read(stream, PB_TYPE_UINT32, &length)))
+      return error;
+    field->value = stream->offset;
+    error = pb_stream_advance(stream, length);
+  } else {
+    field->value = stream->offset;
+    error = pb_stream_skip(stream, field->wiretype);
+  }
+  field->end = stream->offset;
+  return error;
+}
+
+/*!
+ * Collect all remaining fields of a stream in a single pass.
+ *
+ * The resulting array must be freed by the caller, even if an error occurred.
+ *
+ * \param[in,out] stream Stream
+ * \param[out]    fields Pointer receiving fields
+ * \param[out]    count  Pointer receiving field count
+ * \return               Error code
+ */
+extern pb_error_t
+pb_stream_scan(
+    pb_stream_t *stream, pb_stream_field_t **fields, size_t *count) {
+  assert(stream && fields && count);
+  size_t capacity = 0;
+  while (pb_stream_left(stream)) {
+    pb_stream_field_t field;
+    pb_error_t error = pb_stream_next(stream, &field);
+    if (unlikely_(error))
+      return error;
+
+    /* Grow array of fields, if necessary */
+    if (unlikely_(*count == capacity)) {
+      pb_stream_field_t *temp = pb_allocator_resize(&allocator_default,
+        *fields, sizeof(pb_stream_field_t) *
+          (capacity = capacity ? capacity << 1 : 16));
+      if (unlikely_(!temp))
+        return PB_ERROR_ALLOC;                             /* LCOV_EXCL_LINE */
+      *fields = temp;
+    }
+    (*fields)[(*count)++] = field;
+  }
+  return PB_ERROR_NONE;
+}
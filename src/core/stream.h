@@ -28,6 +28,7 @@
 
 #include "core/buffer.h"
 #include "core/common.h"
+#include "core/iovec.h"
 
 /* ----------------------------------------------------------------------------
  * Type definitions
@@ -38,6 +39,14 @@ typedef struct pb_stream_t {
   size_t offset;                       /*!< Current offset */
 } pb_stream_t;
 
+typedef struct pb_stream_iovec_t {
+  pb_buffer_t extent;                  /*!< Extent without data */
+  const pb_iovec_t *iovec;             /*!< Segmented buffer */
+  size_t segment;                      /*!< Current segment */
+  size_t base;                         /*!< Offset of current segment */
+  pb_buffer_t scratch;                 /*!< Straddling strings */
+} pb_stream_iovec_t;
+
 /* ------------------------------------------------------------------------- */
 
 typedef pb_error_t
@@ -50,6 +59,17 @@ typedef pb_error_t
 (*pb_stream_skip_f)(
   pb_stream_t *stream);                /*!< Stream */
 
+/* ------------------------------------------------------------------------- */
+
+typedef struct pb_stream_field_t {
+  pb_tag_t tag;                        /*!< Tag */
+  pb_wiretype_t wiretype;              /*!< Wiretype */
+  size_t start;                        /*!< Offset of tag */
+  size_t header;                       /*!< Offset after tag */
+  size_t value;                        /*!< Offset of value */
+  size_t end;                          /*!< End offset */
+} pb_stream_field_t;
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -59,6 +79,27 @@ pb_stream_advance(
   pb_stream_t *stream,                 /* Stream */
   size_t advance);                     /* Bytes to advance */
 
+extern const uint8_t *
+pb_stream_data(
+  pb_stream_t *stream,                 /* Stream */
+  size_t size);                        /* Contiguous bytes */
+
+extern const uint8_t *
+pb_stream_data_iovec(
+  pb_stream_t *stream,                 /* Stream */
+  size_t size);                        /* Contiguous bytes */
+
+extern pb_error_t
+pb_stream_next(
+  pb_stream_t *stream,                 /* Stream */
+  pb_stream_field_t *field);           /* Pointer receiving field */
+
+extern pb_error_t
+pb_stream_scan(
+  pb_stream_t *stream,                 /* Stream */
+  pb_stream_field_t **fields,          /* Pointer receiving fields */
+  size_t *count);                      /* Pointer receiving field count */
+
 /* ----------------------------------------------------------------------------
  * Jump tables
  * ------------------------------------------------------------------------- */
@@ -71,6 +112,14 @@ pb_stream_read_jump[];
 extern const pb_stream_skip_f
 pb_stream_skip_jump[];
 
+/*! Jump table: type ==> read method (segmented) */
+extern const pb_stream_read_f
+pb_stream_read_iovec_jump[];
+
+/*! Jump table: wiretype ==> skip method (segmented) */
+extern const pb_stream_skip_f
+pb_stream_skip_iovec_jump[];
+
 /* ----------------------------------------------------------------------------
  * Inline functions
  * ------------------------------------------------------------------------- */
@@ -116,6 +165,32 @@ pb_stream_create_at(const pb_buffer_t *buffer, size_t offset) {
   return stream;
 }
 
+/*!
+ * Create a stream over the state of a segmented buffer.
+ *
+ * The state of a segmented stream is kept outside of the stream, so streams
+ * over buffers, which are far more common, stay small. The stream's buffer
+ * only spans the extent of the segmented buffer without holding any data, so
+ * all reads and skips must be dispatched through the segmented jump tables,
+ * and contiguous data must be retrieved with pb_stream_data_iovec().
+ *
+ * \warning A stream does not take ownership of the provided state, so the
+ * caller must ensure that it is not freed during operations.
+ *
+ * \param[in,out] state State
+ * \return              Stream
+ */
+PB_WARN_UNUSED_RESULT
+PB_INLINE pb_stream_t
+pb_stream_create_from_iovec(pb_stream_iovec_t *state) {
+  assert(state);
+  pb_stream_t stream = {
+    .buffer = &(state->extent),
+    .offset = 0
+  };
+  return stream;
+}
+
 /*!
  * Destroy a stream.
  *
@@ -126,6 +201,43 @@ pb_stream_destroy(pb_stream_t *stream) {
   assert(stream); /* Nothing to be done */
 }
 
+/*!
+ * Create the state of a stream over a segmented buffer.
+ *
+ * \warning The state does not take ownership of the provided segmented buffer,
+ * so the caller must ensure that it is not freed during operations.
+ *
+ * \param[in] iovec Segmented buffer
+ * \return          State
+ */
+PB_WARN_UNUSED_RESULT
+PB_INLINE pb_stream_iovec_t
+pb_stream_iovec_create(const pb_iovec_t *iovec) {
+  assert(iovec);
+  assert(pb_iovec_valid(iovec));
+  pb_stream_iovec_t state = {
+    .extent  = pb_buffer_create_zero_copy_internal(
+      NULL, pb_iovec_size(iovec)),
+    .iovec   = iovec,
+    .segment = 0,
+    .base    = 0,
+    .scratch = pb_buffer_create_empty_with_allocator(
+      pb_iovec_allocator(iovec))
+  };
+  return state;
+}
+
+/*!
+ * Destroy the state of a stream over a segmented buffer.
+ *
+ * \param[in,out] state State
+ */
+PB_INLINE void
+pb_stream_iovec_destroy(pb_stream_iovec_t *state) {
+  assert(state);
+  pb_buffer_destroy(&(state->scratch));
+}
+
 /*!
  * Retrieve the buffer of a stream.
  *
@@ -151,27 +263,27 @@ pb_stream_offset(const pb_stream_t *stream) {
 }
 
 /*!
- * Retrieve the number of bytes left in a stream.
+ * Retrieve the size of a stream.
  *
  * \param[in] stream Stream
- * \return           Bytes left
+ * \return           Stream size
  */
 PB_INLINE size_t
-pb_stream_left(const pb_stream_t *stream) {
+pb_stream_size(const pb_stream_t *stream) {
   assert(stream);
-  return pb_buffer_size(stream->buffer) - stream->offset;
+  return pb_buffer_size(stream->buffer);
 }
 
 /*!
- * Retrieve the size of a stream.
+ * Retrieve the number of bytes left in a stream.
  *
  * \param[in] stream Stream
- * \return           Stream size
+ * \return           Bytes left
  */
 PB_INLINE size_t
-pb_stream_size(const pb_stream_t *stream) {
+pb_stream_left(const pb_stream_t *stream) {
   assert(stream);
-  return pb_buffer_size(stream->buffer);
+  return pb_stream_size(stream) - stream->offset;
 }
 
 /*!
@@ -189,6 +301,9 @@ pb_stream_empty(const pb_stream_t *stream) {
 /*!
  * Read a value of given type.
  *
+ * Streams over segmented buffers must be read through the segmented jump
+ * table instead, so reading from a buffer doesn't pay for their support.
+ *
  * \param[in,out] stream Stream
  * \param[in]     type   Type
  * \param[out]    value  Pointer receiving value
@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <string>
 #include <vector>
 
 #include <google/protobuf/descriptor.h>
@@ -30,6 +31,7 @@
 
 #include "generator/enum.hh"
 #include "generator/enum_value.hh"
+#include "generator/name_table.hh"
 #include "generator/strutil.hh"
 
 /* ----------------------------------------------------------------------------
@@ -39,6 +41,7 @@
 namespace protobluff {
 
   using ::std::sort;
+  using ::std::string;
   using ::std::vector;
 
   using ::google::protobuf::EnumDescriptor;
@@ -143,8 +146,15 @@ namespace protobluff {
       /* Generate descriptor footer */
       printer->Print(
         "\n"
-        "  }, `values` } };\n"
-        "\n", "values", SimpleItoa(descriptor_->value_count()));
+        "  }, `values` }", "values", SimpleItoa(descriptor_->value_count()));
+
+      /* Generate name table */
+      vector<string> names;
+      for (size_t v = 0; v < descriptor_->value_count(); v++)
+        names.push_back(values_[v]->GetName());
+      NameTable(names).GenerateTable(printer);
+      printer->Print(" };\n"
+        "\n");
 
     /* Print empty descriptor, if enum contains no values */
     } else {
@@ -90,6 +90,16 @@ namespace protobluff {
       "  .name   = \"`name`\" }");
   }
 
+  /*!
+   * Retrieve the name of an enum value as stored in its descriptor.
+   *
+   * \return Name
+   */
+  string EnumValue::
+  GetName() const {
+    return descriptor_->name();
+  }
+
   /*!
    * Comparator for enum value generators.
    *
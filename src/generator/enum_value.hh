@@ -61,6 +61,10 @@ namespace protobluff {
       Printer *printer)                /* Printer */
     const;
 
+    string
+    GetName()
+    const;
+
     friend bool
     EnumValueComparator(
       const EnumValue *x,              /* Enum value generator */
@@ -30,6 +30,7 @@
 
 #include "generator/extension.hh"
 #include "generator/field.hh"
+#include "generator/name_table.hh"
 #include "generator/strutil.hh"
 
 /* ----------------------------------------------------------------------------
@@ -152,8 +153,15 @@ namespace protobluff {
     /* Generate descriptor footer */
     printer->Print(
       "\n"
-      "  }, `fields` } };\n"
-      "\n", "fields", SimpleItoa(fields_.size()));
+      "  }, `fields` }", "fields", SimpleItoa(fields_.size()));
+
+    /* Generate name table */
+    vector<string> names;
+    for (size_t f = 0; f < fields_.size(); f++)
+      names.push_back(fields_[f]->GetName());
+    NameTable(names).GenerateTable(printer);
+    printer->Print(" };\n"
+      "\n");
   }
 
   /*!
@@ -835,6 +835,16 @@ namespace protobluff {
       (descriptor_->enum_type() && descriptor_->is_optional());
   }
 
+  /*!
+   * Retrieve the name of a field as stored in its descriptor.
+   *
+   * \return Name
+   */
+  string Field::
+  GetName() const {
+    return variables_.find("name")->second;
+  }
+
   /*!
    * Comparator for field generators.
    *
@@ -88,6 +88,10 @@ namespace protobluff {
     HasDefault()
     const;
 
+    string
+    GetName()
+    const;
+
     friend bool
     FieldComparator(
       const Field *x,                  /* Field generator */
@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <cassert>
 #include <set>
+#include <string>
 #include <vector>
 
 #include <google/protobuf/descriptor.h>
@@ -33,6 +34,7 @@
 #include "generator/enum.hh"
 #include "generator/field.hh"
 #include "generator/message.hh"
+#include "generator/name_table.hh"
 #include "generator/oneof.hh"
 #include "generator/strutil.hh"
 
@@ -44,6 +46,7 @@ namespace protobluff {
 
   using ::std::set;
   using ::std::sort;
+  using ::std::string;
   using ::std::vector;
 
   using ::google::protobuf::Descriptor;
@@ -210,8 +213,15 @@ namespace protobluff {
       /* Generate descriptor footer */
       printer->Print(
         "\n"
-        "  }, `fields` } };\n"
-        "\n", "fields", SimpleItoa(descriptor_->field_count()));
+        "  }, `fields` }", "fields", SimpleItoa(descriptor_->field_count()));
+
+      /* Generate name table */
+      vector<string> names;
+      for (size_t f = 0; f < descriptor_->field_count(); f++)
+        names.push_back(fields_[f]->GetName());
+      NameTable(names).GenerateTable(printer);
+      printer->Print(" };\n"
+        "\n");
 
     /* Print empty descriptor, if message contains no fields */
     } else {
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cassert>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/io/printer.h>
+
+#include "generator/name_table.hh"
+#include "generator/strutil.hh"
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+namespace protobluff {
+
+  using ::std::string;
+  using ::std::vector;
+
+  using ::google::protobuf::io::Printer;
+
+  using ::google::protobuf::SimpleItoa;
+
+  /*!
+   * Compute the seeded hash of a name.
+   *
+   * This must be kept in sync with the hash function of the runtime, which is
+   * used to look up names in the generated tables.
+   *
+   * \param[in] name Name
+   * \param[in] seed Seed
+   * \return         Hash
+   */
+  static uint32_t
+  Hash(const string &name, uint32_t seed) {
+    uint32_t value = 2166136261U ^ seed;
+    for (size_t c = 0; c < name.size(); c++)
+      value = (value ^ static_cast<uint8_t>(name[c])) * 16777619U;
+    return value ^ (value >> 16);
+  }
+
+  /*!
+   * Create a perfect-hash name table generator.
+   *
+   * The slot count starts at the next power of two of twice the number of
+   * names and is doubled whenever none of a handful of seeds maps all names
+   * to distinct slots. Names must be given in the order of the descriptors.
+   *
+   * \param[in] names Names
+   */
+  NameTable::
+  NameTable(const vector<string> &names) :
+      seed_(0) {
+    for (size_t size = 2; size <= 64 * names.size(); size <<= 1) {
+      if (size < 2 * names.size())
+        continue;
+
+      /* Try seeds until all names map to distinct slots */
+      for (uint32_t seed = 0; seed < 64; seed++) {
+        vector<uint32_t> slots(size, 0);
+        size_t n = 0;
+        for (; n < names.size(); n++) {
+          uint32_t &slot = slots[Hash(names[n], seed) & (size - 1)];
+          if (slot)
+            break;
+          slot = n + 1;
+        }
+        if (n == names.size()) {
+          seed_  = seed;
+          slots_ = slots;
+          return;
+        }
+      }
+    }
+  }
+
+  /*!
+   * Generate table.
+   *
+   * The table is emitted as the designated initializer of the names member
+   * of a descriptor, including the leading separator. Nothing is generated if
+   * there are no names or no table could be built.
+   *
+   * \param[in,out] printer Printer
+   */
+  void NameTable::
+  GenerateTable(Printer *printer) const {
+    assert(printer);
+    if (slots_.empty())
+      return;
+
+    /* Generate table header */
+    printer->Print(",\n"
+      "  .names = &(const pb_name_table_t){ `seed`, `size`, "
+        "(const uint32_t []){\n"
+      "    ", "seed", SimpleItoa(seed_), "size", SimpleItoa(slots_.size()));
+
+    /* Generate slots */
+    for (size_t s = 0; s < slots_.size(); s++) {
+      printer->Print("`slot`", "slot", SimpleItoa(slots_[s]));
+      if (s < slots_.size() - 1)
+        printer->Print(s % 16 == 15 ? ",\n    " : ", ");
+    }
+
+    /* Generate table footer */
+    printer->Print(" } }");
+  }
+}
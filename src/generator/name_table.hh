@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_GENERATOR_NAME_TABLE_HH
+#define PB_GENERATOR_NAME_TABLE_HH
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/io/printer.h>
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+namespace protobluff {
+
+  using ::std::string;
+  using ::std::vector;
+
+  using ::google::protobuf::io::Printer;
+
+  class NameTable {
+
+  public:
+    explicit
+    NameTable(
+      const vector<string> &names);    /* Names */
+
+    void
+    GenerateTable(
+      Printer *printer)                /* Printer */
+    const;
+
+  private:
+    uint32_t seed_;                    /* Hash seed */
+    vector<uint32_t> slots_;           /* Slots holding index + 1 or 0 */
+  };
+}
+
+#endif /* PB_GENERATOR_NAME_TABLE_HH */
@@ -38,6 +38,8 @@
 
 namespace protobluff {
 
+  using ::std::max;
+  using ::std::min;
   using ::std::sort;
   using ::std::string;
   using ::std::vector;
@@ -146,11 +148,43 @@ namespace protobluff {
       }
     }
 
-    /* Generate descriptor footer */
+    /* Generate index footer */
     printer->Print(
       "\n"
-      "    }, `fields` } };\n"
-      "\n", "fields", SimpleItoa(descriptor_->field_count()));
+      "    }, `fields` }", "fields", SimpleItoa(descriptor_->field_count()));
+
+    /* Determine range of member tags */
+    int base = descriptor_->field(0)->number(), last = base;
+    for (size_t f = 1; f < descriptor_->field_count(); f++) {
+      base = min(base, descriptor_->field(f)->number());
+      last = max(last, descriptor_->field(f)->number());
+    }
+
+    /* Generate member tag bitmap, if compact enough */
+    size_t bits = last - base + 1;
+    if (bits <= 256) {
+      vector<int> bitmap((bits + 7) / 8, 0);
+      for (size_t f = 0; f < descriptor_->field_count(); f++) {
+        size_t bit = descriptor_->field(f)->number() - base;
+        bitmap[bit >> 3] |= 1 << (bit & 7);
+      }
+      printer->Print(", {\n"
+        "    (const uint8_t []){\n"
+        "      ");
+      for (size_t b = 0; b < bitmap.size(); b++) {
+        printer->Print("`byte`", "byte", SimpleItoa(bitmap[b]));
+        if (b < bitmap.size() - 1)
+          printer->Print(", ");
+      }
+      printer->Print(
+        "\n"
+        "    }, `base`, `bits` }", "base", SimpleItoa(base),
+          "bits", SimpleItoa(bits));
+    }
+
+    /* Generate descriptor footer */
+    printer->Print(" };\n"
+      "\n");
   }
 
   /*!
@@ -162,6 +196,17 @@ namespace protobluff {
   GenerateAccessors(Printer *printer) const {
     assert(printer);
     printer->Print(variables_,
+      "/* `signature` : create */\n"
+      "PB_WARN_UNUSED_RESULT\n"
+      "PB_INLINE pb_oneof_t\n"
+      "`message`_create_`name`(\n"
+      "    pb_message_t *message) {\n"
+      "  assert(pb_message_descriptor(message) == \n"
+      "    &`message`_descriptor);\n"
+      "  return pb_oneof_create(\n"
+      "    &`oneof`_descriptor, message);\n"
+      "}\n"
+      "\n"
       "/* `signature` : case */\n"
       "PB_INLINE pb_tag_t\n"
       "`message`_case_`name`(\n"
@@ -169,7 +214,7 @@ namespace protobluff {
       "  assert(pb_message_descriptor(message) == \n"
       "    &`message`_descriptor);\n"
       "  pb_oneof_t oneof = pb_oneof_create(\n"
-      "    &`message`_descriptor, message);\n"
+      "    &`oneof`_descriptor, message);\n"
       "  pb_tag_t tag = pb_oneof_case(&oneof);\n"
       "  pb_oneof_destroy(&oneof);\n"
       "  return tag;\n"
@@ -27,9 +27,779 @@
 #include <string.h>
 
 #include "core/allocator.h"
+#include "core/descriptor.h"
+#include "core/stream.h"
+#include "core/varint.h"
 #include "message/buffer.h"
 #include "message/common.h"
 
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Occurrence of a field inside a message.
+ */
+typedef struct occurrence_t {
+  pb_tag_t tag;                        /*!< Tag */
+  pb_wiretype_t wiretype;              /*!< Wiretype */
+  const uint8_t *data;                 /*!< Value, without length prefix */
+  size_t size;                         /*!< Value size */
+} occurrence_t;
+
+/*!
+ * Consecutive occurrences of a field with the same tag.
+ */
+typedef struct group_t {
+  pb_tag_t tag;                        /*!< Tag */
+  size_t start;                        /*!< Start offset */
+  size_t end;                          /*!< End offset */
+  occurrence_t first;                  /*!< First occurrence */
+  size_t count;                        /*!< Occurrence count */
+} group_t;
+
+/*!
+ * Patch operation.
+ */
+typedef enum operation_t {
+  OPERATION_SET    = 0,                /*!< Replace all occurrences */
+  OPERATION_CLEAR  = 1,                /*!< Remove all occurrences */
+  OPERATION_APPEND = 2,                /*!< Append occurrences */
+  OPERATION_NESTED = 3                 /*!< Patch submessage */
+} operation_t;
+
+/*!
+ * Decoded patch operation for a tag.
+ */
+typedef struct change_t {
+  pb_tag_t tag;                        /*!< Tag */
+  operation_t operation;               /*!< Operation */
+  const uint8_t *data;                 /*!< Payload */
+  size_t size;                         /*!< Payload size */
+  occurrence_t last;                   /*!< Last occurrence in target */
+} change_t;
+
+/*!
+ * Growable output buffer with sticky error state.
+ */
+typedef struct sink_t {
+  pb_allocator_t *allocator;           /*!< Allocator */
+  uint8_t *data;                       /*!< Raw data */
+  size_t size;                         /*!< Raw data size */
+  size_t capacity;                     /*!< Raw data capacity */
+  pb_error_t error;                    /*!< Error code */
+} sink_t;
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Reserve space in a sink and return a pointer to it.
+ *
+ * \param[in,out] sink Sink
+ * \param[in]     size Size
+ * \return             Reserved space or NULL on error
+ */
+static uint8_t *
+sink_reserve(sink_t *sink, size_t size) {
+  assert(sink);
+  if (unlikely_(sink->error))
+    return NULL;
+
+  /* Grow capacity in powers of two */
+  if (sink->size + size > sink->capacity) {
+    size_t capacity = sink->capacity ? sink->capacity : 64;
+    while (capacity < sink->size + size)
+      capacity <<= 1;
+    uint8_t *data = pb_allocator_resize(sink->allocator, sink->data, capacity);
+    if (unlikely_(!data)) {
+      sink->error = PB_ERROR_ALLOC;                        /* LCOV_EXCL_LINE */
+      return NULL;                                         /* LCOV_EXCL_LINE */
+    }
+    sink->data     = data;
+    sink->capacity = capacity;
+  }
+  return &(sink->data[sink->size]);
+}
+
+/*!
+ * Append raw data to a sink.
+ *
+ * \param[in,out] sink   Sink
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ */
+static void
+sink_append(sink_t *sink, const uint8_t data[], size_t size) {
+  assert(sink && (data || !size));
+  uint8_t *temp = size ? sink_reserve(sink, size) : NULL;
+  if (likely_(temp != NULL)) {
+    memcpy(temp, data, size);
+    sink->size += size;
+  }
+}
+
+/*!
+ * Append a minimally encoded varint to a sink.
+ *
+ * \param[in,out] sink  Sink
+ * \param[in]     value Value
+ */
+static void
+sink_append_varint(sink_t *sink, uint64_t value) {
+  assert(sink);
+  uint8_t *temp = sink_reserve(sink, 10);
+  if (likely_(temp != NULL))
+    sink->size += pb_varint_pack_uint64(temp, &value);
+}
+
+/*!
+ * Insert a minimal length prefix for all data appended since the given mark.
+ *
+ * \param[in,out] sink Sink
+ * \param[in]     mark Offset of length-prefixed data
+ */
+static void
+sink_prefix(sink_t *sink, size_t mark) {
+  assert(sink && mark <= sink->size);
+  uint32_t length = sink->size - mark;
+  uint8_t data[5]; size_t size = pb_varint_pack_uint32(data, &length);
+  if (likely_(sink_reserve(sink, size) != NULL)) {
+    memmove(&(sink->data[mark + size]), &(sink->data[mark]), length);
+    memcpy(&(sink->data[mark]), data, size);
+    sink->size += size;
+  }
+}
+
+/*!
+ * Create a sink appending to the data of a buffer.
+ *
+ * \param[in] buffer Buffer
+ * \return           Sink
+ */
+static sink_t
+sink_create(const pb_buffer_t *buffer) {
+  assert(buffer);
+  sink_t sink = {
+    .allocator = buffer->allocator,
+    .data      = buffer->data,
+    .size      = buffer->size,
+    .capacity  = buffer->size
+  };
+  return sink;
+}
+
+/*!
+ * Hand the data of a sink back to the buffer it was created from.
+ *
+ * If an error occurred, everything appended to the sink is discarded, so the
+ * buffer retains its original contents. The data is shrunk to its size.
+ *
+ * \param[in,out] sink   Sink
+ * \param[in,out] buffer Buffer
+ * \return               Error code
+ */
+static pb_error_t
+sink_commit(sink_t *sink, pb_buffer_t *buffer) {
+  assert(sink && buffer);
+  if (unlikely_(sink->error))
+    sink->size = buffer->size;
+
+  /* Shrink data to its size */
+  if (!sink->size && sink->data) {
+    pb_allocator_free(sink->allocator, sink->data);
+    sink->data = NULL;
+  } else if (sink->size < sink->capacity) {
+    uint8_t *temp =
+      pb_allocator_resize(sink->allocator, sink->data, sink->size);
+    if (temp)
+      sink->data = temp;
+  }
+  buffer->data = sink->data;
+  buffer->size = sink->size;
+  return sink->error;
+}
+
+/*!
+ * Compare two fields by tag and offset.
+ *
+ * \param[in] x Field
+ * \param[in] y Field
+ * \return      Comparison result
+ */
+static int
+compare(const void *x, const void *y) {
+  const pb_stream_field_t *a = x, *b = y;
+  if (a->tag != b->tag)
+    return a->tag < b->tag ? -1 : 1;
+  return a->start < b->start ? -1 : a->start > b->start;
+}
+
+/*!
+ * Create an occurrence from a field read from raw data.
+ *
+ * \param[in] data[] Raw data
+ * \param[in] field  Field
+ * \return           Occurrence
+ */
+static occurrence_t
+occurrence_create(const uint8_t data[], const pb_stream_field_t *field) {
+  assert(data && field);
+  occurrence_t occurrence = {
+    .tag      = field->tag,
+    .wiretype = field->wiretype,
+    .data     = &(data[field->value]),
+    .size     = field->end - field->value
+  };
+  return occurrence;
+}
+
+/*!
+ * Read the next occurrence of a field from raw data.
+ *
+ * \param[in]     data[]     Raw data
+ * \param[in]     size       Raw data size
+ * \param[in,out] offset     Offset, advanced past the occurrence
+ * \param[out]    occurrence Occurrence
+ * \return                   Error code
+ */
+static pb_error_t
+next(
+    const uint8_t data[], size_t size, size_t *offset,
+    occurrence_t *occurrence) {
+  assert(data && offset && *offset < size && occurrence);
+  pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+    (uint8_t *)data, size);
+  pb_stream_t stream = pb_stream_create_at(&buffer, *offset);
+  pb_stream_field_t field;
+  pb_error_t error = pb_stream_next(&stream, &field);
+  if (likely_(!error)) {
+    *occurrence = occurrence_create(data, &field);
+    *offset = field.end;
+  }
+  pb_stream_destroy(&stream);
+  return error;
+}
+
+/*!
+ * Append an occurrence of a field in canonical form to a sink.
+ *
+ * Tags, varints and length prefixes are re-encoded minimally, all other
+ * values are copied as they are.
+ *
+ * \param[in,out] sink       Sink
+ * \param[in]     occurrence Occurrence
+ */
+static void
+canonicalize_field(sink_t *sink, const occurrence_t *occurrence) {
+  assert(sink && occurrence);
+  sink_append_varint(sink, occurrence->tag << 3 | occurrence->wiretype);
+  if (occurrence->wiretype == PB_WIRETYPE_VARINT) {
+    uint64_t value;
+    if (unlikely_(!pb_varint_unpack_uint64(
+        occurrence->data, occurrence->size, &value)))
+      sink->error = PB_ERROR_VARINT;                       /* LCOV_EXCL_LINE */
+    sink_append_varint(sink, value);
+  } else {
+    if (occurrence->wiretype == PB_WIRETYPE_LENGTH)
+      sink_append_varint(sink, occurrence->size);
+    sink_append(sink, occurrence->data, occurrence->size);
+  }
+}
+
+/*!
+ * Append the values of an occurrence of a repeated scalar field to a sink.
+ *
+ * The occurrence may either hold a single value or a packed run of values,
+ * regardless of whether the field is declared as packed or not. If the
+ * values are packed, they are appended without tags.
+ *
+ * \param[in,out] sink       Sink
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     occurrence Occurrence
+ * \param[in]     packed     Whether to append packed values
+ */
+static void
+canonicalize_values(
+    sink_t *sink, const pb_field_descriptor_t *descriptor,
+    const occurrence_t *occurrence, int packed) {
+  assert(sink && descriptor && occurrence);
+  pb_wiretype_t wiretype = pb_field_descriptor_wiretype(descriptor);
+  if (unlikely_(occurrence->wiretype != wiretype &&
+                occurrence->wiretype != PB_WIRETYPE_LENGTH)) {
+    sink->error = PB_ERROR_INVALID;
+    return;
+  }
+
+  /* Append values one by one */
+  const uint8_t *data = occurrence->data;
+  for (size_t left = occurrence->size, bytes; !sink->error && left;
+      data += bytes, left -= bytes) {
+    if (!packed)
+      sink_append_varint(sink, pb_field_descriptor_tag(descriptor) << 3 |
+        wiretype);
+    if (wiretype == PB_WIRETYPE_VARINT) {
+      uint64_t value;
+      if (unlikely_(!(bytes = pb_varint_unpack_uint64(data, left, &value)))) {
+        sink->error = PB_ERROR_VARINT;
+        break;
+      }
+      sink_append_varint(sink, value);
+    } else {
+      bytes = wiretype == PB_WIRETYPE_64BIT ? 8 : 4;
+      if (unlikely_(bytes > left)) {
+        sink->error = PB_ERROR_OFFSET;
+        break;
+      }
+      sink_append(sink, data, bytes);
+    }
+  }
+}
+
+/*!
+ * Append a message in canonical form to a sink.
+ *
+ * The occurrences of all fields are collected and sorted by tag, keeping the
+ * relative order of occurrences with the same tag. Then, for every tag, only
+ * the last occurrence of a non-repeated field is retained, unless it is
+ * member of a oneof and shadowed by a later occurrence of another member.
+ * Submessages are canonicalized recursively, and all values of repeated
+ * scalar fields are coalesced into a single packed field, if the field is
+ * packed, or split into distinct fields otherwise. Unknown fields are kept.
+ *
+ * \param[in,out] sink       Sink
+ * \param[in]     descriptor Descriptor
+ * \param[in]     data[]     Raw data
+ * \param[in]     size       Raw data size
+ */
+static void
+canonicalize(
+    sink_t *sink, const pb_descriptor_t *descriptor,
+    const uint8_t data[], size_t size) {
+  assert(sink && descriptor && (data || !size));
+  if (!size)
+    return;
+
+  /* Collect fields of message */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+    (uint8_t *)data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+  pb_stream_field_t *fields = NULL;
+  size_t count = 0;
+  sink->error = pb_stream_scan(&stream, &fields, &count);
+  pb_stream_destroy(&stream);
+
+  /* Sort fields by tag and offset */
+  if (likely_(!sink->error))
+    qsort(fields, count, sizeof(pb_stream_field_t), compare);
+  for (size_t f = 0, end; !sink->error && f < count; f = end) {
+    for (end = f + 1; end < count; end++)
+      if (fields[end].tag != fields[f].tag)
+        break;
+
+    /* Unknown fields are retained as they are */
+    const pb_field_descriptor_t *field =
+      pb_descriptor_field_by_tag(descriptor, fields[f].tag);
+    if (!field) {
+      for (size_t i = f; i < end; i++) {
+        occurrence_t occurrence = occurrence_create(data, &(fields[i]));
+        canonicalize_field(sink, &occurrence);
+      }
+      continue;
+    }
+
+    /* Retain only the last occurrence of a non-repeated field */
+    size_t start = f;
+    if (pb_field_descriptor_label(field) != PB_LABEL_REPEATED) {
+      start = end - 1;
+
+      /* Skip oneof member if shadowed by a later member */
+      if (pb_field_descriptor_label(field) == PB_LABEL_ONEOF) {
+        const pb_oneof_descriptor_t *oneof = pb_field_descriptor_oneof(field);
+        size_t i = 0;
+        for (; i < count; i++)
+          if (fields[i].start > fields[start].start &&
+              pb_oneof_descriptor_member(oneof, fields[i].tag))
+            break;
+        if (i < count)
+          continue;
+      }
+    }
+
+    /* Canonicalize submessages recursively */
+    if (pb_field_descriptor_type(field) == PB_TYPE_MESSAGE) {
+      for (size_t i = start; i < end; i++) {
+        occurrence_t occurrence = occurrence_create(data, &(fields[i]));
+        if (occurrence.wiretype != PB_WIRETYPE_LENGTH) {
+          canonicalize_field(sink, &occurrence);
+        } else {
+          sink_append_varint(sink, occurrence.tag << 3 | PB_WIRETYPE_LENGTH);
+          size_t mark = sink->size;
+          canonicalize(sink, pb_field_descriptor_nested(field),
+            occurrence.data, occurrence.size);
+          sink_prefix(sink, mark);
+        }
+      }
+
+    /* Coalesce values of repeated scalar fields */
+    } else if (pb_field_descriptor_label(field) == PB_LABEL_REPEATED &&
+               pb_field_descriptor_wiretype(field) != PB_WIRETYPE_LENGTH) {
+      int packed = pb_field_descriptor_packed(field);
+      size_t tag = sink->size, mark = tag;
+      if (packed) {
+        sink_append_varint(sink, fields[f].tag << 3 | PB_WIRETYPE_LENGTH);
+        mark = sink->size;
+      }
+      for (size_t i = start; i < end; i++) {
+        occurrence_t occurrence = occurrence_create(data, &(fields[i]));
+        canonicalize_values(sink, field, &occurrence, packed);
+      }
+
+      /* Omit packed field without values */
+      if (packed && sink->size == mark) {
+        sink->size = tag;
+      } else if (packed) {
+        sink_prefix(sink, mark);
+      }
+
+    /* Canonicalize all other fields */
+    } else {
+      for (size_t i = start; i < end; i++) {
+        occurrence_t occurrence = occurrence_create(data, &(fields[i]));
+        canonicalize_field(sink, &occurrence);
+      }
+    }
+  }
+  if (fields)
+    pb_allocator_free(&allocator_default, fields);
+}
+
+/*!
+ * Advance to the next group of occurrences with the same tag.
+ *
+ * The raw data must be in canonical form, so all occurrences of a tag are
+ * adjacent. If the end of the data is reached, the group's count is zero.
+ *
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ * \param[in,out] group  Group
+ * \return               Error code
+ */
+static pb_error_t
+group_next(const uint8_t data[], size_t size, group_t *group) {
+  assert((data || !size) && group);
+  group->start = group->end;
+  group->count = 0;
+  for (size_t offset = group->end; offset < size; ) {
+    occurrence_t occurrence;
+    pb_error_t error = next(data, size, &offset, &occurrence);
+    if (unlikely_(error))
+      return error;
+    if (group->count && occurrence.tag != group->tag)
+      break;
+    if (!group->count++) {
+      group->tag   = occurrence.tag;
+      group->first = occurrence;
+    }
+    group->end = offset;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Append an operation with a length-prefixed payload to a patch.
+ *
+ * \param[in,out] sink      Sink
+ * \param[in]     tag       Tag
+ * \param[in]     operation Operation
+ * \param[in]     data[]    Payload
+ * \param[in]     size      Payload size
+ */
+static void
+diff_operation(
+    sink_t *sink, pb_tag_t tag, operation_t operation,
+    const uint8_t data[], size_t size) {
+  assert(sink && (data || !size));
+  sink_append_varint(sink, (uint64_t)tag << 2 | operation);
+  sink_append_varint(sink, size);
+  sink_append(sink, data, size);
+}
+
+/*!
+ * Append the difference between two messages in canonical form to a patch.
+ *
+ * A patch is a sequence of operations, sorted by tag, each of which starts
+ * with a varint holding the tag and the operation in the lowest two bits:
+ *
+ * - OPERATION_SET:    replace all occurrences with the payload
+ * - OPERATION_CLEAR:  remove all occurrences, without payload
+ * - OPERATION_APPEND: append the payload to the existing occurrences
+ * - OPERATION_NESTED: apply the payload as a patch to the submessage
+ *
+ * Payloads are length-prefixed. The payloads of set and append operations are
+ * complete fields including their tags. Values which are appended to repeated
+ * fields are detected, as well as changes inside submessages, as long as the
+ * nested patch is smaller than the submessage.
+ *
+ * \param[in,out] sink       Sink
+ * \param[in]     descriptor Descriptor
+ * \param[in]     from[]     Raw data of original message
+ * \param[in]     from_size  Raw data size of original message
+ * \param[in]     to[]       Raw data of changed message
+ * \param[in]     to_size    Raw data size of changed message
+ */
+static void
+diff(
+    sink_t *sink, const pb_descriptor_t *descriptor,
+    const uint8_t from[], size_t from_size,
+    const uint8_t to[], size_t to_size) {
+  assert(sink && descriptor && (from || !from_size) && (to || !to_size));
+  group_t x = {}, y = {};
+  if (unlikely_((sink->error = group_next(from, from_size, &x)) ||
+                (sink->error = group_next(to, to_size, &y))))
+    return;
+
+  /* Walk both messages tag by tag */
+  while (!sink->error && (x.count || y.count)) {
+    int removed = !y.count || (x.count && x.tag < y.tag),
+        added   = !x.count || (y.count && y.tag < x.tag);
+    const size_t x_size = x.end - x.start, y_size = y.end - y.start;
+
+    /* Clear removed tag and set added tag */
+    if (removed) {
+      sink_append_varint(sink, (uint64_t)x.tag << 2 | OPERATION_CLEAR);
+    } else if (added) {
+      diff_operation(sink, y.tag, OPERATION_SET, &(to[y.start]), y_size);
+
+    /* Tag is present in both messages, so check for changes */
+    } else if (x_size != y_size ||
+        memcmp(&(from[x.start]), &(to[y.start]), x_size)) {
+      const pb_field_descriptor_t *field =
+        pb_descriptor_field_by_tag(descriptor, y.tag);
+      int repeated = !field ||
+        pb_field_descriptor_label(field) == PB_LABEL_REPEATED;
+      int single = x.count == 1 && y.count == 1 &&
+        x.first.wiretype == PB_WIRETYPE_LENGTH &&
+        y.first.wiretype == PB_WIRETYPE_LENGTH;
+      size_t mark = sink->size;
+
+      /* Patch submessage, if the nested patch is smaller */
+      if (field && !repeated && single &&
+          pb_field_descriptor_type(field) == PB_TYPE_MESSAGE) {
+        sink_append_varint(sink, (uint64_t)y.tag << 2 | OPERATION_NESTED);
+        size_t nested = sink->size;
+        diff(sink, pb_field_descriptor_nested(field),
+          x.first.data, x.first.size, y.first.data, y.first.size);
+        sink_prefix(sink, nested);
+        if (sink->size - mark >= y_size)
+          sink->size = mark;
+
+      /* Append values to packed field */
+      } else if (field && repeated && single &&
+          pb_field_descriptor_packed(field) && x.first.size < y.first.size &&
+          !memcmp(x.first.data, y.first.data, x.first.size)) {
+        sink_append_varint(sink, (uint64_t)y.tag << 2 | OPERATION_APPEND);
+        size_t nested = sink->size;
+        sink_append_varint(sink, y.tag << 3 | PB_WIRETYPE_LENGTH);
+        sink_append_varint(sink, y.first.size - x.first.size);
+        sink_append(sink, &(y.first.data[x.first.size]),
+          y.first.size - x.first.size);
+        sink_prefix(sink, nested);
+
+      /* Append occurrences to repeated or unknown field */
+      } else if (repeated && x_size < y_size &&
+          !memcmp(&(from[x.start]), &(to[y.start]), x_size)) {
+        diff_operation(sink, y.tag, OPERATION_APPEND,
+          &(to[y.start + x_size]), y_size - x_size);
+      }
+
+      /* Otherwise, replace all occurrences */
+      if (!sink->error && sink->size == mark)
+        diff_operation(sink, y.tag, OPERATION_SET, &(to[y.start]), y_size);
+    }
+
+    /* Advance to next tag in either or both messages */
+    if (likely_(!sink->error) && !added)
+      sink->error = group_next(from, from_size, &x);
+    if (likely_(!sink->error) && !removed)
+      sink->error = group_next(to, to_size, &y);
+  }
+}
+
+/*!
+ * Compare two changes by tag.
+ *
+ * \param[in] x Change
+ * \param[in] y Change
+ * \return      Comparison result
+ */
+static int
+compare_change(const void *x, const void *y) {
+  const change_t *a = x, *b = y;
+  return a->tag < b->tag ? -1 : a->tag > b->tag;
+}
+
+/*!
+ * Decode the operations of a patch.
+ *
+ * Operations must be sorted by tag and contain every tag at most once. The
+ * payloads of set and append operations must consist of complete fields of
+ * the operation's tag, and submessages may only be patched if the descriptor
+ * declares a non-repeated message field for the tag.
+ *
+ * \param[in]  descriptor Descriptor
+ * \param[in]  patch[]    Patch
+ * \param[in]  size       Patch size
+ * \param[out] changes    Pointer receiving changes
+ * \param[out] count      Pointer receiving change count
+ * \return                Error code
+ */
+static pb_error_t
+decode(
+    const pb_descriptor_t *descriptor, const uint8_t patch[], size_t size,
+    change_t **changes, size_t *count) {
+  assert(descriptor && (patch || !size) && changes && count);
+  size_t capacity = 0;
+  for (size_t offset = 0, bytes; offset < size; offset += bytes) {
+    uint64_t key;
+    if (unlikely_(!(bytes = pb_varint_unpack_uint64(
+        &(patch[offset]), size - offset, &key))))
+      return PB_ERROR_VARINT;
+    offset += bytes;
+
+    /* Ensure ascending, valid tags */
+    change_t change = {
+      .tag       = key >> 2,
+      .operation = key & 3
+    };
+    if (unlikely_(!change.tag || key >> 2 > 0x1FFFFFFF ||
+        (*count && (*changes)[*count - 1].tag >= change.tag)))
+      return PB_ERROR_INVALID;
+
+    /* Read length-prefixed payload */
+    bytes = 0;
+    if (change.operation != OPERATION_CLEAR) {
+      uint32_t length;
+      if (unlikely_(offset == size || !(bytes = pb_varint_unpack_uint32(
+          &(patch[offset]), size - offset, &length))))
+        return PB_ERROR_VARINT;
+      offset += bytes;
+      if (unlikely_(length > size - offset))
+        return PB_ERROR_OFFSET;
+      change.data = &(patch[offset]);
+      change.size = bytes = length;
+    }
+
+    /* Validate payload according to operation */
+    if (change.operation == OPERATION_NESTED) {
+      const pb_field_descriptor_t *field =
+        pb_descriptor_field_by_tag(descriptor, change.tag);
+      if (unlikely_(!field ||
+          pb_field_descriptor_type(field) != PB_TYPE_MESSAGE ||
+          pb_field_descriptor_label(field) == PB_LABEL_REPEATED))
+        return PB_ERROR_INVALID;
+    } else {
+      for (size_t current = 0; current < change.size; ) {
+        occurrence_t occurrence;
+        pb_error_t error =
+          next(change.data, change.size, &current, &occurrence);
+        if (unlikely_(error))
+          return error;
+        if (unlikely_(occurrence.tag != change.tag))
+          return PB_ERROR_INVALID;
+      }
+    }
+
+    /* Grow array of changes, if necessary */
+    if (unlikely_(*count == capacity)) {
+      change_t *temp = pb_allocator_resize(&allocator_default,
+        *changes, sizeof(change_t) *
+          (capacity = capacity ? capacity << 1 : 16));
+      if (unlikely_(!temp))
+        return PB_ERROR_ALLOC;                             /* LCOV_EXCL_LINE */
+      *changes = temp;
+    }
+    (*changes)[(*count)++] = change;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Append a message with a patch applied to a sink.
+ *
+ * The message is traversed in a single pass, copying all runs of occurrences
+ * which are not affected by the patch as they are. Occurrences of set and
+ * cleared tags are dropped, as well as those of patched submessages, of which
+ * the last one is remembered. Afterwards, the payloads of set and append
+ * operations are appended, and patched submessages are assembled recursively.
+ * The message need not be in canonical form.
+ *
+ * \param[in,out] sink       Sink
+ * \param[in]     descriptor Descriptor
+ * \param[in]     data[]     Raw data
+ * \param[in]     size       Raw data size
+ * \param[in]     patch[]    Patch
+ * \param[in]     patch_size Patch size
+ */
+static void
+apply(
+    sink_t *sink, const pb_descriptor_t *descriptor,
+    const uint8_t data[], size_t size,
+    const uint8_t patch[], size_t patch_size) {
+  assert(sink && descriptor && (data || !size) && (patch || !patch_size));
+  change_t *changes = NULL;
+  size_t count = 0;
+  if (unlikely_(sink->error =
+      decode(descriptor, patch, patch_size, &changes, &count))) {
+    if (changes)
+      pb_allocator_free(&allocator_default, changes);
+    return;
+  }
+
+  /* Copy runs of occurrences which are not affected by the patch */
+  size_t run = 0;
+  for (size_t offset = 0, start = 0; !sink->error && offset < size;
+      start = offset) {
+    occurrence_t occurrence;
+    if (unlikely_(sink->error = next(data, size, &offset, &occurrence)))
+      break;
+    change_t key = { .tag = occurrence.tag }, *change = count
+      ? bsearch(&key, changes, count, sizeof(change_t), compare_change)
+      : NULL;
+    if (!change || change->operation == OPERATION_APPEND)
+      continue;
+
+    /* Remember last occurrence of patched submessage */
+    if (change->operation == OPERATION_NESTED) {
+      if (unlikely_(occurrence.wiretype != PB_WIRETYPE_LENGTH))
+        sink->error = PB_ERROR_INVALID;
+      change->last = occurrence;
+    }
+    sink_append(sink, &(data[run]), start - run);
+    run = offset;
+  }
+  if (likely_(!sink->error))
+    sink_append(sink, &(data[run]), size - run);
+
+  /* Append set and appended occurrences and patched submessages */
+  for (size_t c = 0; !sink->error && c < count; c++) {
+    const change_t *change = &(changes[c]);
+    if (change->operation == OPERATION_NESTED) {
+      sink_append_varint(sink, change->tag << 3 | PB_WIRETYPE_LENGTH);
+      size_t mark = sink->size;
+      apply(sink, pb_field_descriptor_nested(
+        pb_descriptor_field_by_tag(descriptor, change->tag)),
+          change->last.data, change->last.size, change->data, change->size);
+      sink_prefix(sink, mark);
+    } else {
+      sink_append(sink, change->data, change->size);
+    }
+  }
+  if (changes)
+    pb_allocator_free(&allocator_default, changes);
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -61,10 +831,14 @@ pb_buffer_write(
   if (unlikely_(start > end || end > buffer->size))
     return PB_ERROR_OFFSET;
 
+  /* Read-only buffers cannot be written to, not even in place */
+  if (unlikely_(pb_buffer_read_only(buffer)))
+    return PB_ERROR_ALLOC;
+
   /* Resize buffer and move data if necessary */
   ptrdiff_t delta = size - (end - start);
   if (delta) {
-    if (unlikely_(buffer->allocator == &allocator_zero_copy))
+    if (unlikely_(pb_buffer_zero_copy(buffer)))
       return PB_ERROR_ALLOC;
 
     /* Buffer grows, so grow space and then move data */
@@ -124,7 +898,7 @@ pb_buffer_clear(pb_buffer_t *buffer, size_t start, size_t end) {
   /* Resize buffer and move data if necessary */
   ptrdiff_t delta = start - end;
   if (delta) {
-    if (unlikely_(buffer->allocator == &allocator_zero_copy))
+    if (unlikely_(pb_buffer_zero_copy(buffer)))
       return PB_ERROR_ALLOC;
 
     /* Buffer shrinks, so move data and then shrink space */
@@ -149,6 +923,118 @@ pb_buffer_clear(pb_buffer_t *buffer, size_t start, size_t end) {
   return PB_ERROR_NONE;
 }
 
+/*!
+ * Append the canonical form of a message to a buffer.
+ *
+ * The occurrences of all fields are collected and sorted by tag in a single
+ * pass, and then appended in canonical form, so messages with equal contents
+ * are equal in canonical form, regardless of how they were written.
+ *
+ * The buffer's internal state is fully recoverable.
+ *
+ * \param[in,out] buffer     Buffer
+ * \param[in]     descriptor Descriptor
+ * \param[in]     data[]     Raw data
+ * \param[in]     size       Raw data size
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_buffer_canonicalize(
+    pb_buffer_t *buffer, const pb_descriptor_t *descriptor,
+    const uint8_t data[], size_t size) {
+  assert(buffer && descriptor && (data || !size));
+  if (unlikely_(!pb_buffer_valid(buffer)))
+    return PB_ERROR_INVALID;
+  if (unlikely_(pb_buffer_zero_copy(buffer)))
+    return PB_ERROR_ALLOC;
+
+  /* Append canonical form to the buffer's data */
+  sink_t sink = sink_create(buffer);
+  canonicalize(&sink, descriptor, data, size);
+  return sink_commit(&sink, buffer);
+}
+
+/*!
+ * Append the difference between two messages as a patch to a buffer.
+ *
+ * Both messages are canonicalized first, so the patch only contains the
+ * changes to their contents, regardless of how they were written. Applying
+ * the patch to the original message with pb_buffer_patch() yields a message
+ * which is equal to the changed message.
+ *
+ * The buffer's internal state is fully recoverable.
+ *
+ * \param[in,out] buffer     Buffer
+ * \param[in]     descriptor Descriptor
+ * \param[in]     from[]     Raw data of original message
+ * \param[in]     from_size  Raw data size of original message
+ * \param[in]     to[]       Raw data of changed message
+ * \param[in]     to_size    Raw data size of changed message
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_buffer_diff(
+    pb_buffer_t *buffer, const pb_descriptor_t *descriptor,
+    const uint8_t from[], size_t from_size,
+    const uint8_t to[], size_t to_size) {
+  assert(buffer && descriptor && (from || !from_size) && (to || !to_size));
+  if (unlikely_(!pb_buffer_valid(buffer)))
+    return PB_ERROR_INVALID;
+  if (unlikely_(pb_buffer_zero_copy(buffer)))
+    return PB_ERROR_ALLOC;
+
+  /* Canonicalize both messages */
+  sink_t x = { .allocator = &allocator_default },
+         y = { .allocator = &allocator_default };
+  canonicalize(&x, descriptor, from, from_size);
+  canonicalize(&y, descriptor, to, to_size);
+
+  /* Append difference to the buffer's data */
+  sink_t sink = sink_create(buffer);
+  if (likely_(!(sink.error = x.error ? x.error : y.error)))
+    diff(&sink, descriptor, x.data, x.size, y.data, y.size);
+  pb_error_t error = sink_commit(&sink, buffer);
+  if (x.data)
+    pb_allocator_free(&allocator_default, x.data);
+  if (y.data)
+    pb_allocator_free(&allocator_default, y.data);
+  return error;
+}
+
+/*!
+ * Append a message with a patch applied to a buffer.
+ *
+ * The message is traversed only once. Occurrences which are not affected by
+ * the patch are copied as they are, so the message need not be in canonical
+ * form, and the result is not necessarily canonical either.
+ *
+ * The buffer's internal state is fully recoverable.
+ *
+ * \param[in,out] buffer     Buffer
+ * \param[in]     descriptor Descriptor
+ * \param[in]     data[]     Raw data
+ * \param[in]     size       Raw data size
+ * \param[in]     patch[]    Patch
+ * \param[in]     patch_size Patch size
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_buffer_patch(
+    pb_buffer_t *buffer, const pb_descriptor_t *descriptor,
+    const uint8_t data[], size_t size,
+    const uint8_t patch[], size_t patch_size) {
+  assert(buffer && descriptor && (data || !size) && (patch || !patch_size));
+  if (unlikely_(!pb_buffer_valid(buffer)))
+    return PB_ERROR_INVALID;
+  if (unlikely_(pb_buffer_zero_copy(buffer)))
+    return PB_ERROR_ALLOC;
+
+  /* Append patched message to the buffer's data */
+  sink_t sink = sink_create(buffer);
+  apply(&sink, descriptor, data, size, patch, patch_size);
+  return sink_commit(&sink, buffer);
+}
+
 /* LCOV_EXCL_START >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
 
 /*!
@@ -29,6 +29,7 @@
 #include <protobluff/message/buffer.h>
 
 #include "core/buffer.h"
+#include "core/descriptor.h"
 #include "message/common.h"
 
 /* ----------------------------------------------------------------------------
@@ -51,6 +52,34 @@ pb_buffer_clear(
   size_t start,                        /* Start offset */
   size_t end);                         /* End offset */
 
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_buffer_canonicalize(
+  pb_buffer_t *buffer,                 /* Buffer */
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  const uint8_t data[],                /* Raw data */
+  size_t size);                        /* Raw data size */
+
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_buffer_diff(
+  pb_buffer_t *buffer,                 /* Buffer */
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  const uint8_t from[],                /* Raw data of original message */
+  size_t from_size,                    /* Raw data size of original message */
+  const uint8_t to[],                  /* Raw data of changed message */
+  size_t to_size);                     /* Raw data size of changed message */
+
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_buffer_patch(
+  pb_buffer_t *buffer,                 /* Buffer */
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  const uint8_t data[],                /* Raw data */
+  size_t size,                         /* Raw data size */
+  const uint8_t patch[],               /* Patch */
+  size_t patch_size);                  /* Patch size */
+
 extern void
 pb_buffer_dump_range(
   const pb_buffer_t *buffer,           /* Buffer */
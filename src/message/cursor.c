@@ -23,6 +23,11 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
 
 #include "core/descriptor.h"
 #include "core/stream.h"
@@ -179,6 +184,161 @@ next(pb_cursor_t *cursor) {
   return 0;
 }
 
+/*!
+ * Compare 16 bytes of raw data with a probe, yielding one bit per byte.
+ *
+ * SSE2 intrinsics are used if the compiler supports it.
+ *
+ * \param[in] data[]  Raw data
+ * \param[in] probe[] Probe
+ * \return            Bitmask of equal bytes
+ */
+static unsigned int
+compare(const uint8_t data[], const uint8_t probe[]) {
+  assert(data && probe);
+
+#ifdef __SSE2__
+
+  /* Load both into 128-bit integers and compare bytewise */
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(
+    _mm_loadu_si128((const __m128i *)data),
+    _mm_loadu_si128((const __m128i *)probe)));
+
+#else
+
+  /* Linear comparison */
+  unsigned int mask = 0;
+  for (size_t b = 0; b < 16; b++)
+    mask |= (unsigned int)(data[b] == probe[b]) << b;
+  return mask;
+
+#endif /* __SSE2__ */
+
+}
+
+/*!
+ * Move a cursor forward by the given number of values of a packed fixed-sized
+ * field, without reading them.
+ *
+ * \param[in,out] cursor Cursor
+ * \param[in]     count  Value count
+ */
+static void
+skip_packed(pb_cursor_t *cursor, size_t count) {
+  assert(cursor);
+  pb_offset_t *offset = &(cursor->current.offset);
+
+  /* Adjust offsets */
+  const size_t skip = count * (offset->end - offset->start);
+  offset->diff.origin -= skip;
+  offset->start       += skip;
+  offset->end         += skip;
+  cursor->pos         += count;
+}
+
+/*!
+ * Find all values of a packed fixed-sized field matching the given value.
+ *
+ * The remaining values of the packed field, starting at the current value, are
+ * compared 16 bytes at a time against the replicated value. Afterwards, the
+ * cursor is moved to the last value of the packed field.
+ *
+ * \param[in,out] cursor Cursor
+ * \param[in]     value  Pointer holding value
+ * \param[out]    pos[]  Positions
+ * \param[in]     size   Position count
+ * \param[in]     count  Match count
+ * \return               Match count
+ */
+static size_t
+find_packed(
+    pb_cursor_t *cursor, const void *value, size_t pos[], size_t size,
+    size_t count) {
+  assert(cursor && value);
+  pb_offset_t *offset = &(cursor->current.offset),
+              *packed = &(cursor->current.packed);
+
+  /* Retrieve remaining raw data of packed field */
+  const size_t width = offset->end - offset->start;
+  const size_t total = (packed->end - offset->start) / width;
+  const uint8_t *data =
+    pb_journal_data_from(pb_cursor_journal(cursor), offset->start);
+
+  /* Replicate value to fill a 16-byte probe */
+  uint8_t probe[16];
+  for (size_t b = 0; b < 16; b += width)
+    memcpy(&(probe[b]), value, width);
+
+  /* Compare 16 bytes at a time and extract matching values */
+  const unsigned int full = (1U << width) - 1;
+  size_t v = 0;
+  for (; (v + 16 / width) <= total; v += 16 / width) {
+    unsigned int mask = compare(&(data[v * width]), probe);
+    for (size_t w = 0; mask && w < 16 / width; w++, mask >>= width) {
+      if ((mask & full) == full) {
+        if (count < size)
+          pos[count] = cursor->pos + v + w;
+        count++;
+      }
+    }
+  }
+
+  /* Compare remaining values one by one */
+  for (; v < total; v++) {
+    if (!memcmp(&(data[v * width]), value, width)) {
+      if (count < size)
+        pos[count] = cursor->pos + v;
+      count++;
+    }
+  }
+
+  /* Move cursor to last value of packed field */
+  skip_packed(cursor, total - 1);
+  return count;
+}
+
+/*!
+ * Find the first value of a packed fixed-sized field not less than the value.
+ *
+ * The remaining values of the packed field, starting at the current value, are
+ * assumed to be sorted in ascending order, so a binary search is carried out
+ * directly on the raw data. If all values are less than the given value, the
+ * cursor is moved to the last value of the packed field.
+ *
+ * \param[in,out] cursor Cursor
+ * \param[in]     value  Pointer holding value
+ * \return               Test result
+ */
+static int
+lower_bound_packed(pb_cursor_t *cursor, const void *value) {
+  assert(cursor && value);
+  const pb_field_descriptor_t *descriptor = cursor->current.descriptor;
+  pb_offset_t *offset = &(cursor->current.offset),
+              *packed = &(cursor->current.packed);
+
+  /* Retrieve remaining raw data of packed field */
+  const size_t width = offset->end - offset->start;
+  const size_t total = (packed->end - offset->start) / width;
+  const uint8_t *data =
+    pb_journal_data_from(pb_cursor_journal(cursor), offset->start);
+
+  /* Narrow down range to the first value not less than the given value */
+  size_t lower = 0, upper = total;
+  while (lower < upper) {
+    size_t middle = lower + (upper - lower) / 2;
+    if (pb_field_descriptor_compare(descriptor,
+        &(data[middle * width]), value) < 0) {
+      lower = middle + 1;
+    } else {
+      upper = middle;
+    }
+  }
+
+  /* Move cursor to found value or last value of packed field */
+  skip_packed(cursor, lower < total ? lower : total - 1);
+  return lower < total;
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -358,6 +518,9 @@ pb_cursor_rewind(pb_cursor_t *cursor) {
 /*!
  * Seek a cursor from its current position to a field containing the value.
  *
+ * The search is linear, so for repeated lookups on large repeated fields, an
+ * index should be created and pb_index_seek() should be used instead.
+ *
  * \warning The seek operation is not allowed on cursors created without tags,
  * as the cursor would assume the field type to match the value type.
  *
@@ -411,6 +574,108 @@ pb_cursor_match(pb_cursor_t *cursor, const void *value) {
   return result;
 }
 
+/*!
+ * Find all fields containing the value, starting at the current position.
+ *
+ * Values are compared on the wire level, so for packed fixed-sized fields,
+ * the raw data is compared in bulk. The positions of all matching fields are
+ * written to the given array, up to the given number of positions, but the
+ * total number of matches is returned, so the array may be sized accordingly.
+ * The cursor itself is not moved.
+ *
+ * \warning Like pb_cursor_seek(), this operation is not allowed on cursors
+ * created without tags, as the cursor would assume the field type to match
+ * the value type.
+ *
+ * \param[in,out] cursor Cursor
+ * \param[in]     value  Pointer holding value
+ * \param[out]    pos[]  Positions
+ * \param[in]     size   Position count
+ * \return               Match count
+ */
+extern size_t
+pb_cursor_find_all(
+    pb_cursor_t *cursor, const void *value, size_t pos[], size_t size) {
+  assert(cursor && value && (pos || !size));
+  size_t count = 0;
+  if (!pb_cursor_valid(cursor) || !cursor->tag ||
+      pb_field_descriptor_type(cursor->current.descriptor) == PB_TYPE_MESSAGE ||
+      pb_cursor_align(cursor))
+    return count;
+
+  /* Determine whether packed values are of fixed size */
+  pb_wiretype_t wiretype =
+    pb_field_descriptor_wiretype(cursor->current.descriptor);
+  int fixed = wiretype == PB_WIRETYPE_64BIT ||
+              wiretype == PB_WIRETYPE_32BIT;
+
+  /* Iterate over a copy of the cursor and collect matches */
+  pb_cursor_t temp = pb_cursor_copy(cursor);
+  do {
+    if (fixed && temp.current.packed.end) {
+      count = find_packed(&temp, value, pos, size, count);
+    } else if (pb_cursor_match(&temp, value)) {
+      if (count < size)
+        pos[count] = temp.pos;
+      count++;
+    }
+  } while (pb_cursor_next(&temp));
+  pb_cursor_destroy(&temp);
+  return count;
+}
+
+/*!
+ * Seek a cursor to the first field not less than the value, starting at and
+ * including its current position.
+ *
+ * The remaining values of the field are assumed to be sorted in ascending
+ * order. For packed fixed-sized fields, a binary search is carried out
+ * directly on the raw data, so the search takes logarithmic time. All other
+ * fields are searched linearly, so for repeated lookups on large fields, an
+ * index should be created and pb_index_lower_bound() should be used instead.
+ *
+ * \warning Like pb_cursor_seek(), this operation is not allowed on cursors
+ * created without tags, as the cursor would assume the field type to match
+ * the value type.
+ *
+ * \param[in,out] cursor Cursor
+ * \param[in]     value  Pointer holding value
+ * \return               Test result
+ */
+extern int
+pb_cursor_lower_bound(pb_cursor_t *cursor, const void *value) {
+  assert(cursor && value);
+  if (!pb_cursor_valid(cursor) || !cursor->tag ||
+      pb_field_descriptor_type(cursor->current.descriptor) == PB_TYPE_MESSAGE ||
+      pb_cursor_align(cursor))
+    return 0;
+
+  /* Determine whether packed values are of fixed size */
+  const pb_field_descriptor_t *descriptor = cursor->current.descriptor;
+  pb_wiretype_t wiretype = pb_field_descriptor_wiretype(descriptor);
+  int fixed = wiretype == PB_WIRETYPE_64BIT ||
+              wiretype == PB_WIRETYPE_32BIT;
+
+  /* Advance until a value not less than the given value is found */
+  do {
+    if (fixed && cursor->current.packed.end) {
+      if (lower_bound_packed(cursor, value))
+        return 1;
+    } else {
+      union {
+        uint64_t number;
+        double real;
+        pb_string_t string;
+      } temp;
+      if (unlikely_(cursor->error = pb_cursor_get(cursor, &temp)))
+        break;
+      if (pb_field_descriptor_compare(descriptor, &temp, value) >= 0)
+        return 1;
+    }
+  } while (pb_cursor_next(cursor));
+  return 0;
+}
+
 /*!
  * Read the value of the current field from a cursor.
  *
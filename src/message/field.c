@@ -20,7 +20,6 @@
  * IN THE SOFTWARE.
  */
 
-#include <alloca.h>
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -196,14 +195,16 @@ pb_field_destroy(pb_field_t *field) {
 /*!
  * Compare the value of a field with the given value.
  *
- * 32-bit and 64-bit fixed-size fields can be compared by raw pointer, all      // TODO: fix
- * other types must be read explicitly.
+ * The value is encoded once and compared against the raw bytes of the field,
+ * so no decoding is necessary. Only if the size of an encoded varint doesn't
+ * match the raw size, which may happen for non-canonical encodings, the
+ * field's value is decoded for comparison.
  *
  * \warning The caller has to ensure that the space pointed to by the value
  * pointer is appropriately sized for the type of field.
  *
  * \param[in,out] field Field
- * \param[in]     value Pointer receiving value
+ * \param[in]     value Pointer holding value
  * \return              Test result
  */
 extern int
@@ -212,20 +213,45 @@ pb_field_match(pb_field_t *field, const void *value) {
   if (unlikely_(!pb_field_valid(field) || pb_field_align(field)))
     return 0;
 
-  /* Directly compare fixed-size fields */
-  size_t size = pb_field_descriptor_type_size(field->descriptor);
-  // if (pb_field_descriptor_wiretype(field->descriptor) & PB_WIRETYPE_64BIT)   // TODO: fix
-  //   return !memcmp(value, pb_field_raw(field), size);
+  /* Retrieve raw data of field */
+  const uint8_t *data = pb_journal_data_from(
+    pb_field_journal(field), pb_part_start(&(field->part)));
+  size_t size = pb_part_size(&(field->part));
 
-  /* Allocate temporary space for type-agnostic comparison */
-  void *temp = alloca(size);
-  if (unlikely_(pb_field_get(field, temp)))
-    return 0;
+  /* Compare raw data according to wiretype */
+  pb_type_t type = pb_field_descriptor_type(field->descriptor);
+  switch (pb_field_descriptor_wiretype(field->descriptor)) {
 
-  /* Compare field value according to type */
-  return pb_field_descriptor_wiretype(field->descriptor) != PB_WIRETYPE_LENGTH
-    ? !memcmp(value, temp, size)
-    : pb_string_equals(value, temp);
+    /* Encode variable-sized integer and compare */
+    case PB_WIRETYPE_VARINT: {
+      uint8_t temp[10];
+      if (likely_(pb_varint_pack(type, temp, value) == size))
+        return !memcmp(temp, data, size);
+
+      /* Decode non-canonical variable-sized integer */
+      uint64_t other = 0;
+      return pb_varint_unpack(type, data, size, &other) == size &&
+        !memcmp(value, &other, pb_field_descriptor_type_size(
+          field->descriptor));
+    }
+
+    /* Directly compare fixed-sized values */
+    case PB_WIRETYPE_64BIT:
+    case PB_WIRETYPE_32BIT:
+      return size == pb_field_descriptor_type_size(field->descriptor) &&
+        !memcmp(value, data, size);
+
+    /* Directly compare strings and bytes after checking the length prefix */
+    default: {
+      uint32_t length;
+      const pb_offset_t *offset = &(field->part.offset);
+      if (unlikely_(!pb_varint_unpack_uint32(data + offset->diff.length,
+          -offset->diff.length, &length) || length != size))
+        return 0;
+      return size == pb_string_size(value) &&
+        (!size || !memcmp(pb_string_data(value), data, size));
+    }
+  }
 }
 
 /*!
@@ -0,0 +1,436 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/descriptor.h"
+#include "core/stream.h"
+#include "message/common.h"
+#include "message/cursor.h"
+#include "message/index.h"
+#include "message/journal.h"
+#include "message/message.h"
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef union pb_index_value_t {
+  uint64_t number;                     /*!< Scalar value */
+  pb_string_t string;                  /*!< String value */
+} pb_index_value_t;
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Compute the hash of a value using FNV-1a.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] value      Pointer holding value
+ * \return               Hash
+ */
+static size_t
+hash(const pb_field_descriptor_t *descriptor, const void *value) {
+  assert(descriptor && value);
+  const uint8_t *data = value;
+  size_t size = pb_field_descriptor_type_size(descriptor);
+
+  /* Hash contents of strings and bytes instead of the string itself */
+  if (pb_field_descriptor_wiretype(descriptor) == PB_WIRETYPE_LENGTH) {
+    data = pb_string_data(value);
+    size = pb_string_size(value);
+  }
+
+  /* Mix all bytes into hash */
+  uint64_t result = 14695981039346656037ULL;
+  for (size_t b = 0; b < size; b++)
+    result = (result ^ data[b]) * 1099511628211ULL;
+  return (size_t)result;
+}
+
+/*!
+ * Read the value of an indexed field.
+ *
+ * \param[in,out] index Index
+ * \param[in]     entry Index entry
+ * \param[out]    value Value
+ * \return              Error code
+ */
+static pb_error_t
+load(
+    pb_index_t *index, const pb_index_entry_t *entry,
+    pb_index_value_t *value) {
+  assert(index && entry && value);
+  memset(value, 0, sizeof(pb_index_value_t));
+
+  /* Create a stream to read the field's value */
+  pb_stream_t stream = pb_stream_create_at(
+    pb_journal_buffer(pb_message_journal(&(index->message))),
+      entry->offset.start + entry->offset.diff.length);
+  pb_error_t error = pb_stream_read(&stream,
+    pb_field_descriptor_type(index->descriptor), value);
+  pb_stream_destroy(&stream);
+  return error;
+}
+
+/*!
+ * Test whether the value of an indexed field matches the given value.
+ *
+ * \param[in,out] index Index
+ * \param[in]     entry Index entry
+ * \param[in]     value Pointer holding value
+ * \return              Test result
+ */
+static int
+match(pb_index_t *index, const pb_index_entry_t *entry, const void *value) {
+  assert(index && entry && value);
+  pb_index_value_t temp;
+  if (unlikely_(load(index, entry, &temp)))
+    return 0;
+
+  /* Compare field value according to type */
+  return pb_field_descriptor_wiretype(index->descriptor) != PB_WIRETYPE_LENGTH
+    ? !memcmp(value, &temp,
+        pb_field_descriptor_type_size(index->descriptor))
+    : pb_string_equals(value, &(temp.string));
+}
+
+/*!
+ * Build an index by collecting all occurrences of the indexed field.
+ *
+ * Entries are linked into buckets in reverse order, so every bucket is
+ * ordered by the position of its entries within the message.
+ *
+ * \param[in,out] index Index
+ * \return              Error code
+ */
+static pb_error_t
+build(pb_index_t *index) {
+  assert(index && index->descriptor);
+  pb_error_t error = PB_ERROR_NONE;
+  index->entry.size = 0;
+
+  /* Create cursor to collect all occurrences */
+  pb_cursor_t cursor = pb_cursor_create_unsafe(&(index->message),
+    pb_field_descriptor_tag(index->descriptor));
+  if (pb_cursor_valid(&cursor)) {
+    size_t capacity = index->entry.size;
+    do {
+      if (index->entry.size == capacity) {
+        capacity = capacity ? capacity << 1 : 16;
+        pb_index_entry_t *data = pb_allocator_resize(index->allocator,
+          index->entry.data, sizeof(pb_index_entry_t) * capacity);
+        if (unlikely_(!data)) {
+          error = PB_ERROR_ALLOC;                          /* LCOV_EXCL_LINE */
+          break;                                           /* LCOV_EXCL_LINE */
+        }
+        index->entry.data = data;
+      }
+
+      /* Record the current state of the cursor */
+      pb_index_entry_t *entry = &(index->entry.data[index->entry.size]);
+      *entry = (pb_index_entry_t){
+        .hash   = 0,
+        .next   = 0,
+        .pos    = cursor.pos,
+        .offset = cursor.current.offset,
+        .packed = cursor.current.packed
+      };
+
+      /* Read value and compute hash */
+      pb_index_value_t value;
+      if (unlikely_(error = load(index, entry, &value)))
+        break;
+      entry->hash = hash(index->descriptor, &value);
+      index->entry.size++;
+    } while (pb_cursor_next(&cursor));
+  }
+
+  /* Propagate cursor errors, except for reaching the end of the message */
+  if (!error && pb_cursor_error(&cursor) != PB_ERROR_EOM)
+    error = pb_cursor_error(&cursor);
+  pb_cursor_destroy(&cursor);
+  if (unlikely_(error))
+    return error;
+
+  /* Determine number of buckets as the next power of two */
+  size_t size = 1;
+  while (size < index->entry.size)
+    size <<= 1;
+
+  /* Allocate buckets */
+  if (size != index->bucket.size) {
+    size_t *data = pb_allocator_resize(index->allocator,
+      index->bucket.data, sizeof(size_t) * size);
+    if (unlikely_(!data))
+      return PB_ERROR_ALLOC;                               /* LCOV_EXCL_LINE */
+    index->bucket.data = data;
+    index->bucket.size = size;
+  }
+  memset(index->bucket.data, 0, sizeof(size_t) * size);
+
+  /* Link entries into buckets */
+  for (size_t e = index->entry.size; e > 0; e--) {
+    pb_index_entry_t *entry = &(index->entry.data[e - 1]);
+    size_t *bucket = &(index->bucket.data[entry->hash & (size - 1)]);
+    entry->next = *bucket;
+    *bucket     = e;
+  }
+
+  /* Index is now up-to-date */
+  index->revision = pb_journal_revision(
+    pb_message_journal(&(index->message)));
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Ensure that an index reflects the current state of its message.
+ *
+ * \param[in,out] index Index
+ * \return              Error code
+ */
+static pb_error_t
+update(pb_index_t *index) {
+  assert(index);
+  if (unlikely_(!pb_index_valid(index)))
+    return pb_index_error(index);
+
+  /* Rebuild index if the journal was altered */
+  pb_journal_t *journal = pb_message_journal(&(index->message));
+  if (index->revision != pb_journal_revision(journal))
+    return (index->error = build(index));
+  return pb_message_align(&(index->message));
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create an index over all occurrences of a field within a message.
+ *
+ * The index maps the values of a scalar, string or bytes field to the
+ * positions of the respective occurrences within the message, so lookups
+ * are O(1) on average. As the entries are kept in order of their positions,
+ * they also serve as a table of offsets for pb_index_lower_bound(). The index
+ * is bound to the revision of the underlying journal and transparently
+ * rebuilt after any alteration of the journal.
+ *
+ * \warning After creating an index, it is mandatory to check its validity
+ * with the macro pb_index_valid().
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \return                Index
+ */
+extern pb_index_t
+pb_index_create(pb_message_t *message, pb_tag_t tag) {
+  assert(message && tag);
+  if (unlikely_(!pb_message_valid(message)))
+    return pb_index_create_invalid();
+
+  /* Only non-message fields can be indexed */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(pb_message_descriptor(message), tag);
+  if (unlikely_(!descriptor ||
+      pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE))
+    return pb_index_create_invalid();
+
+  /* Zero-copy journals cannot allocate, so fall back to default allocator */
+  pb_journal_t *journal = pb_message_journal(message);
+  pb_index_t index = {
+    .allocator  = pb_buffer_zero_copy(pb_journal_buffer(journal))
+      ? &allocator_default
+      : pb_buffer_allocator(pb_journal_buffer(journal)),
+    .message    = pb_message_copy(message),
+    .descriptor = descriptor,
+    .revision   = SIZE_MAX,
+    .entry      = {
+      .data = NULL,
+      .size = 0
+    },
+    .bucket     = {
+      .data = NULL,
+      .size = 0
+    },
+    .error      = PB_ERROR_NONE
+  };
+
+  /* Build index */
+  if (unlikely_(index.error = build(&index))) {
+    pb_index_destroy(&index);
+    return pb_index_create_invalid();
+  }
+  return index;
+}
+
+/*!
+ * Destroy an index.
+ *
+ * \param[in,out] index Index
+ */
+extern void
+pb_index_destroy(pb_index_t *index) {
+  assert(index);
+  if (index->entry.data)
+    pb_allocator_free(index->allocator, index->entry.data);
+  if (index->bucket.data)
+    pb_allocator_free(index->allocator, index->bucket.data);
+  pb_message_destroy(&(index->message));
+}
+
+/*!
+ * Seek a cursor from its current position to a field containing the value.
+ *
+ * This is the indexed equivalent of pb_cursor_seek(). The cursor must have
+ * been created for the indexed field of the indexed message. In contrast to
+ * pb_cursor_seek(), the cursor is left untouched if the value is not found.
+ *
+ * \param[in,out] index  Index
+ * \param[in,out] cursor Cursor
+ * \param[in]     value  Pointer holding value
+ * \return               Test result
+ */
+extern int
+pb_index_seek(pb_index_t *index, pb_cursor_t *cursor, const void *value) {
+  assert(index && cursor && value);
+  if (!pb_cursor_valid(cursor) || pb_cursor_align(cursor) || update(index))
+    return 0;
+
+  /* Ensure that the cursor belongs to the indexed field and message */
+  if (cursor->tag != pb_field_descriptor_tag(index->descriptor) ||
+      pb_cursor_journal(cursor) != pb_message_journal(&(index->message)) ||
+      pb_message_start(&(cursor->message)) !=
+        pb_message_start(&(index->message)))
+    return 0;
+
+  /* Find first matching entry after the current position of the cursor */
+  size_t key = hash(index->descriptor, value);
+  for (size_t e = index->bucket.data[key & (index->bucket.size - 1)]; e;
+      e = index->entry.data[e - 1].next) {
+    const pb_index_entry_t *entry = &(index->entry.data[e - 1]);
+    if (entry->pos > cursor->pos && entry->hash == key &&
+        match(index, entry, value)) {
+      cursor->current.offset = entry->offset;
+      cursor->current.packed = entry->packed;
+      cursor->pos            = entry->pos;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*!
+ * Seek a cursor to the first field not less than the value, starting at and
+ * including its current position.
+ *
+ * This is the indexed equivalent of pb_cursor_lower_bound(). The entries of
+ * the index serve as a table of offsets, so a binary search can be carried
+ * out on any field, regardless of its encoding. The remaining values of the
+ * field are assumed to be sorted in ascending order. In contrast to
+ * pb_cursor_lower_bound(), the cursor is left untouched if no such value is
+ * found.
+ *
+ * \param[in,out] index  Index
+ * \param[in,out] cursor Cursor
+ * \param[in]     value  Pointer holding value
+ * \return               Test result
+ */
+extern int
+pb_index_lower_bound(
+    pb_index_t *index, pb_cursor_t *cursor, const void *value) {
+  assert(index && cursor && value);
+  if (!pb_cursor_valid(cursor) || pb_cursor_align(cursor) || update(index))
+    return 0;
+
+  /* Ensure that the cursor belongs to the indexed field and message */
+  if (cursor->tag != pb_field_descriptor_tag(index->descriptor) ||
+      pb_cursor_journal(cursor) != pb_message_journal(&(index->message)) ||
+      pb_message_start(&(cursor->message)) !=
+        pb_message_start(&(index->message)))
+    return 0;
+
+  /* Find first entry at the current position of the cursor */
+  size_t lower = 0, upper = index->entry.size;
+  while (lower < upper) {
+    size_t middle = lower + (upper - lower) / 2;
+    if (index->entry.data[middle].pos < cursor->pos) {
+      lower = middle + 1;
+    } else {
+      upper = middle;
+    }
+  }
+
+  /* Find first entry not less than the given value */
+  upper = index->entry.size;
+  while (lower < upper) {
+    size_t middle = lower + (upper - lower) / 2;
+    pb_index_value_t temp;
+    if (unlikely_(load(index, &(index->entry.data[middle]), &temp)))
+      return 0;
+    if (pb_field_descriptor_compare(index->descriptor, &temp, value) < 0) {
+      lower = middle + 1;
+    } else {
+      upper = middle;
+    }
+  }
+
+  /* Move cursor to entry, if any */
+  if (lower == index->entry.size)
+    return 0;
+  const pb_index_entry_t *entry = &(index->entry.data[lower]);
+  cursor->current.offset = entry->offset;
+  cursor->current.packed = entry->packed;
+  cursor->pos            = entry->pos;
+  return 1;
+}
+
+/*!
+ * Test whether any occurrence of the indexed field contains the value.
+ *
+ * \param[in,out] index Index
+ * \param[in]     value Pointer holding value
+ * \return              Test result
+ */
+extern int
+pb_index_match(pb_index_t *index, const void *value) {
+  assert(index && value);
+  if (update(index))
+    return 0;
+
+  /* Find any matching entry */
+  size_t key = hash(index->descriptor, value);
+  for (size_t e = index->bucket.data[key & (index->bucket.size - 1)]; e;
+      e = index->entry.data[e - 1].next) {
+    const pb_index_entry_t *entry = &(index->entry.data[e - 1]);
+    if (entry->hash == key && match(index, entry, value))
+      return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_MESSAGE_INDEX_H
+#define PB_MESSAGE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/message/index.h>
+
+#include "message/common.h"
+#include "message/message.h"
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_index_entry_t {
+  size_t hash;                         /*!< Value hash */
+  size_t next;                         /*!< Next entry in bucket + 1 */
+  size_t pos;                          /*!< Cursor position */
+  pb_offset_t offset;                  /*!< Cursor offsets */
+  pb_offset_t packed;                  /*!< Cursor packed context */
+} pb_index_entry_t;
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create an invalid index.
+ *
+ * \return Index
+ */
+PB_WARN_UNUSED_RESULT
+PB_INLINE pb_index_t
+pb_index_create_invalid(void) {
+  pb_index_t index = {
+    .allocator  = NULL,
+    .message    = pb_message_create_invalid(),
+    .descriptor = NULL,
+    .revision   = SIZE_MAX,
+    .entry      = {
+      .data = NULL,
+      .size = 0
+    },
+    .bucket     = {
+      .data = NULL,
+      .size = 0
+    },
+    .error      = PB_ERROR_INVALID
+  };
+  return index;
+}
+
+#endif /* PB_MESSAGE_INDEX_H */
@@ -23,8 +23,10 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "core/allocator.h"
+#include "core/record.h"
 #include "message/buffer.h"
 #include "message/common.h"
 #include "message/journal.h"
@@ -49,11 +51,11 @@ push(
     pb_journal_t *journal, size_t origin, size_t offset, ptrdiff_t delta) {
   assert(journal && origin <= offset && delta);
   assert(pb_journal_valid(journal));
-  pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
-  if (unlikely_(allocator == &allocator_zero_copy))
+  if (unlikely_(pb_buffer_zero_copy(&(journal->buffer))))
     return PB_ERROR_ALLOC;
 
   /* Grow journal and append entry */
+  pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
   pb_journal_entry_t *data = pb_allocator_resize(allocator,
     journal->entry.data, sizeof(pb_journal_entry_t)
       * (journal->entry.size + 1));
@@ -86,6 +88,159 @@ pop(pb_journal_t *journal) {
 
 /* LCOV_EXCL_STOP <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
 
+/*!
+ * Detach a journal from a buffer shared with snapshots.
+ *
+ * If the buffer is still referenced by another journal, a private copy is
+ * created before the first write. Otherwise, the journal is the last one to
+ * reference the buffer, so it can take ownership without copying.
+ *
+ * \param[in,out] journal Journal
+ * \return                Error code
+ */
+static pb_error_t
+detach(pb_journal_t *journal) {
+  assert(journal && journal->refs);
+  pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
+  size_t *refs = journal->refs;
+  if (atomic_load_(refs) > 1) {
+    uint8_t *data = journal->buffer.data, *copy = NULL;
+    if (journal->buffer.size) {
+      if (unlikely_(!(copy = pb_allocator_allocate(
+          allocator, journal->buffer.size))))
+        return PB_ERROR_ALLOC;
+      memcpy(copy, data, journal->buffer.size);
+    }
+    journal->buffer.data = copy;
+    journal->refs        = NULL;
+
+    /* Release reference, unless all others were released in the meantime */
+    if (atomic_add_(refs, (size_t)-1) != 1)
+      return PB_ERROR_NONE;
+    if (data)
+      pb_allocator_free(allocator, data);
+  }
+
+  /* Journal is the last one referencing the buffer */
+  pb_allocator_free(allocator, refs);
+  journal->refs = NULL;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Reserve space for retiring allocations of a shared journal.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     count   Allocation count
+ * \return                Error code
+ */
+static pb_error_t
+reserve(pb_journal_t *journal, size_t count) {
+  assert(journal && count);
+  pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
+  void **data = pb_allocator_resize(allocator, journal->shared.retired.data,
+    sizeof(void *) * (journal->shared.retired.size + count));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  journal->shared.retired.data = data;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Write or clear data of a shared journal, swapping in a new buffer.
+ *
+ * Concurrent readers may still access the current buffer and entries through
+ * views, so they are never altered in place, not even for writes that don't
+ * change the size. Instead, a new buffer is assembled and swapped in within a
+ * write section, and the previous allocations are retired. Entries are grown
+ * in powers of two, so they are only rarely swapped.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     origin  Origin
+ * \param[in]     start   Start offset
+ * \param[in]     end     End offset
+ * \param[in]     data[]  Raw data
+ * \param[in]     size    Raw data size
+ * \return                Error code
+ */
+static pb_error_t
+swap(
+    pb_journal_t *journal, size_t origin, size_t start, size_t end,
+    const uint8_t data[], size_t size) {
+  assert(journal && (data || !size));
+  pb_buffer_t *buffer = &(journal->buffer);
+  if (unlikely_(start > end || end > buffer->size))
+    return PB_ERROR_OFFSET;
+  if (unlikely_(pb_buffer_zero_copy(buffer)))
+    return PB_ERROR_ALLOC;
+
+  /* Reserve space for retiring the buffer and entries */
+  pb_allocator_t *allocator = pb_buffer_allocator(buffer);
+  pb_error_t error = reserve(journal, 2);
+  if (unlikely_(error))
+    return error;                                          /* LCOV_EXCL_LINE */
+
+  /* Allocate new entries if size changed and capacity is exhausted */
+  pb_journal_entry_t *entries = journal->entry.data;
+  const size_t count = journal->entry.size;
+  ptrdiff_t delta = size - (end - start);
+  if (delta) {
+    if (!(count & (count - 1))) {
+      entries = pb_allocator_allocate(allocator,
+        sizeof(pb_journal_entry_t) * (count ? count << 1 : 1));
+      if (unlikely_(!entries))
+        return PB_ERROR_ALLOC;
+      if (count)
+        memcpy(entries, journal->entry.data,
+          sizeof(pb_journal_entry_t) * count);
+    }
+    entries[count] = (pb_journal_entry_t){
+      .origin = origin,
+      .offset = end,
+      .delta  = delta
+    };
+  }
+
+  /* Assemble new buffer, unless it is empty */
+  uint8_t *temp = NULL;
+  if (buffer->size + delta) {
+    if (unlikely_(!(temp = pb_allocator_allocate(
+        allocator, buffer->size + delta)))) {
+      if (entries != journal->entry.data)
+        pb_allocator_free(allocator, entries);
+      return PB_ERROR_ALLOC;
+    }
+    if (start)
+      memcpy(temp, buffer->data, start);
+    if (size)
+      memcpy(&(temp[start]), data, size);
+    if (end < buffer->size)
+      memcpy(&(temp[start + size]), &(buffer->data[end]),
+        buffer->size - end);
+  }
+
+  /* Publish new buffer and entries */
+  void *retired[2] = {
+    buffer->data, entries != journal->entry.data
+      ? journal->entry.data
+      : NULL
+  };
+  pb_journal_write_begin(journal);
+  journal->entry.data  = entries;
+  journal->entry.size += !!delta;
+  buffer->data  = temp;
+  buffer->size += delta;
+  journal->revision++;
+  pb_journal_write_end(journal);
+
+  /* Retire previous allocations */
+  for (size_t r = 0; r < 2; ++r)
+    if (retired[r])
+      journal->shared.retired.data[journal->shared.retired.size++] =
+        retired[r];
+  return PB_ERROR_NONE;
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -121,11 +276,12 @@ pb_journal_create_with_allocator(
     pb_allocator_t *allocator, const uint8_t data[], size_t size) {
   assert(allocator && data && size);
   pb_journal_t journal = {
-    .buffer = pb_buffer_create_with_allocator(allocator, data, size),
-    .entry  = {
+    .buffer   = pb_buffer_create_with_allocator(allocator, data, size),
+    .entry    = {
       .data = NULL,
       .size = 0
-    }
+    },
+    .revision = 0
   };
   return journal;
 }
@@ -153,11 +309,12 @@ extern pb_journal_t
 pb_journal_create_empty_with_allocator(pb_allocator_t *allocator) {
   assert(allocator);
   pb_journal_t journal = {
-    .buffer = pb_buffer_create_empty_with_allocator(allocator),
-    .entry  = {
+    .buffer   = pb_buffer_create_empty_with_allocator(allocator),
+    .entry    = {
       .data = NULL,
       .size = 0
-    }
+    },
+    .revision = 0
   };
   return journal;
 }
@@ -173,11 +330,44 @@ extern pb_journal_t
 pb_journal_create_zero_copy(uint8_t data[], size_t size) {
   assert(data && size);
   pb_journal_t journal = {
-    .buffer = pb_buffer_create_zero_copy(data, size),
-    .entry  = {
+    .buffer   = pb_buffer_create_zero_copy(data, size),
+    .entry    = {
       .data = NULL,
       .size = 0
-    }
+    },
+    .revision = 0
+  };
+  return journal;
+}
+
+/*!
+ * Create a zero-copy journal over the current record of a record iterator.
+ *
+ * This allows to create messages over records without copying, e.g. when
+ * iterating a memory-mapped record file. As for all zero-copy journals, only
+ * alterations that don't change the size of the record will succeed, and if
+ * the record file is memory-mapped, no alterations will succeed at all.
+ *
+ * \warning The journal refers to the current record, so it must not be used
+ * after the record iterator was advanced.
+ *
+ * \param[in] iter Record iterator
+ * \return         Journal
+ */
+extern pb_journal_t
+pb_journal_create_from_record(const pb_record_iter_t *iter) {
+  assert(iter);
+  if (unlikely_(!pb_record_iter_valid(iter)))
+    return pb_journal_create_invalid();
+  const pb_buffer_t *record = pb_record_iter_buffer(iter);
+  pb_journal_t journal = {
+    .buffer   = pb_buffer_create_view_internal(record,
+      record->data, record->size),
+    .entry    = {
+      .data = NULL,
+      .size = 0
+    },
+    .revision = 0
   };
   return journal;
 }
@@ -191,7 +381,18 @@ extern void
 pb_journal_destroy(pb_journal_t *journal) {
   assert(journal);
   if (pb_journal_valid(journal)) {
-    if (journal->entry.data) {
+    pb_journal_reclaim(journal);
+
+    /* Release reference on buffer, unless it's the last one */
+    if (journal->refs) {
+      pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
+      if (atomic_add_(journal->refs, (size_t)-1) != 1)
+        journal->buffer.data = NULL;
+      else
+        pb_allocator_free(allocator, journal->refs);
+      journal->refs = NULL;
+    }
+    if (journal->entry.data && !pb_buffer_zero_copy(&(journal->buffer))) {
       pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
       pb_allocator_free(allocator, journal->entry.data);
 
@@ -203,6 +404,338 @@ pb_journal_destroy(pb_journal_t *journal) {
   }
 }
 
+/*!
+ * Create a snapshot of a journal.
+ *
+ * The snapshot is a journal which shares the buffer of the given journal by
+ * reference count, so creating it doesn't copy any data. Whichever of the
+ * journals sharing the buffer is written to first materializes a private copy,
+ * so a snapshot always keeps the version at the time of its creation. The
+ * snapshot starts without any entries, and the journals may be destroyed in
+ * any order, as well as from different threads.
+ *
+ * \warning A snapshot must only be created by the thread owning the journal.
+ * Zero-copy and shared journals cannot be snapshotted.
+ *
+ * \param[in,out] journal Journal
+ * \return                Snapshot
+ */
+extern pb_journal_t
+pb_journal_snapshot(pb_journal_t *journal) {
+  assert(journal);
+  if (unlikely_(!pb_journal_valid(journal) || journal->shared.enabled ||
+      pb_buffer_zero_copy(&(journal->buffer))))
+    return pb_journal_create_invalid();
+
+  /* Create reference count, if buffer isn't referenced yet */
+  pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
+  if (!journal->refs) {
+    if (unlikely_(!(journal->refs = pb_allocator_allocate(
+        allocator, sizeof(size_t)))))
+      return pb_journal_create_invalid();
+    *journal->refs = 1;
+  }
+  atomic_add_(journal->refs, 1);
+
+  /* Create snapshot referencing the same buffer */
+  pb_journal_t snapshot = {
+    .buffer   = journal->buffer,
+    .entry    = {
+      .data = NULL,
+      .size = 0
+    },
+    .revision = 0,
+    .refs     = journal->refs
+  };
+  return snapshot;
+}
+
+/*!
+ * Share a journal with concurrent readers.
+ *
+ * Writes to a shared journal are wrapped in a sequence lock, and buffers and
+ * entries are never altered in place, but swapped and retired. Operations on
+ * parts and messages, which may consist of several writes, e.g. to adjust the
+ * length prefixes of all containing messages, are wrapped in a single write
+ * section, so readers never observe an intermediate state. Readers take a view
+ * on the journal, which is retried until it captures a version outside of a
+ * write section, and then read through messages, cursors and fields created on
+ * the view, while a single writer may continue to alter the journal.
+ *
+ * \code{.c}
+ *   pb_journal_t view    = pb_journal_view(&journal);
+ *   pb_message_t message = pb_message_create(&descriptor, &view);
+ *   error = pb_message_get(&message, tag, &value);
+ *   pb_message_destroy(&message);
+ *   pb_journal_destroy(&view);
+ * \endcode
+ *
+ * Zero-copy journals cannot be shared, as their buffer cannot be swapped.
+ *
+ * \param[in,out] journal Journal
+ * \return                Error code
+ */
+extern pb_error_t
+pb_journal_share(pb_journal_t *journal) {
+  assert(journal);
+  if (unlikely_(!pb_journal_valid(journal)))
+    return PB_ERROR_INVALID;
+  if (unlikely_(pb_buffer_zero_copy(&(journal->buffer))))
+    return PB_ERROR_ALLOC;
+
+  /* Detach from buffer shared with snapshots */
+  pb_error_t error;
+  if (journal->refs && (error = detach(journal)))
+    return error;                                          /* LCOV_EXCL_LINE */
+
+  /* Grow entries to the next power of two, which is their implicit capacity */
+  const size_t count = journal->entry.size;
+  if (count & (count - 1)) {
+    size_t capacity = 1;
+    while (capacity < count)
+      capacity <<= 1;
+    pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
+    pb_journal_entry_t *data = pb_allocator_resize(allocator,
+      journal->entry.data, sizeof(pb_journal_entry_t) * capacity);
+    if (unlikely_(!data))
+      return PB_ERROR_ALLOC;                               /* LCOV_EXCL_LINE */
+    journal->entry.data = data;
+  }
+  journal->shared.enabled = 1;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Create a view on a shared journal.
+ *
+ * A view is a zero-copy journal referring to the buffer and entries of a
+ * shared journal as left by the last completed write section, which stays
+ * valid until retired allocations are reclaimed. Messages, cursors and fields
+ * created on the view can be used without any synchronization, and if it is
+ * outdated, they can be aligned by taking a new view on the journal.
+ *
+ * \warning A view must only be read, never written to, and the writer must not
+ * take a view within a write section, as it would wait for itself.
+ *
+ * \param[in] journal Journal
+ * \return            View
+ */
+extern pb_journal_t
+pb_journal_view(const pb_journal_t *journal) {
+  assert(journal);
+  if (unlikely_(!pb_journal_valid(journal)))
+    return pb_journal_create_invalid();
+
+  /* Copy buffer and entries until they are consistent */
+  pb_journal_t view; size_t sequence;
+  do {
+    sequence = pb_journal_read_begin(journal);
+    view = (pb_journal_t){
+      .buffer   = pb_buffer_create_zero_copy_internal(
+        journal->buffer.data, journal->buffer.size),
+      .entry    = {
+        .data = journal->entry.data,
+        .size = journal->entry.size
+      },
+      .revision = journal->revision,
+      .shared   = {
+        .sequence = sequence
+      }
+    };
+  } while (pb_journal_read_retry(journal, sequence));
+  return view;
+}
+
+/*!
+ * Free all allocations retired by writes to a shared journal.
+ *
+ * \warning This function may only be called by the writer, and only if no
+ * concurrent readers are active, as they may still access those allocations.
+ *
+ * \param[in,out] journal Journal
+ */
+extern void
+pb_journal_reclaim(pb_journal_t *journal) {
+  assert(journal);
+  if (journal->shared.retired.data) {
+    pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
+    for (size_t r = 0; r < journal->shared.retired.size; ++r)
+      pb_allocator_free(allocator, journal->shared.retired.data[r]);
+    pb_allocator_free(allocator, journal->shared.retired.data);
+
+    /* Clear retired allocations */
+    journal->shared.retired.data = NULL;
+    journal->shared.retired.size = 0;
+  }
+}
+
+/*!
+ * Begin a read section on a shared journal.
+ *
+ * If a write section is in progress, this function spins until it has
+ * finished, as write sections are short and readers would need to retry
+ * anyway.
+ *
+ * \param[in] journal Journal
+ * \return            Sequence
+ */
+extern size_t
+pb_journal_read_begin(const pb_journal_t *journal) {
+  assert(journal);
+  size_t sequence;
+  do {
+    sequence = atomic_load_(&(journal->shared.sequence));
+  } while (unlikely_(sequence & 1));
+  return sequence;
+}
+
+/*!
+ * Check whether a read section on a shared journal must be retried.
+ *
+ * \param[in] journal  Journal
+ * \param[in] sequence Sequence
+ * \return             Test result
+ */
+extern int
+pb_journal_read_retry(const pb_journal_t *journal, size_t sequence) {
+  assert(journal);
+  atomic_acquire_fence_();
+  return atomic_load_(&(journal->shared.sequence)) != sequence;
+}
+
+/*!
+ * Begin a write section on a shared journal.
+ *
+ * The sequence is odd while writing, so concurrent readers can detect that
+ * they may have observed an intermediate state and must retry. A logical edit
+ * may consist of several writes, so write sections may be nested and only the
+ * outermost one alters the sequence. If the journal is not shared, this
+ * function does nothing.
+ *
+ * \param[in,out] journal Journal
+ */
+extern void
+pb_journal_write_begin(pb_journal_t *journal) {
+  assert(journal);
+  if (journal->shared.enabled && !journal->shared.depth++) {
+    atomic_store_(&(journal->shared.sequence), journal->shared.sequence + 1);
+    atomic_release_fence_();
+  }
+}
+
+/*!
+ * End a write section on a shared journal.
+ *
+ * \param[in,out] journal Journal
+ */
+extern void
+pb_journal_write_end(pb_journal_t *journal) {
+  assert(journal);
+  if (journal->shared.enabled) {
+    assert(journal->shared.depth);
+    if (!--journal->shared.depth)
+      atomic_store_(&(journal->shared.sequence),
+        journal->shared.sequence + 1);
+  }
+}
+
+/*!
+ * Rewrite the buffer of a journal in canonical form.
+ *
+ * After many writes, a message may contain shadowed occurrences of fields,
+ * fields in order of insertion, overlong varints and several packed runs of
+ * the same field. The canonical form is deterministic: fields are sorted by
+ * tag, only the last occurrence of a non-repeated field or oneof is retained,
+ * tags, varints and length prefixes are encoded minimally, and the values of
+ * repeated scalar fields are coalesced. Thus, messages with equal contents are
+ * equal in canonical form.
+ *
+ * The canonical buffer is assembled from scratch in a single pass over the
+ * current buffer with pb_buffer_canonicalize() and then swapped in, so no
+ * journal entries are created. Instead, the entries are reset, as offsets of
+ * the old buffer cannot be mapped to the new one. If the journal is zero-copy,
+ * canonicalization only succeeds if the size of the buffer doesn't change and
+ * it isn't read-only, and the buffer is rewritten in place.
+ *
+ * \warning All messages, cursors and fields referring to the journal must be
+ * recreated after canonicalization, as only the revision of the journal is
+ * incremented, so they cannot detect that the journal was altered. Views must
+ * not be canonicalized.
+ *
+ * \param[in,out] journal    Journal
+ * \param[in]     descriptor Descriptor
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_journal_canonicalize(
+    pb_journal_t *journal, const pb_descriptor_t *descriptor) {
+  assert(journal && descriptor);
+  if (unlikely_(!pb_journal_valid(journal)))
+    return PB_ERROR_INVALID;
+  pb_buffer_t *buffer = &(journal->buffer);
+  pb_allocator_t *allocator = pb_buffer_allocator(buffer);
+  const int zero_copy = pb_buffer_zero_copy(buffer);
+
+  /* Reserve space for retiring the buffer of a shared journal */
+  pb_error_t error;
+  if (journal->shared.enabled && (error = reserve(journal, 1)))
+    return error;                                          /* LCOV_EXCL_LINE */
+
+  /* Assemble canonical buffer */
+  pb_buffer_t temp = pb_buffer_create_empty_with_allocator(
+    zero_copy ? &allocator_default : allocator);
+  error = pb_buffer_canonicalize(&temp, descriptor,
+    buffer->data, buffer->size);
+  if (!error && zero_copy && (temp.size != buffer->size ||
+      pb_buffer_read_only(buffer)))
+    error = PB_ERROR_ALLOC;
+
+  /* Zero-copy journals can only be rewritten in place */
+  if (unlikely_(error) || zero_copy) {
+    if (!error && temp.size)
+      memcpy(buffer->data, temp.data, temp.size);
+    if (!error)
+      journal->revision++;
+    pb_buffer_destroy(&temp);
+    return error;
+  }
+
+  /* Release reference on buffer shared with snapshots */
+  uint8_t *data = buffer->data;
+  if (journal->refs) {
+    if (atomic_add_(journal->refs, (size_t)-1) != 1)
+      data = NULL;
+    else
+      pb_allocator_free(allocator, journal->refs);
+    journal->refs = NULL;
+  }
+
+  /* Swap in canonical buffer and reset entries of shared journal */
+  if (journal->shared.enabled) {
+    pb_journal_write_begin(journal);
+    buffer->data = temp.data;
+    buffer->size = temp.size;
+    journal->entry.size = 0;
+    journal->revision++;
+    pb_journal_write_end(journal);
+    if (data)
+      journal->shared.retired.data[journal->shared.retired.size++] = data;
+
+  /* Otherwise free previous buffer and entries */
+  } else {
+    if (data)
+      pb_allocator_free(allocator, data);
+    if (journal->entry.data)
+      pb_allocator_free(allocator, journal->entry.data);
+    journal->entry.data = NULL;
+    journal->entry.size = 0;
+    buffer->data = temp.data;
+    buffer->size = temp.size;
+    journal->revision++;
+  }
+  return PB_ERROR_NONE;
+}
+
 /*!
  * Write data to a journal.
  *
@@ -226,6 +759,14 @@ pb_journal_write(
     return PB_ERROR_INVALID;
   pb_error_t error = PB_ERROR_NONE;
 
+  /* Detach from buffer shared with snapshots */
+  if (unlikely_(journal->refs != NULL) && (error = detach(journal)))
+    return error;
+
+  /* Swap buffer if journal is shared */
+  if (unlikely_(journal->shared.enabled))
+    return swap(journal, origin, start, end, data, size);
+
   /* Perform journaled write if size changed */
   ptrdiff_t delta = size - (end - start);
   if (delta) {
@@ -239,6 +780,10 @@ pb_journal_write(
   } else {
     error = pb_buffer_write(&(journal->buffer), start, end, data, size);
   }
+
+  /* Increment revision on success */
+  if (likely_(!error))
+    journal->revision++;
   return error;
 }
 
@@ -262,6 +807,14 @@ pb_journal_clear(
     return PB_ERROR_INVALID;
   pb_error_t error = PB_ERROR_NONE;
 
+  /* Detach from buffer shared with snapshots */
+  if (unlikely_(journal->refs != NULL) && (error = detach(journal)))
+    return error;
+
+  /* Swap buffer if journal is shared */
+  if (unlikely_(journal->shared.enabled))
+    return swap(journal, origin, start, end, NULL, 0);
+
   /* Perform journaled clear if size changed */
   ptrdiff_t delta = start - end;
   if (delta) {
@@ -275,6 +828,10 @@ pb_journal_clear(
   } else {
     error = pb_buffer_clear(&(journal->buffer), start, end);
   }
+
+  /* Increment revision on success */
+  if (likely_(!error))
+    journal->revision++;
   return error;
 }
 
@@ -99,6 +99,22 @@ pb_journal_version(const pb_journal_t *journal) {
   return journal->entry.size;
 }
 
+/*!
+ * Retrieve the revision of a journal.
+ *
+ * In contrast to the version, which only changes if the size of the journal
+ * changes, the revision is incremented on every write, including in-place
+ * writes, so it can be used to detect any modification.
+ *
+ * \param[in] journal Journal
+ * \return            Revision
+ */
+PB_INLINE size_t
+pb_journal_revision(const pb_journal_t *journal) {
+  assert(journal);
+  return journal->revision;
+}
+
 /*!
  * Retrieve the raw data of a journal from a given offset.
  *
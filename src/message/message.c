@@ -25,7 +25,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "core/allocator.h"
+#include "core/buffer.h"
 #include "core/descriptor.h"
+#include "core/encoder.h"
+#include "core/stream.h"
+#include "core/varint.h"
+#include "message/buffer.h"
 #include "message/common.h"
 #include "message/cursor.h"
 #include "message/field.h"
@@ -34,6 +40,298 @@
 #include "message/oneof.h"
 #include "message/part.h"
 
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Return the smaller of two values.
+ *
+ * \param[in] x Value to compare
+ * \param[in] y Value to compare
+ * \return      Smaller value
+ */
+#define min(x, y) \
+  ((x) < (y) ? (x) : (y))
+
+/*!
+ * Unpack a run of varints into an array of the given native type.
+ *
+ * Whenever the next eight bytes hold eight single-byte varints, which is the
+ * common case for small values, they are widened at once. Otherwise, the
+ * unpack function for the type is called directly, so there are no indirect
+ * calls per value.
+ *
+ * \param[in] T      Native type
+ * \param[in] unpack Unpack function
+ * \param[in] zigzag Whether values are zig-zag encoded
+ */
+#define unpack_varints(T, unpack, zigzag) \
+  do { \
+    T *array = values; \
+    while (left) { \
+      uint64_t block; \
+      if (left >= 8 && *count + 8 <= size && \
+          (memcpy(&block, data, 8), !(block & 0x8080808080808080ULL))) { \
+        for (size_t b = 0; b < 8; b++) \
+          array[*count + b] = zigzag \
+            ? (T)((data[b] >> 1) ^ -(data[b] & 1)) \
+            : (T)(data[b]); \
+        data += 8; left -= 8; *count += 8; \
+      } else { \
+        T value; size_t bytes = unpack(data, left, &value); \
+        if (unlikely_(!bytes)) \
+          return PB_ERROR_VARINT; \
+        if (*count < size) \
+          array[*count] = value; \
+        data += bytes; left -= bytes; (*count)++; \
+      } \
+    } \
+  } while (0)
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Occurrence of a field inside a message.
+ */
+typedef struct field_t {
+  const void *key;                     /*!< Field or oneof, if not repeated */
+  size_t start;                        /*!< Start offset, including tag */
+  size_t end;                          /*!< End offset */
+} field_t;
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Unpack the values of a packed varint field into an array.
+ *
+ * \param[in]     type   Type
+ * \param[in]     data[] Raw data
+ * \param[in]     left   Bytes left
+ * \param[out]    values Pointer receiving values
+ * \param[in]     size   Value count
+ * \param[in,out] count  Total value count
+ * \return               Error code
+ */
+static pb_error_t
+get_packed_varint(
+    pb_type_t type, const uint8_t data[], size_t left, void *values,
+    size_t size, size_t *count) {
+  assert(data && count);
+  switch (type) {
+    case PB_TYPE_INT32:
+    case PB_TYPE_ENUM:
+      unpack_varints(int32_t, pb_varint_unpack_int32, 0);
+      break;
+    case PB_TYPE_INT64:
+      unpack_varints(int64_t, pb_varint_unpack_int64, 0);
+      break;
+    case PB_TYPE_UINT32:
+      unpack_varints(uint32_t, pb_varint_unpack_uint32, 0);
+      break;
+    case PB_TYPE_UINT64:
+      unpack_varints(uint64_t, pb_varint_unpack_uint64, 0);
+      break;
+    case PB_TYPE_SINT32:
+      unpack_varints(int32_t, pb_varint_unpack_sint32, 1);
+      break;
+    case PB_TYPE_SINT64:
+      unpack_varints(int64_t, pb_varint_unpack_sint64, 1);
+      break;
+    case PB_TYPE_BOOL:
+      unpack_varints(uint8_t, pb_varint_unpack_uint8, 0);
+      break;
+    default:
+      return PB_ERROR_INVALID;                             /* LCOV_EXCL_LINE */
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Collect the occurrences of all fields of a message in a single pass.
+ *
+ * Every occurrence of a non-repeated field is keyed by its field descriptor,
+ * or by its oneof descriptor, if it is member of a oneof, as the members of a
+ * oneof shadow each other. Repeated and unknown fields are not keyed.
+ *
+ * \param[in]  message Message
+ * \param[out] fields  Pointer receiving fields
+ * \param[out] size    Pointer receiving field count
+ * \return             Error code
+ */
+static pb_error_t
+collect(pb_message_t *message, field_t **fields, size_t *size) {
+  assert(message && fields && size);
+  pb_error_t error = PB_ERROR_NONE;
+  size_t capacity = 0, end = pb_message_end(message);
+
+  /* Iterate tag-value pairs */
+  pb_stream_t stream = pb_stream_create_at(pb_journal_buffer(
+    pb_message_journal(message)), pb_message_start(message));
+  while (!error && pb_stream_offset(&stream) < end) {
+    size_t start = pb_stream_offset(&stream);
+    pb_tag_t tag;
+    if (unlikely_(error = pb_stream_read(&stream, PB_TYPE_UINT32, &tag)))
+      break;
+
+    /* Skip value, rejecting invalid wiretypes */
+    pb_wiretype_t wiretype = tag & 7;
+    if (unlikely_(wiretype > PB_WIRETYPE_32BIT ||
+        !pb_stream_skip_jump[wiretype])) {
+      error = PB_ERROR_INVALID;
+      break;
+    } else if (unlikely_(error = pb_stream_skip(&stream, wiretype))) {
+      break;
+    }
+
+    /* Grow array of fields, if necessary */
+    if (unlikely_(*size == capacity)) {
+      field_t *temp = pb_allocator_resize(&allocator_default, *fields,
+        sizeof(field_t) * (capacity = capacity ? capacity << 1 : 16));
+      if (unlikely_(!temp)) {
+        error = PB_ERROR_ALLOC;                            /* LCOV_EXCL_LINE */
+        break;                                             /* LCOV_EXCL_LINE */
+      }
+      *fields = temp;
+    }
+
+    /* Key non-repeated fields by field or oneof */
+    const pb_field_descriptor_t *descriptor =
+      pb_descriptor_field_by_tag(message->descriptor, tag >> 3);
+    const void *key = NULL;
+    if (descriptor) {
+      switch (pb_field_descriptor_label(descriptor)) {
+        case PB_LABEL_REPEATED:
+          break;
+        case PB_LABEL_ONEOF:
+          key = pb_field_descriptor_oneof(descriptor);
+          break;
+        default:
+          key = descriptor;
+      }
+    }
+    (*fields)[(*size)++] = (field_t){ key, start, pb_stream_offset(&stream) };
+  }
+  pb_stream_destroy(&stream);
+
+  /* A field must not cross the end of the message */
+  if (!error && pb_stream_offset(&stream) != end)
+    error = PB_ERROR_OFFSET;
+  return error;
+}
+
+/*!
+ * Mark all fields which are shadowed by a later occurrence of the same key.
+ *
+ * The fields are visited from last to first, and the keys are tracked in an
+ * open-addressing hash set, so shadowed fields are found in linear time. The
+ * end offsets of shadowed fields are set to their start offsets.
+ *
+ * \param[in,out] fields[] Fields
+ * \param[in]     size     Field count
+ * \param[out]    shadowed Pointer receiving number of shadowed bytes
+ * \return                 Error code
+ */
+static pb_error_t
+shadow(field_t fields[], size_t size, size_t *shadowed) {
+  assert(fields && size && shadowed);
+
+  /* Allocate hash set with a load factor of at most one half */
+  size_t slots = 16;
+  while (slots < size << 1)
+    slots <<= 1;
+  const void **set = pb_allocator_allocate(&allocator_default,
+    sizeof(*set) * slots);
+  if (unlikely_(!set))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  memset(set, 0, sizeof(*set) * slots);
+
+  /* Visit fields from last to first and mark all but the last occurrence */
+  for (size_t f = size; f > 0; ) {
+    field_t *field = &(fields[--f]);
+    if (!field->key)
+      continue;
+    size_t s = (size_t)((((uint64_t)(uintptr_t)field->key >> 3) *
+      0x9E3779B97F4A7C15ULL) >> 32);
+    while (set[s &= slots - 1] && set[s] != field->key)
+      s++;
+    if (set[s]) {
+      *shadowed  += field->end - field->start;
+      field->end  = field->start;
+    } else {
+      set[s] = field->key;
+    }
+  }
+  pb_allocator_free(&allocator_default, set);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Retrieve the canonical form of a message.
+ *
+ * \param[in,out] message Message
+ * \param[out]    buffer  Buffer receiving canonical form
+ * \return                Error code
+ */
+static pb_error_t
+canonical(pb_message_t *message, pb_buffer_t *buffer) {
+  assert(message && buffer);
+  assert(pb_message_valid(message) && pb_message_aligned(message));
+  *buffer = pb_buffer_create_empty();
+  return pb_message_empty(message)
+    ? PB_ERROR_NONE
+    : pb_buffer_canonicalize(buffer, message->descriptor,
+        pb_journal_data_from(pb_message_journal(message),
+          pb_message_start(message)), pb_message_size(message));
+}
+
+/*!
+ * Mix the bits of a 64-bit value.
+ *
+ * \param[in] value Value
+ * \return          Mixed value
+ */
+static uint64_t
+mix(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xFF51AFD7ED558CCDULL;
+  value ^= value >> 33;
+  value *= 0xC4CEB9FE1A85EC53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+/*!
+ * Compute a 64-bit hash of raw data, consuming eight bytes at a time.
+ *
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \param[in] seed   Seed
+ * \return           Hash
+ */
+static uint64_t
+hash(const uint8_t data[], size_t size, uint64_t seed) {
+  assert(data || !size);
+  uint64_t value = seed ^ mix(size);
+  for (; size >= 8; data += 8, size -= 8) {
+    uint64_t block;
+    memcpy(&block, data, 8);
+    value = (value ^ mix(block)) * 0x9E3779B97F4A7C15ULL;
+  }
+
+  /* Zero-pad remaining bytes */
+  if (size) {
+    uint64_t block = 0;
+    memcpy(&block, data, size);
+    value = (value ^ mix(block)) * 0x9E3779B97F4A7C15ULL;
+  }
+  return mix(value);
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -284,6 +582,119 @@ pb_message_get(pb_message_t *message, pb_tag_t tag, void *value) {
   return error;
 }
 
+/*!
+ * Read all values of a repeated field from a message into an array.
+ *
+ * The message is scanned once and all occurrences of the field are written
+ * to the given array in order, up to the given number of values. Packed runs
+ * of fixed-sized values are copied as a whole, and packed runs of varints are
+ * unpacked in a tight loop. The total number of values is always returned,
+ * so the array may be sized accordingly. Strings and bytes point into the
+ * underlying journal and are valid until it is altered.
+ *
+ * \warning The caller has to ensure that the space pointed to by the values
+ * pointer is appropriately sized for the type of field.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[out]    values  Pointer receiving values
+ * \param[in]     size    Value count
+ * \param[out]    count   Total value count
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_get_repeated(
+    pb_message_t *message, pb_tag_t tag, void *values, size_t size,
+    size_t *count) {
+  assert(message && tag && (values || !size) && count);
+  *count = 0;
+  if (unlikely_(!pb_message_valid(message)))
+    return PB_ERROR_INVALID;
+
+  /* Assert repeated non-message field */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(message->descriptor, tag);
+  assert(descriptor &&
+    pb_field_descriptor_type(descriptor)  != PB_TYPE_MESSAGE &&
+    pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED);
+
+  /* Ensure that the message is properly aligned */
+  pb_error_t error = pb_message_align(message);
+  if (unlikely_(error))
+    return error;
+
+  /* Retrieve type, wiretype and native size of values */
+  pb_type_t     type     = pb_field_descriptor_type(descriptor);
+  pb_wiretype_t wiretype = pb_field_descriptor_wiretype(descriptor);
+  size_t        width    = pb_field_descriptor_type_size(descriptor);
+
+  /* Create temporary buffer over the message */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+    pb_journal_data_from(pb_message_journal(message), 0),
+      pb_message_end(message));
+
+  /* Create stream over temporary buffer and collect all values */
+  pb_stream_t stream = pb_stream_create_at(&buffer, pb_message_start(message));
+  while (!error && pb_stream_left(&stream)) {
+    uint32_t key;
+    if ((error = pb_stream_read(&stream, PB_TYPE_UINT32, &key)))
+      break;
+
+    /* Skip other fields */
+    pb_wiretype_t current = key & 7;
+    if (unlikely_(current > PB_WIRETYPE_32BIT ||
+        !pb_stream_skip_jump[current])) {
+      error = PB_ERROR_INVALID;
+    } else if ((key >> 3) != tag) {
+      error = pb_stream_skip(&stream, current);
+
+    /* Read packed run of values */
+    } else if (current == PB_WIRETYPE_LENGTH &&
+               wiretype != PB_WIRETYPE_LENGTH) {
+      uint32_t length;
+      if ((error = pb_stream_read(&stream, PB_TYPE_UINT32, &length)))
+        break;
+      const uint8_t *data = pb_stream_data(&stream, length);
+      if (unlikely_(!data)) {
+        error = PB_ERROR_OFFSET;
+
+      /* Unpack varints */
+      } else if (wiretype == PB_WIRETYPE_VARINT) {
+        if (!(error = get_packed_varint(type, data, length,
+            values, size, count)))
+          error = pb_stream_advance(&stream, length);
+
+      /* Copy fixed-sized values as a whole */
+      } else if (unlikely_(length % width)) {
+        error = PB_ERROR_OFFSET;
+      } else {
+        if (*count < size)
+          memcpy((uint8_t *)values + *count * width, data,
+            min(length / width, size - *count) * width);
+        *count += length / width;
+        error = pb_stream_advance(&stream, length);
+      }
+
+    /* Read single value */
+    } else if (current == wiretype) {
+      error = *count < size
+        ? pb_stream_read(&stream, type, (uint8_t *)values + *count * width)
+        : pb_stream_skip(&stream, current);
+      if (!error)
+        (*count)++;
+
+    /* Skip value with mismatching wiretype */
+    } else {
+      error = pb_stream_skip(&stream, current);
+    }
+  }
+
+  /* Cleanup and return */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+  return error;
+}
+
 /*!
  * Write a value or submessage for a given tag to a message.
  *
@@ -315,6 +726,7 @@ pb_message_put(pb_message_t *message, pb_tag_t tag, const void *value) {
   assert(descriptor);
 
   /* Create field and write value */
+  pb_journal_write_begin(pb_message_journal(message));
   if (pb_field_descriptor_type(descriptor) != PB_TYPE_MESSAGE) {
     pb_field_t field = pb_field_create_without_default(message, tag);
     error = pb_field_put(&field, value);
@@ -338,6 +750,264 @@ pb_message_put(pb_message_t *message, pb_tag_t tag, const void *value) {
     }
     pb_message_destroy(&submessage);
   }
+  pb_journal_write_end(pb_message_journal(message));
+  return error;
+}
+
+/*!
+ * Append values to a repeated field of a message.
+ *
+ * In contrast to writing values one by one with pb_message_put(), all values
+ * are encoded at once - as a single packed field, if the field is packed -
+ * and inserted with a single journal write, so the length prefixes of all
+ * containing messages are only adjusted once. If a packed field already ends
+ * with a packed run of values, the values are merged into it.
+ *
+ * \warning The caller has to ensure that the space pointed to by the values
+ * pointer is appropriately sized for the type of field.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[in]     values  Pointer holding values
+ * \param[in]     size    Value count
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_put_repeated(
+    pb_message_t *message, pb_tag_t tag, const void *values, size_t size) {
+  assert(message && tag && (values || !size));
+  if (unlikely_(!pb_message_valid(message)))
+    return PB_ERROR_INVALID;
+
+#ifndef NDEBUG
+
+  /* Assert repeated non-message field */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(message->descriptor, tag);
+  assert(descriptor &&
+    pb_field_descriptor_type(descriptor)  != PB_TYPE_MESSAGE &&
+    pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED);
+
+#endif /* NDEBUG */
+
+  /* Nothing to be done for an empty list of values */
+  if (unlikely_(!size))
+    return PB_ERROR_NONE;
+
+  /* Encode values and insert them into the message */
+  pb_encoder_t encoder = pb_encoder_create(message->descriptor);
+  pb_error_t error = pb_encoder_encode(&encoder, tag, values, size);
+  if (likely_(!error)) {
+    const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+    error = pb_part_insert(message, tag,
+      pb_buffer_data(buffer), pb_buffer_size(buffer));
+  }
+  pb_encoder_destroy(&encoder);
+  return error;
+}
+
+/*!
+ * Merge a message into another message.
+ *
+ * The raw data of the source message is appended to the end of the destination
+ * message with a single journal write, so the length prefixes of all messages
+ * containing the destination message are only adjusted once. Values of
+ * non-repeated fields of the source message shadow those of the destination
+ * message, as the last occurrence wins, and values of repeated fields are
+ * appended.
+ *
+ * In contrast to the Protocol Buffers merge semantics, submessages are not
+ * merged field by field, but replaced, as with all other reads the last
+ * occurrence of a submessage wins. Squashing or canonicalizing the message
+ * removes the former occurrences.
+ *
+ * Both messages must be of the same type and are not allowed to share a common
+ * journal, as the raw data of the source message may move while writing to
+ * the journal. Otherwise, the messages are not merged and an error is returned.
+ *
+ * \param[in,out] message Message
+ * \param[in]     source  Message to merge
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_merge(pb_message_t *message, const pb_message_t *source) {
+  assert(message && source);
+  pb_message_t temp = pb_message_copy(source);
+  pb_error_t error = PB_ERROR_NONE;
+  if (unlikely_(!pb_message_valid(message) ||
+                !pb_message_valid(&temp) || pb_message_align(&temp) ||
+                pb_message_descriptor(message) !=
+                  pb_message_descriptor(&temp) ||
+                pb_message_journal(message) == pb_message_journal(&temp))) {
+    error = PB_ERROR_INVALID;
+
+  /* Append raw data, unless there's nothing to merge */
+  } else if (!pb_message_empty(&temp)) {
+    error = pb_part_append(message, pb_journal_data_from(
+      pb_message_journal(&temp), pb_message_start(&temp)),
+        pb_message_size(&temp));
+  }
+  pb_message_destroy(&temp);
+  return error;
+}
+
+/*!
+ * Test whether two messages have equal contents.
+ *
+ * Comparing the raw data of two messages is not sufficient, as the same
+ * contents may be written in different ways, e.g. with fields in different
+ * order, with shadowed occurrences after merging, or with several packed runs
+ * of a repeated field. Thus, if the raw data differs, the canonical forms of
+ * both messages are compared, which resolve all of these differences.
+ *
+ * Messages of different types, as well as invalid or malformed messages, are
+ * never equal, unless their raw data is identical.
+ *
+ * \param[in] x Message
+ * \param[in] y Message
+ * \return      Test result
+ */
+extern int
+pb_message_equals(const pb_message_t *x, const pb_message_t *y) {
+  assert(x && y);
+  pb_message_t a = pb_message_copy(x),
+               b = pb_message_copy(y);
+  int result = 0;
+  if (likely_(pb_message_valid(&a) && !pb_message_align(&a) &&
+              pb_message_valid(&b) && !pb_message_align(&b) &&
+              a.descriptor == b.descriptor)) {
+    const size_t size = pb_message_size(&a);
+
+    /* Identical raw data is always equal */
+    if (size == pb_message_size(&b) && (!size || !memcmp(
+        pb_journal_data_from(pb_message_journal(&a), pb_message_start(&a)),
+        pb_journal_data_from(pb_message_journal(&b), pb_message_start(&b)),
+          size))) {
+      result = 1;
+
+    /* Otherwise compare canonical forms */
+    } else {
+      pb_buffer_t buffer[2];
+      pb_error_t error[2] = {
+        canonical(&a, &(buffer[0])),
+        canonical(&b, &(buffer[1]))
+      };
+      if (!error[0] && !error[1])
+        result = pb_buffer_size(&(buffer[0])) ==
+                 pb_buffer_size(&(buffer[1])) &&
+          (pb_buffer_empty(&(buffer[0])) || !memcmp(
+            pb_buffer_data(&(buffer[0])), pb_buffer_data(&(buffer[1])),
+              pb_buffer_size(&(buffer[0]))));
+      for (size_t i = 0; i < 2; ++i)
+        pb_buffer_destroy(&(buffer[i]));
+    }
+  }
+  pb_message_destroy(&b);
+  pb_message_destroy(&a);
+  return result;
+}
+
+/*!
+ * Compute a 64-bit hash of the contents of a message.
+ *
+ * The hash is computed over the canonical form of the message, so messages
+ * which are equal according to pb_message_equals() have equal hashes, and
+ * can be used as keys of hash tables. If the message is malformed, the hash
+ * is computed over its raw data. Invalid messages hash to the same value.
+ *
+ * \param[in] message Message
+ * \param[in] seed    Seed
+ * \return            Hash
+ */
+extern uint64_t
+pb_message_hash(const pb_message_t *message, uint64_t seed) {
+  assert(message);
+  pb_message_t temp = pb_message_copy(message);
+  uint64_t value = mix(seed);
+  if (likely_(pb_message_valid(&temp) && !pb_message_align(&temp))) {
+    pb_buffer_t buffer;
+    if (!canonical(&temp, &buffer)) {
+      value = hash(pb_buffer_data(&buffer), pb_buffer_size(&buffer), seed);
+
+    /* Fall back to raw data of malformed message */
+    } else {
+      value = hash(pb_journal_data_from(pb_message_journal(&temp),
+        pb_message_start(&temp)), pb_message_size(&temp), seed);
+    }
+    pb_buffer_destroy(&buffer);
+  }
+  pb_message_destroy(&temp);
+  return value;
+}
+
+/*!
+ * Append the difference between two messages as a patch to a buffer.
+ *
+ * The patch consists of field-level operations, i.e. setting or clearing all
+ * occurrences of a tag, appending values to a repeated field, or patching a
+ * submessage, so its size depends on the size of the changes rather than on
+ * the size of the messages. Applying the patch to the original message with
+ * pb_message_patch() yields a message which is equal to the changed message.
+ *
+ * \param[in,out] patch Buffer receiving patch
+ * \param[in]     from  Original message
+ * \param[in]     to    Changed message
+ * \return              Error code
+ */
+extern pb_error_t
+pb_message_diff(
+    pb_buffer_t *patch, const pb_message_t *from, const pb_message_t *to) {
+  assert(patch && from && to);
+  pb_message_t x = pb_message_copy(from),
+               y = pb_message_copy(to);
+  pb_error_t error = PB_ERROR_INVALID;
+  if (likely_(pb_message_valid(&x) && !pb_message_align(&x) &&
+              pb_message_valid(&y) && !pb_message_align(&y) &&
+              x.descriptor == y.descriptor))
+    error = pb_buffer_diff(patch, x.descriptor,
+      pb_journal_data_from(pb_message_journal(&x), pb_message_start(&x)),
+        pb_message_size(&x),
+      pb_journal_data_from(pb_message_journal(&y), pb_message_start(&y)),
+        pb_message_size(&y));
+  pb_message_destroy(&y);
+  pb_message_destroy(&x);
+  return error;
+}
+
+/*!
+ * Apply a patch to a message.
+ *
+ * The message is traversed in a single pass and the patched contents are
+ * written back at once, so the length prefixes of all containing messages are
+ * only adjusted once, regardless of the number of operations in the patch.
+ *
+ * \warning Patching a message invalidates all fields, submessages and cursors
+ * pointing into the message, as the patched contents may have the same size,
+ * in which case they cannot detect that the message was altered.
+ *
+ * \param[in,out] message Message
+ * \param[in]     patch   Patch
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_patch(pb_message_t *message, const pb_buffer_t *patch) {
+  assert(message && patch);
+  if (unlikely_(!pb_message_valid(message) || pb_message_align(message) ||
+                !pb_buffer_valid(patch)))
+    return PB_ERROR_INVALID;
+  if (pb_buffer_empty(patch))
+    return PB_ERROR_NONE;
+
+  /* Assemble patched message and write it back at once */
+  pb_buffer_t buffer = pb_buffer_create_empty();
+  pb_error_t error = pb_buffer_patch(&buffer, message->descriptor,
+    pb_journal_data_from(pb_message_journal(message),
+      pb_message_start(message)), pb_message_size(message),
+    pb_buffer_data(patch), pb_buffer_size(patch));
+  if (likely_(!error))
+    error = pb_part_write(&(message->part),
+      pb_buffer_data(&buffer), pb_buffer_size(&buffer));
+  pb_buffer_destroy(&buffer);
   return error;
 }
 
@@ -374,6 +1044,7 @@ pb_message_erase(pb_message_t *message, pb_tag_t tag) {
   assert(descriptor);
 
   /* Clear non-oneof field or submessage */
+  pb_journal_write_begin(pb_message_journal(message));
   if (likely_(pb_field_descriptor_label(descriptor) != PB_LABEL_ONEOF)) {
 
     /* Use cursor to omit field/message creation */
@@ -394,6 +1065,7 @@ pb_message_erase(pb_message_t *message, pb_tag_t tag) {
     error = pb_oneof_clear(&oneof);
     pb_oneof_destroy(&oneof);
   }
+  pb_journal_write_end(pb_message_journal(message));
   return error;
 }
 
@@ -411,3 +1083,57 @@ pb_message_clear(pb_message_t *message) {
   assert(message);
   return pb_part_clear(&(message->part));
 }
+
+/*!
+ * Remove all shadowed occurrences of non-repeated fields from a message.
+ *
+ * Merging messages leaves earlier occurrences of non-repeated fields in the
+ * message, which are shadowed by the last occurrence. The occurrences of all
+ * fields are collected in a single pass, and all fields except the shadowed
+ * ones are written back with a single journal write, so the length prefixes
+ * of all containing messages are only adjusted once. Members of a oneof shadow
+ * each other, while repeated and unknown fields are always retained.
+ *
+ * As with all other reads, the last occurrence of a submessage wins, so former
+ * occurrences of submessages are removed and not merged into the last one.
+ *
+ * \warning Squashing a message invalidates all fields, submessages and cursors
+ * pointing into the message, if any occurrence was removed.
+ *
+ * \param[in,out] message Message
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_squash(pb_message_t *message) {
+  assert(message);
+  if (unlikely_(!pb_message_valid(message) || pb_message_align(message)))
+    return PB_ERROR_INVALID;
+
+  /* Collect fields and mark shadowed occurrences */
+  field_t *fields = NULL;
+  size_t size = 0, shadowed = 0;
+  pb_error_t error = collect(message, &fields, &size);
+  if (!error && size)
+    error = shadow(fields, size, &shadowed);
+
+  /* Assemble retained fields and write them back at once */
+  if (!error && shadowed) {
+    size_t length = pb_message_size(message) - shadowed;
+    uint8_t *data = pb_allocator_allocate(&allocator_default, length);
+    if (unlikely_(!data)) {
+      error = PB_ERROR_ALLOC;                              /* LCOV_EXCL_LINE */
+    } else {
+      const uint8_t *base = pb_journal_data(pb_message_journal(message));
+      for (size_t f = 0, offset = 0; f < size; f++) {
+        memcpy(&(data[offset]), &(base[fields[f].start]),
+          fields[f].end - fields[f].start);
+        offset += fields[f].end - fields[f].start;
+      }
+      error = pb_part_write(&(message->part), data, length);
+      pb_allocator_free(&allocator_default, data);
+    }
+  }
+  if (fields)
+    pb_allocator_free(&allocator_default, fields);
+  return error;
+}
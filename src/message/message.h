@@ -167,7 +167,10 @@ pb_message_empty(const pb_message_t *message) {
 /* ------------------------------------------------------------------------- */
 
 /*!
- * Test whether two messages are the same.
+ * Test whether two messages are the same, i.e. refer to the same part.
+ *
+ * In contrast to pb_message_equals(), which compares the contents of two
+ * messages, this function tests for identity.
  *
  * \warning Message alignment is checked implicitly by comparing the messages'
  * memory segments and thus their versions.
@@ -177,7 +180,7 @@ pb_message_empty(const pb_message_t *message) {
  * \return      Test result
  */
 PB_INLINE int
-pb_message_equals(const pb_message_t *x, const pb_message_t *y) {
+pb_message_same(const pb_message_t *x, const pb_message_t *y) {
   assert(x && y);
   return !memcmp(x, y, sizeof(pb_message_t));
 }
@@ -21,14 +21,72 @@
  */
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#include "core/buffer.h"
 #include "core/descriptor.h"
+#include "core/stream.h"
 #include "message/common.h"
 #include "message/cursor.h"
+#include "message/journal.h"
 #include "message/message.h"
 #include "message/oneof.h"
 
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Determine the active tag of a oneof with a single pass over the message.
+ *
+ * Instead of moving a cursor over the message, which involves descriptor
+ * lookups for every field, only the tags are read and classified using the
+ * oneof descriptor, while the values are skipped.
+ *
+ * \param[in,out] oneof Oneof
+ * \param[out]    tag   Tag
+ * \return              Error code
+ */
+static pb_error_t
+scan(pb_oneof_t *oneof, pb_tag_t *tag) {
+  assert(oneof && tag);
+  pb_message_t *message = &(oneof->cursor.message);
+  if (!pb_message_valid(message))
+    return pb_message_error(message);
+
+  /* Ensure that the message is properly aligned */
+  pb_error_t error = pb_message_align(message);
+  if (unlikely_(error))
+    return error;
+
+  /* Create temporary buffer over the message */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+    pb_journal_data_from(pb_message_journal(message), 0),
+      pb_message_end(message));
+
+  /* Create stream over temporary buffer and classify all tags */
+  pb_stream_t stream = pb_stream_create_at(&buffer, pb_message_start(message));
+  while (!error && pb_stream_left(&stream)) {
+    uint32_t key;
+    if (!(error = pb_stream_read(&stream, PB_TYPE_UINT32, &key))) {
+      pb_wiretype_t wiretype = key & 7;
+      if (unlikely_(wiretype > PB_WIRETYPE_32BIT ||
+          !pb_stream_skip_jump[wiretype])) {
+        error = PB_ERROR_INVALID;
+      } else if (!(error = pb_stream_skip(&stream, wiretype))) {
+        if (pb_oneof_descriptor_member(oneof->descriptor, key >> 3))
+          *tag = key >> 3;
+      }
+    }
+  }
+
+  /* Cleanup and return */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+  return error;
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -46,7 +104,11 @@ pb_oneof_create(
   assert(descriptor && message);
   pb_oneof_t oneof = {
     .descriptor = descriptor,
-    .cursor     = pb_cursor_create_without_tag(message)
+    .cursor     = pb_cursor_create_without_tag(message),
+    .cache      = {
+      .tag      = 0,
+      .revision = SIZE_MAX
+    }
   };
   return oneof;
 }
@@ -65,21 +127,35 @@ pb_oneof_destroy(pb_oneof_t *oneof) {
 /*!
  * Retrieve the active tag of a oneof.
  *
+ * The active tag is cached together with the revision of the underlying
+ * journal, so repeated queries on an unaltered message are constant-time. The
+ * revision is used instead of the version, as writes which don't change the
+ * size of the message, e.g. patches, may replace a member of the oneof.
+ *
  * \param[in,out] oneof Oneof
  * \return              Tag
  */
 extern pb_tag_t
 pb_oneof_case(pb_oneof_t *oneof) {
   assert(oneof);
+  if (!pb_message_valid(&(oneof->cursor.message)))
+    return 0;
+
+  /* Return cached tag, if the journal was not altered */
+  size_t revision = pb_journal_revision(
+    pb_message_journal(&(oneof->cursor.message)));
+  if (oneof->cache.revision == revision)
+    return oneof->cache.tag;
+
+  /* Otherwise determine and cache active tag */
   pb_tag_t tag = 0;
-  if (pb_cursor_rewind(&(oneof->cursor))) {
-    do {
-      const pb_field_descriptor_t *descriptor =
-        pb_cursor_descriptor(&(oneof->cursor));
-      if (pb_field_descriptor_oneof(descriptor) == oneof->descriptor)
-        tag = pb_cursor_tag(&(oneof->cursor));
-    } while (pb_cursor_next(&(oneof->cursor)));
+  pb_error_t error = scan(oneof, &tag);
+  if (unlikely_(error)) {
+    oneof->cursor.error = error;
+    return tag;
   }
+  oneof->cache.tag      = tag;
+  oneof->cache.revision = revision;
   return tag;
 }
 
@@ -93,11 +169,10 @@ extern pb_error_t
 pb_oneof_clear(pb_oneof_t *oneof) {
   assert(oneof);
   pb_error_t error = PB_ERROR_NONE;
-  if (pb_cursor_rewind(&(oneof->cursor))) {
+  if (pb_oneof_case(oneof) && pb_cursor_rewind(&(oneof->cursor))) {
     do {
-      const pb_field_descriptor_t *descriptor =
-        pb_cursor_descriptor(&(oneof->cursor));
-      if (pb_field_descriptor_oneof(descriptor) == oneof->descriptor)
+      if (pb_oneof_descriptor_member(oneof->descriptor,
+          pb_cursor_tag(&(oneof->cursor))))
         error = pb_cursor_erase(&(oneof->cursor));
     } while (!error && pb_cursor_next(&(oneof->cursor)));
   }
@@ -23,6 +23,8 @@
 #ifndef PB_MESSAGE_ONEOF_H
 #define PB_MESSAGE_ONEOF_H
 
+#include <stdint.h>
+
 #include <protobluff/message/oneof.h>
 
 #include "message/common.h"
@@ -42,7 +44,11 @@ PB_INLINE pb_oneof_t
 pb_oneof_create_invalid(void) {
   pb_oneof_t oneof = {
     .descriptor = NULL,
-    .cursor     = pb_cursor_create_invalid()
+    .cursor     = pb_cursor_create_invalid(),
+    .cache      = {
+      .tag      = 0,
+      .revision = SIZE_MAX
+    }
   };
   return oneof;
 }
@@ -268,6 +268,7 @@ init(pb_part_t *part, pb_wiretype_t wiretype, pb_tag_t tag) {
     }
 
     /* Write data to journal and update offsets */
+    pb_journal_write_begin(part->journal);
     pb_error_t error = pb_journal_write(part->journal,
       part->offset.start + part->offset.diff.origin,
       part->offset.start,  part->offset.end, data, size);
@@ -280,15 +281,102 @@ init(pb_part_t *part, pb_wiretype_t wiretype, pb_tag_t tag) {
       part->offset.diff.length -= part->offset.start;
 
       /* Recursive length prefix update of parent messages */
-      if (!adjust(part, size))
-        return;
-    }                                                      /* LCOV_EXCL_LINE */
+      error = adjust(part, size);
+    }
+    pb_journal_write_end(part->journal);
+    if (!error)
+      return;
   } while (0);                                             /* LCOV_EXCL_LINE */
 
   /* Yes. You pulled a Pobert */
   pb_part_invalidate(part);                                /* LCOV_EXCL_LINE */
 }
 
+/*!
+ * Find the field after which a field with the given tag is to be inserted.
+ *
+ * The cursor is moved to the last field with a tag smaller than or equal to
+ * the given tag. If there is no such field, the cursor points to the first
+ * field of the message, or is invalid if the message is empty.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[out]    cursor  Cursor
+ * \return                Error code
+ */
+static pb_error_t
+locate(pb_message_t *message, pb_tag_t tag, pb_cursor_t *cursor) {
+  assert(message && tag && cursor);
+  *cursor = pb_cursor_create_without_tag(message);
+  pb_cursor_t temp = pb_cursor_copy(cursor);
+  if (pb_cursor_valid(&temp)) {
+    do {
+      if (pb_cursor_tag(&temp) <= tag) {
+        pb_cursor_destroy(cursor);
+        *cursor = pb_cursor_copy(&temp);
+      }
+    } while (pb_cursor_next(&temp));
+  }
+
+  /* Don't indicate an error, if the cursor just reached the end */
+  pb_error_t error = pb_cursor_error(&temp);
+  pb_cursor_destroy(&temp);
+  return error != PB_ERROR_EOM
+    ? error
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Write complete fields at the given offset of a message.
+ *
+ * A part is created for the written data, treating the first tag as its tag,
+ * so the length prefixes of all containing messages can be adjusted at once.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     origin  Start offset of message
+ * \param[in]     start   Start offset of fields
+ * \param[in]     data[]  Raw data
+ * \param[in]     size    Raw data size
+ * \return                Error code
+ */
+static pb_error_t
+place(
+    pb_journal_t *journal, size_t origin, size_t start,
+    const uint8_t data[], size_t size) {
+  assert(journal && data && size);
+
+  /* Write data to journal */
+  pb_journal_write_begin(journal);
+  pb_error_t error = pb_journal_write(journal, origin, start, start,
+    data, size);
+  if (unlikely_(error)) {
+    pb_journal_write_end(journal);
+    return error;
+  }
+
+  /* Create a part for the written data, treating the first tag as its tag */
+  size_t offset = pb_varint_scan(data, size);
+  pb_part_t part = {
+    .journal = journal,
+    .version = pb_journal_version(journal),
+    .offset  = {
+      .start = start + offset,
+      .end   = start + size,
+      .diff  = {
+        .origin = origin - (start + offset),
+        .tag    = -(ptrdiff_t)offset,
+        .length = 0
+      }
+    }
+  };
+
+  /* Recursive length prefix update of parent messages */
+  error = adjust(&part, size);
+  pb_part_destroy(&part);
+  pb_journal_write_end(journal);
+  return error;
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -361,20 +449,8 @@ pb_part_create(pb_message_t *message, pb_tag_t tag) {
     assert(descriptor);
 
     /* Determine exact or best matching field offset */
-    pb_cursor_t cursor = pb_cursor_create_without_tag(message);
-    pb_cursor_t temp   = pb_cursor_copy(&cursor);
-    if (pb_cursor_valid(&temp)) {
-      do {
-        if (pb_cursor_tag(&temp) <= tag) {
-          pb_cursor_destroy(&cursor);
-          cursor = pb_cursor_copy(&temp);
-        }
-      } while (pb_cursor_next(&temp));
-    }
-
-    /* Don't indicate an error, if the cursor just reached the end */
-    if (pb_cursor_error(&temp) == PB_ERROR_EOM) {
-      pb_cursor_destroy(&temp);
+    pb_cursor_t cursor;
+    if (!locate(message, tag, &cursor)) {
 
       /* Record start offset and handle different cases */
       size_t start = pb_message_start(message);
@@ -382,7 +458,7 @@ pb_part_create(pb_message_t *message, pb_tag_t tag) {
 
         /* If the tag is part of a oneof ensure it is the active tag */
         if (pb_field_descriptor_label(descriptor) == PB_LABEL_ONEOF) {
-          temp = pb_cursor_copy(&cursor);
+          pb_cursor_t temp = pb_cursor_copy(&cursor);
           do {
             int member = pb_field_descriptor_oneof(descriptor) ==
               pb_field_descriptor_oneof(pb_cursor_descriptor(&temp));
@@ -446,7 +522,6 @@ pb_part_create(pb_message_t *message, pb_tag_t tag) {
       pb_cursor_destroy(&cursor);
       return part;
     }
-    pb_cursor_destroy(&temp);
     pb_cursor_destroy(&cursor);
   } while (0);
   return pb_part_create_invalid();
@@ -532,6 +607,9 @@ pb_part_error(const pb_part_t *part) {
 /*!
  * Write data to a part.
  *
+ * If no data is given, the contents of the part are cleared, but in contrast
+ * to pb_part_clear(), the tag and length prefix of the part are retained.
+ *
  * \param[in,out] part   Part
  * \param[in]     data[] Raw data
  * \param[in]     size   Raw data size
@@ -539,15 +617,22 @@ pb_part_error(const pb_part_t *part) {
  */
 extern pb_error_t
 pb_part_write(pb_part_t *part, const uint8_t data[], size_t size) {
-  assert(part && data && size);
+  assert(part && (data || !size));
   if (!pb_part_valid(part) || (!pb_part_aligned(part) && pb_part_align(part)))
     return PB_ERROR_INVALID;
+  if (unlikely_(!size && pb_part_empty(part)))
+    return PB_ERROR_NONE;
 
-  /* Write data to journal */
+  /* Write data to journal or clear contents */
+  pb_journal_write_begin(part->journal);
   ptrdiff_t  delta = size - pb_part_size(part);
-  pb_error_t error = pb_journal_write(part->journal,
-    part->offset.start, part->offset.start,
-    part->offset.end, data, size);
+  pb_error_t error = size
+    ? pb_journal_write(part->journal,
+        part->offset.start, part->offset.start,
+        part->offset.end, data, size)
+    : pb_journal_clear(part->journal,
+        part->offset.start, part->offset.start,
+        part->offset.end);
   if (likely_(!error)) {
 
     /* Update offsets if necessary */
@@ -566,9 +651,109 @@ pb_part_write(pb_part_t *part, const uint8_t data[], size_t size) {
         error = pb_part_align(part);
     }
   }
+  pb_journal_write_end(part->journal);
   return error;
 }
 
+/*!
+ * Insert complete fields for a specific tag into a message.
+ *
+ * The raw data must consist of one or more fields of the given tag, including
+ * their tags and length prefixes, and is inserted after the last field with a
+ * smaller or equal tag, exactly where pb_part_create() would create a new part
+ * for a repeated field. The data is written with a single journal write and
+ * the length prefixes of all containing messages are adjusted once.
+ *
+ * If the data is a single packed field and the preceding field is a packed
+ * field of the same tag, the values are merged into the preceding field.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[in]     data[]  Raw data
+ * \param[in]     size    Raw data size
+ * \return                Error code
+ */
+extern pb_error_t
+pb_part_insert(
+    pb_message_t *message, pb_tag_t tag, const uint8_t data[], size_t size) {
+  assert(message && tag && data && size);
+  if (!pb_message_valid(message) || pb_message_align(message))
+    return PB_ERROR_INVALID;
+
+  /* Determine best matching field offset */
+  pb_cursor_t cursor;
+  pb_error_t error = locate(message, tag, &cursor);
+  if (unlikely_(error)) {
+    pb_cursor_destroy(&cursor);
+    return error;
+  }
+
+  /* Record offsets and determine whether to merge packed fields */
+  size_t origin = pb_message_start(message),
+         start  = origin;
+  int merge = 0;
+  if (pb_cursor_valid(&cursor) && pb_cursor_tag(&cursor) <= tag) {
+    start = pb_cursor_offset(&cursor)->end;
+    merge = pb_cursor_tag(&cursor) == tag && cursor.current.packed.end &&
+      (data[0] & 7) == PB_WIRETYPE_LENGTH;
+  }
+  pb_cursor_destroy(&cursor);
+
+  /* Create an empty part at the end of the preceding packed field */
+  pb_journal_t *journal = pb_message_journal(message);
+  if (merge) {
+    pb_part_t part = {
+      .journal = journal,
+      .version = pb_message_version(message),
+      .offset  = {
+        .start = start,
+        .end   = start,
+        .diff  = {
+          .origin = origin - start,
+          .tag    = 0,
+          .length = 0
+        }
+      }
+    };
+
+    /* Strip tag and length prefix and write values */
+    size_t skip = pb_varint_scan(data, size);
+    if (likely_(skip && skip < size))
+      skip += pb_varint_scan(&(data[skip]), size - skip);
+    error = likely_(skip && skip < size)
+      ? pb_part_write(&part, &(data[skip]), size - skip)
+      : PB_ERROR_INVALID;
+    pb_part_destroy(&part);
+    return error;
+  }
+
+  /* Write data to journal */
+  return place(journal, origin, start, data, size);
+}
+
+/*!
+ * Append complete fields to the end of a message.
+ *
+ * The raw data must consist of one or more complete fields, including their
+ * tags and length prefixes, which are written with a single journal write, so
+ * the length prefixes of all containing messages are adjusted once.
+ *
+ * \param[in,out] message Message
+ * \param[in]     data[]  Raw data
+ * \param[in]     size    Raw data size
+ * \return                Error code
+ */
+extern pb_error_t
+pb_part_append(pb_message_t *message, const uint8_t data[], size_t size) {
+  assert(message && data && size);
+  if (!pb_message_valid(message) || pb_message_align(message))
+    return PB_ERROR_INVALID;
+
+  /* Write data to journal */
+  return place(pb_message_journal(message),
+    pb_message_start(message), pb_message_end(message), data, size);
+}
+
 /*!
  * Clear data from a part and invalidate it.
  *
@@ -587,6 +772,8 @@ pb_part_clear(pb_part_t *part) {
     : 0;
 
   /* Clear data from journal */
+  pb_journal_t *journal = part->journal;
+  pb_journal_write_begin(journal);
   ptrdiff_t  delta = -(pb_part_size(part)) + part->offset.diff.tag;
   pb_error_t error = pb_journal_clear(part->journal,
     part->offset.start + origin,
@@ -609,6 +796,7 @@ pb_part_clear(pb_part_t *part) {
     }
     pb_part_invalidate(part);
   }
+  pb_journal_write_end(journal);
   return error;
 }
 
@@ -70,6 +70,21 @@ pb_part_write(
   const uint8_t data[],                /* Raw data */
   size_t size);                        /* Raw data size */
 
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_part_insert(
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag,                        /* Tag */
+  const uint8_t data[],                /* Raw data */
+  size_t size);                        /* Raw data size */
+
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_part_append(
+  pb_message_t *message,               /* Message */
+  const uint8_t data[],                /* Raw data */
+  size_t size);                        /* Raw data size */
+
 PB_WARN_UNUSED_RESULT
 extern pb_error_t
 pb_part_clear(
@@ -0,0 +1,582 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <alloca.h>
+#include <assert.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif /* HAVE_PTHREAD */
+
+#include <protobluff/core/allocator.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/iovec.h"
+#include "core/stream.h"
+#include "util/decoder.h"
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Number of tasks claimed at once, amortizing the cost of the atomic update.
+ */
+#define CHUNK_SIZE 16
+
+/*!
+ * Size of a cache line, so ranges of different threads never share one.
+ */
+#define CACHE_LINE 64
+
+/*!
+ * Maximum number of threads, bounding the per-thread state on the stack.
+ */
+#define THREADS_MAX 64
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef void
+(*task_f)(
+  void *context,                       /* Context */
+  size_t index,                        /* Task index */
+  size_t thread);                      /* Thread index */
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct range_t {
+  size_t next;                         /* Next unclaimed task */
+  size_t end;                          /* End of range */
+  uint8_t padding[CACHE_LINE - 2 * sizeof(size_t)];
+} range_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct pool_t {
+  range_t *ranges;                     /* Task ranges */
+  size_t size;                         /* Task range count */
+  size_t step;                         /* Tasks claimed at once */
+  task_f task;                         /* Task */
+  void *context;                       /* Context */
+} pool_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct worker_t {
+  const pool_t *pool;                  /* Pool */
+  size_t thread;                       /* Thread index */
+} worker_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct item_t {
+  size_t offset;                       /* Offset of submessage */
+  size_t length;                       /* Length of submessage */
+} item_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct failure_t {
+  size_t index;                        /* Lowest index of failed buffer */
+  pb_error_t error;                    /* Error code */
+  uint8_t padding[CACHE_LINE - sizeof(size_t) - sizeof(pb_error_t)];
+} failure_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct batch_t {
+  const pb_descriptor_t *descriptor;   /* Descriptor */
+  const pb_buffer_t *buffers;          /* Buffers */
+  pb_decoder_handler_f handler;        /* Handler */
+  void **user;                         /* User data per thread */
+  pb_error_t *errors;                  /* Error codes per buffer */
+  failure_t *failures;                 /* First failure per thread */
+} batch_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct repeated_t {
+  const pb_decoder_t *decoder;         /* Decoder */
+  const pb_field_descriptor_t
+    *descriptor;                       /* Field descriptor */
+  const item_t *items;                 /* Submessages */
+  size_t size;                         /* Submessage count */
+  size_t chunk;                        /* Submessages per chunk */
+  pb_decoder_handler_f handler;        /* Handler */
+  pb_decoder_chunk_f deliver;          /* Chunk handler */
+  void **user;                         /* User data per thread */
+  size_t turn;                         /* Next chunk to be delivered */
+  pb_error_t error;                    /* Error code */
+} repeated_t;
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Execute tasks until all ranges are drained.
+ *
+ * Every worker first drains its own range and then steals from the ranges of
+ * the other workers in round-robin order, so the load is balanced even if the
+ * tasks differ in cost. Tasks are claimed in steps with a single atomic
+ * fetch-and-add, which may overshoot the end of a range and is harmless.
+ *
+ * \param[in] data Worker
+ * \return         Nothing
+ */
+static void *
+work(void *data) {
+  assert(data);
+  const worker_t *worker = data;
+  const pool_t   *pool   = worker->pool;
+  for (size_t r = 0; r < pool->size; ++r) {
+    range_t *range = &(pool->ranges[(worker->thread + r) % pool->size]);
+
+    /* Claim and execute steps of tasks */
+    size_t begin;
+    while ((begin = atomic_add_(&(range->next), pool->step)) < range->end) {
+      size_t end = range->end - begin > pool->step
+        ? begin + pool->step
+        : range->end;
+      for (size_t index = begin; index < end; ++index)
+        pool->task(pool->context, index, worker->thread);
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * Execute a number of tasks on a pool of threads.
+ *
+ * The tasks are split into contiguous ranges, one per thread, and the calling
+ * thread acts as the first worker. If a thread cannot be created, its range
+ * is stolen by the remaining workers, so all tasks are executed nevertheless.
+ * The threads are created upon every invocation and joined before returning,
+ * so they are not kept alive between batches. Without pthreads, all tasks are
+ * executed by the calling thread.
+ *
+ * If the tasks must be claimed in ascending order, all workers share a single
+ * range and claim one task at a time, so a task is only ever claimed after
+ * all preceding tasks have been claimed.
+ *
+ * \param[in]     size    Task count
+ * \param[in]     threads Thread count
+ * \param[in]     ordered Whether to claim tasks in order
+ * \param[in]     task    Task
+ * \param[in,out] context Context
+ */
+static void
+run(size_t size, size_t threads, int ordered, task_f task, void *context) {
+  assert(threads && threads <= THREADS_MAX && task);
+  range_t  *ranges  = alloca(sizeof(range_t)  * threads);
+  worker_t *workers = alloca(sizeof(worker_t) * threads);
+  pool_t pool = {
+    .ranges  = ranges,
+    .size    = ordered ? 1 : threads,
+    .step    = ordered ? 1 : CHUNK_SIZE,
+    .task    = task,
+    .context = context
+  };
+
+  /* Split tasks into ranges of equal size */
+  const size_t share = size / pool.size, rest = size % pool.size;
+  for (size_t r = 0, begin = 0; r < pool.size; ++r) {
+    ranges[r].next = begin;
+    ranges[r].end  = begin += share + (r < rest);
+  }
+  for (size_t t = 0; t < threads; ++t)
+    workers[t] = (worker_t){ &pool, t };
+
+#ifdef HAVE_PTHREAD
+
+  /* Start workers and participate in the work */
+  pthread_t *handles = alloca(sizeof(pthread_t) * threads);
+  size_t started = 1;
+  while (started < threads && !pthread_create(
+      &(handles[started]), NULL, work, &(workers[started])))
+    started++;
+  work(&(workers[0]));
+
+  /* Wait for workers to finish */
+  for (size_t t = 1; t < started; ++t)
+    pthread_join(handles[t], NULL);
+
+#else
+
+  /* Execute all tasks on the calling thread */
+  work(&(workers[0]));
+
+#endif /* HAVE_PTHREAD */
+}
+
+/*!
+ * Decode a single buffer of a batch.
+ *
+ * \param[in,out] context Batch
+ * \param[in]     index   Buffer index
+ * \param[in]     thread  Thread index
+ */
+static void
+decode(void *context, size_t index, size_t thread) {
+  assert(context);
+  batch_t *batch = context;
+  pb_error_t error = PB_ERROR_INVALID;
+  if (likely_(pb_buffer_valid(&(batch->buffers[index])))) {
+    pb_decoder_t decoder = pb_decoder_create(
+      batch->descriptor, &(batch->buffers[index]));
+    error = pb_decoder_decode(&decoder, batch->handler,
+      batch->user ? batch->user[thread] : NULL);
+    pb_decoder_destroy(&decoder);
+  }
+
+  /* Record error code and lowest failed index of thread */
+  if (batch->errors)
+    batch->errors[index] = error;
+  if (error && index < batch->failures[thread].index) {
+    batch->failures[thread].index = index;
+    batch->failures[thread].error = error;
+  }
+}
+
+/*!
+ * Collect the offsets and lengths of all occurrences of a message field.
+ *
+ * This is a skip-only pass over the message, which only reads tags and the
+ * lengths of length-delimited values, so the values themselves are never
+ * touched. The resulting array must be freed by the caller.
+ *
+ * \param[in]  decoder Decoder
+ * \param[in]  tag     Tag
+ * \param[out] items   Submessages
+ * \param[out] size    Submessage count
+ * \return             Error code
+ */
+static pb_error_t
+collect(
+    const pb_decoder_t *decoder, pb_tag_t tag,
+    item_t **items, size_t *size) {
+  assert(decoder && items && size);
+  pb_error_t error = PB_ERROR_NONE;
+  size_t capacity = 0;
+
+  /* Select jump tables once, so reads don't check for segmented buffers */
+  pb_stream_iovec_t state;
+  if (unlikely_(decoder->iovec != NULL))
+    state = pb_stream_iovec_create(decoder->iovec);
+  pb_stream_t stream = decoder->iovec
+    ? pb_stream_create_from_iovec(&state)
+    : pb_stream_create(decoder->buffer);
+  const pb_stream_read_f *read = decoder->iovec
+    ? pb_stream_read_iovec_jump
+    : pb_stream_read_jump;
+  const pb_stream_skip_f *skip = decoder->iovec
+    ? pb_stream_skip_iovec_jump
+    : pb_stream_skip_jump;
+
+  /* Iterate tag-value pairs */
+  while (!error && pb_stream_left(&stream)) {
+    pb_tag_t current;
+    if (unlikely_(error =
+        read[PB_TYPE_UINT32](&stream, PB_TYPE_UINT32, &current)))
+      break;
+
+    /* Skip all other fields, if wiretype is valid */
+    pb_wiretype_t wiretype = current & 7;
+    if (current >> 3 != tag || wiretype != PB_WIRETYPE_LENGTH) {
+      error = unlikely_(wiretype > PB_WIRETYPE_32BIT || !skip[wiretype])
+        ? PB_ERROR_INVALID
+        : skip[wiretype](&stream);
+      continue;
+    }
+
+    /* Read length of submessage */
+    uint32_t length;
+    if (unlikely_(error =
+        read[PB_TYPE_UINT32](&stream, PB_TYPE_UINT32, &length)))
+      break;
+
+    /* Grow array of submessages, if necessary */
+    if (unlikely_(*size == capacity)) {
+      item_t *temp = pb_allocator_resize(&allocator_default, *items,
+        sizeof(item_t) * (capacity = capacity ? capacity << 1 : 64));
+      if (unlikely_(!temp)) {
+        error = PB_ERROR_ALLOC;                            /* LCOV_EXCL_LINE */
+        break;                                             /* LCOV_EXCL_LINE */
+      }
+      *items = temp;
+    }
+
+    /* Record submessage and skip it */
+    (*items)[(*size)++] = (item_t){ pb_stream_offset(&stream), length };
+    error = pb_stream_advance(&stream, length);
+  }
+  pb_stream_destroy(&stream);
+  if (unlikely_(decoder->iovec != NULL))
+    pb_stream_iovec_destroy(&state);
+  return error;
+}
+
+/*!
+ * Decode a single submessage of a repeated field.
+ *
+ * \param[in]     repeated Repeated field
+ * \param[in]     item     Submessage
+ * \param[in,out] user     User data
+ * \return                 Error code
+ */
+static pb_error_t
+decode_item(const repeated_t *repeated, const item_t *item, void *user) {
+  assert(repeated && item);
+  const pb_decoder_t *decoder = repeated->decoder;
+  const pb_descriptor_t *descriptor =
+    pb_field_descriptor_nested(repeated->descriptor);
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Create decoder for contiguous submessage and invoke handler */
+  if (likely_(!decoder->iovec)) {
+    pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+      (uint8_t *)pb_buffer_data_from(decoder->buffer, item->offset),
+      item->length);
+    pb_decoder_t subdecoder = pb_decoder_create(descriptor, &buffer);
+    pb_decoder_set_flags(&subdecoder, decoder->flags);
+    error = repeated->handler(repeated->descriptor, &subdecoder, user);
+
+    /* Free all allocated memory */
+    pb_decoder_destroy(&subdecoder);
+    pb_buffer_destroy(&buffer);
+
+  /* Create decoder for range of segmented buffer and invoke handler */
+  } else {
+    pb_iovec_t iovec = pb_iovec_create_range(
+      decoder->iovec, item->offset, item->length);
+    if (likely_(pb_iovec_valid(&iovec))) {
+      pb_decoder_t subdecoder = pb_decoder_create_from_iovec(
+        descriptor, &iovec);
+      pb_decoder_set_flags(&subdecoder, decoder->flags);
+      error = repeated->handler(repeated->descriptor, &subdecoder, user);
+
+      /* Free all allocated memory */
+      pb_decoder_destroy(&subdecoder);
+      pb_iovec_destroy(&iovec);
+    } else {
+      error = PB_ERROR_ALLOC;                              /* LCOV_EXCL_LINE */
+    }
+  }
+  return error;
+}
+
+/*!
+ * Decode a chunk of submessages of a repeated field and deliver it in order.
+ *
+ * Chunks are claimed in ascending order, so the preceding chunk is always
+ * being worked on while waiting for its delivery. After a chunk has failed,
+ * subsequent chunks are neither decoded nor delivered.
+ *
+ * \param[in,out] context Repeated field
+ * \param[in]     index   Chunk index
+ * \param[in]     thread  Thread index
+ */
+static void
+decode_chunk(void *context, size_t index, size_t thread) {
+  assert(context);
+  repeated_t *repeated = context;
+  void *user = repeated->user ? repeated->user[thread] : NULL;
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Decode submessages of chunk, unless a preceding chunk failed */
+  const size_t begin = index * repeated->chunk,
+               end   = repeated->size - begin > repeated->chunk
+                 ? begin + repeated->chunk
+                 : repeated->size;
+  if (likely_(!atomic_load_(&(repeated->error))))
+    for (size_t i = begin; !error && i < end; ++i)
+      error = decode_item(repeated, &(repeated->items[i]), user);
+
+  /* Wait for preceding chunks to be delivered */
+  while (atomic_load_(&(repeated->turn)) != index)
+    sched_yield();
+
+  /* Deliver chunk and pass the turn to the next chunk */
+  if (likely_(!atomic_load_(&(repeated->error)))) {
+    if (!error && repeated->deliver)
+      error = repeated->deliver(begin, end - begin, user);
+    if (unlikely_(error))
+      atomic_store_(&(repeated->error), error);
+  }
+  atomic_store_(&(repeated->turn), index + 1);
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Decode a batch of independent buffers in parallel.
+ *
+ * The buffers are distributed over a pool of threads with work stealing, and
+ * the calling thread takes part in decoding. The handler is invoked with the
+ * user data of the thread decoding the buffer, so it can accumulate results
+ * without synchronization, as long as the descriptor and handler are safe to
+ * be used from multiple threads. Buffers are decoded in no particular order.
+ *
+ * If an array of error codes is given, the error code for every buffer is
+ * stored at the respective index. Regardless of scheduling, the returned
+ * error code is the one of the first failed buffer in the batch.
+ *
+ * At most 64 threads are used, including the calling thread. The threads are
+ * created upon every call and joined before returning, so the batch should be
+ * large enough to amortize their start-up.
+ *
+ * \warning The user data array must hold a pointer for every thread used, but
+ * may be NULL if the handler doesn't need any.
+ *
+ * \param[in]     descriptor Descriptor
+ * \param[in]     buffers[]  Buffers
+ * \param[in]     size       Buffer count
+ * \param[in]     handler    Handler
+ * \param[in,out] user[]     User data per thread
+ * \param[in]     threads    Thread count
+ * \param[out]    errors[]   Error codes per buffer
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_decoder_decode_batch(
+    const pb_descriptor_t *descriptor, const pb_buffer_t buffers[],
+    size_t size, pb_decoder_handler_f handler, void *user[],
+    size_t threads, pb_error_t errors[]) {
+  assert(descriptor && (buffers || !size) && handler && threads);
+  if (threads > THREADS_MAX)
+    threads = THREADS_MAX;
+  if (threads > size)
+    threads = size ? size : 1;
+
+  /* Initialize first failure of every thread */
+  failure_t *failures = alloca(sizeof(failure_t) * threads);
+  for (size_t t = 0; t < threads; ++t) {
+    failures[t].index = size;
+    failures[t].error = PB_ERROR_NONE;
+  }
+
+  /* Decode buffers on pool */
+  batch_t batch = {
+    .descriptor = descriptor,
+    .buffers    = buffers,
+    .handler    = handler,
+    .user       = user,
+    .errors     = errors,
+    .failures   = failures
+  };
+  run(size, threads, 0, decode, &batch);
+
+  /* Return error code of first failed buffer */
+  const failure_t *first = &(failures[0]);
+  for (size_t t = 1; t < threads; ++t)
+    if (failures[t].index < first->index)
+      first = &(failures[t]);
+  return first->error;
+}
+
+/*!
+ * Decode the submessages of a repeated message field in parallel.
+ *
+ * A skip-only pass collects the offsets of all occurrences of the field, so
+ * the submessages can then be split into chunks and decoded on a pool of
+ * threads. Like for a regular decoder, the handler is invoked with a decoder
+ * for every submessage, together with the user data of the decoding thread.
+ *
+ * After all submessages of a chunk have been passed to the handler, the chunk
+ * handler is invoked from the same thread, with the index of the chunk's first
+ * submessage and the number of submessages it contains. Chunks are delivered
+ * in their original order, so the results accumulated in the user data of the
+ * thread can be consumed and reset. All other fields are skipped.
+ *
+ * If a submessage or chunk fails, subsequent chunks are not delivered, and the
+ * error code of the first failed chunk is returned. As for batches, at most 64
+ * threads are used, which are created upon every call.
+ *
+ * \warning The user data array must hold a pointer for every thread used, but
+ * may be NULL if the handlers don't need any.
+ *
+ * \param[in]     decoder Decoder
+ * \param[in]     tag     Tag of repeated message field
+ * \param[in]     handler Handler
+ * \param[in]     deliver Chunk handler
+ * \param[in,out] user[]  User data per thread
+ * \param[in]     threads Thread count
+ * \param[in]     chunk   Submessages per chunk
+ * \return                Error code
+ */
+extern pb_error_t
+pb_decoder_decode_repeated(
+    const pb_decoder_t *decoder, pb_tag_t tag,
+    pb_decoder_handler_f handler, pb_decoder_chunk_f deliver,
+    void *user[], size_t threads, size_t chunk) {
+  assert(decoder && handler && threads && chunk);
+  if (unlikely_(!pb_decoder_valid(decoder)))
+    return PB_ERROR_INVALID;
+  if (threads > THREADS_MAX)
+    threads = THREADS_MAX;
+
+  /* Ensure the field is a known message field */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(decoder->descriptor, tag);
+  if (unlikely_(!descriptor ||
+      pb_field_descriptor_type(descriptor) != PB_TYPE_MESSAGE))
+    return PB_ERROR_INVALID;
+
+  /* Collect submessages and decode them in chunks */
+  item_t *items = NULL; size_t size = 0;
+  pb_error_t error = collect(decoder, tag, &items, &size);
+  if (likely_(!error && size)) {
+    const size_t chunks = (size - 1) / chunk + 1;
+    repeated_t repeated = {
+      .decoder    = decoder,
+      .descriptor = descriptor,
+      .items      = items,
+      .size       = size,
+      .chunk      = chunk,
+      .handler    = handler,
+      .deliver    = deliver,
+      .user       = user,
+      .turn       = 0,
+      .error      = PB_ERROR_NONE
+    };
+    run(chunks, threads < chunks ? threads : chunks, 1,
+      decode_chunk, &repeated);
+    error = repeated.error;
+  }
+
+  /* Free all allocated memory */
+  if (items)
+    pb_allocator_free(&allocator_default, items);
+  return error;
+}
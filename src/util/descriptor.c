@@ -21,12 +21,190 @@
  */
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <protobluff/core/allocator.h>
+
+#include "core/allocator.h"
 #include "core/common.h"
 #include "util/descriptor.h"
 
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef const char *
+(*name_f)(
+  const void *descriptor,              /* Descriptor */
+  size_t index);                       /* Index */
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Compute the seeded hash of a name.
+ *
+ * This is a 32-bit FNV-1a hash with the seed mixed into the offset basis and
+ * the upper half folded into the lower half, as only the lower bits are used
+ * to index the slots. The generator must use the exact same function.
+ *
+ * \param[in] name[] Name
+ * \param[in] seed   Seed
+ * \return           Hash
+ */
+static uint32_t
+hash(const char name[], uint32_t seed) {
+  assert(name);
+  uint32_t value = 2166136261U ^ seed;
+  for (const uint8_t *c = (const uint8_t *)name; *c; ++c)
+    value = (value ^ *c) * 16777619U;
+  return value ^ (value >> 16);
+}
+
+/*!
+ * Retrieve the name of a field descriptor.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] index      Index
+ * \return               Name
+ */
+static const char *
+field_name(const void *descriptor, size_t index) {
+  assert(descriptor);
+  return pb_field_descriptor_name(
+    &(((const pb_descriptor_t *)descriptor)->field.data[index]));
+}
+
+/*!
+ * Retrieve the name of an enum value descriptor.
+ *
+ * \param[in] descriptor Enum descriptor
+ * \param[in] index      Index
+ * \return               Name
+ */
+static const char *
+value_name(const void *descriptor, size_t index) {
+  assert(descriptor);
+  return pb_enum_value_descriptor_name(
+    &(((const pb_enum_descriptor_t *)descriptor)->value.data[index]));
+}
+
+/*!
+ * Build a perfect-hash name table.
+ *
+ * The slot count starts at the next power of two of twice the number of names
+ * and is doubled whenever none of a handful of seeds maps all names to
+ * distinct slots. If the names are not unique, no table can be built.
+ *
+ * \param[in] descriptor Descriptor or enum descriptor
+ * \param[in] size       Name count
+ * \param[in] name       Name accessor
+ * \return               Name table
+ */
+static pb_name_table_t *
+table_create(const void *descriptor, size_t size, name_f name) {
+  assert(descriptor && size && name);
+  for (size_t slots = 2; slots <= 64 * size; slots <<= 1) {
+    if (slots < 2 * size)
+      continue;
+
+    /* Allocate table with slots */
+    pb_name_table_t *table = pb_allocator_allocate(&allocator_default,
+      sizeof(pb_name_table_t) + slots * sizeof(uint32_t));
+    if (unlikely_(!table))
+      return NULL;                                         /* LCOV_EXCL_LINE */
+    uint32_t *slot = (uint32_t *)(table + 1);
+
+    /* Try seeds until all names map to distinct slots */
+    for (uint32_t seed = 0; seed < 64; ++seed) {
+      memset(slot, 0, slots * sizeof(uint32_t));
+      size_t n = 0;
+      for (; n < size; ++n) {
+        uint32_t *current = &(slot[hash(name(descriptor, n), seed) &
+          (slots - 1)]);
+        if (*current)
+          break;
+        *current = n + 1;
+      }
+      if (n == size) {
+        memcpy(table, &(pb_name_table_t){
+          .seed = seed,
+          .size = slots,
+          .slot = slot
+        }, sizeof(pb_name_table_t));
+        return table;
+      }
+    }
+    pb_allocator_free(&allocator_default, table);
+  }
+  return NULL;
+}
+
+/*!
+ * Build a name table for the fields of a descriptor.
+ *
+ * \param[in] descriptor Descriptor
+ * \return               Name table
+ */
+static const void *
+field_table_create(const void *descriptor) {
+  assert(descriptor);
+  return table_create(descriptor,
+    ((const pb_descriptor_t *)descriptor)->field.size, field_name);
+}
+
+/*!
+ * Build a name table for the values of an enum descriptor.
+ *
+ * \param[in] descriptor Enum descriptor
+ * \return               Name table
+ */
+static const void *
+value_table_create(const void *descriptor) {
+  assert(descriptor);
+  return table_create(descriptor,
+    ((const pb_enum_descriptor_t *)descriptor)->value.size, value_name);
+}
+
+/*!
+ * Retrieve the index of a name from a descriptor or enum descriptor.
+ *
+ * \param[in] descriptor Descriptor or enum descriptor
+ * \param[in] table      Name table, if generated
+ * \param[in] size       Name count
+ * \param[in] name       Name accessor
+ * \param[in] create     Name table constructor
+ * \param[in] key[]      Name to look up
+ * \return               Index or name count
+ */
+static size_t
+lookup(
+    const void *descriptor, const pb_name_table_t *table, size_t size,
+    name_f name, pb_descriptor_cache_f create, const char key[]) {
+  assert(descriptor && name && create && key);
+  if (!size)
+    return size;
+
+  /* Probe the name table, building it if not generated */
+  if (!table)
+    table = pb_descriptor_cache(descriptor, create);
+  if (likely_(table != NULL)) {
+    uint32_t slot = table->slot[hash(key, table->seed) & (table->size - 1)];
+    return slot && !strcmp(name(descriptor, slot - 1), key)
+      ? slot - 1
+      : size;
+  }
+
+  /* Fall back to a linear search */
+  for (size_t index = 0; index < size; ++index)
+    if (!strcmp(name(descriptor, index), key))
+      return index;
+  return size;
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -34,8 +212,9 @@
 /*!
  * Retrieve the field descriptor for a given name from a descriptor.
  *
- * \warning Querying a descriptor by name is far less efficient than querying
- * by tag, as a lot more comparisons are involved.
+ * Names are resolved through a perfect-hash table, which is emitted by the
+ * generator or built lazily upon the first lookup, followed by a single string
+ * comparison. Extensions are checked one after another.
  *
  * \param[in] descriptor Descriptor
  * \param[in] name[]     Name
@@ -45,14 +224,13 @@ extern const pb_field_descriptor_t *
 pb_descriptor_field_by_name(
     const pb_descriptor_t *descriptor, const char name[]) {
   assert(descriptor && name);
-  for (size_t f = 0; f < descriptor->field.size; ++f) {
-    if (strcmp(pb_field_descriptor_name(&(descriptor->field.data[f])), name))
-      continue;
-    return &(descriptor->field.data[f]);
-  }
-  return pb_descriptor_extension(descriptor) ?
-    pb_descriptor_field_by_name(
-      pb_descriptor_extension(descriptor), name) : NULL;
+  do {
+    size_t f = lookup(descriptor, descriptor->names,
+      descriptor->field.size, field_name, field_table_create, name);
+    if (f < descriptor->field.size)
+      return &(descriptor->field.data[f]);
+  } while ((descriptor = atomic_load_(&(descriptor->extension))));
+  return NULL;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -60,8 +238,8 @@ pb_descriptor_field_by_name(
 /*!
  * Retrieve the value descriptor for a given name from an enum descriptor.
  *
- * \warning Querying an enum descriptor by name is far less efficient than
- * querying by number, as a lot more comparisons are involved.
+ * Names are resolved through a perfect-hash table, which is emitted by the
+ * generator or built lazily upon the first lookup.
  *
  * \param[in] descriptor Enum descriptor
  * \param[in] name       Name
@@ -71,11 +249,9 @@ extern const struct pb_enum_value_descriptor_t *
 pb_enum_descriptor_value_by_name(
     const pb_enum_descriptor_t *descriptor, const char name[]) {
   assert(descriptor && name);
-  for (size_t v = 0; v < descriptor->value.size; ++v) {
-    if (strcmp(pb_enum_value_descriptor_name(
-        &(descriptor->value.data[v])), name))
-      continue;
-    return &(descriptor->value.data[v]);
-  }
-  return NULL;
+  size_t v = lookup(descriptor, descriptor->names,
+    descriptor->value.size, value_name, value_table_create, name);
+  return v < descriptor->value.size
+    ? &(descriptor->value.data[v])
+    : NULL;
 }
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/stream.h"
+#include "core/varint.h"
+#include "util/prune.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the masked field for a given tag.
+ *
+ * \param[in] mask Mask
+ * \param[in] tag  Tag
+ * \return         Masked field or NULL
+ */
+static const pb_mask_field_t *
+lookup(const pb_mask_t *mask, pb_tag_t tag) {
+  assert(mask && tag);
+  size_t lower = 0, upper = mask->field.size;
+  while (lower < upper) {
+    size_t middle = lower + ((upper - lower) >> 1);
+    const pb_mask_field_t *field = &(mask->field.data[middle]);
+    if (field->tag == tag)
+      return field;
+    if (field->tag < tag) {
+      lower = middle + 1;
+    } else {
+      upper = middle;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * Copy all fields of a message which are selected by a mask.
+ *
+ * Every input byte is touched at most once: the fields are read from a stream,
+ * which decodes tags and length prefixes and scans varints for their end, and
+ * values are only copied if their field is selected. Fields without a nested
+ * mask are copied as a whole, while submessages with a nested mask are pruned
+ * recursively. As a pruned submessage can never be larger than the original
+ * one, as many bytes as the original length prefix occupies are reserved for
+ * the new length prefix. If the minimal length prefix turns out to be
+ * shorter, the pruned submessage is moved accordingly.
+ *
+ * \param[in]  descriptor Descriptor
+ * \param[in]  mask       Mask
+ * \param[in]  data[]     Raw data
+ * \param[in]  size       Raw data size
+ * \param[out] out[]      Output data, at least as large as the raw data
+ * \param[out] written    Pointer receiving written bytes
+ * \return                Error code
+ */
+static pb_error_t
+prune(
+    const pb_descriptor_t *descriptor, const pb_mask_t *mask,
+    const uint8_t data[], size_t size, uint8_t out[], size_t *written) {
+  assert(descriptor && mask && (data || !size) && (out || !size) && written);
+  pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+    (uint8_t *)data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+  pb_error_t error = PB_ERROR_NONE;
+  *written = 0;
+  while (!error && pb_stream_left(&stream)) {
+    pb_stream_field_t current;
+    if (unlikely_(error = pb_stream_next(&stream, &current)))
+      break;
+
+    /* Skip fields which are not selected by the mask */
+    const pb_mask_field_t *field = lookup(mask, current.tag);
+    if (!field)
+      continue;
+
+    /* Copy selected fields without nested mask as a whole */
+    if (!field->nested) {
+      memcpy(&(out[*written]), &(data[current.start]),
+        current.end - current.start);
+      *written += current.end - current.start;
+      continue;
+    }
+
+    /* Nested masks may only be applied to submessages */
+    const pb_field_descriptor_t *nested =
+      pb_descriptor_field_by_tag(descriptor, current.tag);
+    if (unlikely_(!nested || current.wiretype != PB_WIRETYPE_LENGTH ||
+        pb_field_descriptor_type(nested) != PB_TYPE_MESSAGE)) {
+      error = PB_ERROR_INVALID;
+      break;
+    }
+
+    /* Copy tag and prune submessage behind reserved length prefix */
+    const size_t reserved = current.value - current.header;
+    memcpy(&(out[*written]), &(data[current.start]),
+      current.header - current.start);
+    *written += current.header - current.start;
+    size_t pruned;
+    if (unlikely_(error = prune(pb_field_descriptor_nested(nested),
+        field->nested, &(data[current.value]), current.end - current.value,
+          &(out[*written + reserved]), &pruned)))
+      break;
+
+    /* Write minimal length prefix and move submessage, if necessary */
+    uint32_t length = pruned;
+    uint8_t prefix[5]; size_t used = pb_varint_pack_uint32(prefix, &length);
+    if (used < reserved)
+      memmove(&(out[*written + used]), &(out[*written + reserved]), length);
+    memcpy(&(out[*written]), prefix, used);
+    *written += used + length;
+  }
+  pb_stream_destroy(&stream);
+  return error;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Copy a message, retaining only the fields which are selected by a mask.
+ *
+ * A mask lists the tags of the selected fields in ascending order. Fields
+ * without a nested mask are copied as a whole, while submessages with a nested
+ * mask are pruned recursively and their length prefixes are recomputed. The
+ * input buffer is traversed in a single pass, and the pruned message is
+ * appended to the output buffer, which is grown only once, as pruning can
+ * never yield a larger message.
+ *
+ * The output buffer's internal state is fully recoverable.
+ *
+ * \param[in]     descriptor Descriptor
+ * \param[in]     mask       Mask
+ * \param[in]     in         Input buffer
+ * \param[in,out] out        Output buffer
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_prune(
+    const pb_descriptor_t *descriptor, const pb_mask_t *mask,
+    const pb_buffer_t *in, pb_buffer_t *out) {
+  assert(descriptor && mask && in && out && in != out);
+  if (unlikely_(!pb_buffer_valid(in) || !pb_buffer_valid(out)))
+    return PB_ERROR_INVALID;
+  if (unlikely_(pb_buffer_zero_copy(out)))
+    return PB_ERROR_ALLOC;
+  if (pb_buffer_empty(in))
+    return PB_ERROR_NONE;
+
+  /* Grow output buffer to hold the unpruned message */
+  const size_t capacity = out->size + in->size;
+  uint8_t *data = pb_allocator_resize(out->allocator, out->data, capacity);
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+
+  /* Append pruned message */
+  size_t written = 0;
+  pb_error_t error = prune(descriptor, mask,
+    in->data, in->size, &(data[out->size]), &written);
+  if (unlikely_(error))
+    written = 0;
+
+  /* Shrink data to its size */
+  const size_t size = out->size + written;
+  if (!size) {
+    pb_allocator_free(out->allocator, data);
+    data = NULL;
+  } else if (size < capacity) {
+    uint8_t *temp = pb_allocator_resize(out->allocator, data, size);
+    if (temp)
+      data = temp;
+  }
+  out->data = data;
+  out->size = size;
+  return error;
+}
@@ -23,6 +23,7 @@
 #include <assert.h>
 #include <check.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -139,6 +140,76 @@ START_TEST(test_create_zero_copy) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Create a memory-mapped buffer.
+ */
+START_TEST(test_create_mmap) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Write data to file */
+  FILE *file = fopen("core-buffer.mmap", "wb");
+  ck_assert_ptr_ne(NULL, file);
+  ck_assert_uint_eq(size, fwrite(data, 1, size, file));
+  fclose(file);
+
+  /* Create buffer */
+  pb_buffer_t buffer = pb_buffer_create_mmap("core-buffer.mmap");
+
+  /* Assert buffer validity and error */
+  fail_unless(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_error(&buffer));
+
+  /* Assert buffer size */
+  fail_if(pb_buffer_empty(&buffer));
+  ck_assert_uint_eq(size, pb_buffer_size(&buffer));
+
+  /* Assert same contents */
+  fail_if(memcmp(data, pb_buffer_data(&buffer), size));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  remove("core-buffer.mmap");
+} END_TEST
+
+/*
+ * Create a memory-mapped buffer from an empty file.
+ */
+START_TEST(test_create_mmap_empty) {
+  FILE *file = fopen("core-buffer.mmap", "wb");
+  ck_assert_ptr_ne(NULL, file);
+  fclose(file);
+
+  /* Create buffer */
+  pb_buffer_t buffer = pb_buffer_create_mmap("core-buffer.mmap");
+
+  /* Assert buffer validity and error */
+  fail_unless(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_error(&buffer));
+
+  /* Assert buffer size */
+  fail_unless(pb_buffer_empty(&buffer));
+  ck_assert_uint_eq(0, pb_buffer_size(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  remove("core-buffer.mmap");
+} END_TEST
+
+/*
+ * Create a memory-mapped buffer from a file that does not exist.
+ */
+START_TEST(test_create_mmap_invalid) {
+  pb_buffer_t buffer = pb_buffer_create_mmap("core-buffer.mmap.absent");
+
+  /* Assert buffer validity and error */
+  fail_if(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_buffer_error(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /*
  * Create an invalid buffer.
  */
@@ -269,6 +340,39 @@ START_TEST(test_grow_zero_copy) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Grow a memory-mapped buffer and expect a NULL pointer.
+ */
+START_TEST(test_grow_mmap) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Write data to file */
+  FILE *file = fopen("core-buffer.mmap", "wb");
+  ck_assert_ptr_ne(NULL, file);
+  ck_assert_uint_eq(size, fwrite(data, 1, size, file));
+  fclose(file);
+
+  /* Create buffer */
+  pb_buffer_t buffer = pb_buffer_create_mmap("core-buffer.mmap");
+
+  /* Assert buffer validity and error */
+  fail_unless(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_error(&buffer));
+
+  /* Grow buffer */
+  uint8_t *new_data = pb_buffer_grow(&buffer, 16);
+  ck_assert_ptr_eq(NULL, new_data);
+
+  /* Assert buffer size */
+  fail_if(pb_buffer_empty(&buffer));
+  ck_assert_uint_eq(9, pb_buffer_size(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  remove("core-buffer.mmap");
+} END_TEST
+
 /*
  * Grow an invalid buffer and expect a NULL pointer.
  */
@@ -448,6 +552,9 @@ main(void) {
   tcase_add_test(tcase, test_create);
   tcase_add_test(tcase, test_create_empty);
   tcase_add_test(tcase, test_create_zero_copy);
+  tcase_add_test(tcase, test_create_mmap);
+  tcase_add_test(tcase, test_create_mmap_empty);
+  tcase_add_test(tcase, test_create_mmap_invalid);
   tcase_add_test(tcase, test_create_invalid);
   tcase_add_test(tcase, test_create_invalid_allocate);
   suite_add_tcase(suite, tcase);
@@ -457,6 +564,7 @@ main(void) {
   tcase_add_test(tcase, test_grow);
   tcase_add_test(tcase, test_grow_empty);
   tcase_add_test(tcase, test_grow_zero_copy);
+  tcase_add_test(tcase, test_grow_mmap);
   tcase_add_test(tcase, test_grow_invalid);
   tcase_add_test(tcase, test_grow_invalid_allocate);
   tcase_add_test(tcase, test_grow_invalid_resize);
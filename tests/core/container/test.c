@@ -0,0 +1,569 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/container.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+#include "core/record.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", SINT32,  OPTIONAL },
+    {  2, "F02", UINT32,  OPTIONAL },
+    {  3, "F03", STRING,  OPTIONAL },
+    {  4, "F04", UINT32,  REPEATED }
+  }, 4 } };
+
+/* ----------------------------------------------------------------------------
+ * Helpers
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Decoder handler that extracts the value of the second field.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ */
+static pb_error_t
+handler(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  assert(descriptor && value && user);
+  if (pb_field_descriptor_tag(descriptor) == 2)
+    *(uint32_t *)user = *(const uint32_t *)value;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Write records with keys from -5 to 4 and values from 0 to 9.
+ *
+ * \param[in,out] writer Container writer
+ */
+static void
+write_records(pb_container_writer_t *writer) {
+  for (uint32_t r = 0; r < 10; r++) {
+    int32_t key = (int32_t)r - 5;
+    pb_encoder_t encoder = pb_encoder_create(&descriptor);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder, 1, &key, 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder, 2, &r, 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_container_writer_write(writer, pb_encoder_buffer(&encoder)));
+    pb_encoder_destroy(&encoder);
+  }
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_container_writer_finish(writer));
+}
+
+/*!
+ * Decode the value of the current record of a record iterator.
+ *
+ * \param[in] iter Record iterator
+ * \return         Value
+ */
+static uint32_t
+read_record(const pb_record_iter_t *iter) {
+  uint32_t value = UINT32_MAX;
+  pb_decoder_t decoder = pb_record_iter_decoder(iter, &descriptor);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler, &value));
+  pb_decoder_destroy(&decoder);
+  return value;
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a container writer.
+ */
+START_TEST(test_writer_create) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 4);
+
+  /* Assert container writer validity and error */
+  fail_unless(pb_container_writer_valid(&writer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_container_writer_error(&writer));
+
+  /* Assert container writer records and buffer */
+  ck_assert_uint_eq(0, pb_container_writer_records(&writer));
+  fail_unless(pb_buffer_empty(pb_container_writer_buffer(&writer)));
+
+  /* Free all allocated memory */
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Create a container writer with an invalid key field.
+ */
+START_TEST(test_writer_create_invalid) {
+  const pb_tag_t tags[] = { 3, 4, 5 };
+  for (size_t t = 0; t < 3; t++) {
+    pb_container_writer_t writer =
+      pb_container_writer_create(&descriptor, tags[t], 4);
+
+    /* Assert container writer validity and error */
+    fail_if(pb_container_writer_valid(&writer));
+    ck_assert_uint_eq(PB_ERROR_ALLOC, pb_container_writer_error(&writer));
+
+    /* Free all allocated memory */
+    pb_container_writer_destroy(&writer);
+  }
+} END_TEST
+
+/*
+ * Write records to a container writer.
+ */
+START_TEST(test_writer_write) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 4);
+  write_records(&writer);
+
+  /* Assert container writer records and buffer */
+  ck_assert_uint_eq(10, pb_container_writer_records(&writer));
+  fail_if(pb_buffer_empty(pb_container_writer_buffer(&writer)));
+
+  /* Assert no more writes after finishing */
+  pb_buffer_t buffer = pb_buffer_create_empty();
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_container_writer_write(&writer, &buffer));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_container_writer_finish(&writer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Write an invalid record to a container writer.
+ */
+START_TEST(test_writer_write_invalid) {
+  const uint8_t data[] = { 8, 255 };
+  const size_t  size   = 2;
+
+  /* Create buffer and container writer */
+  pb_buffer_t           buffer = pb_buffer_create(data, size);
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 4);
+
+  /* Assert error for malformed record */
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_container_writer_write(&writer, &buffer));
+  ck_assert_uint_eq(0, pb_container_writer_records(&writer));
+
+  /* Free all allocated memory */
+  pb_container_writer_destroy(&writer);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a container reader.
+ */
+START_TEST(test_reader_create) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 4);
+  write_records(&writer);
+
+  /* Create container reader */
+  pb_container_reader_t reader =
+    pb_container_reader_create(pb_container_writer_buffer(&writer));
+
+  /* Assert container reader validity and error */
+  fail_unless(pb_container_reader_valid(&reader));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_container_reader_error(&reader));
+
+  /* Assert container reader records and blocks */
+  ck_assert_uint_eq(10, pb_container_reader_records(&reader));
+  ck_assert_uint_eq(3, pb_container_reader_blocks(&reader));
+
+  /* Free all allocated memory */
+  pb_container_reader_destroy(&reader);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Create a container reader over an empty container.
+ */
+START_TEST(test_reader_create_empty) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 0, 4);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_container_writer_finish(&writer));
+
+  /* Create container reader */
+  pb_container_reader_t reader =
+    pb_container_reader_create(pb_container_writer_buffer(&writer));
+
+  /* Assert container reader validity and error */
+  fail_unless(pb_container_reader_valid(&reader));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_container_reader_error(&reader));
+
+  /* Assert container reader records and blocks */
+  ck_assert_uint_eq(0, pb_container_reader_records(&reader));
+  ck_assert_uint_eq(0, pb_container_reader_blocks(&reader));
+
+  /* Free all allocated memory */
+  pb_container_reader_destroy(&reader);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Create a container reader over a buffer that is not a container.
+ */
+START_TEST(test_reader_create_invalid) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 4);
+  write_records(&writer);
+
+  /* Copy container and corrupt magic number */
+  const pb_buffer_t *container = pb_container_writer_buffer(&writer);
+  pb_buffer_t buffer = pb_buffer_create(
+    pb_buffer_data(container), pb_buffer_size(container));
+  buffer.data[pb_buffer_size(&buffer) - 1] ^= 0xFF;
+
+  /* Create container reader */
+  pb_container_reader_t reader = pb_container_reader_create(&buffer);
+
+  /* Assert container reader validity and error */
+  fail_if(pb_container_reader_valid(&reader));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_container_reader_error(&reader));
+
+  /* Free all allocated memory */
+  pb_container_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Create a container reader over a container with a crafted footer.
+ */
+START_TEST(test_reader_create_invalid_footer) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 4);
+  write_records(&writer);
+
+  /* Copy container */
+  const pb_buffer_t *container = pb_container_writer_buffer(&writer);
+  pb_buffer_t buffer = pb_buffer_create(
+    pb_buffer_data(container), pb_buffer_size(container));
+
+  /* Craft footer where the size of the block index overflows to one entry */
+  uint8_t *footer = &(buffer.data[pb_buffer_size(&buffer) - 32]);
+  uint64_t offset  = pb_buffer_size(&buffer) - 32 - 3 * sizeof(uint64_t),
+           records = (UINT64_C(1) << 61) + 1;
+  uint32_t block   = 1;
+  memcpy(&(footer[ 0]), &offset,  sizeof(uint64_t));
+  memcpy(&(footer[ 8]), &records, sizeof(uint64_t));
+  memcpy(&(footer[16]), &block,   sizeof(uint32_t));
+
+  /* Create container reader */
+  pb_container_reader_t reader = pb_container_reader_create(&buffer);
+
+  /* Assert container reader validity and error */
+  fail_if(pb_container_reader_valid(&reader));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_container_reader_error(&reader));
+
+  /* Free all allocated memory */
+  pb_container_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Create a container reader over a truncated container.
+ */
+START_TEST(test_reader_create_invalid_size) {
+  const uint8_t data[] = { 2, 8, 1 };
+  const size_t  size   = 3;
+
+  /* Create buffer and container reader */
+  pb_buffer_t           buffer = pb_buffer_create(data, size);
+  pb_container_reader_t reader = pb_container_reader_create(&buffer);
+
+  /* Assert container reader validity and error */
+  fail_if(pb_container_reader_valid(&reader));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_container_reader_error(&reader));
+
+  /* Free all allocated memory */
+  pb_container_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Iterate the records of a block of a container reader.
+ */
+START_TEST(test_reader_block) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 4);
+  write_records(&writer);
+
+  /* Create container reader */
+  pb_container_reader_t reader =
+    pb_container_reader_create(pb_container_writer_buffer(&writer));
+
+  /* Iterate records of all blocks */
+  const size_t sizes[] = { 4, 4, 2 };
+  uint32_t value = 0;
+  for (size_t b = 0; b < 3; b++) {
+    pb_record_iter_t iter = pb_container_reader_block(&reader, b);
+    fail_unless(pb_record_iter_valid(&iter));
+
+    /* Assert block size and values */
+    size_t records = 0;
+    do {
+      ck_assert_uint_eq(value++, read_record(&iter));
+      records++;
+    } while (pb_record_iter_next(&iter));
+    ck_assert_uint_eq(sizes[b], records);
+    ck_assert_uint_eq(PB_ERROR_EOM, pb_record_iter_error(&iter));
+    pb_record_iter_destroy(&iter);
+  }
+
+  /* Assert invalid block */
+  pb_record_iter_t iter = pb_container_reader_block(&reader, 3);
+  fail_if(pb_record_iter_valid(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_container_reader_destroy(&reader);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Seek to a record of a container reader.
+ */
+START_TEST(test_reader_seek) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 4);
+  write_records(&writer);
+
+  /* Create container reader */
+  pb_container_reader_t reader =
+    pb_container_reader_create(pb_container_writer_buffer(&writer));
+
+  /* Seek to every record and iterate until the end */
+  for (uint32_t r = 0; r < 10; r++) {
+    pb_record_iter_t iter = pb_container_reader_seek(&reader, r);
+    fail_unless(pb_record_iter_valid(&iter));
+
+    /* Assert values */
+    uint32_t value = r;
+    do {
+      ck_assert_uint_eq(value++, read_record(&iter));
+    } while (pb_record_iter_next(&iter));
+    ck_assert_uint_eq(10, value);
+    pb_record_iter_destroy(&iter);
+  }
+
+  /* Assert invalid record */
+  pb_record_iter_t iter = pb_container_reader_seek(&reader, 10);
+  fail_if(pb_record_iter_valid(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_container_reader_destroy(&reader);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Skip blocks of a container reader that don't match a key range.
+ */
+START_TEST(test_reader_find) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 4);
+  write_records(&writer);
+
+  /* Create container reader */
+  pb_container_reader_t reader =
+    pb_container_reader_create(pb_container_writer_buffer(&writer));
+
+  /* Assert matching blocks for keys from -1 to 2 */
+  int32_t min = -1, max = 2;
+  fail_if(pb_container_reader_match(&reader, 0, &min, &max));
+  fail_unless(pb_container_reader_match(&reader, 1, &min, &max));
+  fail_if(pb_container_reader_match(&reader, 2, &min, &max));
+  ck_assert_uint_eq(1, pb_container_reader_find(&reader, 0, &min, &max));
+  ck_assert_uint_eq(3, pb_container_reader_find(&reader, 2, &min, &max));
+
+  /* Assert matching blocks for keys from -10 to -2 */
+  min = -10, max = -2;
+  ck_assert_uint_eq(0, pb_container_reader_find(&reader, 0, &min, &max));
+  ck_assert_uint_eq(3, pb_container_reader_find(&reader, 1, &min, &max));
+
+  /* Assert matching blocks for keys from 4 to 10 */
+  min = 4, max = 10;
+  ck_assert_uint_eq(2, pb_container_reader_find(&reader, 0, &min, &max));
+
+  /* Free all allocated memory */
+  pb_container_reader_destroy(&reader);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Skip blocks of a container reader without key.
+ */
+START_TEST(test_reader_find_without_key) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 0, 4);
+  write_records(&writer);
+
+  /* Create container reader */
+  pb_container_reader_t reader =
+    pb_container_reader_create(pb_container_writer_buffer(&writer));
+  fail_unless(pb_container_reader_valid(&reader));
+
+  /* Assert all blocks match */
+  int32_t min = 100, max = 200;
+  ck_assert_uint_eq(0, pb_container_reader_find(&reader, 0, &min, &max));
+  ck_assert_uint_eq(2, pb_container_reader_find(&reader, 2, &min, &max));
+
+  /* Free all allocated memory */
+  pb_container_reader_destroy(&reader);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Skip blocks of a container reader with records without key.
+ */
+START_TEST(test_reader_find_default) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 1);
+
+  /* Write record without key */
+  pb_buffer_t buffer = pb_buffer_create_empty();
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_container_writer_write(&writer, &buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_container_writer_finish(&writer));
+
+  /* Create container reader */
+  pb_container_reader_t reader =
+    pb_container_reader_create(pb_container_writer_buffer(&writer));
+  fail_unless(pb_container_reader_valid(&reader));
+
+  /* Assert block matches default key */
+  int32_t min = 0, max = 0;
+  fail_unless(pb_container_reader_match(&reader, 0, &min, &max));
+  min = 1, max = 1;
+  fail_if(pb_container_reader_match(&reader, 0, &min, &max));
+
+  /* Free all allocated memory */
+  pb_container_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/*
+ * Partition the blocks of a container reader among workers.
+ */
+START_TEST(test_reader_partition) {
+  pb_container_writer_t writer =
+    pb_container_writer_create(&descriptor, 1, 1);
+  write_records(&writer);
+
+  /* Create container reader */
+  pb_container_reader_t reader =
+    pb_container_reader_create(pb_container_writer_buffer(&writer));
+  ck_assert_uint_eq(10, pb_container_reader_blocks(&reader));
+
+  /* Assert contiguous and complete partitions */
+  size_t start, end, next = 0;
+  for (size_t w = 0; w < 3; w++) {
+    pb_container_reader_partition(&reader, w, 3, &start, &end);
+    ck_assert_uint_eq(next, start);
+    fail_unless(end - start >= 3 && end - start <= 4);
+    next = end;
+  }
+  ck_assert_uint_eq(10, next);
+
+  /* Free all allocated memory */
+  pb_container_reader_destroy(&reader);
+  pb_container_writer_destroy(&writer);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/container"),
+       *tcase = NULL;
+
+  /* Add tests to test case "writer" */
+  tcase = tcase_create("writer");
+  tcase_add_test(tcase, test_writer_create);
+  tcase_add_test(tcase, test_writer_create_invalid);
+  tcase_add_test(tcase, test_writer_write);
+  tcase_add_test(tcase, test_writer_write_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "reader" */
+  tcase = tcase_create("reader");
+  tcase_add_test(tcase, test_reader_create);
+  tcase_add_test(tcase, test_reader_create_empty);
+  tcase_add_test(tcase, test_reader_create_invalid);
+  tcase_add_test(tcase, test_reader_create_invalid_footer);
+  tcase_add_test(tcase, test_reader_create_invalid_size);
+  tcase_add_test(tcase, test_reader_block);
+  tcase_add_test(tcase, test_reader_seek);
+  tcase_add_test(tcase, test_reader_find);
+  tcase_add_test(tcase, test_reader_find_without_key);
+  tcase_add_test(tcase, test_reader_find_default);
+  tcase_add_test(tcase, test_reader_partition);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
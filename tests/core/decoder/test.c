@@ -32,6 +32,7 @@
 #include "core/common.h"
 #include "core/decoder.h"
 #include "core/descriptor.h"
+#include "core/iovec.h"
 
 /* ----------------------------------------------------------------------------
  * Decoder callback
@@ -53,6 +54,45 @@ handler(
   return PB_ERROR_NONE;
 }
 
+/*!
+ * Log of decoded fields.
+ */
+typedef struct log_t {
+  pb_tag_t tags[12];                   /*!< Occurrences */
+  uint64_t hash;                       /*!< Hash of values */
+} log_t;
+
+/*!
+ * Field handler that counts occurrences and hashes values, recursing into
+ * nested messages.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ */
+static pb_error_t
+handler_recursive(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  assert(descriptor && value && user);
+  log_t *log = user;
+  log->tags[pb_field_descriptor_tag(descriptor) - 1]++;
+  switch (pb_field_descriptor_type(descriptor)) {
+    case PB_TYPE_MESSAGE:
+      return pb_decoder_decode(value, handler_recursive, user);
+    case PB_TYPE_STRING:
+    case PB_TYPE_BYTES:
+      for (size_t b = 0; b < pb_string_size(value); b++)
+        log->hash = log->hash * 31 + pb_string_data(value)[b];
+      break;
+    default: {
+      uint64_t raw = 0;
+      memcpy(&raw, value, pb_field_descriptor_type_size(descriptor));
+      log->hash = log->hash * 31 + raw;
+    }
+  }
+  return PB_ERROR_NONE;
+}
+
 /* ----------------------------------------------------------------------------
  * Descriptors
  * ------------------------------------------------------------------------- */
@@ -84,6 +124,15 @@ descriptor = { {
     { 12, "F12", MESSAGE, REPEATED, &descriptor }
   }, 12 } };
 
+/* Descriptor with required fields */
+static pb_descriptor_t
+descriptor_required = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  REQUIRED },
+    {  2, "F02", ENUM,    OPTIONAL, &enum_descriptor },
+    {  3, "F03", MESSAGE, OPTIONAL, &descriptor_required }
+  }, 3 } };
+
 /* ----------------------------------------------------------------------------
  * Tests
  * ------------------------------------------------------------------------- */
@@ -358,6 +407,310 @@ START_TEST(test_decode_invalid_packed) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Decode a segmented buffer split at every possible position.
+ */
+START_TEST(test_decode_iovec) {
+  const uint8_t data[] = {
+    8, 172, 2,
+    16, 255, 255, 255, 255, 255, 255, 255, 255, 255, 1,
+    50, 8, 0, 0, 128, 63, 0, 0, 0, 64,
+    57, 0, 0, 0, 0, 0, 0, 248, 63,
+    66, 5, 'H', 'E', 'L', 'L', 'O',
+    120, 150, 1,
+    114, 3, 1, 2, 3,
+    109, 1, 2, 3, 4,
+    90, 8, 8, 1, 66, 2, 'A', 'B', 90, 0 };
+  const size_t  size   = 63;
+
+  /* Decode contiguous buffer for reference */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+  log_t expected = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler_recursive, &expected));
+  ck_assert_uint_eq(2, expected.tags[0]);
+  ck_assert_uint_eq(2, expected.tags[10]);
+
+  /* Decode segmented buffer split at every position */
+  for (size_t s = 0; s <= size; s++) {
+    const struct iovec segments[] = {
+      { (void *)data, s },
+      { (void *)&(data[s]), size - s }
+    };
+    pb_iovec_t   iovec      = pb_iovec_create(segments, 2);
+    pb_decoder_t subdecoder = pb_decoder_create_from_iovec(
+      &descriptor, &iovec);
+
+    /* Assert decoder validity and error */
+    fail_unless(pb_decoder_valid(&subdecoder));
+    ck_assert_ptr_eq(&iovec, pb_decoder_iovec(&subdecoder));
+
+    /* Decode using the handler and compare */
+    log_t log = {};
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_decoder_decode(&subdecoder, handler_recursive, &log));
+    fail_if(memcmp(&expected, &log, sizeof(log_t)));
+
+    /* Free all allocated memory */
+    pb_decoder_destroy(&subdecoder);
+    pb_iovec_destroy(&iovec);
+  }
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a segmented buffer consisting of single-byte segments.
+ */
+START_TEST(test_decode_iovec_bytewise) {
+  const uint8_t data[] = {
+    16, 255, 255, 255, 255, 255, 255, 255, 255, 255, 1,
+    57, 0, 0, 0, 0, 0, 0, 248, 63,
+    98, 9, 66, 5, 'H', 'E', 'L', 'L', 'O', 8, 1 };
+  const size_t  size   = 31;
+
+  /* Decode contiguous buffer for reference */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+  log_t expected = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler_recursive, &expected));
+
+  /* Create segmented buffer with single-byte segments */
+  struct iovec segments[31];
+  for (size_t s = 0; s < size; s++)
+    segments[s] = (struct iovec){ (void *)&(data[s]), 1 };
+  pb_iovec_t   iovec      = pb_iovec_create(segments, size);
+  pb_decoder_t subdecoder = pb_decoder_create_from_iovec(&descriptor, &iovec);
+
+  /* Decode using the handler and compare */
+  log_t log = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&subdecoder, handler_recursive, &log));
+  fail_if(memcmp(&expected, &log, sizeof(log_t)));
+  ck_assert_uint_eq(1, log.tags[11]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&subdecoder);
+  pb_iovec_destroy(&iovec);
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a segmented buffer with a nested message exceeding its boundaries.
+ */
+START_TEST(test_decode_iovec_invalid_length) {
+  const uint8_t data[] = { 98, 5, 8, 1 };
+  const size_t  size   = 4;
+
+  /* Create segmented buffer and decoder */
+  const struct iovec segments[] = {
+    { (void *)data, 3 },
+    { (void *)&(data[3]), size - 3 }
+  };
+  pb_iovec_t   iovec   = pb_iovec_create(segments, 2);
+  pb_decoder_t decoder = pb_decoder_create_from_iovec(&descriptor, &iovec);
+
+  /* Decode using the handler */
+  log_t log = {};
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_decoder_decode(&decoder, handler_recursive, &log));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Decode and validate a buffer using a handler.
+ */
+START_TEST(test_validate) {
+  const uint8_t data[] = { 8, 1, 16, 2, 26, 2, 8, 5 };
+  const size_t  size   = 8;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+  pb_decoder_set_flags(&decoder, PB_DECODER_VALIDATE);
+
+  /* Decode and validate using the handler */
+  log_t log = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler_recursive, &log));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(2, log.tags[0]);
+  ck_assert_uint_eq(1, log.tags[1]);
+  ck_assert_uint_eq(1, log.tags[2]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode and validate a buffer missing a required field.
+ */
+START_TEST(test_validate_absent) {
+  const uint8_t data[] = { 16, 1 };
+  const size_t  size   = 2;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+  pb_decoder_set_flags(&decoder, PB_DECODER_VALIDATE);
+
+  /* Decode and validate using the handler */
+  log_t log = {};
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_decoder_decode(&decoder, handler_recursive, &log));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode and validate a buffer missing a required field in a submessage.
+ */
+START_TEST(test_validate_absent_nested) {
+  const uint8_t data[] = { 8, 1, 26, 2, 16, 1 };
+  const size_t  size   = 6;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+  pb_decoder_set_flags(&decoder, PB_DECODER_VALIDATE);
+
+  /* Decode and validate using the handler */
+  log_t log = {};
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_decoder_decode(&decoder, handler_recursive, &log));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode and validate a buffer with a field of an invalid wiretype.
+ */
+START_TEST(test_validate_wiretype) {
+  const uint8_t data[] = { 13, 1, 0, 0, 0 };
+  const size_t  size   = 5;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+  pb_decoder_set_flags(&decoder, PB_DECODER_VALIDATE);
+
+  /* Decode and validate using the handler */
+  log_t log = {};
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_decoder_decode(&decoder, handler_recursive, &log));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode and validate a buffer with an unknown field of an invalid wiretype.
+ */
+START_TEST(test_validate_wiretype_unknown) {
+  const pb_wiretype_t wiretypes[] = { 3, 4, 6, 7 };
+  for (size_t w = 0; w < 4; ++w) {
+    const uint8_t data[] = { 8, 1, (4 << 3) | wiretypes[w], 1 };
+    const size_t  size   = 4;
+
+    /* Create buffer and decoder */
+    pb_buffer_t  buffer  = pb_buffer_create(data, size);
+    pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+    pb_decoder_set_flags(&decoder, PB_DECODER_VALIDATE);
+
+    /* Decode and validate using the handler */
+    log_t log = {};
+    ck_assert_uint_eq(PB_ERROR_INVALID,
+      pb_decoder_decode(&decoder, handler_recursive, &log));
+
+    /* Free all allocated memory */
+    pb_decoder_destroy(&decoder);
+    pb_buffer_destroy(&buffer);
+  }
+} END_TEST
+
+/*
+ * Decode and validate a buffer with a packed field exceeding its length.
+ */
+START_TEST(test_validate_packed) {
+  const uint8_t data[] = { 8, 1, 18, 1, 200, 1 };
+  const size_t  size   = 6;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+  pb_decoder_set_flags(&decoder, PB_DECODER_VALIDATE);
+
+  /* Decode and validate using the handler */
+  log_t log = {};
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_decoder_decode(&decoder, handler_recursive, &log));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode and validate a buffer with an undefined enum value.
+ */
+START_TEST(test_validate_enum) {
+  const uint8_t data[] = { 8, 1, 16, 7 };
+  const size_t  size   = 4;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+  pb_decoder_set_flags(&decoder, PB_DECODER_VALIDATE | PB_DECODER_VALIDATE_ENUM);
+
+  /* Decode and validate using the handler */
+  log_t log = {};
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_decoder_decode(&decoder, handler_recursive, &log));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode and validate a buffer with an undefined, unchecked enum value.
+ */
+START_TEST(test_validate_enum_unchecked) {
+  const uint8_t data[] = { 8, 1, 16, 7 };
+  const size_t  size   = 4;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+  pb_decoder_set_flags(&decoder, PB_DECODER_VALIDATE);
+
+  /* Decode and validate using the handler */
+  log_t log = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler_recursive, &log));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /* ----------------------------------------------------------------------------
  * Program
  * ------------------------------------------------------------------------- */
@@ -390,6 +743,21 @@ main(void) {
   tcase_add_test(tcase, test_decode_invalid_length_data);
   tcase_add_test(tcase, test_decode_invalid_value);
   tcase_add_test(tcase, test_decode_invalid_packed);
+  tcase_add_test(tcase, test_decode_iovec);
+  tcase_add_test(tcase, test_decode_iovec_bytewise);
+  tcase_add_test(tcase, test_decode_iovec_invalid_length);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "validate" */
+  tcase = tcase_create("validate");
+  tcase_add_test(tcase, test_validate);
+  tcase_add_test(tcase, test_validate_absent);
+  tcase_add_test(tcase, test_validate_absent_nested);
+  tcase_add_test(tcase, test_validate_wiretype);
+  tcase_add_test(tcase, test_validate_wiretype_unknown);
+  tcase_add_test(tcase, test_validate_packed);
+  tcase_add_test(tcase, test_validate_enum);
+  tcase_add_test(tcase, test_validate_enum_unchecked);
   suite_add_tcase(suite, tcase);
 
   /* Create a test suite runner in no-fork mode */
@@ -83,6 +83,15 @@ descriptor_extension = { {
     { 21, "F21", UINT64,  OPTIONAL }
   }, 2, } };
 
+/* Required descriptor */
+static pb_descriptor_t
+descriptor_required = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  REQUIRED },
+    {  2, "F02", UINT64,  OPTIONAL },
+    {  3, "F03", SINT32,  REQUIRED }
+  }, 3 } };
+
 /* Nested extension descriptor */
 static pb_descriptor_t
 descriptor_extension_nested = { {
@@ -90,6 +99,39 @@ descriptor_extension_nested = { {
     { 30, "F30", MESSAGE,  OPTIONAL, &descriptor }
   }, 1, } };
 
+/*
+ * Compare two values of the type of a field descriptor.
+ */
+START_TEST(test_compare) {
+  uint32_t u1 = 1, u2 = UINT32_MAX;
+  ck_assert_int_eq(-1, pb_field_descriptor_compare(
+    &(descriptor.field.data[0]), &u1, &u2));
+  int32_t s1 = -1, s2 = 1;
+  ck_assert_int_eq(-1, pb_field_descriptor_compare(
+    &(descriptor.field.data[2]), &s1, &s2));
+  int64_t l1 = 5, l2 = 5;
+  ck_assert_int_eq(0, pb_field_descriptor_compare(
+    &(descriptor.field.data[3]), &l1, &l2));
+  double d1 = 0.5, d2 = -0.5;
+  ck_assert_int_eq(1, pb_field_descriptor_compare(
+    &(descriptor.field.data[6]), &d1, &d2));
+} END_TEST
+
+/*
+ * Compare two strings with a field descriptor.
+ */
+START_TEST(test_compare_string) {
+  pb_string_t x = pb_string_init_from_chars("AB"),
+              y = pb_string_init_from_chars("ABC"),
+              z = pb_string_init_from_chars("B");
+  ck_assert_int_eq(-1, pb_field_descriptor_compare(
+    &(descriptor.field.data[7]), &x, &y));
+  ck_assert_int_eq(1, pb_field_descriptor_compare(
+    &(descriptor.field.data[7]), &z, &y));
+  ck_assert_int_eq(0, pb_field_descriptor_compare(
+    &(descriptor.field.data[7]), &x, &x));
+} END_TEST
+
 /* ------------------------------------------------------------------------- */
 
 /* Enum descriptor */
@@ -130,6 +172,7 @@ static void
 teardown() {
   pb_descriptor_reset(&descriptor);
   pb_descriptor_reset(&descriptor_extension);
+  pb_descriptor_reset(&descriptor_extension_nested);
 }
 
 /* ----------------------------------------------------------------------------
@@ -313,6 +356,79 @@ START_TEST(test_extend) {
     pb_descriptor_extension(&descriptor_extension_nested));
 } END_TEST
 
+/*
+ * Merge the fields of a descriptor and its extensions ordered by tag.
+ */
+START_TEST(test_extend_merged) {
+  ck_assert_ptr_eq(NULL, descriptor.table);
+
+  /* Extend descriptor twice */
+  pb_descriptor_extend(&descriptor, &descriptor_extension_nested);
+  pb_descriptor_extend(&descriptor, &descriptor_extension);
+  fail_unless(descriptor.table);
+  fail_unless(descriptor.table->previous);
+  ck_assert_ptr_eq(NULL, descriptor.table->previous->previous);
+  ck_assert_ptr_eq(&descriptor_extension, descriptor.table->last);
+
+  /* Assert merged field descriptors */
+  ck_assert_uint_eq(descriptor.field.size + 3, descriptor.table->size);
+  for (size_t f = 1; f < descriptor.table->size; ++f)
+    fail_unless(pb_field_descriptor_tag(descriptor.table->data[f - 1]) <
+                pb_field_descriptor_tag(descriptor.table->data[f]));
+  ck_assert_ptr_eq(&(descriptor_extension.field.data[1]),
+    descriptor.table->data[descriptor.table->size - 2]);
+  ck_assert_ptr_eq(&(descriptor_extension_nested.field.data[0]),
+    descriptor.table->data[descriptor.table->size - 1]);
+
+  /* Assert field retrieval */
+  ck_assert_ptr_eq(&(descriptor_extension.field.data[0]),
+    pb_descriptor_field_by_tag(&descriptor, 20));
+  ck_assert_ptr_eq(&(descriptor_extension_nested.field.data[0]),
+    pb_descriptor_field_by_tag(&descriptor, 30));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor, 25));
+} END_TEST
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Retrieve the bitmask of required fields of a descriptor.
+ */
+START_TEST(test_required) {
+  ck_assert_ptr_eq(NULL, descriptor_required.required);
+
+  /* Assert bitmask is built and published on the descriptor */
+  const uint64_t *mask = pb_descriptor_required(&descriptor_required);
+  fail_unless(mask);
+  ck_assert_uint_eq(5, mask[0]);
+  ck_assert_ptr_eq(mask, descriptor_required.required);
+  ck_assert_ptr_eq(mask, pb_descriptor_required(&descriptor_required));
+} END_TEST
+
+/*
+ * Retrieve a lazily built structure for a descriptor.
+ */
+static const void *
+cache_create(const void *descriptor) {
+  return descriptor;
+}
+
+/*
+ * Retrieve lazily built structures for colliding descriptors.
+ */
+START_TEST(test_cache_collision) {
+  static char data[17][16384];
+
+  /* Assert lookups are given up after a bounded number of probes */
+  for (size_t d = 0; d < 16; ++d)
+    ck_assert_ptr_eq(data[d], pb_descriptor_cache(data[d], cache_create));
+  ck_assert_ptr_eq(NULL, pb_descriptor_cache(data[16], cache_create));
+
+  /* Assert cached structures are returned */
+  for (size_t d = 0; d < 16; ++d)
+    ck_assert_ptr_eq(data[d], pb_descriptor_cache(data[d], cache_create));
+} END_TEST
+
 /* ------------------------------------------------------------------------- */
 
 /*
@@ -538,6 +654,23 @@ main(void) {
   tcase = tcase_create("extend");
   tcase_add_checked_fixture(tcase, setup, teardown);
   tcase_add_test(tcase, test_extend);
+  tcase_add_test(tcase, test_extend_merged);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "required" */
+  tcase = tcase_create("required");
+  tcase_add_test(tcase, test_required);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "cache" */
+  tcase = tcase_create("cache");
+  tcase_add_test(tcase, test_cache_collision);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "compare" */
+  tcase = tcase_create("compare");
+  tcase_add_test(tcase, test_compare);
+  tcase_add_test(tcase, test_compare_string);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "enum_iterator" */
@@ -33,6 +33,7 @@
 #include "core/common.h"
 #include "core/descriptor.h"
 #include "core/encoder.h"
+#include "core/iovec.h"
 
 /* ----------------------------------------------------------------------------
  * System-default allocator callback overrides
@@ -805,6 +806,125 @@ START_TEST(test_encode_32bit_invalid_resize) {
   pb_encoder_destroy(&encoder);
 } END_TEST
 
+/*
+ * Encode large strings by reference in scatter-gather mode.
+ */
+START_TEST(test_encode_iovec) {
+  pb_encoder_t encoder1 = pb_encoder_create_iovec(&descriptor, 8);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+
+  /* Encode values in both encoders */
+  const uint8_t data[] = "0123456789ABCDEF";
+  uint32_t    value1 = 127;
+  pb_string_t value2 = pb_string_init((uint8_t *)data, 16),
+              value3 = pb_string_init((uint8_t *)data, 3);
+  for (size_t e = 0; e < 2; e++) {
+    pb_encoder_t *encoder = e ? &encoder2 : &encoder1;
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(encoder, 1, &value1, 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(encoder, 9, &value2, 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(encoder, 8, &value3, 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(encoder, 9, &value2, 1));
+  }
+
+  /* Assert encoder sizes */
+  ck_assert_uint_eq(43, pb_encoder_size(&encoder1));
+  ck_assert_uint_eq(43, pb_encoder_size(&encoder2));
+  ck_assert_uint_eq(11, pb_buffer_size(pb_encoder_buffer(&encoder1)));
+
+  /* Create segmented buffer and assert segments */
+  pb_iovec_t iovec = pb_iovec_create_from_encoder(&encoder1);
+  fail_unless(pb_iovec_valid(&iovec));
+  ck_assert_uint_eq(43, pb_iovec_size(&iovec));
+  ck_assert_uint_eq(4, pb_iovec_count(&iovec));
+  ck_assert_ptr_eq(data, pb_iovec_segments(&iovec)[1].iov_base);
+  ck_assert_ptr_eq(data, pb_iovec_segments(&iovec)[3].iov_base);
+
+  /* Assert identical encoding */
+  uint8_t temp[43];
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&iovec, 0, temp, 43));
+  fail_if(memcmp(pb_buffer_data(pb_encoder_buffer(&encoder2)), temp, 43));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Encode messages containing references in scatter-gather mode.
+ */
+START_TEST(test_encode_iovec_message) {
+  pb_encoder_t encoder1 = pb_encoder_create_iovec(&descriptor, 8);
+  pb_encoder_t encoder2 = pb_encoder_create_iovec(&descriptor, 8);
+  pb_encoder_t encoder3 = pb_encoder_create(&descriptor);
+
+  /* Encode a value and a message */
+  const uint8_t data[] = "0123456789ABCDEF";
+  pb_string_t value = pb_string_init((uint8_t *)data, 16);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 9, &value, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 11, &encoder2, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 12, &encoder2, 1));
+
+  /* Encode message into encoder in copy mode, which flattens references */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder3, 11, &encoder2, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder3, 12, &encoder2, 1));
+  ck_assert_uint_eq(40, pb_buffer_size(pb_encoder_buffer(&encoder3)));
+
+  /* Create segmented buffer and assert segments */
+  pb_iovec_t iovec = pb_iovec_create_from_encoder(&encoder1);
+  fail_unless(pb_iovec_valid(&iovec));
+  ck_assert_uint_eq(40, pb_iovec_size(&iovec));
+  ck_assert_uint_eq(4, pb_iovec_count(&iovec));
+  ck_assert_ptr_eq(data, pb_iovec_segments(&iovec)[1].iov_base);
+  ck_assert_ptr_eq(data, pb_iovec_segments(&iovec)[3].iov_base);
+
+  /* Assert identical encoding */
+  uint8_t temp[40];
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&iovec, 0, temp, 40));
+  fail_if(memcmp(pb_buffer_data(pb_encoder_buffer(&encoder3)), temp, 40));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+  pb_encoder_destroy(&encoder3);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Create a segmented buffer from an empty or invalid encoder.
+ */
+START_TEST(test_encode_iovec_empty) {
+  pb_encoder_t encoder = pb_encoder_create_iovec(&descriptor, 8);
+
+  /* Create segmented buffer and assert size */
+  pb_iovec_t iovec = pb_iovec_create_from_encoder(&encoder);
+  fail_unless(pb_iovec_valid(&iovec));
+  fail_unless(pb_iovec_empty(&iovec));
+  ck_assert_uint_eq(0, pb_iovec_count(&iovec));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+  pb_encoder_destroy(&encoder);
+
+  /* Create segmented buffer from invalid encoder */
+  encoder = pb_encoder_create_invalid();
+  iovec   = pb_iovec_create_from_encoder(&encoder);
+  fail_if(pb_iovec_valid(&iovec));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
 /* ----------------------------------------------------------------------------
  * Program
  * ------------------------------------------------------------------------- */
@@ -854,6 +974,13 @@ main(void) {
   tcase_add_test(tcase, test_encode_32bit_invalid_resize);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "iovec" */
+  tcase = tcase_create("iovec");
+  tcase_add_test(tcase, test_encode_iovec);
+  tcase_add_test(tcase, test_encode_iovec_message);
+  tcase_add_test(tcase, test_encode_iovec_empty);
+  suite_add_tcase(suite, tcase);
+
   /* Create a test suite runner in no-fork mode */
   void *runner = srunner_create(suite);
   srunner_set_fork_status(runner, CK_NOFORK);
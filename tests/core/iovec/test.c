@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "core/common.h"
+#include "core/iovec.h"
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a segmented buffer.
+ */
+START_TEST(test_create) {
+  const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  const struct iovec segments[] = {
+    { (void *)data, 3 },
+    { (void *)&(data[3]), 5 }
+  };
+
+  /* Create segmented buffer */
+  pb_iovec_t iovec = pb_iovec_create(segments, 2);
+
+  /* Assert segmented buffer validity and error */
+  fail_unless(pb_iovec_valid(&iovec));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_error(&iovec));
+
+  /* Assert segmented buffer size and segments */
+  fail_if(pb_iovec_empty(&iovec));
+  ck_assert_uint_eq(8, pb_iovec_size(&iovec));
+  ck_assert_uint_eq(2, pb_iovec_count(&iovec));
+  ck_assert_ptr_ne(segments, pb_iovec_segments(&iovec));
+  ck_assert_ptr_eq(&(data[3]), pb_iovec_segments(&iovec)[1].iov_base);
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Create a segmented buffer with empty segments.
+ */
+START_TEST(test_create_empty) {
+  const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  const struct iovec segments[] = {
+    { (void *)data, 0 },
+    { (void *)data, 8 },
+    { NULL, 0 }
+  };
+
+  /* Create segmented buffer */
+  pb_iovec_t iovec = pb_iovec_create(segments, 3);
+
+  /* Assert segmented buffer validity and error */
+  fail_unless(pb_iovec_valid(&iovec));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_error(&iovec));
+
+  /* Assert segmented buffer size and segments */
+  ck_assert_uint_eq(8, pb_iovec_size(&iovec));
+  ck_assert_uint_eq(1, pb_iovec_count(&iovec));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+
+  /* Create segmented buffer without segments */
+  iovec = pb_iovec_create(NULL, 0);
+
+  /* Assert segmented buffer validity and size */
+  fail_unless(pb_iovec_valid(&iovec));
+  fail_unless(pb_iovec_empty(&iovec));
+  ck_assert_uint_eq(0, pb_iovec_count(&iovec));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Create a segmented buffer over a range of another segmented buffer.
+ */
+START_TEST(test_create_range) {
+  const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  const struct iovec segments[] = {
+    { (void *)data, 3 },
+    { (void *)&(data[3]), 2 },
+    { (void *)&(data[5]), 3 }
+  };
+
+  /* Create segmented buffer and range */
+  pb_iovec_t iovec = pb_iovec_create(segments, 3),
+             range = pb_iovec_create_range(&iovec, 2, 4);
+
+  /* Assert range validity and size */
+  fail_unless(pb_iovec_valid(&range));
+  ck_assert_uint_eq(4, pb_iovec_size(&range));
+  ck_assert_uint_eq(3, pb_iovec_count(&range));
+
+  /* Assert trimmed segments */
+  ck_assert_ptr_eq(&(data[2]), pb_iovec_segments(&range)[0].iov_base);
+  ck_assert_uint_eq(1, pb_iovec_segments(&range)[0].iov_len);
+  ck_assert_uint_eq(2, pb_iovec_segments(&range)[1].iov_len);
+  ck_assert_ptr_eq(&(data[5]), pb_iovec_segments(&range)[2].iov_base);
+  ck_assert_uint_eq(1, pb_iovec_segments(&range)[2].iov_len);
+
+  /* Read range and assert contents */
+  uint8_t temp[4];
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&range, 0, temp, 4));
+  fail_if(memcmp(&(data[2]), temp, 4));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&range);
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Create a segmented buffer over a range within a single segment.
+ */
+START_TEST(test_create_range_segment) {
+  const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  const struct iovec segments[] = {
+    { (void *)data, 3 },
+    { (void *)&(data[3]), 5 }
+  };
+
+  /* Create segmented buffer and range */
+  pb_iovec_t iovec = pb_iovec_create(segments, 2),
+             range = pb_iovec_create_range(&iovec, 4, 3);
+
+  /* Assert range validity and size */
+  fail_unless(pb_iovec_valid(&range));
+  ck_assert_uint_eq(3, pb_iovec_size(&range));
+  ck_assert_uint_eq(1, pb_iovec_count(&range));
+  ck_assert_ptr_eq(&(data[4]), pb_iovec_segments(&range)[0].iov_base);
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&range);
+
+  /* Create empty range */
+  range = pb_iovec_create_range(&iovec, 8, 0);
+  fail_unless(pb_iovec_valid(&range));
+  fail_unless(pb_iovec_empty(&range));
+  ck_assert_uint_eq(0, pb_iovec_count(&range));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&range);
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Create a segmented buffer over a range exceeding another segmented buffer.
+ */
+START_TEST(test_create_range_invalid) {
+  const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  const struct iovec segments[] = {
+    { (void *)data, 8 }
+  };
+
+  /* Create segmented buffer and range */
+  pb_iovec_t iovec = pb_iovec_create(segments, 1),
+             range = pb_iovec_create_range(&iovec, 4, 5);
+
+  /* Assert range validity and error */
+  fail_if(pb_iovec_valid(&range));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_iovec_error(&range));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&range);
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Read bytes straddling segments.
+ */
+START_TEST(test_read) {
+  const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  const struct iovec segments[] = {
+    { (void *)data, 3 },
+    { (void *)&(data[3]), 1 },
+    { (void *)&(data[4]), 4 }
+  };
+
+  /* Create segmented buffer */
+  pb_iovec_t iovec = pb_iovec_create(segments, 3);
+
+  /* Read bytes and assert contents */
+  uint8_t temp[8];
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&iovec, 0, temp, 8));
+  fail_if(memcmp(data, temp, 8));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&iovec, 2, temp, 3));
+  fail_if(memcmp(&(data[2]), temp, 3));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Read bytes beyond the end of a segmented buffer.
+ */
+START_TEST(test_read_underrun) {
+  const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  const struct iovec segments[] = {
+    { (void *)data, 8 }
+  };
+
+  /* Create segmented buffer */
+  pb_iovec_t iovec = pb_iovec_create(segments, 1);
+
+  /* Read bytes and assert error */
+  uint8_t temp[8];
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_iovec_read(&iovec, 4, temp, 5));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Read bytes from an invalid segmented buffer.
+ */
+START_TEST(test_read_invalid) {
+  pb_iovec_t iovec = pb_iovec_create_invalid();
+
+  /* Read bytes and assert error */
+  uint8_t temp[8];
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_iovec_read(&iovec, 0, temp, 1));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/iovec"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_empty);
+  tcase_add_test(tcase, test_create_range);
+  tcase_add_test(tcase, test_create_range_segment);
+  tcase_add_test(tcase, test_create_range_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "read" */
+  tcase = tcase_create("read");
+  tcase_add_test(tcase, test_read);
+  tcase_add_test(tcase, test_read_underrun);
+  tcase_add_test(tcase, test_read_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,453 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/parser.h"
+
+/* ----------------------------------------------------------------------------
+ * Parser callback
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Log of parser events.
+ */
+typedef struct log_t {
+  char text[512];                      /*!< Formatted events */
+  size_t size;                         /*!< Formatted events size */
+  const uint8_t *string;               /*!< Data of last string */
+} log_t;
+
+/*!
+ * Handler that formats all events into a log.
+ *
+ * \param[in]     event      Event
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ */
+static pb_error_t
+handler(
+    pb_parser_event_t event, const pb_field_descriptor_t *descriptor,
+    const void *value, void *user) {
+  assert(descriptor && user);
+  log_t *log = user;
+  char *text = &(log->text[log->size]);
+  size_t left = sizeof(log->text) - log->size;
+  pb_tag_t tag = pb_field_descriptor_tag(descriptor);
+  int size = 0;
+  switch (event) {
+    case PB_PARSER_EVENT_ENTER:
+      size = snprintf(text, left, "%u{", tag);
+      break;
+    case PB_PARSER_EVENT_LEAVE:
+      size = snprintf(text, left, "}%u;", tag);
+      break;
+    case PB_PARSER_EVENT_VALUE:
+      switch (pb_field_descriptor_type(descriptor)) {
+        case PB_TYPE_UINT32:
+        case PB_TYPE_FIXED32:
+          size = snprintf(text, left, "%u=%u;", tag,
+            *(const uint32_t *)value);
+          break;
+        case PB_TYPE_SINT64:
+          size = snprintf(text, left, "%u=%lld;", tag,
+            (long long)*(const int64_t *)value);
+          break;
+        case PB_TYPE_DOUBLE:
+          size = snprintf(text, left, "%u=%g;", tag,
+            *(const double *)value);
+          break;
+        case PB_TYPE_STRING:
+          log->string = pb_string_data(value);
+          size = snprintf(text, left, "%u=%.*s;", tag,
+            (int)pb_string_size(value), (const char *)pb_string_data(value));
+          break;
+        default:
+          break;
+      }
+      break;
+  }
+  log->size += size;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Handler that fails.
+ *
+ * \param[in]     event      Event
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ */
+static pb_error_t
+handler_fail(
+    pb_parser_event_t event, const pb_field_descriptor_t *descriptor,
+    const void *value, void *user) {
+  assert(descriptor);
+  return PB_ERROR_INVALID;
+}
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F02", SINT64,  OPTIONAL },
+    {  3, "F03", FIXED32, OPTIONAL },
+    {  4, "F04", DOUBLE,  OPTIONAL },
+    {  5, "F05", STRING,  OPTIONAL },
+    {  6, "F06", UINT32,  REPEATED, NULL, NULL, PACKED },
+    {  7, "F07", MESSAGE, OPTIONAL, &descriptor }
+  }, 7 } };
+
+/* ----------------------------------------------------------------------------
+ * Data
+ * ------------------------------------------------------------------------- */
+
+/* Encoded message with all kinds of fields and an unknown field */
+static const uint8_t
+message[] = {
+  8, 172, 2,                           /* F01 = 300 */
+  16, 1,                               /* F02 = -1 */
+  29, 7, 0, 0, 0,                      /* F03 = 7 */
+  33, 0, 0, 0, 0, 0, 0, 248, 63,       /* F04 = 1.5 */
+  42, 5, 'H', 'E', 'L', 'L', 'O',      /* F05 = "HELLO" */
+  120, 150, 1,                         /* F15 = 150 (unknown) */
+  50, 4, 1, 2, 172, 2,                 /* F06 = [1, 2, 300] */
+  58, 6, 8, 1, 42, 2, 'A', 'B',        /* F07 = { F01 = 1, F05 = "AB" } */
+  58, 0                                /* F07 = {} */
+};
+
+/* Expected log of parser events */
+static const char
+expected[] =
+  "1=300;2=-1;3=7;4=1.5;5=HELLO;6=1;6=2;6=300;7{1=1;5=AB;}7;7{}7;";
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a parser.
+ */
+START_TEST(test_create) {
+  log_t log = {};
+  pb_parser_t parser = pb_parser_create(&descriptor, handler, &log);
+
+  /* Assert parser validity and error */
+  fail_unless(pb_parser_valid(&parser));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_parser_error(&parser));
+
+  /* Assert parser descriptor, offset and depth */
+  ck_assert_ptr_eq(&descriptor, pb_parser_descriptor(&parser));
+  ck_assert_uint_eq(0, pb_parser_offset(&parser));
+  ck_assert_uint_eq(0, pb_parser_depth(&parser));
+
+  /* Free all allocated memory */
+  pb_parser_destroy(&parser);
+} END_TEST
+
+/*
+ * Feed a message in a single chunk.
+ */
+START_TEST(test_feed) {
+  log_t log = {};
+  pb_parser_t parser = pb_parser_create(&descriptor, handler, &log);
+
+  /* Feed message and finish */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_parser_feed(&parser, message, sizeof(message)));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_parser_finish(&parser));
+
+  /* Assert events and offset */
+  ck_assert_str_eq(expected, log.text);
+  ck_assert_uint_eq(sizeof(message), pb_parser_offset(&parser));
+
+  /* Free all allocated memory */
+  pb_parser_destroy(&parser);
+} END_TEST
+
+/*
+ * Feed a message in two chunks split at every possible position.
+ */
+START_TEST(test_feed_split) {
+  for (size_t s = 0; s <= sizeof(message); s++) {
+    log_t log = {};
+    pb_parser_t parser = pb_parser_create(&descriptor, handler, &log);
+
+    /* Feed message in two chunks and finish */
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_parser_feed(&parser, message, s));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_parser_feed(&parser, &(message[s]), sizeof(message) - s));
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_parser_finish(&parser));
+
+    /* Assert events */
+    ck_assert_str_eq(expected, log.text);
+
+    /* Free all allocated memory */
+    pb_parser_destroy(&parser);
+  }
+} END_TEST
+
+/*
+ * Feed a message byte by byte.
+ */
+START_TEST(test_feed_bytewise) {
+  log_t log = {};
+  pb_parser_t parser = pb_parser_create(&descriptor, handler, &log);
+
+  /* Feed message byte by byte and finish */
+  for (size_t b = 0; b < sizeof(message); b++)
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_parser_feed(&parser, &(message[b]), 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_parser_finish(&parser));
+
+  /* Assert events */
+  ck_assert_str_eq(expected, log.text);
+
+  /* Free all allocated memory */
+  pb_parser_destroy(&parser);
+} END_TEST
+
+/*
+ * Feed a message and ensure that only straddling strings are copied.
+ */
+START_TEST(test_feed_string) {
+  log_t log = {};
+  pb_parser_t parser = pb_parser_create(&descriptor, handler, &log);
+
+  /* Feed string in a single chunk */
+  const uint8_t data[] = { 42, 2, 'A', 'B' };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_parser_feed(&parser, data, 4));
+  ck_assert_ptr_eq(&(data[2]), log.string);
+
+  /* Feed string in two chunks */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_parser_feed(&parser, data, 3));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_parser_feed(&parser, &(data[3]), 1));
+  ck_assert_ptr_ne(&(data[2]), log.string);
+  ck_assert_ptr_ne(&(data[3]), log.string);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_parser_finish(&parser));
+
+  /* Assert events */
+  ck_assert_str_eq("5=AB;5=AB;", log.text);
+
+  /* Free all allocated memory */
+  pb_parser_destroy(&parser);
+} END_TEST
+
+/*
+ * Feed a message with nested messages and track the nesting depth.
+ */
+START_TEST(test_feed_nested) {
+  const uint8_t data[] = { 58, 4, 58, 2, 8, 1 };
+  const size_t  size   = 6;
+
+  /* Create parser */
+  log_t log = {};
+  pb_parser_t parser = pb_parser_create(&descriptor, handler, &log);
+
+  /* Feed message and assert depth */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_parser_feed(&parser, data, 4));
+  ck_assert_uint_eq(2, pb_parser_depth(&parser));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_parser_feed(&parser, &(data[4]), 1));
+  ck_assert_uint_eq(2, pb_parser_depth(&parser));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_parser_feed(&parser, &(data[5]), 1));
+  ck_assert_uint_eq(0, pb_parser_depth(&parser));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_parser_finish(&parser));
+
+  /* Assert events */
+  ck_assert_uint_eq(size, pb_parser_offset(&parser));
+  ck_assert_str_eq("7{7{1=1;}7;}7;", log.text);
+
+  /* Free all allocated memory */
+  pb_parser_destroy(&parser);
+} END_TEST
+
+/*
+ * Feed a message with an invalid variable-sized integer.
+ */
+START_TEST(test_feed_invalid_varint) {
+  const uint8_t data[] = { 8, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+                           255, 255 };
+  const size_t  size   = 12;
+
+  /* Create parser */
+  log_t log = {};
+  pb_parser_t parser = pb_parser_create(&descriptor, handler, &log);
+
+  /* Feed message and assert error */
+  ck_assert_uint_eq(PB_ERROR_VARINT, pb_parser_feed(&parser, data, size));
+  fail_if(pb_parser_valid(&parser));
+  ck_assert_uint_eq(PB_ERROR_VARINT, pb_parser_error(&parser));
+
+  /* Assert parser refuses further data */
+  ck_assert_uint_eq(PB_ERROR_VARINT, pb_parser_feed(&parser, data, 1));
+  ck_assert_uint_eq(PB_ERROR_VARINT, pb_parser_finish(&parser));
+
+  /* Free all allocated memory */
+  pb_parser_destroy(&parser);
+} END_TEST
+
+/*
+ * Feed a message with a field exceeding its enclosing message.
+ */
+START_TEST(test_feed_invalid_offset) {
+  const uint8_t data[] = { 58, 2, 42, 3, 'A', 'B', 'C' };
+  const size_t  size   = 7;
+
+  /* Create parser */
+  log_t log = {};
+  pb_parser_t parser = pb_parser_create(&descriptor, handler, &log);
+
+  /* Feed message and assert error */
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_parser_feed(&parser, data, size));
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_parser_error(&parser));
+
+  /* Free all allocated memory */
+  pb_parser_destroy(&parser);
+} END_TEST
+
+/*
+ * Feed a message with an invalid wiretype.
+ */
+START_TEST(test_feed_invalid_wiretype) {
+  const uint8_t data[] = { 11 };
+  const size_t  size   = 1;
+
+  /* Create parser */
+  log_t log = {};
+  pb_parser_t parser = pb_parser_create(&descriptor, handler, &log);
+
+  /* Feed message and assert error */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_parser_feed(&parser, data, size));
+
+  /* Free all allocated memory */
+  pb_parser_destroy(&parser);
+} END_TEST
+
+/*
+ * Feed a message to a parser with a failing handler.
+ */
+START_TEST(test_feed_invalid_handler) {
+  log_t log = {};
+  pb_parser_t parser = pb_parser_create(&descriptor, handler_fail, &log);
+
+  /* Feed message and assert error */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_parser_feed(&parser, message, sizeof(message)));
+
+  /* Free all allocated memory */
+  pb_parser_destroy(&parser);
+} END_TEST
+
+/*
+ * Finish a parser in the middle of a message.
+ */
+START_TEST(test_finish_invalid) {
+  for (size_t s = 1; s < sizeof(message); s++) {
+    log_t log = {};
+    pb_parser_t parser = pb_parser_create(&descriptor, handler, &log);
+
+    /* Feed message partially */
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_parser_feed(&parser, message, s));
+
+    /* Assert error if not at a field boundary of the outermost message */
+    pb_error_t error = pb_parser_finish(&parser);
+    if (error)
+      ck_assert_uint_eq(PB_ERROR_OFFSET, error);
+    else
+      ck_assert_uint_eq(0, pb_parser_depth(&parser));
+
+    /* Free all allocated memory */
+    pb_parser_destroy(&parser);
+  }
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/parser"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "feed" */
+  tcase = tcase_create("feed");
+  tcase_add_test(tcase, test_feed);
+  tcase_add_test(tcase, test_feed_split);
+  tcase_add_test(tcase, test_feed_bytewise);
+  tcase_add_test(tcase, test_feed_string);
+  tcase_add_test(tcase, test_feed_nested);
+  tcase_add_test(tcase, test_feed_invalid_varint);
+  tcase_add_test(tcase, test_feed_invalid_offset);
+  tcase_add_test(tcase, test_feed_invalid_wiretype);
+  tcase_add_test(tcase, test_feed_invalid_handler);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "finish" */
+  tcase = tcase_create("finish");
+  tcase_add_test(tcase, test_finish_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
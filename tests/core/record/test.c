@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/record.h"
+
+/* ----------------------------------------------------------------------------
+ * Decoder callback
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Field handler that sums up values.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ */
+static pb_error_t
+handler(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  assert(descriptor && value && user);
+  *(uint32_t *)user += *(const uint32_t *)value;
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL }
+  }, 1 } };
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a record iterator over a buffer.
+ */
+START_TEST(test_create) {
+  const uint8_t data[] = { 2, 8, 1, 0, 2, 8, 2 };
+  const size_t  size   = 7;
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create(data, size);
+  pb_record_iter_t iter   = pb_record_iter_create(&buffer);
+
+  /* Assert record iterator validity and error */
+  fail_unless(pb_record_iter_valid(&iter));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_record_iter_error(&iter));
+
+  /* Assert record iterator offset and record */
+  ck_assert_uint_eq(0, pb_record_iter_offset(&iter));
+  ck_assert_uint_eq(2, pb_buffer_size(pb_record_iter_buffer(&iter)));
+  ck_assert_ptr_eq(pb_buffer_data(&buffer) + 1,
+    pb_buffer_data(pb_record_iter_buffer(&iter)));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a record iterator over a buffer at a given offset.
+ */
+START_TEST(test_create_at) {
+  const uint8_t data[] = { 2, 8, 1, 0, 2, 8, 2 };
+  const size_t  size   = 7;
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create(data, size);
+  pb_record_iter_t iter   = pb_record_iter_create_at(&buffer, 4);
+
+  /* Assert record iterator validity and error */
+  fail_unless(pb_record_iter_valid(&iter));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_record_iter_error(&iter));
+
+  /* Assert record iterator offset and record */
+  ck_assert_uint_eq(4, pb_record_iter_offset(&iter));
+  ck_assert_uint_eq(2, pb_buffer_size(pb_record_iter_buffer(&iter)));
+
+  /* Assert end of records */
+  fail_if(pb_record_iter_next(&iter));
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_record_iter_error(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a record iterator over a range of a buffer.
+ */
+START_TEST(test_create_range) {
+  const uint8_t data[] = { 2, 8, 1, 0, 2, 8, 2 };
+  const size_t  size   = 7;
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create(data, size);
+  pb_record_iter_t iter   = pb_record_iter_create_range(&buffer, 0, 4);
+
+  /* Assert record iterator validity and error */
+  fail_unless(pb_record_iter_valid(&iter));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_record_iter_error(&iter));
+
+  /* Assert records within range */
+  fail_unless(pb_record_iter_next(&iter));
+  ck_assert_uint_eq(3, pb_record_iter_offset(&iter));
+  fail_if(pb_record_iter_next(&iter));
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_record_iter_error(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a record iterator over a range cutting through a record.
+ */
+START_TEST(test_create_range_invalid) {
+  const uint8_t data[] = { 2, 8, 1, 0, 2, 8, 2 };
+  const size_t  size   = 7;
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create(data, size);
+  pb_record_iter_t iter   = pb_record_iter_create_range(&buffer, 0, 2);
+
+  /* Assert record iterator validity and error */
+  fail_if(pb_record_iter_valid(&iter));
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_record_iter_error(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a record iterator over an empty buffer.
+ */
+START_TEST(test_create_empty) {
+  pb_buffer_t      buffer = pb_buffer_create_empty();
+  pb_record_iter_t iter   = pb_record_iter_create(&buffer);
+
+  /* Assert record iterator validity and error */
+  fail_if(pb_record_iter_valid(&iter));
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_record_iter_error(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a record iterator over an invalid buffer.
+ */
+START_TEST(test_create_invalid) {
+  pb_buffer_t      buffer = pb_buffer_create_invalid();
+  pb_record_iter_t iter   = pb_record_iter_create(&buffer);
+
+  /* Assert record iterator validity and error */
+  fail_if(pb_record_iter_valid(&iter));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_record_iter_error(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a record iterator over a buffer with an invalid offset.
+ */
+START_TEST(test_create_invalid_offset) {
+  const uint8_t data[] = { 2, 8, 1 };
+  const size_t  size   = 3;
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create(data, size);
+  pb_record_iter_t iter   = pb_record_iter_create_at(&buffer, 4);
+
+  /* Assert record iterator validity and error */
+  fail_if(pb_record_iter_valid(&iter));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_record_iter_error(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Iterate all records of a buffer, including empty records.
+ */
+START_TEST(test_next) {
+  const uint8_t data[] = { 2, 8, 1, 0, 2, 8, 2 };
+  const size_t  size   = 7;
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create(data, size);
+  pb_record_iter_t iter   = pb_record_iter_create(&buffer);
+
+  /* Assert record sizes and offsets */
+  const size_t sizes[]   = { 2, 0, 2 };
+  const size_t offsets[] = { 0, 3, 4 };
+  size_t records = 0;
+  do {
+    ck_assert_uint_eq(offsets[records], pb_record_iter_offset(&iter));
+    ck_assert_uint_eq(sizes[records],
+      pb_buffer_size(pb_record_iter_buffer(&iter)));
+    records++;
+  } while (pb_record_iter_next(&iter));
+  ck_assert_uint_eq(3, records);
+
+  /* Assert record iterator validity and error */
+  fail_if(pb_record_iter_valid(&iter));
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_record_iter_error(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Iterate the records of a buffer with a truncated record.
+ */
+START_TEST(test_next_invalid_offset) {
+  const uint8_t data[] = { 2, 8, 1, 4, 8, 2 };
+  const size_t  size   = 6;
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create(data, size);
+  pb_record_iter_t iter   = pb_record_iter_create(&buffer);
+
+  /* Assert record iterator validity and error */
+  fail_unless(pb_record_iter_valid(&iter));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_record_iter_error(&iter));
+
+  /* Assert truncated record */
+  fail_if(pb_record_iter_next(&iter));
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_record_iter_error(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Iterate the records of a buffer with an invalid length prefix.
+ */
+START_TEST(test_next_invalid_varint) {
+  const uint8_t data[] = { 2, 8, 1, 255, 255 };
+  const size_t  size   = 5;
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create(data, size);
+  pb_record_iter_t iter   = pb_record_iter_create(&buffer);
+
+  /* Assert truncated length prefix */
+  fail_if(pb_record_iter_next(&iter));
+  ck_assert_uint_eq(PB_ERROR_VARINT, pb_record_iter_error(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode all records of a buffer.
+ */
+START_TEST(test_decoder) {
+  const uint8_t data[] = { 2, 8, 1, 0, 2, 8, 2, 4, 8, 3, 8, 4 };
+  const size_t  size   = 12;
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create(data, size);
+  pb_record_iter_t iter   = pb_record_iter_create(&buffer);
+
+  /* Decode all records */
+  uint32_t sum = 0;
+  do {
+    pb_decoder_t decoder = pb_record_iter_decoder(&iter, &descriptor);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_decoder_decode(&decoder, handler, &sum));
+    pb_decoder_destroy(&decoder);
+  } while (pb_record_iter_next(&iter));
+
+  /* Assert sum of values */
+  ck_assert_uint_eq(10, sum);
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode all records of a memory-mapped buffer.
+ */
+START_TEST(test_decoder_mmap) {
+  const uint8_t data[] = { 2, 8, 1, 0, 2, 8, 2, 4, 8, 3, 8, 4 };
+  const size_t  size   = 12;
+
+  /* Write data to file */
+  FILE *file = fopen("core-record.mmap", "wb");
+  ck_assert_ptr_ne(NULL, file);
+  ck_assert_uint_eq(size, fwrite(data, 1, size, file));
+  fclose(file);
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create_mmap("core-record.mmap");
+  pb_record_iter_t iter   = pb_record_iter_create(&buffer);
+
+  /* Decode all records */
+  uint32_t sum = 0;
+  do {
+    pb_decoder_t decoder = pb_record_iter_decoder(&iter, &descriptor);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_decoder_decode(&decoder, handler, &sum));
+    pb_decoder_destroy(&decoder);
+  } while (pb_record_iter_next(&iter));
+
+  /* Assert sum of values */
+  ck_assert_uint_eq(10, sum);
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_record_iter_error(&iter));
+
+  /* Free all allocated memory */
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+  remove("core-record.mmap");
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/record"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_at);
+  tcase_add_test(tcase, test_create_range);
+  tcase_add_test(tcase, test_create_range_invalid);
+  tcase_add_test(tcase, test_create_empty);
+  tcase_add_test(tcase, test_create_invalid);
+  tcase_add_test(tcase, test_create_invalid_offset);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "next" */
+  tcase = tcase_create("next");
+  tcase_add_test(tcase, test_next);
+  tcase_add_test(tcase, test_next_invalid_offset);
+  tcase_add_test(tcase, test_next_invalid_varint);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "decoder" */
+  tcase = tcase_create("decoder");
+  tcase_add_test(tcase, test_decoder);
+  tcase_add_test(tcase, test_decoder_mmap);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,546 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/iovec.h"
+#include "core/rewriter.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F02", SINT64,  OPTIONAL },
+    {  3, "F03", FLOAT,   OPTIONAL },
+    {  8, "F08", STRING,  OPTIONAL },
+    { 11, "F11", MESSAGE, OPTIONAL, &descriptor },
+    { 12, "F12", MESSAGE, REPEATED, &descriptor }
+  }, 6 } };
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a rewriter.
+ */
+START_TEST(test_create) {
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Assert rewriter validity and error */
+  fail_unless(pb_rewriter_valid(&rewriter));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_rewriter_error(&rewriter));
+
+  /* Assert rewriter descriptor and size */
+  ck_assert_ptr_eq(&descriptor, pb_rewriter_descriptor(&rewriter));
+  ck_assert_uint_eq(0, pb_rewriter_size(&rewriter));
+  ck_assert_uint_eq(0, pb_rewriter_references_count(&rewriter));
+
+  /* Free all allocated memory */
+  pb_rewriter_destroy(&rewriter);
+} END_TEST
+
+/*
+ * Rewrite a field of a message.
+ */
+START_TEST(test_rewrite) {
+  const uint8_t data[] = { 8, 1, 66, 3, 'A', 'B', 'C', 90, 2, 8, 5 };
+  const uint8_t check[] = { 8, 172, 2 };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 11);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Rewrite field */
+  uint32_t value = 300;
+  pb_rewriter_edit_t edits[] = {
+    { { (const pb_tag_t []){ 1 }, 1 }, &value }
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_rewriter_rewrite(&rewriter, &buffer, edits, 1));
+
+  /* Assert regenerated field and referenced remainder */
+  ck_assert_uint_eq(12, pb_rewriter_size(&rewriter));
+  ck_assert_uint_eq(3, pb_buffer_size(pb_rewriter_buffer(&rewriter)));
+  fail_if(memcmp(check, pb_buffer_data(pb_rewriter_buffer(&rewriter)), 3));
+  ck_assert_uint_eq(1, pb_rewriter_references_count(&rewriter));
+  ck_assert_uint_eq(3, pb_rewriter_references(&rewriter)[0].offset);
+  ck_assert_ptr_eq(&(data[2]), pb_rewriter_references(&rewriter)[0].data);
+  ck_assert_uint_eq(9, pb_rewriter_references(&rewriter)[0].size);
+
+  /* Free all allocated memory */
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Rewrite a message without edits.
+ */
+START_TEST(test_rewrite_empty) {
+  const uint8_t data[] = { 8, 1, 66, 3, 'A', 'B', 'C', 90, 2, 8, 5 };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 11);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Rewrite message and assert that it's referenced as a whole */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_rewriter_rewrite(&rewriter, &buffer, NULL, 0));
+  ck_assert_uint_eq(11, pb_rewriter_size(&rewriter));
+  ck_assert_uint_eq(0, pb_buffer_size(pb_rewriter_buffer(&rewriter)));
+  ck_assert_uint_eq(1, pb_rewriter_references_count(&rewriter));
+  ck_assert_ptr_eq(data, pb_rewriter_references(&rewriter)[0].data);
+
+  /* Free all allocated memory */
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Rewrite several fields of a message.
+ */
+START_TEST(test_rewrite_multiple) {
+  const uint8_t data[] = { 8, 1, 16, 1, 8, 2, 66, 3, 'A', 'B', 'C' };
+  const uint8_t check[] = {
+    16, 1, 8, 3, 66, 3, 'A', 'B', 'C', 29, 0, 0, 128, 63 };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 11);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Rewrite fields, dropping earlier occurrences and appending missing ones */
+  uint32_t value1 = 3;
+  float    value2 = 1.0f;
+  pb_rewriter_edit_t edits[] = {
+    { { (const pb_tag_t []){ 3 }, 1 }, &value2 },
+    { { (const pb_tag_t []){ 1 }, 1 }, &value1 }
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_rewriter_rewrite(&rewriter, &buffer, edits, 2));
+
+  /* Create segmented buffer and assert contents */
+  pb_iovec_t iovec = pb_iovec_create_from_rewriter(&rewriter);
+  fail_unless(pb_iovec_valid(&iovec));
+  ck_assert_uint_eq(14, pb_iovec_size(&iovec));
+
+  /* Read segmented buffer and assert contents */
+  uint8_t temp[14];
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&iovec, 0, temp, 14));
+  fail_if(memcmp(check, temp, 14));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Rewrite a message, removing a field.
+ */
+START_TEST(test_rewrite_remove) {
+  const uint8_t data[] = { 8, 1, 66, 3, 'A', 'B', 'C', 90, 2, 8, 5 };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 11);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Remove field */
+  pb_rewriter_edit_t edits[] = {
+    { { (const pb_tag_t []){ 8 }, 1 }, NULL }
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_rewriter_rewrite(&rewriter, &buffer, edits, 1));
+
+  /* Assert that surrounding regions are referenced in place */
+  ck_assert_uint_eq(6, pb_rewriter_size(&rewriter));
+  ck_assert_uint_eq(0, pb_buffer_size(pb_rewriter_buffer(&rewriter)));
+  ck_assert_uint_eq(2, pb_rewriter_references_count(&rewriter));
+  ck_assert_ptr_eq(&(data[0]), pb_rewriter_references(&rewriter)[0].data);
+  ck_assert_uint_eq(2, pb_rewriter_references(&rewriter)[0].size);
+  ck_assert_ptr_eq(&(data[7]), pb_rewriter_references(&rewriter)[1].data);
+  ck_assert_uint_eq(4, pb_rewriter_references(&rewriter)[1].size);
+
+  /* Free all allocated memory */
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Rewrite a field of a submessage.
+ */
+START_TEST(test_rewrite_nested) {
+  const uint8_t data[] = { 8, 1, 66, 3, 'A', 'B', 'C', 90, 2, 8, 5 };
+  const uint8_t check[] = {
+    8, 1, 66, 3, 'A', 'B', 'C', 90, 9, 8, 5,
+    66, 5, 'D', 'E', 'F', 'G', 'H' };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 11);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Rewrite field of submessage */
+  pb_string_t value = pb_string_init_from_chars("DEFGH");
+  pb_rewriter_edit_t edits[] = {
+    { { (const pb_tag_t []){ 11, 8 }, 2 }, &value }
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_rewriter_rewrite(&rewriter, &buffer, edits, 1));
+
+  /* Assert that only headers were regenerated */
+  ck_assert_uint_eq(18, pb_rewriter_size(&rewriter));
+  ck_assert_uint_eq(3, pb_buffer_size(pb_rewriter_buffer(&rewriter)));
+  ck_assert_uint_eq(3, pb_rewriter_references_count(&rewriter));
+  ck_assert_ptr_eq(pb_string_data(&value),
+    pb_rewriter_references(&rewriter)[2].data);
+
+  /* Create segmented buffer and assert contents */
+  pb_iovec_t iovec = pb_iovec_create_from_rewriter(&rewriter);
+  fail_unless(pb_iovec_valid(&iovec));
+  ck_assert_uint_eq(18, pb_iovec_size(&iovec));
+  ck_assert_uint_eq(5, pb_iovec_count(&iovec));
+
+  /* Read segmented buffer and assert contents */
+  uint8_t temp[18];
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&iovec, 0, temp, 18));
+  fail_if(memcmp(check, temp, 18));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Rewrite a field of a submessage which doesn't occur in the message.
+ */
+START_TEST(test_rewrite_nested_absent) {
+  const uint8_t data[] = { 8, 1 };
+  const uint8_t check[] = { 8, 1, 90, 4, 90, 2, 16, 3 };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 2);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Rewrite field of nested submessage */
+  int64_t value = -2;
+  pb_rewriter_edit_t edits[] = {
+    { { (const pb_tag_t []){ 11, 11, 2 }, 3 }, &value }
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_rewriter_rewrite(&rewriter, &buffer, edits, 1));
+
+  /* Create segmented buffer and assert contents */
+  pb_iovec_t iovec = pb_iovec_create_from_rewriter(&rewriter);
+  fail_unless(pb_iovec_valid(&iovec));
+  ck_assert_uint_eq(8, pb_iovec_size(&iovec));
+
+  /* Read segmented buffer and assert contents */
+  uint8_t temp[8];
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&iovec, 0, temp, 8));
+  fail_if(memcmp(check, temp, 8));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Remove a field of a submessage which doesn't occur in the message.
+ */
+START_TEST(test_rewrite_nested_absent_remove) {
+  const uint8_t data[] = { 8, 1 };
+  const uint8_t check[] = { 8, 1 };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 2);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Rewrite field of submessage */
+  pb_rewriter_edit_t edits[] = {
+    { { (const pb_tag_t []){ 11, 1 }, 2 }, NULL }
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_rewriter_rewrite(&rewriter, &buffer, edits, 1));
+
+  /* Create segmented buffer and assert contents */
+  pb_iovec_t iovec = pb_iovec_create_from_rewriter(&rewriter);
+  fail_unless(pb_iovec_valid(&iovec));
+  ck_assert_uint_eq(2, pb_iovec_size(&iovec));
+
+  /* Read segmented buffer and assert contents */
+  uint8_t temp[2];
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&iovec, 0, temp, 2));
+  fail_if(memcmp(check, temp, 2));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Rewrite a field of a submessage which occurs more than once.
+ */
+START_TEST(test_rewrite_nested_split) {
+  const uint8_t data[] = { 90, 2, 8, 5, 90, 0 };
+  const uint8_t check[] = { 90, 0, 90, 2, 8, 7 };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 6);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Rewrite field of submessage */
+  uint32_t value = 7;
+  pb_rewriter_edit_t edits[] = {
+    { { (const pb_tag_t []){ 11, 1 }, 2 }, &value }
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_rewriter_rewrite(&rewriter, &buffer, edits, 1));
+
+  /* Create segmented buffer and assert contents */
+  pb_iovec_t iovec = pb_iovec_create_from_rewriter(&rewriter);
+  fail_unless(pb_iovec_valid(&iovec));
+  ck_assert_uint_eq(6, pb_iovec_size(&iovec));
+
+  /* Read segmented buffer and assert contents */
+  uint8_t temp[6];
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&iovec, 0, temp, 6));
+  fail_if(memcmp(check, temp, 6));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Remove a field of a submessage which occurs more than once.
+ */
+START_TEST(test_rewrite_nested_split_remove) {
+  const uint8_t data[] = { 90, 2, 8, 5, 90, 0 };
+  const uint8_t check[] = { 90, 0, 90, 0 };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 6);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Rewrite field of submessage */
+  pb_rewriter_edit_t edits[] = {
+    { { (const pb_tag_t []){ 11, 1 }, 2 }, NULL }
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_rewriter_rewrite(&rewriter, &buffer, edits, 1));
+
+  /* Create segmented buffer and assert contents */
+  pb_iovec_t iovec = pb_iovec_create_from_rewriter(&rewriter);
+  fail_unless(pb_iovec_valid(&iovec));
+  ck_assert_uint_eq(4, pb_iovec_size(&iovec));
+
+  /* Read segmented buffer and assert contents */
+  uint8_t temp[4];
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_iovec_read(&iovec, 0, temp, 4));
+  fail_if(memcmp(check, temp, 4));
+
+  /* Free all allocated memory */
+  pb_iovec_destroy(&iovec);
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Rewrite a message with invalid edits.
+ */
+START_TEST(test_rewrite_invalid) {
+  const uint8_t data[] = { 8, 1, 66, 3, 'A', 'B', 'C', 90, 2, 8, 5 };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 11);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Rewrite message without edits to assert that it's discarded on error */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_rewriter_rewrite(&rewriter, &buffer, NULL, 0));
+
+  /* Edits with empty path, zero tag and unknown tag */
+  uint32_t value = 1;
+  pb_rewriter_edit_t edits1[] = {
+    { { (const pb_tag_t []){ 1 }, 0 }, &value }
+  };
+  pb_rewriter_edit_t edits2[] = {
+    { { (const pb_tag_t []){ 11, 0 }, 2 }, &value }
+  };
+  pb_rewriter_edit_t edits3[] = {
+    { { (const pb_tag_t []){ 11, 4 }, 2 }, &value }
+  };
+
+  /* Edits with conflicting paths */
+  pb_rewriter_edit_t edits4[] = {
+    { { (const pb_tag_t []){ 1 }, 1 }, &value },
+    { { (const pb_tag_t []){ 1 }, 1 }, NULL }
+  };
+  pb_rewriter_edit_t edits5[] = {
+    { { (const pb_tag_t []){ 11, 1 }, 2 }, &value },
+    { { (const pb_tag_t []){ 11 }, 1 }, NULL }
+  };
+
+  /* Edits of submessages, repeated fields and fields of scalars */
+  pb_rewriter_edit_t edits6[] = {
+    { { (const pb_tag_t []){ 11 }, 1 }, &value }
+  };
+  pb_rewriter_edit_t edits7[] = {
+    { { (const pb_tag_t []){ 12, 1 }, 2 }, &value }
+  };
+  pb_rewriter_edit_t edits8[] = {
+    { { (const pb_tag_t []){ 1, 1 }, 2 }, &value }
+  };
+
+  /* Assert rewriter errors */
+  const pb_rewriter_edit_t *edits[] = {
+    edits1, edits2, edits3, edits4, edits5, edits6, edits7, edits8
+  };
+  const size_t sizes[] = { 1, 1, 1, 2, 2, 1, 1, 1 };
+  for (size_t e = 0; e < 8; e++) {
+    ck_assert_uint_eq(PB_ERROR_INVALID,
+      pb_rewriter_rewrite(&rewriter, &buffer, edits[e], sizes[e]));
+    ck_assert_uint_eq(0, pb_rewriter_size(&rewriter));
+    ck_assert_uint_eq(0, pb_rewriter_references_count(&rewriter));
+  }
+
+  /* Free all allocated memory */
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Rewrite a malformed message.
+ */
+START_TEST(test_rewrite_malformed) {
+  const uint8_t data[] = { 8, 1, 66, 4, 'A', 'B', 'C' };
+
+  /* Create buffer and rewriter */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 7);
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Rewrite field of malformed message */
+  uint32_t value = 1;
+  pb_rewriter_edit_t edits[] = {
+    { { (const pb_tag_t []){ 1 }, 1 }, &value }
+  };
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_rewriter_rewrite(&rewriter, &buffer, edits, 1));
+
+  /* Rewrite message with truncated varint */
+  pb_buffer_destroy(&buffer);
+  buffer = pb_buffer_create_zero_copy((uint8_t *)data, 1);
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_rewriter_rewrite(&rewriter, &buffer, edits, 1));
+
+  /* Free all allocated memory */
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Rewrite an invalid buffer.
+ */
+START_TEST(test_rewrite_invalid_buffer) {
+  pb_buffer_t buffer = pb_buffer_create_invalid();
+  pb_rewriter_t rewriter = pb_rewriter_create(&descriptor);
+
+  /* Assert rewriter error */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_rewriter_rewrite(&rewriter, &buffer, NULL, 0));
+
+  /* Assert segmented buffer of invalid rewriter */
+  pb_rewriter_t invalid = pb_rewriter_create_invalid();
+  pb_iovec_t iovec = pb_iovec_create_from_rewriter(&invalid);
+  fail_if(pb_iovec_valid(&iovec));
+
+  /* Free all allocated memory */
+  pb_rewriter_destroy(&invalid);
+  pb_rewriter_destroy(&rewriter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/rewriter"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "rewrite" */
+  tcase = tcase_create("rewrite");
+  tcase_add_test(tcase, test_rewrite);
+  tcase_add_test(tcase, test_rewrite_empty);
+  tcase_add_test(tcase, test_rewrite_multiple);
+  tcase_add_test(tcase, test_rewrite_remove);
+  tcase_add_test(tcase, test_rewrite_nested);
+  tcase_add_test(tcase, test_rewrite_nested_absent);
+  tcase_add_test(tcase, test_rewrite_nested_absent_remove);
+  tcase_add_test(tcase, test_rewrite_nested_split);
+  tcase_add_test(tcase, test_rewrite_nested_split_remove);
+  tcase_add_test(tcase, test_rewrite_invalid);
+  tcase_add_test(tcase, test_rewrite_malformed);
+  tcase_add_test(tcase, test_rewrite_invalid_buffer);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -23,9 +23,12 @@
 #include <check.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "core/allocator.h"
 #include "core/buffer.h"
 #include "core/common.h"
+#include "core/iovec.h"
 #include "core/stream.h"
 
 /* ----------------------------------------------------------------------------
@@ -923,6 +926,412 @@ START_TEST(test_skip_32bit_underrun) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Read the fields of a stream.
+ */
+START_TEST(test_next) {
+  const uint8_t data[] = { 8, 150, 1, 18, 2, 'A', 'B', 29, 1, 2, 3, 4 };
+  const size_t  size   = 12;
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Read varint field */
+  pb_stream_field_t field;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_stream_next(&stream, &field));
+  ck_assert_uint_eq(1, field.tag);
+  ck_assert_uint_eq(PB_WIRETYPE_VARINT, field.wiretype);
+  ck_assert_uint_eq(0, field.start);
+  ck_assert_uint_eq(1, field.header);
+  ck_assert_uint_eq(1, field.value);
+  ck_assert_uint_eq(3, field.end);
+
+  /* Read length-prefixed field */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_stream_next(&stream, &field));
+  ck_assert_uint_eq(2, field.tag);
+  ck_assert_uint_eq(PB_WIRETYPE_LENGTH, field.wiretype);
+  ck_assert_uint_eq(3, field.start);
+  ck_assert_uint_eq(4, field.header);
+  ck_assert_uint_eq(5, field.value);
+  ck_assert_uint_eq(7, field.end);
+
+  /* Read fixed-sized field */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_stream_next(&stream, &field));
+  ck_assert_uint_eq(3, field.tag);
+  ck_assert_uint_eq(PB_WIRETYPE_32BIT, field.wiretype);
+  ck_assert_uint_eq(8, field.value);
+  ck_assert_uint_eq(12, field.end);
+  ck_assert_uint_eq(0, pb_stream_left(&stream));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Read a field with an invalid tag or wiretype from a stream.
+ */
+START_TEST(test_next_invalid) {
+  const uint8_t data[][2] = { { 0, 1 }, { 11, 1 }, { 15, 1 } };
+
+  /* Create buffers and streams and assert invalid fields */
+  for (size_t d = 0; d < 3; d++) {
+    pb_buffer_t buffer = pb_buffer_create(data[d], 2);
+    pb_stream_t stream = pb_stream_create(&buffer);
+    pb_stream_field_t field;
+    ck_assert_uint_eq(PB_ERROR_INVALID, pb_stream_next(&stream, &field));
+
+    /* Free all allocated memory */
+    pb_stream_destroy(&stream);
+    pb_buffer_destroy(&buffer);
+  }
+} END_TEST
+
+/*
+ * Read a field whose value exceeds a stream.
+ */
+START_TEST(test_next_underrun) {
+  const uint8_t data[] = { 18, 3, 'A', 'B' };
+  const size_t  size   = 4;
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Read field */
+  pb_stream_field_t field;
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_stream_next(&stream, &field));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Collect all fields of a stream.
+ */
+START_TEST(test_scan) {
+  uint8_t data[64];
+  for (size_t d = 0; d < 64; d += 2)
+    memcpy(&(data[d]), (uint8_t []){ 8, d }, 2);
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, 64);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Collect fields */
+  pb_stream_field_t *fields = NULL;
+  size_t count = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_stream_scan(&stream, &fields, &count));
+  ck_assert_uint_eq(32, count);
+  for (size_t f = 0; f < count; f++) {
+    ck_assert_uint_eq(1, fields[f].tag);
+    ck_assert_uint_eq(f << 1, fields[f].start);
+    ck_assert_uint_eq((f + 1) << 1, fields[f].end);
+  }
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator_default, fields);
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Collect all fields of a stream containing an invalid field.
+ */
+START_TEST(test_scan_invalid) {
+  const uint8_t data[] = { 8, 1, 8 };
+  const size_t  size   = 3;
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Collect fields */
+  pb_stream_field_t *fields = NULL;
+  size_t count = 0;
+  ck_assert_uint_eq(PB_ERROR_VARINT, pb_stream_scan(&stream, &fields, &count));
+  ck_assert_uint_eq(1, count);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator_default, fields);
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a stream over a segmented buffer.
+ */
+START_TEST(test_iovec_create) {
+  const uint8_t data[] = { 255, 255, 255, 255, 255, 255, 255, 255, 255, 1 };
+  const struct iovec segments[] = {
+    { (void *)data, 4 },
+    { (void *)&(data[4]), 6 }
+  };
+
+  /* Create segmented buffer and stream */
+  pb_iovec_t        iovec  = pb_iovec_create(segments, 2);
+  pb_stream_iovec_t state  = pb_stream_iovec_create(&iovec);
+  pb_stream_t       stream = pb_stream_create_from_iovec(&state);
+
+  /* Assert stream size and offset */
+  fail_if(pb_stream_empty(&stream));
+  ck_assert_uint_eq(10, pb_stream_size(&stream));
+  ck_assert_uint_eq(0, pb_stream_offset(&stream));
+  ck_assert_uint_eq(10, pb_stream_left(&stream));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_stream_iovec_destroy(&state);
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Read variable-sized integers straddling segments.
+ */
+START_TEST(test_iovec_read_varint) {
+  const uint8_t data[] = { 255, 255, 255, 255, 255, 255, 255, 255, 255, 1,
+                           172, 2 };
+  const size_t  size   = 12;
+
+  /* Split data at every position */
+  for (size_t s = 0; s <= size; s++) {
+    const struct iovec segments[] = {
+      { (void *)data, s },
+      { (void *)&(data[s]), size - s }
+    };
+
+    /* Create segmented buffer and stream */
+    pb_iovec_t        iovec  = pb_iovec_create(segments, 2);
+    pb_stream_iovec_t state  = pb_stream_iovec_create(&iovec);
+    pb_stream_t       stream = pb_stream_create_from_iovec(&state);
+
+    /* Read variable-sized integers */
+    uint64_t value;
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_stream_read_iovec_jump[PB_TYPE_UINT64](
+        &stream, PB_TYPE_UINT64, &value));
+    ck_assert_uint_eq(UINT64_MAX, value);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_stream_read_iovec_jump[PB_TYPE_UINT64](
+        &stream, PB_TYPE_UINT64, &value));
+    ck_assert_uint_eq(300, value);
+
+    /* Assert stream offset */
+    ck_assert_uint_eq(12, pb_stream_offset(&stream));
+    ck_assert_uint_eq(0, pb_stream_left(&stream));
+
+    /* Free all allocated memory */
+    pb_stream_destroy(&stream);
+    pb_stream_iovec_destroy(&state);
+    pb_iovec_destroy(&iovec);
+  }
+} END_TEST
+
+/*
+ * Read an invalid variable-sized integer straddling segments.
+ */
+START_TEST(test_iovec_read_varint_invalid) {
+  const uint8_t data[] = { 255, 255, 255 };
+  const struct iovec segments[] = {
+    { (void *)data, 1 },
+    { (void *)&(data[1]), 2 }
+  };
+
+  /* Create segmented buffer and stream */
+  pb_iovec_t        iovec  = pb_iovec_create(segments, 2);
+  pb_stream_iovec_t state  = pb_stream_iovec_create(&iovec);
+  pb_stream_t       stream = pb_stream_create_from_iovec(&state);
+
+  /* Read variable-sized integer */
+  uint64_t value;
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_stream_read_iovec_jump[PB_TYPE_UINT64](
+      &stream, PB_TYPE_UINT64, &value));
+  ck_assert_uint_eq(0, pb_stream_offset(&stream));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_stream_iovec_destroy(&state);
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Read fixed-sized values straddling segments.
+ */
+START_TEST(test_iovec_read_fixed) {
+  const uint8_t data[] = { 0, 0, 0, 0, 0, 0, 248, 63, 0, 0, 128, 63 };
+  const size_t  size   = 12;
+
+  /* Split data at every position */
+  for (size_t s = 0; s <= size; s++) {
+    const struct iovec segments[] = {
+      { (void *)data, s },
+      { (void *)&(data[s]), size - s }
+    };
+
+    /* Create segmented buffer and stream */
+    pb_iovec_t        iovec  = pb_iovec_create(segments, 2);
+    pb_stream_iovec_t state  = pb_stream_iovec_create(&iovec);
+    pb_stream_t       stream = pb_stream_create_from_iovec(&state);
+
+    /* Read fixed-sized values */
+    double value1; float value2;
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_stream_read_iovec_jump[PB_TYPE_DOUBLE](
+        &stream, PB_TYPE_DOUBLE, &value1));
+    fail_unless(value1 == 1.5);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_stream_read_iovec_jump[PB_TYPE_FLOAT](
+        &stream, PB_TYPE_FLOAT, &value2));
+    fail_unless(value2 == 1.0);
+
+    /* Assert underrun */
+    ck_assert_uint_eq(PB_ERROR_OFFSET,
+      pb_stream_read_iovec_jump[PB_TYPE_FLOAT](
+        &stream, PB_TYPE_FLOAT, &value2));
+
+    /* Free all allocated memory */
+    pb_stream_destroy(&stream);
+    pb_stream_iovec_destroy(&state);
+    pb_iovec_destroy(&iovec);
+  }
+} END_TEST
+
+/*
+ * Read length-prefixed values contained in and straddling segments.
+ */
+START_TEST(test_iovec_read_length) {
+  const uint8_t data[] = { 2, 'A', 'B', 3, 'C', 'D', 'E', 0 };
+  const struct iovec segments[] = {
+    { (void *)data, 5 },
+    { (void *)&(data[5]), 3 }
+  };
+
+  /* Create segmented buffer and stream */
+  pb_iovec_t        iovec  = pb_iovec_create(segments, 2);
+  pb_stream_iovec_t state  = pb_stream_iovec_create(&iovec);
+  pb_stream_t       stream = pb_stream_create_from_iovec(&state);
+
+  /* Read contained value, which is returned in place */
+  pb_string_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read_iovec_jump[PB_TYPE_BYTES](&stream, PB_TYPE_BYTES, &value));
+  ck_assert_ptr_eq(&(data[1]), pb_string_data(&value));
+  ck_assert_uint_eq(2, pb_string_size(&value));
+
+  /* Read straddling value, which is copied */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read_iovec_jump[PB_TYPE_BYTES](&stream, PB_TYPE_BYTES, &value));
+  ck_assert_ptr_ne(&(data[4]), pb_string_data(&value));
+  ck_assert_uint_eq(3, pb_string_size(&value));
+  fail_if(memcmp(&(data[4]), pb_string_data(&value), 3));
+
+  /* Read empty value */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read_iovec_jump[PB_TYPE_BYTES](&stream, PB_TYPE_BYTES, &value));
+  ck_assert_uint_eq(0, pb_string_size(&value));
+  ck_assert_uint_eq(0, pb_stream_left(&stream));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_stream_iovec_destroy(&state);
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Read a length-prefixed value exceeding a segmented buffer.
+ */
+START_TEST(test_iovec_read_length_underrun) {
+  const uint8_t data[] = { 4, 'A', 'B', 'C' };
+  const struct iovec segments[] = {
+    { (void *)data, 2 },
+    { (void *)&(data[2]), 2 }
+  };
+
+  /* Create segmented buffer and stream */
+  pb_iovec_t        iovec  = pb_iovec_create(segments, 2);
+  pb_stream_iovec_t state  = pb_stream_iovec_create(&iovec);
+  pb_stream_t       stream = pb_stream_create_from_iovec(&state);
+
+  /* Read length-prefixed value */
+  pb_string_t value;
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_stream_read_iovec_jump[PB_TYPE_BYTES](&stream, PB_TYPE_BYTES, &value));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_stream_iovec_destroy(&state);
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Skip values of all wiretypes straddling segments.
+ */
+START_TEST(test_iovec_skip) {
+  const uint8_t data[] = { 172, 2, 1, 2, 3, 4, 5, 6, 7, 8,
+                           3, 1, 2, 3, 1, 2, 3, 4 };
+  const size_t  size   = 18;
+
+  /* Split data at every position */
+  for (size_t s = 0; s <= size; s++) {
+    const struct iovec segments[] = {
+      { (void *)data, s },
+      { (void *)&(data[s]), size - s }
+    };
+
+    /* Create segmented buffer and stream */
+    pb_iovec_t        iovec  = pb_iovec_create(segments, 2);
+    pb_stream_iovec_t state  = pb_stream_iovec_create(&iovec);
+    pb_stream_t       stream = pb_stream_create_from_iovec(&state);
+
+    /* Skip values */
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_stream_skip_iovec_jump[PB_WIRETYPE_VARINT](&stream));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_stream_skip_iovec_jump[PB_WIRETYPE_64BIT](&stream));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_stream_skip_iovec_jump[PB_WIRETYPE_LENGTH](&stream));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_stream_skip_iovec_jump[PB_WIRETYPE_32BIT](&stream));
+    ck_assert_uint_eq(0, pb_stream_left(&stream));
+
+    /* Free all allocated memory */
+    pb_stream_destroy(&stream);
+    pb_stream_iovec_destroy(&state);
+    pb_iovec_destroy(&iovec);
+  }
+} END_TEST
+
+/*
+ * Retrieve contiguous data from a stream over a segmented buffer.
+ */
+START_TEST(test_iovec_data) {
+  const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  const struct iovec segments[] = {
+    { (void *)data, 3 },
+    { (void *)&(data[3]), 5 }
+  };
+
+  /* Create segmented buffer and stream */
+  pb_iovec_t        iovec  = pb_iovec_create(segments, 2);
+  pb_stream_iovec_t state  = pb_stream_iovec_create(&iovec);
+  pb_stream_t       stream = pb_stream_create_from_iovec(&state);
+
+  /* Assert contiguous and straddling data */
+  ck_assert_ptr_eq(data, pb_stream_data_iovec(&stream, 3));
+  ck_assert_ptr_eq(NULL, pb_stream_data_iovec(&stream, 4));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_stream_advance(&stream, 3));
+  ck_assert_ptr_eq(&(data[3]), pb_stream_data_iovec(&stream, 5));
+  ck_assert_ptr_eq(NULL, pb_stream_data_iovec(&stream, 6));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_stream_iovec_destroy(&state);
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
 /* ----------------------------------------------------------------------------
  * Program
  * ------------------------------------------------------------------------- */
@@ -985,6 +1394,27 @@ main(void) {
   tcase_add_test(tcase, test_skip_32bit_underrun);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "next" */
+  tcase = tcase_create("next");
+  tcase_add_test(tcase, test_next);
+  tcase_add_test(tcase, test_next_invalid);
+  tcase_add_test(tcase, test_next_underrun);
+  tcase_add_test(tcase, test_scan);
+  tcase_add_test(tcase, test_scan_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "iovec" */
+  tcase = tcase_create("iovec");
+  tcase_add_test(tcase, test_iovec_create);
+  tcase_add_test(tcase, test_iovec_read_varint);
+  tcase_add_test(tcase, test_iovec_read_varint_invalid);
+  tcase_add_test(tcase, test_iovec_read_fixed);
+  tcase_add_test(tcase, test_iovec_read_length);
+  tcase_add_test(tcase, test_iovec_read_length_underrun);
+  tcase_add_test(tcase, test_iovec_skip);
+  tcase_add_test(tcase, test_iovec_data);
+  suite_add_tcase(suite, tcase);
+
   /* Create a test suite runner in no-fork mode */
   void *runner = srunner_create(suite);
   srunner_set_fork_status(runner, CK_NOFORK);
@@ -22,6 +22,7 @@
 
 #include <assert.h>
 #include <check.h>
+#include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -498,6 +499,40 @@ START_TEST(test_write_invalid_zero_copy) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Write data to a memory-mapped buffer in place.
+ */
+START_TEST(test_write_invalid_mmap) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Write data to file */
+  FILE *file = fopen("message-buffer.mmap", "wb");
+  ck_assert_ptr_ne(NULL, file);
+  ck_assert_uint_eq(size, fwrite(data, 1, size, file));
+  fclose(file);
+
+  /* Create buffer */
+  pb_buffer_t buffer = pb_buffer_create_mmap("message-buffer.mmap");
+
+  /* Assert buffer validity and error */
+  fail_unless(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_error(&buffer));
+
+  /* Try to update buffer without changing its size */
+  uint8_t new_data[] = "DATA";
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_buffer_write(&buffer, 5, 9, new_data, 4));
+
+  /* Assert buffer size and contents */
+  ck_assert_uint_eq(size, pb_buffer_size(&buffer));
+  fail_if(memcmp(data, pb_buffer_data(&buffer), size));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  remove("message-buffer.mmap");
+} END_TEST
+
 /*
  * Clear data from a buffer.
  */
@@ -810,6 +845,7 @@ main(void) {
   tcase_add_test(tcase, test_write_invalid_allocate);
   tcase_add_test(tcase, test_write_invalid_resize);
   tcase_add_test(tcase, test_write_invalid_zero_copy);
+  tcase_add_test(tcase, test_write_invalid_mmap);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "clear" */
@@ -100,7 +100,7 @@ START_TEST(test_create) {
   ck_assert_uint_eq(1, pb_cursor_tag(&cursor));
 
   /* Assert same contents but different location */
-  fail_unless(pb_message_equals(&message, pb_cursor_message(&cursor)));
+  fail_unless(pb_message_same(&message, pb_cursor_message(&cursor)));
   ck_assert_ptr_ne(&message, pb_cursor_message(&cursor));
 
   /* Free all allocated memory */
@@ -348,7 +348,7 @@ START_TEST(test_create_without_tag) {
   ck_assert_uint_eq(1, pb_cursor_tag(&cursor));
 
   /* Assert same contents but different location */
-  fail_unless(pb_message_equals(&message, pb_cursor_message(&cursor)));
+  fail_unless(pb_message_same(&message, pb_cursor_message(&cursor)));
   ck_assert_ptr_ne(&message, pb_cursor_message(&cursor));
 
   /* Free all allocated memory */
@@ -2143,6 +2143,342 @@ START_TEST(test_match_invalid_type) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Find all fields of a cursor containing the value.
+ */
+START_TEST(test_find_all) {
+  const uint8_t data[] = { 8, 1, 8, 2, 8, 1, 8, 3, 8, 1 };
+  const size_t  size   = 10;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Find all fields containing the value */
+  uint32_t value = 1; size_t pos[4];
+  ck_assert_uint_eq(3, pb_cursor_find_all(&cursor, &value, pos, 4));
+  ck_assert_uint_eq(0, pos[0]);
+  ck_assert_uint_eq(2, pos[1]);
+  ck_assert_uint_eq(4, pos[2]);
+
+  /* Assert cursor position */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(0, cursor.pos);
+
+  /* Find all fields starting at the next position */
+  fail_unless(pb_cursor_next(&cursor));
+  ck_assert_uint_eq(2, pb_cursor_find_all(&cursor, &value, NULL, 0));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Find all fields of a cursor containing the value in a packed field.
+ */
+START_TEST(test_find_all_packed) {
+  const float values[] = { 1, 2, 1, 3, 4, 1, 5, 6, 1, 1 };
+  uint8_t data[42] = { 42, 40 };
+  memcpy(&(data[2]), values, 40);
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, 42);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 5);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Find all fields containing the value */
+  float value = 1; size_t pos[8];
+  ck_assert_uint_eq(5, pb_cursor_find_all(&cursor, &value, pos, 8));
+  ck_assert_uint_eq(0, pos[0]);
+  ck_assert_uint_eq(2, pos[1]);
+  ck_assert_uint_eq(5, pos[2]);
+  ck_assert_uint_eq(8, pos[3]);
+  ck_assert_uint_eq(9, pos[4]);
+
+  /* Find all fields containing another value */
+  value = 6;
+  ck_assert_uint_eq(1, pb_cursor_find_all(&cursor, &value, pos, 8));
+  ck_assert_uint_eq(7, pos[0]);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Find all fields of a cursor containing the value in a merged packed field.
+ */
+START_TEST(test_find_all_packed_merged) {
+  const float values[] = { 1, 2, 1, 3, 4, 1 };
+  uint8_t data[36] = { 42, 16 };
+  memcpy(&(data[2]), values, 16);
+  data[18] = 42; data[19] = 16;
+  memcpy(&(data[20]), &(values[2]), 16);
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, 36);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 5);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Move cursor to second value */
+  fail_unless(pb_cursor_next(&cursor));
+
+  /* Find all fields containing the value, with limited space */
+  float value = 1; size_t pos[2];
+  ck_assert_uint_eq(3, pb_cursor_find_all(&cursor, &value, pos, 2));
+  ck_assert_uint_eq(2, pos[0]);
+  ck_assert_uint_eq(4, pos[1]);
+
+  /* Assert cursor position */
+  ck_assert_uint_eq(1, cursor.pos);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Find all fields of a cursor containing the value in a string field.
+ */
+START_TEST(test_find_all_string) {
+  const uint8_t data[] = { 66, 1, 65, 66, 2, 65, 66, 66, 1, 65 };
+  const size_t  size   = 10;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 8);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Find all fields containing the value */
+  pb_string_t value = pb_string_init_from_chars("A"); size_t pos[4];
+  ck_assert_uint_eq(2, pb_cursor_find_all(&cursor, &value, pos, 4));
+  ck_assert_uint_eq(0, pos[0]);
+  ck_assert_uint_eq(2, pos[1]);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Find all fields of an invalid cursor containing the value.
+ */
+START_TEST(test_find_all_invalid) {
+  pb_cursor_t cursor = pb_cursor_create_invalid();
+
+  /* Assert cursor validity and error */
+  fail_if(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_cursor_error(&cursor));
+
+  /* Find all fields containing the value */
+  uint32_t value = 1;
+  ck_assert_uint_eq(0, pb_cursor_find_all(&cursor, &value, NULL, 0));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+} END_TEST
+
+/*
+ * Seek a cursor to the first field not less than the value.
+ */
+START_TEST(test_lower_bound) {
+  const uint8_t data[] = { 8, 1, 8, 3, 8, 5, 8, 7 };
+  const size_t  size   = 8;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Seek first field not less than the value */
+  uint32_t value = 4, temp;
+  fail_unless(pb_cursor_lower_bound(&cursor, &value));
+  ck_assert_uint_eq(2, cursor.pos);
+
+  /* Assert cursor value */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  ck_assert_uint_eq(5, temp);
+
+  /* Seek again, including the current position */
+  value = 5;
+  fail_unless(pb_cursor_lower_bound(&cursor, &value));
+  ck_assert_uint_eq(2, cursor.pos);
+
+  /* Seek value greater than all values */
+  value = 8;
+  fail_if(pb_cursor_lower_bound(&cursor, &value));
+
+  /* Assert cursor validity and error */
+  fail_if(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_cursor_error(&cursor));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Seek a cursor to the first field not less than the value in a packed field.
+ */
+START_TEST(test_lower_bound_packed) {
+  const float values[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+  uint8_t data[42] = { 42, 40 };
+  memcpy(&(data[2]), values, 40);
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, 42);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 5);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Seek first field not less than the value */
+  float value = 6.5, temp;
+  fail_unless(pb_cursor_lower_bound(&cursor, &value));
+  ck_assert_uint_eq(6, cursor.pos);
+
+  /* Assert cursor value */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  fail_unless(temp == 7);
+
+  /* Seek value less than all values */
+  value = 0;
+  fail_unless(pb_cursor_lower_bound(&cursor, &value));
+  ck_assert_uint_eq(6, cursor.pos);
+
+  /* Move cursor to next field */
+  fail_unless(pb_cursor_next(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  fail_unless(temp == 8);
+
+  /* Seek value greater than all values */
+  value = 11;
+  fail_if(pb_cursor_lower_bound(&cursor, &value));
+
+  /* Assert cursor validity and error */
+  fail_if(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_cursor_error(&cursor));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Seek a cursor to the first field not less than the value in a merged packed
+ * field.
+ */
+START_TEST(test_lower_bound_packed_merged) {
+  const float values[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  uint8_t data[36] = { 42, 16 };
+  memcpy(&(data[2]), values, 16);
+  data[18] = 42; data[19] = 16;
+  memcpy(&(data[20]), &(values[4]), 16);
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, 36);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 5);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Seek first field not less than the value */
+  float value = 6, temp;
+  fail_unless(pb_cursor_lower_bound(&cursor, &value));
+  ck_assert_uint_eq(5, cursor.pos);
+
+  /* Assert cursor value */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  fail_unless(temp == 6);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Seek a cursor to the first field not less than the value in a string field.
+ */
+START_TEST(test_lower_bound_string) {
+  const uint8_t data[] = { 66, 1, 65, 66, 2, 65, 66, 66, 1, 67 };
+  const size_t  size   = 10;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 8);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Seek first field not less than a prefix */
+  pb_string_t value = pb_string_init_from_chars("AA");
+  fail_unless(pb_cursor_lower_bound(&cursor, &value));
+  ck_assert_uint_eq(1, cursor.pos);
+
+  /* Seek first field not less than the value */
+  value = pb_string_init_from_chars("B");
+  fail_unless(pb_cursor_lower_bound(&cursor, &value));
+  ck_assert_uint_eq(2, cursor.pos);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Seek an invalid cursor to the first field not less than the value.
+ */
+START_TEST(test_lower_bound_invalid) {
+  pb_cursor_t cursor = pb_cursor_create_invalid();
+
+  /* Assert cursor validity and error */
+  fail_if(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_cursor_error(&cursor));
+
+  /* Seek first field not less than the value */
+  uint32_t value = 1;
+  fail_if(pb_cursor_lower_bound(&cursor, &value));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+} END_TEST
+
 /*
  * Read the value of the current field from a cursor.
  */
@@ -3576,6 +3912,24 @@ main(void) {
   tcase_add_test(tcase, test_match_invalid_type);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "find" */
+  tcase = tcase_create("find");
+  tcase_add_test(tcase, test_find_all);
+  tcase_add_test(tcase, test_find_all_packed);
+  tcase_add_test(tcase, test_find_all_packed_merged);
+  tcase_add_test(tcase, test_find_all_string);
+  tcase_add_test(tcase, test_find_all_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "lower_bound" */
+  tcase = tcase_create("lower_bound");
+  tcase_add_test(tcase, test_lower_bound);
+  tcase_add_test(tcase, test_lower_bound_packed);
+  tcase_add_test(tcase, test_lower_bound_packed_merged);
+  tcase_add_test(tcase, test_lower_bound_string);
+  tcase_add_test(tcase, test_lower_bound_invalid);
+  suite_add_tcase(suite, tcase);
+
   /* Add tests to test case "get" */
   tcase = tcase_create("get");
   tcase_add_test(tcase, test_get);
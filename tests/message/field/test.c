@@ -775,6 +775,30 @@ START_TEST(test_match_not) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Compare the value of a field with non-canonical encoding.
+ */
+START_TEST(test_match_non_canonical) {
+  const uint8_t data[] = { 8, 255, 0 };
+  const size_t  size   = 3;
+
+  /* Create journal, message and field */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_field_t   field   = pb_field_create(&message, 1);
+
+  /* Compare with value of field */
+  uint32_t value = 127;
+  fail_unless(pb_field_match(&field, &value));
+  value = 255;
+  fail_if(pb_field_match(&field, &value));
+
+  /* Free all allocated memory */
+  pb_field_destroy(&field);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Compare the value of a 32-bit unsigned integer field with the given value.
  */
@@ -2403,6 +2427,7 @@ main(void) {
   tcase = tcase_create("match");
   tcase_add_test(tcase, test_match);
   tcase_add_test(tcase, test_match_not);
+  tcase_add_test(tcase, test_match_non_canonical);
   tcase_add_test(tcase, test_match_uint32);
   tcase_add_test(tcase, test_match_uint64);
   tcase_add_test(tcase, test_match_int32);
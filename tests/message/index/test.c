@@ -0,0 +1,568 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/buffer.h"
+#include "message/common.h"
+#include "message/cursor.h"
+#include "message/index.h"
+#include "message/journal.h"
+#include "message/message.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  REPEATED },
+    {  2, "F02", UINT32,  REPEATED, NULL, NULL, PACKED },
+    {  3, "F03", STRING,  REPEATED },
+    {  4, "F04", MESSAGE, OPTIONAL, &descriptor }
+  }, 4 } };
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create an index over a repeated field.
+ */
+START_TEST(test_create) {
+  const uint8_t data[] = { 8, 1, 8, 2, 8, 3 };
+  const size_t  size   = 6;
+
+  /* Create journal, message and index */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 1);
+
+  /* Assert index validity and error */
+  fail_unless(pb_index_valid(&index));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_index_error(&index));
+
+  /* Assert index descriptor and size */
+  ck_assert_ptr_eq(&(descriptor.field.data[0]), pb_index_descriptor(&index));
+  ck_assert_uint_eq(3, pb_index_size(&index));
+
+  /* Free all allocated memory */
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create an index over a field of an empty message.
+ */
+START_TEST(test_create_message_empty) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 1);
+
+  /* Assert index validity and error */
+  fail_unless(pb_index_valid(&index));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_index_error(&index));
+
+  /* Assert index size and match */
+  uint32_t value = 1;
+  ck_assert_uint_eq(0, pb_index_size(&index));
+  fail_if(pb_index_match(&index, &value));
+
+  /* Free all allocated memory */
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create an index over a field of a zero-copy message.
+ */
+START_TEST(test_create_message_zero_copy) {
+  uint8_t data[] = { 8, 1, 8, 2, 8, 3 };
+  size_t  size   = 6;
+
+  /* Create journal, message and index */
+  pb_journal_t journal = pb_journal_create_zero_copy(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 1);
+
+  /* Assert index validity and error */
+  fail_unless(pb_index_valid(&index));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_index_error(&index));
+
+  /* Assert index match */
+  uint32_t value = 2;
+  fail_unless(pb_index_match(&index, &value));
+
+  /* Free all allocated memory */
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create an index over a message field.
+ */
+START_TEST(test_create_message_field) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 4);
+
+  /* Assert index validity and error */
+  fail_if(pb_index_valid(&index));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_index_error(&index));
+
+  /* Free all allocated memory */
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create an index over a field of an invalid message.
+ */
+START_TEST(test_create_message_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+  pb_index_t   index   = pb_index_create(&message, 1);
+
+  /* Assert index validity and error */
+  fail_if(pb_index_valid(&index));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_index_error(&index));
+
+  /* Free all allocated memory */
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+} END_TEST
+
+/*
+ * Create an invalid index.
+ */
+START_TEST(test_create_invalid) {
+  pb_index_t index = pb_index_create_invalid();
+
+  /* Assert index validity and error */
+  fail_if(pb_index_valid(&index));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_index_error(&index));
+
+  /* Assert index match */
+  uint32_t value = 1;
+  fail_if(pb_index_match(&index, &value));
+
+  /* Free all allocated memory */
+  pb_index_destroy(&index);
+} END_TEST
+
+/*
+ * Seek a cursor to a field containing the value using an index.
+ */
+START_TEST(test_seek) {
+  const uint8_t data[] = { 8, 5, 8, 1, 8, 5, 8, 3 };
+  const size_t  size   = 8;
+
+  /* Create journal, message, index and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 1);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+
+  /* Assert index and cursor validity */
+  fail_unless(pb_index_valid(&index));
+  fail_unless(pb_cursor_valid(&cursor));
+
+  /* Seek value with index */
+  uint32_t value = 5, temp;
+  fail_unless(pb_index_seek(&index, &cursor, &value));
+  ck_assert_uint_eq(2, cursor.pos);
+
+  /* Assert cursor value */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  ck_assert_uint_eq(5, temp);
+
+  /* Seek value with index again */
+  fail_if(pb_index_seek(&index, &cursor, &value));
+
+  /* Assert cursor validity and position */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(2, cursor.pos);
+
+  /* Move cursor to next field */
+  fail_unless(pb_cursor_next(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  ck_assert_uint_eq(3, temp);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Seek a cursor to a packed field containing the value using an index.
+ */
+START_TEST(test_seek_packed) {
+  const uint8_t data[] = { 18, 4, 1, 2, 3, 4 };
+  const size_t  size   = 6;
+
+  /* Create journal, message, index and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 2);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 2);
+
+  /* Assert index and cursor validity */
+  fail_unless(pb_index_valid(&index));
+  fail_unless(pb_cursor_valid(&cursor));
+
+  /* Seek value with index */
+  uint32_t value = 3, temp;
+  fail_unless(pb_index_seek(&index, &cursor, &value));
+  ck_assert_uint_eq(2, cursor.pos);
+
+  /* Assert cursor value */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  ck_assert_uint_eq(3, temp);
+
+  /* Move cursor to next field */
+  fail_unless(pb_cursor_next(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  ck_assert_uint_eq(4, temp);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Seek a cursor to a string field containing the value using an index.
+ */
+START_TEST(test_seek_string) {
+  const uint8_t data[] = { 26, 1, 'A', 26, 2, 'B', 'C', 26, 1, 'D' };
+  const size_t  size   = 10;
+
+  /* Create journal, message, index and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 3);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 3);
+
+  /* Assert index and cursor validity */
+  fail_unless(pb_index_valid(&index));
+  fail_unless(pb_cursor_valid(&cursor));
+
+  /* Seek value with index */
+  pb_string_t value = pb_string_init_from_chars("BC"), temp;
+  fail_unless(pb_index_seek(&index, &cursor, &value));
+  ck_assert_uint_eq(1, cursor.pos);
+
+  /* Assert cursor value */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  fail_unless(pb_string_equals(&value, &temp));
+
+  /* Assert index match */
+  pb_string_t other = pb_string_init_from_chars("B");
+  fail_if(pb_index_match(&index, &other));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Seek a cursor to a field containing the value using an index.
+ */
+START_TEST(test_seek_large) {
+  pb_buffer_t buffer = pb_buffer_create_empty();
+  for (uint32_t v = 0; v < 50000; v++) {
+    uint8_t data[6] = { 8 }; size_t size = 1; uint32_t x = v;
+    for (; x >= 128; x >>= 7)
+      data[size++] = (x & 127) | 128;
+    data[size++] = x;
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_write(&buffer,
+      pb_buffer_size(&buffer), pb_buffer_size(&buffer), data, size));
+  }
+
+  /* Create journal, message and index */
+  pb_journal_t journal = pb_journal_create(
+    pb_buffer_data(&buffer), pb_buffer_size(&buffer));
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 1);
+
+  /* Assert index validity and size */
+  fail_unless(pb_index_valid(&index));
+  ck_assert_uint_eq(50000, pb_index_size(&index));
+
+  /* Seek values with index from the start */
+  for (uint32_t v = 1; v < 50000; v += 997) {
+    pb_cursor_t cursor = pb_cursor_create(&message, 1);
+    fail_unless(pb_index_seek(&index, &cursor, &v));
+    ck_assert_uint_eq(v, cursor.pos);
+
+    /* Assert cursor value */
+    uint32_t temp;
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+    ck_assert_uint_eq(v, temp);
+    pb_cursor_destroy(&cursor);
+  }
+
+  /* Assert index match */
+  uint32_t value = 50000;
+  fail_if(pb_index_match(&index, &value));
+
+  /* Free all allocated memory */
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Seek a cursor of another field using an index.
+ */
+START_TEST(test_seek_mismatch) {
+  const uint8_t data[] = { 8, 1, 8, 2, 18, 2, 1, 2 };
+  const size_t  size   = 8;
+
+  /* Create journal, message, index and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 1);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 2);
+
+  /* Assert index and cursor validity */
+  fail_unless(pb_index_valid(&index));
+  fail_unless(pb_cursor_valid(&cursor));
+
+  /* Seek value with index */
+  uint32_t value = 2;
+  fail_if(pb_index_seek(&index, &cursor, &value));
+  ck_assert_uint_eq(0, cursor.pos);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Seek a cursor to the first field not less than the value with an index.
+ */
+START_TEST(test_lower_bound) {
+  const uint8_t data[] = { 8, 1, 8, 3, 8, 3, 8, 7 };
+  const size_t  size   = 8;
+
+  /* Create journal, message, index and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 1);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+
+  /* Assert index and cursor validity */
+  fail_unless(pb_index_valid(&index));
+  fail_unless(pb_cursor_valid(&cursor));
+
+  /* Seek first field not less than the value with index */
+  uint32_t value = 2, temp;
+  fail_unless(pb_index_lower_bound(&index, &cursor, &value));
+  ck_assert_uint_eq(1, cursor.pos);
+
+  /* Assert cursor value */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  ck_assert_uint_eq(3, temp);
+
+  /* Seek again, starting at the next position */
+  fail_unless(pb_cursor_next(&cursor));
+  value = 3;
+  fail_unless(pb_index_lower_bound(&index, &cursor, &value));
+  ck_assert_uint_eq(2, cursor.pos);
+
+  /* Seek value greater than all values */
+  value = 8;
+  fail_if(pb_index_lower_bound(&index, &cursor, &value));
+
+  /* Assert cursor validity and position */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(2, cursor.pos);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Seek a cursor to the first field not less than the value in a packed field
+ * with an index.
+ */
+START_TEST(test_lower_bound_packed) {
+  const uint8_t data[] = { 18, 4, 1, 2, 200, 1, 18, 2, 201, 1 };
+  const size_t  size   = 10;
+
+  /* Create journal, message, index and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 2);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 2);
+
+  /* Assert index and cursor validity */
+  fail_unless(pb_index_valid(&index));
+  fail_unless(pb_cursor_valid(&cursor));
+
+  /* Seek first field not less than the value with index */
+  uint32_t value = 201, temp;
+  fail_unless(pb_index_lower_bound(&index, &cursor, &value));
+  ck_assert_uint_eq(3, cursor.pos);
+
+  /* Assert cursor value */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  ck_assert_uint_eq(201, temp);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Test whether a field contains the value after altering the message.
+ */
+START_TEST(test_match_altered) {
+  const uint8_t data[] = { 8, 1, 8, 2, 8, 3 };
+  const size_t  size   = 6;
+
+  /* Create journal, message and index */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_index_t   index   = pb_index_create(&message, 1);
+
+  /* Assert index match */
+  uint32_t value = 2, other = 7;
+  fail_unless(pb_index_match(&index, &value));
+  fail_if(pb_index_match(&index, &other));
+
+  /* Write value in-place */
+  pb_cursor_t cursor = pb_cursor_create(&message, 1);
+  fail_unless(pb_cursor_next(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_put(&cursor, &other));
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+  pb_cursor_destroy(&cursor);
+
+  /* Assert index match */
+  fail_if(pb_index_match(&index, &value));
+  fail_unless(pb_index_match(&index, &other));
+
+  /* Erase first field to alter offsets */
+  cursor = pb_cursor_create(&message, 1);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_erase(&cursor));
+  ck_assert_uint_eq(4, pb_journal_size(&journal));
+  pb_cursor_destroy(&cursor);
+
+  /* Assert index match and seek */
+  value  = 3;
+  cursor = pb_cursor_create(&message, 1);
+  fail_unless(pb_index_match(&index, &value));
+  fail_unless(pb_index_seek(&index, &cursor, &value));
+  ck_assert_uint_eq(1, cursor.pos);
+
+  /* Assert cursor value */
+  uint32_t temp;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &temp));
+  ck_assert_uint_eq(3, temp);
+  pb_cursor_destroy(&cursor);
+
+  /* Free all allocated memory */
+  pb_index_destroy(&index);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/message/index"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_message_empty);
+  tcase_add_test(tcase, test_create_message_zero_copy);
+  tcase_add_test(tcase, test_create_message_field);
+  tcase_add_test(tcase, test_create_message_invalid);
+  tcase_add_test(tcase, test_create_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "seek" */
+  tcase = tcase_create("seek");
+  tcase_add_test(tcase, test_seek);
+  tcase_add_test(tcase, test_seek_packed);
+  tcase_add_test(tcase, test_seek_string);
+  tcase_add_test(tcase, test_seek_large);
+  tcase_add_test(tcase, test_seek_mismatch);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "lower_bound" */
+  tcase = tcase_create("lower_bound");
+  tcase_add_test(tcase, test_lower_bound);
+  tcase_add_test(tcase, test_lower_bound_packed);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "match" */
+  tcase = tcase_create("match");
+  tcase_add_test(tcase, test_match_altered);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
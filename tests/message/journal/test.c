@@ -22,11 +22,18 @@
 
 #include <assert.h>
 #include <check.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <protobluff/descriptor.h>
+
 #include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/descriptor.h"
+#include "core/record.h"
 #include "message/common.h"
 #include "message/journal.h"
 
@@ -61,6 +68,35 @@ allocator_resize_fail(void *data, void *block, size_t size) {
   return NULL;
 }
 
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor (forward declaration) */
+static pb_descriptor_t
+descriptor;
+
+/* Oneof descriptor */
+static const pb_oneof_descriptor_t
+oneof_descriptor = {
+  &descriptor, {
+    (const size_t []){
+      5, 6
+    }, 2 } };
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F02", UINT32,  REPEATED, NULL, NULL, PACKED },
+    {  3, "F03", FIXED32, REPEATED },
+    {  4, "F04", MESSAGE, OPTIONAL, &descriptor },
+    {  5, "F05", STRING,  REPEATED },
+    {  6, "F06", UINT32,  ONEOF, NULL, &oneof_descriptor },
+    {  7, "F07", UINT32,  ONEOF, NULL, &oneof_descriptor }
+  }, 7 } };
+
 /* ----------------------------------------------------------------------------
  * Tests
  * ------------------------------------------------------------------------- */
@@ -142,6 +178,102 @@ START_TEST(test_create_zero_copy) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Create a zero-copy journal over the current record of a record iterator.
+ */
+START_TEST(test_create_from_record) {
+  const uint8_t data[] = { 0, 2, 8, 1 };
+  const size_t  size   = 4;
+
+  /* Create buffer and record iterator */
+  pb_buffer_t      buffer = pb_buffer_create(data, size);
+  pb_record_iter_t iter   = pb_record_iter_create(&buffer);
+
+  /* Create journal over empty record */
+  pb_journal_t journal = pb_journal_create_from_record(&iter);
+
+  /* Assert journal validity and error */
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&journal));
+  fail_unless(pb_journal_empty(&journal));
+  pb_journal_destroy(&journal);
+
+  /* Create journal over next record */
+  fail_unless(pb_record_iter_next(&iter));
+  journal = pb_journal_create_from_record(&iter);
+
+  /* Assert journal size and version */
+  fail_if(pb_journal_empty(&journal));
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+
+  /* Assert same contents and location */
+  ck_assert_ptr_eq(pb_buffer_data(&buffer) + 2, pb_journal_data(&journal));
+
+  /* Assert journal cannot change in size */
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_journal_write(&journal, 0, 0, 0, data, 1));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a zero-copy journal over a record of a memory-mapped file.
+ */
+START_TEST(test_create_from_record_mmap) {
+  const uint8_t data[] = { 2, 8, 1 };
+  const size_t  size   = 3;
+
+  /* Write data to file */
+  FILE *file = fopen("message-journal.mmap", "wb");
+  ck_assert_ptr_ne(NULL, file);
+  ck_assert_uint_eq(size, fwrite(data, 1, size, file));
+  fclose(file);
+
+  /* Create buffer, record iterator and journal */
+  pb_buffer_t      buffer  = pb_buffer_create_mmap("message-journal.mmap");
+  pb_record_iter_t iter    = pb_record_iter_create(&buffer);
+  pb_journal_t     journal = pb_journal_create_from_record(&iter);
+
+  /* Assert journal validity and size */
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+
+  /* Assert journal cannot be written to in place */
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_journal_write(&journal, 0, 1, 2, &(data[1]), 1));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+  remove("message-journal.mmap");
+} END_TEST
+
+/*
+ * Create a zero-copy journal from an invalid record iterator.
+ */
+START_TEST(test_create_from_record_invalid) {
+  pb_buffer_t      buffer = pb_buffer_create_empty();
+  pb_record_iter_t iter   = pb_record_iter_create(&buffer);
+
+  /* Create journal */
+  pb_journal_t journal = pb_journal_create_from_record(&iter);
+
+  /* Assert journal validity and error */
+  fail_if(pb_journal_valid(&journal));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_journal_error(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_record_iter_destroy(&iter);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /*
  * Create an invalid journal.
  */
@@ -220,6 +352,7 @@ START_TEST(test_write) {
     fail_if(pb_journal_empty(&journal));
     ck_assert_uint_eq(s, pb_journal_size(&journal));
     ck_assert_uint_eq(s, pb_journal_version(&journal));
+    ck_assert_uint_eq(s, pb_journal_revision(&journal));
 
     /* Assert same contents but different location */
     fail_if(memcmp(data, pb_journal_data(&journal), s));
@@ -268,6 +401,7 @@ START_TEST(test_write_zero_copy) {
   fail_if(pb_journal_empty(&journal));
   ck_assert_uint_eq(size, pb_journal_size(&journal));
   ck_assert_uint_eq(0, pb_journal_version(&journal));
+  ck_assert_uint_eq(1, pb_journal_revision(&journal));
 
   /* Assert same contents but different location */
   fail_if(memcmp(new_data, pb_journal_data(&journal), size));
@@ -1031,6 +1165,702 @@ START_TEST(test_align_invalid) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Create a snapshot of a journal and write to it.
+ */
+START_TEST(test_snapshot) {
+  pb_journal_t journal  = pb_journal_create((uint8_t *)"SOME DATA", 9);
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+
+  /* Assert snapshot validity and shared buffer */
+  fail_unless(pb_journal_valid(&snapshot));
+  ck_assert_uint_eq(9, pb_journal_size(&snapshot));
+  ck_assert_uint_eq(0, pb_journal_version(&snapshot));
+  ck_assert_ptr_eq(pb_journal_data(&journal), pb_journal_data(&snapshot));
+  ck_assert_uint_eq(2, *journal.refs);
+
+  /* Write to snapshot: "SOME DATA" => "SOME" */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_clear(&snapshot, 4, 4, 9));
+  ck_assert_ptr_ne(pb_journal_data(&journal), pb_journal_data(&snapshot));
+  ck_assert_ptr_eq(NULL, snapshot.refs);
+  ck_assert_uint_eq(1, *journal.refs);
+  ck_assert_uint_eq(1, pb_journal_version(&snapshot));
+
+  /* Assert contents */
+  ck_assert_uint_eq(4, pb_journal_size(&snapshot));
+  fail_if(memcmp("SOME", pb_journal_data(&snapshot), 4));
+  ck_assert_uint_eq(9, pb_journal_size(&journal));
+  fail_if(memcmp("SOME DATA", pb_journal_data(&journal), 9));
+
+  /* Write to journal, which is now the last one referencing the buffer */
+  const uint8_t *data = pb_journal_data(&journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 0, 4,
+    (uint8_t *)"EMOS", 4));
+  ck_assert_ptr_eq(data, pb_journal_data(&journal));
+  ck_assert_ptr_eq(NULL, journal.refs);
+  fail_if(memcmp("EMOS DATA", pb_journal_data(&journal), 9));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&snapshot);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create several snapshots of a journal and write to the journal.
+ */
+START_TEST(test_snapshot_multiple) {
+  pb_journal_t journal = pb_journal_create((uint8_t *)"SOME DATA", 9);
+  pb_journal_t snapshot1 = pb_journal_snapshot(&journal),
+               snapshot2 = pb_journal_snapshot(&journal);
+  ck_assert_uint_eq(3, *journal.refs);
+
+  /* Write data of same length to journal */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 0, 4,
+    (uint8_t *)"EMOS", 4));
+  fail_if(memcmp("EMOS DATA", pb_journal_data(&journal), 9));
+  ck_assert_uint_eq(2, *snapshot1.refs);
+
+  /* Assert snapshots are unaltered and still share the buffer */
+  fail_if(memcmp("SOME DATA", pb_journal_data(&snapshot1), 9));
+  ck_assert_ptr_eq(pb_journal_data(&snapshot1), pb_journal_data(&snapshot2));
+
+  /* Destroy snapshots in creation order */
+  pb_journal_destroy(&snapshot1);
+  ck_assert_uint_eq(1, *snapshot2.refs);
+  fail_if(memcmp("SOME DATA", pb_journal_data(&snapshot2), 9));
+  pb_journal_destroy(&snapshot2);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Destroy a journal before its snapshot.
+ */
+START_TEST(test_snapshot_destroy) {
+  pb_journal_t journal  = pb_journal_create((uint8_t *)"SOME DATA", 9);
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+  pb_journal_destroy(&journal);
+
+  /* Assert snapshot is unaltered */
+  fail_unless(pb_journal_valid(&snapshot));
+  fail_if(memcmp("SOME DATA", pb_journal_data(&snapshot), 9));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&snapshot);
+} END_TEST
+
+/*
+ * Create a snapshot of a zero-copy journal.
+ */
+START_TEST(test_snapshot_zero_copy) {
+  uint8_t data[] = "SOME DATA";
+  size_t  size   = 9;
+
+  /* Create journal and snapshot */
+  pb_journal_t journal  = pb_journal_create_zero_copy(data, size);
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+
+  /* Assert snapshot validity and error */
+  fail_if(pb_journal_valid(&snapshot));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_journal_error(&snapshot));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a snapshot of a shared journal.
+ */
+START_TEST(test_snapshot_shared) {
+  pb_journal_t journal = pb_journal_create((uint8_t *)"SOME DATA", 9);
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+
+  /* Share journal, detaching it from the snapshot */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+  ck_assert_ptr_eq(NULL, journal.refs);
+  ck_assert_ptr_ne(pb_journal_data(&journal), pb_journal_data(&snapshot));
+  pb_journal_destroy(&snapshot);
+
+  /* Create snapshot of shared journal */
+  snapshot = pb_journal_snapshot(&journal);
+  fail_if(pb_journal_valid(&snapshot));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a snapshot of an invalid journal.
+ */
+START_TEST(test_snapshot_invalid) {
+  pb_journal_t journal  = pb_journal_create_invalid();
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+
+  /* Assert snapshot validity and error */
+  fail_if(pb_journal_valid(&snapshot));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_journal_error(&snapshot));
+} END_TEST
+
+/*
+ * Share a journal and write to it.
+ */
+START_TEST(test_share) {
+  pb_journal_t journal = pb_journal_create_empty();
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+
+  /* Grow journal: "" => "SOME DATA" */
+  uint8_t data[] = "SOME DATA";
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 0, 0,
+    data, 9));
+  ck_assert_uint_eq(9, pb_journal_size(&journal));
+  ck_assert_uint_eq(1, pb_journal_version(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), 9));
+
+  /* Write in place: "SOME DATA" => "SOME ATAD" */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 5, 9,
+    (uint8_t *)"ATAD", 4));
+  ck_assert_uint_eq(9, pb_journal_size(&journal));
+  ck_assert_uint_eq(1, pb_journal_version(&journal));
+  fail_if(memcmp("SOME ATAD", pb_journal_data(&journal), 9));
+
+  /* Shrink journal: "SOME ATAD" => "SOMETAD" */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_clear(&journal, 4, 4, 6));
+  ck_assert_uint_eq(7, pb_journal_size(&journal));
+  ck_assert_uint_eq(2, pb_journal_version(&journal));
+  fail_if(memcmp("SOMETAD", pb_journal_data(&journal), 7));
+
+  /* Assert entries, sequence and revision */
+  ck_assert_uint_eq(9,  journal.entry.data[0].delta);
+  ck_assert_uint_eq(-2, journal.entry.data[1].delta);
+  ck_assert_uint_eq(6,  pb_journal_read_begin(&journal));
+  ck_assert_uint_eq(3,  pb_journal_revision(&journal));
+
+  /* Assert retired allocations */
+  ck_assert_uint_eq(3, journal.shared.retired.size);
+  pb_journal_reclaim(&journal);
+  ck_assert_uint_eq(0, journal.shared.retired.size);
+
+  /* Clear journal: "SOMETAD" => "" */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_clear(&journal, 0, 0, 7));
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(3, pb_journal_version(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Share a journal which already holds entries.
+ */
+START_TEST(test_share_entries) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Grow journal before and after sharing */
+  uint8_t data[] = "HELP I'M TRAPPED IN A UNIVERSE FACTORY";
+  for (size_t s = 1; s < 38; s++) {
+    if (s == 4)
+      ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 0,
+      pb_journal_size(&journal), data, s));
+  }
+
+  /* Assert contents and entries */
+  ck_assert_uint_eq(37, pb_journal_size(&journal));
+  ck_assert_uint_eq(37, pb_journal_version(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), 37));
+  for (size_t e = 0; e < 37; e++)
+    ck_assert_uint_eq(1, journal.entry.data[e].delta);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Share a zero-copy journal.
+ */
+START_TEST(test_share_zero_copy) {
+  uint8_t data[] = "SOME DATA";
+  size_t  size   = 9;
+
+  /* Create journal */
+  pb_journal_t journal = pb_journal_create_zero_copy(data, size);
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_journal_share(&journal));
+  ck_assert_uint_eq(0, journal.shared.enabled);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a view on a shared journal.
+ */
+START_TEST(test_view) {
+  pb_journal_t journal = pb_journal_create((uint8_t *)"SOME DATA", 9);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+
+  /* Create view and alter journal: "SOME DATA" => "SOME" */
+  pb_journal_t view = pb_journal_view(&journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_clear(&journal, 4, 4, 9));
+
+  /* Assert view is unaltered */
+  fail_unless(pb_journal_valid(&view));
+  ck_assert_uint_eq(9, pb_journal_size(&view));
+  ck_assert_uint_eq(0, pb_journal_version(&view));
+  fail_if(memcmp("SOME DATA", pb_journal_data(&view), 9));
+  fail_unless(pb_journal_read_retry(&journal, view.shared.sequence));
+  pb_journal_destroy(&view);
+
+  /* Create a new view and align a part */
+  view = pb_journal_view(&journal);
+  ck_assert_uint_eq(4, pb_journal_size(&view));
+  ck_assert_uint_eq(1, pb_journal_version(&view));
+  fail_if(pb_journal_read_retry(&journal, view.shared.sequence));
+
+  pb_version_t version = 0;
+  pb_offset_t  offset  = { 0, 9 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_align(&view, &version, &offset));
+  ck_assert_uint_eq(1, version);
+  ck_assert_uint_eq(4, offset.end);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&view);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a view on an invalid journal.
+ */
+START_TEST(test_view_invalid) {
+  pb_journal_t journal = pb_journal_create_invalid();
+  pb_journal_t view    = pb_journal_view(&journal);
+
+  /* Assert view validity and error */
+  fail_if(pb_journal_valid(&view));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_journal_error(&view));
+} END_TEST
+
+/*
+ * Write data outside of a shared journal's boundaries.
+ */
+START_TEST(test_share_invalid_offset) {
+  pb_journal_t journal = pb_journal_create((uint8_t *)"SOME DATA", 9);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+
+  /* Write data */
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_journal_write(&journal, 0, 8, 10,
+    (uint8_t *)"DATA", 4));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Share an invalid journal.
+ */
+START_TEST(test_share_invalid) {
+  pb_journal_t journal = pb_journal_create_invalid();
+
+  /* Assert journal validity and error */
+  fail_if(pb_journal_valid(&journal));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_share(&journal));
+} END_TEST
+
+/*
+ * Detect a write within a read section.
+ */
+START_TEST(test_read_retry) {
+  pb_journal_t journal = pb_journal_create_empty();
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+
+  /* Read without and with a write in between */
+  size_t sequence = pb_journal_read_begin(&journal);
+  fail_if(pb_journal_read_retry(&journal, sequence));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 0, 0,
+    (uint8_t *)"DATA", 4));
+  fail_unless(pb_journal_read_retry(&journal, sequence));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Nest write sections on a shared journal.
+ */
+START_TEST(test_write_section) {
+  pb_journal_t journal = pb_journal_create_empty();
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+
+  /* Write within nested write sections */
+  size_t sequence = pb_journal_read_begin(&journal);
+  pb_journal_write_begin(&journal);
+  pb_journal_write_begin(&journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 0, 0,
+    (uint8_t *)"DATA", 4));
+  pb_journal_write_end(&journal);
+  ck_assert_uint_eq(sequence + 1, journal.shared.sequence);
+  pb_journal_write_end(&journal);
+  ck_assert_uint_eq(sequence + 2, journal.shared.sequence);
+  fail_unless(pb_journal_read_retry(&journal, sequence));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Begin and end a write section on a journal which is not shared.
+ */
+START_TEST(test_write_section_unshared) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Write within write section */
+  pb_journal_write_begin(&journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 0, 0,
+    (uint8_t *)"DATA", 4));
+  pb_journal_write_end(&journal);
+  ck_assert_uint_eq(0, journal.shared.sequence);
+  ck_assert_uint_eq(0, journal.shared.depth);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/* Whether the writer has finished */
+static int
+done;
+
+/*
+ * Read a shared journal concurrently, counting inconsistent reads.
+ */
+static void *
+reader(void *data) {
+  const pb_journal_t *journal = data;
+  uintptr_t inconsistent = 0;
+  while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+    pb_journal_t view = pb_journal_view(journal);
+
+    /* Every byte must equal the size of the view */
+    size_t size = pb_journal_size(&view);
+    for (size_t b = 0; b < size; b++)
+      inconsistent += pb_journal_data(&view)[b] != size;
+    inconsistent += pb_journal_version(&view) != pb_journal_revision(&view);
+    pb_journal_destroy(&view);
+  }
+  return (void *)inconsistent;
+}
+
+/*
+ * Write to a shared journal while it is read concurrently.
+ */
+START_TEST(test_share_concurrent) {
+  pb_journal_t journal = pb_journal_create_empty();
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+
+  /* Start reader */
+  pthread_t thread;
+  done = 0;
+  ck_assert_int_eq(0, pthread_create(&thread, NULL, reader, &journal));
+
+  /* Repeatedly replace contents with data of different sizes */
+  for (size_t w = 0; w < 10000; w++) {
+    uint8_t data[32];
+    size_t  size = w % 32 + 1;
+    memset(data, size, size);
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 0,
+      pb_journal_size(&journal), data, size));
+  }
+  __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+
+  /* Wait for reader and assert consistency */
+  void *inconsistent;
+  ck_assert_int_eq(0, pthread_join(thread, &inconsistent));
+  ck_assert_ptr_eq(NULL, inconsistent);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a journal in canonical form.
+ */
+START_TEST(test_canonicalize) {
+  const uint8_t data[] = {
+    42, 1, 'a', 16, 3, 8, 129, 0, 18, 2, 4, 5, 8, 2, 29, 1, 0, 0, 0, 42, 1, 'b'
+  };
+  pb_journal_t journal = pb_journal_create(data, 22);
+
+  /* Canonicalize journal */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+
+  /* Assert sorted fields, last occurrence and coalesced packed field */
+  ck_assert_uint_eq(18, pb_journal_size(&journal));
+  fail_if(memcmp((const uint8_t []){
+    8, 2, 18, 3, 3, 4, 5, 29, 1, 0, 0, 0, 42, 1, 'a', 42, 1, 'b'
+  }, pb_journal_data(&journal), 18));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+  ck_assert_uint_eq(1, pb_journal_revision(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a journal with submessages in canonical form.
+ */
+START_TEST(test_canonicalize_nested) {
+  const uint8_t data[] = { 34, 2, 8, 5, 34, 132, 0, 8, 2, 8, 1 };
+  pb_journal_t journal = pb_journal_create(data, 11);
+
+  /* Canonicalize journal */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+
+  /* Assert last occurrence and minimal length prefix */
+  ck_assert_uint_eq(4, pb_journal_size(&journal));
+  fail_if(memcmp((const uint8_t []){ 34, 2, 8, 1 },
+    pb_journal_data(&journal), 4));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a journal with members of a oneof in canonical form.
+ */
+START_TEST(test_canonicalize_oneof) {
+  const uint8_t data[] = { 56, 2, 48, 3, 8, 1, 56, 4 };
+  pb_journal_t journal = pb_journal_create(data, 8);
+
+  /* Canonicalize journal */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+
+  /* Assert last member */
+  ck_assert_uint_eq(4, pb_journal_size(&journal));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 56, 4 },
+    pb_journal_data(&journal), 4));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a journal with unknown fields in canonical form.
+ */
+START_TEST(test_canonicalize_unknown) {
+  const uint8_t data[] = { 82, 1, 'a', 80, 129, 0, 8, 1, 80, 2 };
+  pb_journal_t journal = pb_journal_create(data, 10);
+
+  /* Canonicalize journal */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+
+  /* Assert all occurrences of unknown fields */
+  ck_assert_uint_eq(9, pb_journal_size(&journal));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 82, 1, 'a', 80, 1, 80, 2 },
+    pb_journal_data(&journal), 9));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a journal with empty packed fields in canonical form.
+ */
+START_TEST(test_canonicalize_packed) {
+  const uint8_t data[] = { 18, 0, 8, 1, 18, 0 };
+  pb_journal_t journal = pb_journal_create(data, 6);
+
+  /* Canonicalize journal */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+
+  /* Assert omitted packed field */
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+  fail_if(memcmp((const uint8_t []){ 8, 1 },
+    pb_journal_data(&journal), 2));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a journal with packed values of an unpacked field in canonical form.
+ */
+START_TEST(test_canonicalize_unpacked) {
+  const uint8_t data[] = { 26, 8, 1, 0, 0, 0, 2, 0, 0, 0 };
+  pb_journal_t journal = pb_journal_create(data, 10);
+
+  /* Canonicalize journal */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+
+  /* Assert distinct fields */
+  ck_assert_uint_eq(10, pb_journal_size(&journal));
+  fail_if(memcmp((const uint8_t []){ 29, 1, 0, 0, 0, 29, 2, 0, 0, 0 },
+    pb_journal_data(&journal), 10));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a journal with entries in canonical form.
+ */
+START_TEST(test_canonicalize_entries) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Write fields in reverse order */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 0, 0,
+    (const uint8_t []){ 16, 1 }, 2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 2, 2,
+    (const uint8_t []){ 8, 1 }, 2));
+  ck_assert_uint_eq(2, pb_journal_version(&journal));
+
+  /* Canonicalize journal and assert reset entries */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+  ck_assert_uint_eq(3, pb_journal_revision(&journal));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 18, 1, 1 },
+    pb_journal_data(&journal), 5));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite an empty journal in canonical form.
+ */
+START_TEST(test_canonicalize_empty) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Canonicalize journal */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+  fail_unless(pb_journal_empty(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a zero-copy journal in canonical form.
+ */
+START_TEST(test_canonicalize_zero_copy) {
+  uint8_t data[] = { 42, 1, 'a', 8, 1 };
+  pb_journal_t journal = pb_journal_create_zero_copy(data, 5);
+
+  /* Canonicalize journal in place */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 42, 1, 'a' }, data, 5));
+
+  /* Canonicalize journal changing its size */
+  memcpy(data, (const uint8_t []){ 8, 129, 0, 8, 1 }, 5);
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_journal_canonicalize(&journal, &descriptor));
+  fail_if(memcmp((const uint8_t []){ 8, 129, 0, 8, 1 }, data, 5));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a journal sharing its buffer with a snapshot in canonical form.
+ */
+START_TEST(test_canonicalize_snapshot) {
+  const uint8_t data[] = { 16, 1, 8, 1 };
+  pb_journal_t journal  = pb_journal_create(data, 4);
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+
+  /* Canonicalize journal and assert snapshot is unaltered */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 18, 1, 1 },
+    pb_journal_data(&journal), 5));
+  fail_if(memcmp(data, pb_journal_data(&snapshot), 4));
+  ck_assert_ptr_eq(NULL, journal.refs);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&snapshot);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a shared journal in canonical form.
+ */
+START_TEST(test_canonicalize_shared) {
+  const uint8_t data[] = { 16, 1, 8, 1 };
+  pb_journal_t journal = pb_journal_create(data, 4);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+
+  /* Create view and canonicalize journal */
+  pb_journal_t view = pb_journal_view(&journal);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_canonicalize(&journal, &descriptor));
+  fail_unless(pb_journal_read_retry(&journal, view.shared.sequence));
+
+  /* Assert view is unaltered and buffer is retired */
+  fail_if(memcmp(data, pb_journal_data(&view), 4));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 18, 1, 1 },
+    pb_journal_data(&journal), 5));
+  ck_assert_uint_eq(1, journal.shared.retired.size);
+  pb_journal_destroy(&view);
+
+  /* Write to journal after reset of entries */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 5, 5,
+    (const uint8_t []){ 8, 2 }, 2));
+  ck_assert_uint_eq(1, pb_journal_version(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite a journal with malformed data in canonical form.
+ */
+START_TEST(test_canonicalize_malformed) {
+  const uint8_t data[] = { 8, 1, 24, 1 };
+  pb_journal_t journal = pb_journal_create(data, 4);
+
+  /* Canonicalize journal with wiretype mismatch */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_journal_canonicalize(&journal, &descriptor));
+  fail_if(memcmp(data, pb_journal_data(&journal), 4));
+  ck_assert_uint_eq(0, pb_journal_revision(&journal));
+  pb_journal_destroy(&journal);
+
+  /* Canonicalize journal with truncated varint */
+  journal = pb_journal_create((const uint8_t []){ 8, 1, 8, 128 }, 4);
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_journal_canonicalize(&journal, &descriptor));
+  pb_journal_destroy(&journal);
+
+  /* Canonicalize journal with truncated length-prefixed field */
+  journal = pb_journal_create((const uint8_t []){ 42, 3, 'a' }, 3);
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_journal_canonicalize(&journal, &descriptor));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Rewrite an invalid journal in canonical form.
+ */
+START_TEST(test_canonicalize_invalid) {
+  pb_journal_t journal = pb_journal_create_invalid();
+
+  /* Assert journal validity and error */
+  fail_if(pb_journal_valid(&journal));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_journal_canonicalize(&journal, &descriptor));
+} END_TEST
+
 /* ----------------------------------------------------------------------------
  * Program
  * ------------------------------------------------------------------------- */
@@ -1051,6 +1881,9 @@ main(void) {
   tcase_add_test(tcase, test_create);
   tcase_add_test(tcase, test_create_empty);
   tcase_add_test(tcase, test_create_zero_copy);
+  tcase_add_test(tcase, test_create_from_record);
+  tcase_add_test(tcase, test_create_from_record_mmap);
+  tcase_add_test(tcase, test_create_from_record_invalid);
   tcase_add_test(tcase, test_create_invalid);
   tcase_add_test(tcase, test_create_invalid_allocate);
   suite_add_tcase(suite, tcase);
@@ -1088,6 +1921,48 @@ main(void) {
   tcase_add_test(tcase, test_align_invalid);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "snapshot" */
+  tcase = tcase_create("snapshot");
+  tcase_add_test(tcase, test_snapshot);
+  tcase_add_test(tcase, test_snapshot_multiple);
+  tcase_add_test(tcase, test_snapshot_destroy);
+  tcase_add_test(tcase, test_snapshot_zero_copy);
+  tcase_add_test(tcase, test_snapshot_shared);
+  tcase_add_test(tcase, test_snapshot_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "share" */
+  tcase = tcase_create("share");
+  tcase_add_test(tcase, test_share);
+  tcase_add_test(tcase, test_share_entries);
+  tcase_add_test(tcase, test_share_zero_copy);
+  tcase_add_test(tcase, test_share_invalid_offset);
+  tcase_add_test(tcase, test_share_invalid);
+  tcase_add_test(tcase, test_read_retry);
+  tcase_add_test(tcase, test_write_section);
+  tcase_add_test(tcase, test_write_section_unshared);
+  tcase_add_test(tcase, test_view);
+  tcase_add_test(tcase, test_view_invalid);
+  tcase_add_test(tcase, test_share_concurrent);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "canonicalize" */
+  tcase = tcase_create("canonicalize");
+  tcase_add_test(tcase, test_canonicalize);
+  tcase_add_test(tcase, test_canonicalize_nested);
+  tcase_add_test(tcase, test_canonicalize_oneof);
+  tcase_add_test(tcase, test_canonicalize_unknown);
+  tcase_add_test(tcase, test_canonicalize_packed);
+  tcase_add_test(tcase, test_canonicalize_unpacked);
+  tcase_add_test(tcase, test_canonicalize_entries);
+  tcase_add_test(tcase, test_canonicalize_empty);
+  tcase_add_test(tcase, test_canonicalize_zero_copy);
+  tcase_add_test(tcase, test_canonicalize_snapshot);
+  tcase_add_test(tcase, test_canonicalize_shared);
+  tcase_add_test(tcase, test_canonicalize_malformed);
+  tcase_add_test(tcase, test_canonicalize_invalid);
+  suite_add_tcase(suite, tcase);
+
   /* Create a test suite runner in no-fork mode */
   void *runner = srunner_create(suite);
   srunner_set_fork_status(runner, CK_NOFORK);
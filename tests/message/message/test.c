@@ -20,6 +20,7 @@
  * IN THE SOFTWARE.
  */
 
+#include <assert.h>
 #include <check.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -27,6 +28,7 @@
 
 #include <protobluff/descriptor.h>
 
+#include "core/allocator.h"
 #include "core/descriptor.h"
 #include "core/varint.h"
 #include "message/common.h"
@@ -35,6 +37,73 @@
 #include "message/journal.h"
 #include "message/message.h"
 
+/* ----------------------------------------------------------------------------
+ * System-default allocator callback overrides
+ * ------------------------------------------------------------------------- */
+
+/* Shared journal observed during allocations */
+static struct {
+  const pb_journal_t *journal;         /*!< Journal */
+  size_t views;                        /*!< Views taken */
+  size_t retries;                      /*!< Views retried */
+  size_t invalid;                      /*!< Views with invalid prefixes */
+} observer;
+
+/*!
+ * Take a view on the observed journal, as a concurrent reader would.
+ *
+ * Views can only be taken outside of write sections, and every view must
+ * consist of a message with a submessage with a submessage with a string.
+ */
+static void
+observe(void) {
+  if (!observer.journal)
+    return;
+  if (observer.journal->shared.sequence & 1) {
+    observer.retries++;
+    return;
+  }
+
+  /* Check length prefixes of all containing messages */
+  pb_journal_t view = pb_journal_view(observer.journal);
+  const uint8_t *data = pb_journal_data(&view);
+  size_t size = pb_journal_size(&view);
+  if (size < 6 || data[1] != size - 2 || data[3] != size - 4 ||
+      data[5] != size - 6)
+    observer.invalid++;
+  observer.views++;
+  pb_journal_destroy(&view);
+}
+
+/*!
+ * Allocator observing a shared journal upon allocation.
+ *
+ * \param[in,out] data Internal allocator data
+ * \param[in]     size Bytes to be allocated
+ * \return             Memory block
+ */
+static void *
+allocator_allocate_observe(void *data, size_t size) {
+  assert(!data && size);
+  observe();
+  return allocator_default.proc.allocate(data, size);
+}
+
+/*!
+ * Allocator observing a shared journal upon reallocation.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be resized
+ * \param[in]     size  Bytes to be allocated
+ * \return              Memory block
+ */
+static void *
+allocator_resize_observe(void *data, void *block, size_t size) {
+  assert(!data && size);
+  observe();
+  return allocator_default.proc.resize(data, block, size);
+}
+
 /* ----------------------------------------------------------------------------
  * Defaults
  * ------------------------------------------------------------------------- */
@@ -108,6 +177,18 @@ descriptor = { {
     { 15, "F15", MESSAGE, ONEOF, &descriptor, &oneof_descriptor }
   }, 15 } };
 
+/* Descriptor with repeated fields */
+static pb_descriptor_t
+descriptor_repeated = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  REPEATED, NULL, NULL, PACKED },
+    {  2, "F02", SINT64,  REPEATED, NULL, NULL, PACKED },
+    {  3, "F03", FLOAT,   REPEATED, NULL, NULL, PACKED },
+    {  4, "F04", UINT32,  REPEATED },
+    {  5, "F05", STRING,  REPEATED },
+    {  6, "F06", MESSAGE, OPTIONAL, &descriptor_repeated }
+  }, 6 } };
+
 /* ----------------------------------------------------------------------------
  * Tests
  * ------------------------------------------------------------------------- */
@@ -669,7 +750,7 @@ START_TEST(test_create_nested) {
     /* Create same submessage from root message */
     pb_message_t submessage = pb_message_create_nested(
       &(messages[0]), tags, m);
-    fail_unless(pb_message_equals(&(messages[m]), &submessage));
+    fail_unless(pb_message_same(&(messages[m]), &submessage));
 
     /* Assert submessage validity and error */
     fail_unless(pb_message_valid(&(messages[m])));
@@ -1136,7 +1217,7 @@ START_TEST(test_copy) {
   ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&copy));
 
   /* Assert same contents */
-  fail_unless(pb_message_equals(&message, &copy));
+  fail_unless(pb_message_same(&message, &copy));
 
   /* Free all allocated memory */
   pb_message_destroy(&copy);
@@ -1509,6 +1590,44 @@ START_TEST(test_get) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Read the value for a given tag from a view on a shared journal.
+ */
+START_TEST(test_get_shared) {
+  const uint8_t data[] = { 8, 127 };
+  const size_t  size   = 2;
+
+  /* Create shared journal, view and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+  pb_journal_t view    = pb_journal_view(&journal);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Write value to message, changing its size */
+  uint32_t value = 300;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 1, &value));
+  ck_assert_uint_eq(3, pb_journal_size(&journal));
+
+  /* Read value from previous view */
+  pb_message_t reader = pb_message_create(&descriptor, &view);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&reader, 1, &value));
+  ck_assert_uint_eq(127, value);
+  pb_message_destroy(&reader);
+  pb_journal_destroy(&view);
+
+  /* Read value from current view */
+  view   = pb_journal_view(&journal);
+  reader = pb_message_create(&descriptor, &view);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&reader, 1, &value));
+  ck_assert_uint_eq(300, value);
+  pb_message_destroy(&reader);
+  pb_journal_destroy(&view);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Read the value for a given tag from an empty message.
  */
@@ -1865,6 +1984,238 @@ START_TEST(test_get_invalid) {
   pb_message_destroy(&message);
 } END_TEST
 
+/*
+ * Read all values of a repeated field from a message into an array.
+ */
+START_TEST(test_get_repeated) {
+  const uint8_t data[] = { 32, 1, 8, 127, 32, 2, 32, 172, 2 };
+  const size_t  size   = 9;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Read values from message */
+  uint32_t values[4]; size_t count;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_get_repeated(&message, 4, values, 4, &count));
+  ck_assert_uint_eq(3, count);
+  ck_assert_uint_eq(1, values[0]);
+  ck_assert_uint_eq(2, values[1]);
+  ck_assert_uint_eq(300, values[2]);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all values of a packed varint field from a message into an array.
+ */
+START_TEST(test_get_repeated_packed) {
+  uint8_t data[32] = { 10, 22 };
+  for (size_t v = 0; v < 20; v++)
+    data[2 + v] = v;
+  data[22] = 172; data[23] = 2;
+  data[24] = 10;  data[25] = 1; data[26] = 20;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, 27);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Read values from message */
+  uint32_t values[32]; size_t count;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_get_repeated(&message, 1, values, 32, &count));
+  ck_assert_uint_eq(22, count);
+  for (size_t v = 0; v < 20; v++)
+    ck_assert_uint_eq(v, values[v]);
+  ck_assert_uint_eq(300, values[20]);
+  ck_assert_uint_eq(20, values[21]);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all values of a packed zig-zag encoded field from a message.
+ */
+START_TEST(test_get_repeated_packed_zigzag) {
+  const uint8_t data[] = { 18, 11, 1, 2, 3, 4, 5, 6, 7, 8, 9, 255, 1 };
+  const size_t  size   = 13;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Read values from message */
+  int64_t values[10]; size_t count;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_get_repeated(&message, 2, values, 10, &count));
+  ck_assert_uint_eq(10, count);
+  ck_assert_int_eq(-1, values[0]);
+  ck_assert_int_eq( 1, values[1]);
+  ck_assert_int_eq(-2, values[2]);
+  ck_assert_int_eq( 4, values[7]);
+  ck_assert_int_eq(-5, values[8]);
+  ck_assert_int_eq(-128, values[9]);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all values of a merged packed fixed-sized field from a message.
+ */
+START_TEST(test_get_repeated_packed_merged) {
+  const float values[] = { 1, 2, 3, 4, 5, 6 };
+  uint8_t data[31] = { 26, 12 };
+  memcpy(&(data[2]), values, 12);
+  data[14] = 29;
+  memcpy(&(data[15]), &(values[3]), 4);
+  data[19] = 26; data[20] = 8;
+  memcpy(&(data[21]), &(values[4]), 8);
+  data[29] = 8; data[30] = 1;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, 31);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Read values from message */
+  float temp[6]; size_t count;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_get_repeated(&message, 3, temp, 6, &count));
+  ck_assert_uint_eq(6, count);
+  fail_if(memcmp(values, temp, sizeof(values)));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all values of a repeated field from a message into a small array.
+ */
+START_TEST(test_get_repeated_partial) {
+  const float values[] = { 1, 2, 3, 4, 5, 6 };
+  uint8_t data[26] = { 26, 24 };
+  memcpy(&(data[2]), values, 24);
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, 26);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Read values from message */
+  float temp[4] = { 0, 0, 0, 0 }; size_t count;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_get_repeated(&message, 3, temp, 3, &count));
+  ck_assert_uint_eq(6, count);
+  fail_if(memcmp(values, temp, 3 * sizeof(float)));
+  fail_unless(temp[3] == 0);
+
+  /* Count values only */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_get_repeated(&message, 3, NULL, 0, &count));
+  ck_assert_uint_eq(6, count);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all values of a repeated string field from a message into an array.
+ */
+START_TEST(test_get_repeated_string) {
+  const uint8_t data[] = { 42, 1, 65, 8, 1, 42, 2, 66, 67 };
+  const size_t  size   = 9;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Read values from message */
+  pb_string_t values[2]; size_t count;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_get_repeated(&message, 5, values, 2, &count));
+  ck_assert_uint_eq(2, count);
+  ck_assert_uint_eq(1, pb_string_size(&(values[0])));
+  ck_assert_uint_eq(2, pb_string_size(&(values[1])));
+  fail_if(memcmp("BC", pb_string_data(&(values[1])), 2));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all values of a repeated field from a message with an invalid varint.
+ */
+START_TEST(test_get_repeated_invalid_varint) {
+  const uint8_t data[] = { 10, 3, 1, 2, 128 };
+  const size_t  size   = 5;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
+
+  /* Read values from message */
+  uint32_t values[4]; size_t count;
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_message_get_repeated(&message, 1, values, 4, &count));
+  ck_assert_uint_eq(2, count);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all values of a repeated field from an invalid message.
+ */
+START_TEST(test_get_repeated_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+
+  /* Read values from message */
+  uint32_t values[4]; size_t count;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_get_repeated(&message, 1, values, 4, &count));
+  ck_assert_uint_eq(0, count);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
 /*
  * Write a value for a given tag to a message.
  */
@@ -2408,7 +2759,7 @@ START_TEST(test_put_unaligned) {
   ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message1));
 
   /* Assert messages are unaligned */
-  fail_if(pb_message_equals(&message1, &message2));
+  fail_if(pb_message_same(&message1, &message2));
 
   /* Assert contents */
   ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message1, 1, &value1));
@@ -2420,6 +2771,51 @@ START_TEST(test_put_unaligned) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Write a value for a given tag to a nested message of a shared journal.
+ */
+START_TEST(test_put_shared_nested) {
+  const uint8_t data[] = { 90, 5, 90, 3, 66, 1, 104 };
+  const size_t  size   = 7;
+
+  /* Patch allocator */
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_allocate_observe,
+      .resize   = allocator_resize_observe,
+      .free     = allocator_default.proc.free
+    }
+  };
+
+  /* Create shared journal and nested message */
+  pb_journal_t journal =
+    pb_journal_create_with_allocator(&allocator, data, size);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_share(&journal));
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t nested  = pb_message_create_nested(&message,
+    (const pb_tag_t []){ 11, 11 }, 2);
+
+  /* Write value to nested message, while taking views upon allocation */
+  pb_string_t value = pb_string_init_from_chars("hello");
+  observer.journal = &journal;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&nested, 8, &value));
+  observer.journal = NULL;
+
+  /* Assert views were only taken outside of the write section */
+  fail_unless(observer.retries);
+  ck_assert_uint_eq(0, observer.invalid);
+
+  /* Assert journal contents */
+  const uint8_t check[] = { 90, 9, 90, 7, 66, 5, 104, 101, 108, 108, 111 };
+  ck_assert_uint_eq(11, pb_journal_size(&journal));
+  fail_if(memcmp(check, pb_journal_data(&journal), 11));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&nested);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Write a value for a given tag to an invalid message.
  */
@@ -2439,27 +2835,31 @@ START_TEST(test_put_invalid) {
 } END_TEST
 
 /*
- * Erase a field for a given tag from a message.
+ * Append values to a repeated field of a message.
  */
-START_TEST(test_erase) {
-  const uint8_t data[] = { 8, 127 };
-  const size_t  size   = 2;
+START_TEST(test_put_repeated) {
+  uint8_t data[] = { 32, 1, 32, 2, 32, 172, 2 };
+  size_t  size   = 7;
 
   /* Create journal and message */
-  pb_journal_t journal = pb_journal_create(data, size);
-  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
 
-  /* Clear field from message */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  /* Write values to message */
+  uint32_t values[] = { 1, 2, 300 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_repeated(&message, 4, values, 3));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  /* Align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message size and version */
+  ck_assert_uint_eq(7, pb_message_size(&message));
+  ck_assert_uint_eq(1, pb_message_version(&message));
 
   /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  ck_assert_uint_eq(7, pb_journal_size(&journal));
 
   /* Free all allocated memory */
   pb_message_destroy(&message);
@@ -2467,23 +2867,28 @@ START_TEST(test_erase) {
 } END_TEST
 
 /*
- * Erase a field for a given tag from an empty message.
+ * Append values to a packed field of a message.
  */
-START_TEST(test_erase_empty) {
-  pb_journal_t journal = pb_journal_create_empty();
-  pb_message_t message = pb_message_create(&descriptor, &journal);
+START_TEST(test_put_repeated_packed) {
+  const uint8_t data[] = { 10, 4, 1, 2, 172, 2, 32, 5 };
+  const size_t  size   = 8;
 
-  /* Clear field from message */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(&(data[6]), 2);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  /* Write values to message */
+  uint32_t values[] = { 1, 2, 300 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_repeated(&message, 1, values, 3));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message size and version */
+  ck_assert_uint_eq(8, pb_message_size(&message));
+  ck_assert_uint_eq(1, pb_message_version(&message));
 
   /* Free all allocated memory */
   pb_message_destroy(&message);
@@ -2491,27 +2896,32 @@ START_TEST(test_erase_empty) {
 } END_TEST
 
 /*
- * Erase a field for a given tag from a merged message.
+ * Append values to a packed field of a message ending with a packed field.
  */
-START_TEST(test_erase_merged) {
-  const uint8_t data[] = { 8, 1, 8, 2, 8, 3, 8, 4 };
-  const size_t  size   = 8;
+START_TEST(test_put_repeated_packed_merged) {
+  const uint8_t data[] = { 10, 2, 1, 2, 32, 5 };
+  const size_t  size   = 6;
 
   /* Create journal and message */
   pb_journal_t journal = pb_journal_create(data, size);
-  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
 
-  /* Clear field from message */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  /* Write values to message */
+  uint32_t values[] = { 3, 4 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_repeated(&message, 1, values, 2));
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  /* Assert journal data and size */
+  const uint8_t check[] = { 10, 4, 1, 2, 3, 4, 32, 5 };
+  ck_assert_uint_eq(8, pb_journal_size(&journal));
+  fail_if(memcmp(check, pb_journal_data(&journal), 8));
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Read values from message */
+  uint32_t temp[4]; size_t count;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_get_repeated(&message, 1, temp, 4, &count));
+  ck_assert_uint_eq(4, count);
+  ck_assert_uint_eq(4, temp[3]);
 
   /* Free all allocated memory */
   pb_message_destroy(&message);
@@ -2519,25 +2929,681 @@ START_TEST(test_erase_merged) {
 } END_TEST
 
 /*
- * Clear a submessage for a given tag from a message.
+ * Append values to a repeated string field of a message.
  */
-START_TEST(test_erase_message) {
-  pb_journal_t journal = pb_journal_create_empty();
-  pb_message_t message = pb_message_create(&descriptor, &journal);
-  pb_message_t submessage = pb_message_create_within(&message, 11);
+START_TEST(test_put_repeated_string) {
+  const uint8_t data[] = { 8, 1, 42, 1, 65, 42, 2, 66, 67, 42, 1, 68 };
+  const size_t  size   = 12;
 
-  /* Align messages to perform checks */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, 5);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
+
+  /* Write values to message */
+  pb_string_t values[] = {
+    pb_string_init_from_chars("BC"),
+    pb_string_init_from_chars("D")
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_repeated(&message, 5, values, 2));
+
+  /* Assert journal data and size */
+  ck_assert_uint_eq(size, pb_journal_size(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
 
-  /* Assert message size and version */
-  fail_if(pb_message_empty(&message));
-  ck_assert_uint_eq(2, pb_message_size(&message));
-  ck_assert_uint_eq(1, pb_message_version(&message));
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
 
-  /* Clear submessage and align message to perform checks */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+/*
+ * Append values to a repeated field of a nested message.
+ */
+START_TEST(test_put_repeated_nested) {
+  const uint8_t data[] = { 32, 9, 50, 4, 32, 7, 50, 0 };
+  const size_t  size   = 8;
+
+  /* Create journal, message and submessage */
+  pb_journal_t journal    = pb_journal_create(data, size);
+  pb_message_t message    = pb_message_create(&descriptor_repeated, &journal);
+  pb_message_t submessage = pb_message_create_nested(&message,
+    (const pb_tag_t []){ 6, 6 }, 2);
+
+  /* Assert submessage validity */
+  fail_unless(pb_message_valid(&submessage));
+
+  /* Write values to submessage */
+  uint32_t values[] = { 1, 2, 3 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_repeated(&submessage, 1, values, 3));
+
+  /* Assert journal data and size */
+  const uint8_t check[] = { 32, 9, 50, 9, 32, 7, 50, 5, 10, 3, 1, 2, 3 };
+  ck_assert_uint_eq(13, pb_journal_size(&journal));
+  fail_if(memcmp(check, pb_journal_data(&journal), 13));
+
+  /* Align submessage to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage));
+  ck_assert_uint_eq(5, pb_message_size(&submessage));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Append values to a repeated field of an invalid message.
+ */
+START_TEST(test_put_repeated_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+
+  /* Write values to message */
+  uint32_t values[] = { 1, 2, 3 };
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_put_repeated(&message, 1, values, 3));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
+/*
+ * Test whether two messages have equal contents.
+ */
+START_TEST(test_equals) {
+  pb_journal_t journal1 = pb_journal_create(
+    (const uint8_t []){ 8, 1, 16, 2 }, 4);
+  pb_journal_t journal2 = pb_journal_create(
+    (const uint8_t []){ 16, 2, 8, 5, 8, 129, 0 }, 7);
+  pb_journal_t journal3 = pb_journal_create(
+    (const uint8_t []){ 16, 2, 8, 2 }, 4);
+
+  /* Create messages */
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1);
+  pb_message_t message2 = pb_message_create(&descriptor, &journal2);
+  pb_message_t message3 = pb_message_create(&descriptor, &journal3);
+
+  /* Assert equality regardless of order, shadowing and encoding */
+  fail_unless(pb_message_equals(&message1, &message1));
+  fail_unless(pb_message_equals(&message1, &message2));
+  fail_unless(pb_message_equals(&message2, &message1));
+  fail_if(pb_message_equals(&message1, &message3));
+  fail_if(pb_message_equals(&message2, &message3));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message3);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal3);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Test whether two messages with repeated fields have equal contents.
+ */
+START_TEST(test_equals_repeated) {
+  pb_journal_t journal1 = pb_journal_create(
+    (const uint8_t []){ 10, 1, 1, 32, 3, 10, 1, 2 }, 8);
+  pb_journal_t journal2 = pb_journal_create(
+    (const uint8_t []){ 10, 2, 1, 2, 32, 3 }, 6);
+  pb_journal_t journal3 = pb_journal_create(
+    (const uint8_t []){ 10, 2, 2, 1, 32, 3 }, 6);
+
+  /* Create messages */
+  pb_message_t message1 = pb_message_create(&descriptor_repeated, &journal1);
+  pb_message_t message2 = pb_message_create(&descriptor_repeated, &journal2);
+  pb_message_t message3 = pb_message_create(&descriptor_repeated, &journal3);
+
+  /* Assert equality regardless of packed runs, but not order of values */
+  fail_unless(pb_message_equals(&message1, &message2));
+  fail_if(pb_message_equals(&message1, &message3));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message3);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal3);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Test whether two submessages have equal contents.
+ */
+START_TEST(test_equals_nested) {
+  pb_journal_t journal1 = pb_journal_create(
+    (const uint8_t []){ 8, 1, 90, 4, 16, 2, 8, 3 }, 8);
+  pb_journal_t journal2 = pb_journal_create(
+    (const uint8_t []){ 90, 4, 8, 3, 16, 2 }, 6);
+
+  /* Create messages and submessages */
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1);
+  pb_message_t message2 = pb_message_create(&descriptor, &journal2);
+  pb_message_t submessage1 = pb_message_create_within(&message1, 11);
+  pb_message_t submessage2 = pb_message_create_within(&message2, 11);
+
+  /* Assert equality of submessages, but not of messages */
+  fail_unless(pb_message_equals(&submessage1, &submessage2));
+  fail_if(pb_message_equals(&message1, &message2));
+  fail_if(pb_message_equals(&message1, &submessage1));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage2);
+  pb_message_destroy(&submessage1);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Test whether two messages of different types have equal contents.
+ */
+START_TEST(test_equals_descriptor) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Create messages */
+  pb_message_t message1 = pb_message_create(&descriptor, &journal);
+  pb_message_t message2 = pb_message_create(&descriptor_repeated, &journal);
+
+  /* Assert inequality */
+  fail_if(pb_message_equals(&message1, &message2));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Test whether two invalid messages have equal contents.
+ */
+START_TEST(test_equals_invalid) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t invalid = pb_message_create_invalid();
+
+  /* Assert inequality */
+  fail_if(pb_message_equals(&message, &invalid));
+  fail_if(pb_message_equals(&invalid, &invalid));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&invalid);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Compute the hash of a message.
+ */
+START_TEST(test_hash) {
+  pb_journal_t journal1 = pb_journal_create(
+    (const uint8_t []){ 8, 1, 16, 2 }, 4);
+  pb_journal_t journal2 = pb_journal_create(
+    (const uint8_t []){ 16, 2, 8, 5, 8, 129, 0 }, 7);
+  pb_journal_t journal3 = pb_journal_create(
+    (const uint8_t []){ 16, 2, 8, 2 }, 4);
+
+  /* Create messages */
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1);
+  pb_message_t message2 = pb_message_create(&descriptor, &journal2);
+  pb_message_t message3 = pb_message_create(&descriptor, &journal3);
+
+  /* Assert equal hashes for equal messages */
+  ck_assert_uint_eq(pb_message_hash(&message1, 0),
+    pb_message_hash(&message2, 0));
+  fail_if(pb_message_hash(&message1, 0) == pb_message_hash(&message3, 0));
+  fail_if(pb_message_hash(&message1, 0) == pb_message_hash(&message1, 1));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message3);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal3);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Compute the hash of a malformed message.
+ */
+START_TEST(test_hash_malformed) {
+  pb_journal_t journal1 = pb_journal_create(
+    (const uint8_t []){ 8, 1, 16, 128 }, 4);
+  pb_journal_t journal2 = pb_journal_create(
+    (const uint8_t []){ 8, 1, 16, 129 }, 4);
+
+  /* Create messages */
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1);
+  pb_message_t message2 = pb_message_create(&descriptor, &journal2);
+
+  /* Assert hashes of raw data */
+  fail_if(pb_message_hash(&message1, 0) == pb_message_hash(&message2, 0));
+  fail_if(pb_message_equals(&message1, &message2));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Compute the hash of an invalid message.
+ */
+START_TEST(test_hash_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Assert hash depends on seed only */
+  ck_assert_uint_eq(pb_message_hash(&message, 0),
+    pb_message_hash(&message, 0));
+  fail_if(pb_message_hash(&message, 0) == pb_message_hash(&message, 1));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
+/*
+ * Compute the difference between two messages.
+ */
+START_TEST(test_diff) {
+  pb_journal_t journal1 = pb_journal_create(
+    (const uint8_t []){ 8, 1, 16, 2, 24, 3 }, 6);
+  pb_journal_t journal2 = pb_journal_create(
+    (const uint8_t []){ 32, 4, 16, 5, 8, 1 }, 6);
+
+  /* Create messages and patch */
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1);
+  pb_message_t message2 = pb_message_create(&descriptor, &journal2);
+  pb_buffer_t patch = pb_buffer_create_empty();
+
+  /* Compute difference and assert patch */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_diff(&patch, &message1, &message2));
+  ck_assert_uint_eq(9, pb_buffer_size(&patch));
+  fail_if(memcmp((const uint8_t []){ 8, 2, 16, 5, 13, 16, 2, 32, 4 },
+    pb_buffer_data(&patch), 9));
+
+  /* Apply patch and assert equality */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_patch(&message1, &patch));
+  fail_unless(pb_message_equals(&message1, &message2));
+  ck_assert_uint_eq(6, pb_journal_size(&journal1));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 16, 5, 32, 4 },
+    pb_journal_data(&journal1), 6));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Compute the difference between two messages with equal contents.
+ */
+START_TEST(test_diff_equal) {
+  pb_journal_t journal1 = pb_journal_create(
+    (const uint8_t []){ 8, 1, 16, 2 }, 4);
+  pb_journal_t journal2 = pb_journal_create(
+    (const uint8_t []){ 16, 2, 8, 5, 8, 1 }, 6);
+
+  /* Create messages and patch */
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1);
+  pb_message_t message2 = pb_message_create(&descriptor, &journal2);
+  pb_buffer_t patch = pb_buffer_create_empty();
+
+  /* Compute difference and assert empty patch */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_diff(&patch, &message1, &message2));
+  fail_unless(pb_buffer_empty(&patch));
+
+  /* Apply patch and assert unchanged message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_patch(&message1, &patch));
+  ck_assert_uint_eq(0, pb_journal_revision(&journal1));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Compute the difference between two messages with repeated fields.
+ */
+START_TEST(test_diff_repeated) {
+  pb_journal_t journal1 = pb_journal_create(
+    (const uint8_t []){ 10, 2, 1, 2, 32, 1 }, 6);
+  pb_journal_t journal2 = pb_journal_create(
+    (const uint8_t []){ 10, 3, 1, 2, 3, 32, 1, 32, 2 }, 9);
+
+  /* Create messages and patch */
+  pb_message_t message1 = pb_message_create(&descriptor_repeated, &journal1);
+  pb_message_t message2 = pb_message_create(&descriptor_repeated, &journal2);
+  pb_buffer_t patch = pb_buffer_create_empty();
+
+  /* Compute difference and assert appended values */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_diff(&patch, &message1, &message2));
+  ck_assert_uint_eq(9, pb_buffer_size(&patch));
+  fail_if(memcmp((const uint8_t []){ 6, 3, 10, 1, 3, 18, 2, 32, 2 },
+    pb_buffer_data(&patch), 9));
+
+  /* Apply patch and assert equality */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_patch(&message1, &patch));
+  fail_unless(pb_message_equals(&message1, &message2));
+  ck_assert_uint_eq(11, pb_journal_size(&journal1));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Compute the difference between two messages with submessages.
+ */
+START_TEST(test_diff_nested) {
+  pb_journal_t journal1 = pb_journal_create(
+    (const uint8_t []){ 8, 1, 90, 6, 8, 1, 16, 2, 24, 3 }, 10);
+  pb_journal_t journal2 = pb_journal_create(
+    (const uint8_t []){ 8, 1, 90, 6, 8, 1, 16, 2, 24, 4 }, 10);
+
+  /* Create messages and patch */
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1);
+  pb_message_t message2 = pb_message_create(&descriptor, &journal2);
+  pb_buffer_t patch = pb_buffer_create_empty();
+
+  /* Compute difference and assert patched submessage */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_diff(&patch, &message1, &message2));
+  ck_assert_uint_eq(6, pb_buffer_size(&patch));
+  fail_if(memcmp((const uint8_t []){ 47, 4, 12, 2, 24, 4 },
+    pb_buffer_data(&patch), 6));
+
+  /* Apply patch and assert equality */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_patch(&message1, &patch));
+  ck_assert_uint_eq(10, pb_journal_size(&journal1));
+  fail_if(memcmp(pb_journal_data(&journal2),
+    pb_journal_data(&journal1), 10));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Compute the difference between two invalid messages.
+ */
+START_TEST(test_diff_invalid) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Create messages and patch */
+  pb_message_t message1 = pb_message_create(&descriptor, &journal);
+  pb_message_t message2 = pb_message_create(&descriptor_repeated, &journal);
+  pb_message_t invalid = pb_message_create_invalid();
+  pb_buffer_t patch = pb_buffer_create_empty();
+
+  /* Assert invalid messages and different types */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_diff(&patch, &message1, &message2));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_diff(&patch, &message1, &invalid));
+  fail_unless(pb_buffer_empty(&patch));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_message_destroy(&invalid);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Apply a patch to a message with shadowed occurrences.
+ */
+START_TEST(test_patch) {
+  const uint8_t data[] = { 16, 9, 8, 1, 16, 2, 24, 3 };
+  const size_t  size   = 8;
+
+  /* Create journal, message and patch */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_buffer_t patch = pb_buffer_create(
+    (const uint8_t []){ 8, 2, 16, 5 }, 4);
+
+  /* Apply patch and assert all occurrences being replaced */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_patch(&message, &patch));
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 24, 3, 16, 5 },
+    pb_journal_data(&journal), 6));
+
+  /* Assert message size */
+  ck_assert_uint_eq(6, pb_message_size(&message));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Apply a patch to a submessage.
+ */
+START_TEST(test_patch_nested) {
+  const uint8_t data[] = { 8, 1, 90, 2, 8, 1 };
+  const size_t  size   = 6;
+
+  /* Create journal, message, submessage and patch */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+  pb_buffer_t patch = pb_buffer_create(
+    (const uint8_t []){ 8, 2, 16, 2 }, 4);
+
+  /* Apply patch and assert adjusted length prefix */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_patch(&submessage, &patch));
+  ck_assert_uint_eq(8, pb_journal_size(&journal));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 90, 4, 8, 1, 16, 2 },
+    pb_journal_data(&journal), 8));
+
+  /* Align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+  ck_assert_uint_eq(8, pb_message_size(&message));
+  ck_assert_uint_eq(4, pb_message_size(&submessage));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Apply a patch clearing all fields of a submessage.
+ */
+START_TEST(test_patch_clear) {
+  const uint8_t data[] = { 8, 1, 90, 2, 8, 1 };
+  const size_t  size   = 6;
+
+  /* Create journal, message, submessage and patch */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+  pb_buffer_t patch = pb_buffer_create((const uint8_t []){ 5 }, 1);
+
+  /* Apply patch and assert empty submessage */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_patch(&submessage, &patch));
+  ck_assert_uint_eq(4, pb_journal_size(&journal));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 90, 0 },
+    pb_journal_data(&journal), 4));
+
+  /* Align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+  ck_assert_uint_eq(4, pb_message_size(&message));
+  fail_unless(pb_message_empty(&submessage));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Apply an invalid patch to a message.
+ */
+START_TEST(test_patch_invalid) {
+  const uint8_t data[] = { 8, 1, 16, 2 };
+  const size_t  size   = 4;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Assert tags out of order */
+  pb_buffer_t patch1 = pb_buffer_create((const uint8_t []){ 13, 5 }, 2);
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_patch(&message, &patch1));
+  pb_buffer_destroy(&patch1);
+
+  /* Assert payload of other tag */
+  pb_buffer_t patch2 = pb_buffer_create(
+    (const uint8_t []){ 8, 2, 24, 3 }, 4);
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_patch(&message, &patch2));
+  pb_buffer_destroy(&patch2);
+
+  /* Assert patched field not being a submessage */
+  pb_buffer_t patch3 = pb_buffer_create((const uint8_t []){ 7, 0 }, 2);
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_patch(&message, &patch3));
+  pb_buffer_destroy(&patch3);
+
+  /* Assert truncated payload */
+  pb_buffer_t patch4 = pb_buffer_create(
+    (const uint8_t []){ 8, 5, 16 }, 3);
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_message_patch(&message, &patch4));
+  pb_buffer_destroy(&patch4);
+
+  /* Assert unchanged message */
+  ck_assert_uint_eq(4, pb_journal_size(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag from a message.
+ */
+START_TEST(test_erase) {
+  const uint8_t data[] = { 8, 127 };
+  const size_t  size   = 2;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Clear field from message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag from an empty message.
+ */
+START_TEST(test_erase_empty) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Clear field from message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag from a merged message.
+ */
+START_TEST(test_erase_merged) {
+  const uint8_t data[] = { 8, 1, 8, 2, 8, 3, 8, 4 };
+  const size_t  size   = 8;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Clear field from message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear a submessage for a given tag from a message.
+ */
+START_TEST(test_erase_message) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+
+  /* Align messages to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message size and version */
+  fail_if(pb_message_empty(&message));
+  ck_assert_uint_eq(2, pb_message_size(&message));
+  ck_assert_uint_eq(1, pb_message_version(&message));
+
+  /* Clear submessage and align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
 
   /* Assert message validity and error */
   fail_unless(pb_message_valid(&message));
@@ -3071,6 +4137,361 @@ START_TEST(test_clear_invalid) {
   pb_message_destroy(&message);
 } END_TEST
 
+/*
+ * Merge a message into another message.
+ */
+START_TEST(test_merge) {
+  const uint8_t data[] = { 8, 1 };
+  const size_t  size   = 2;
+
+  /* Create journals and messages */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_journal_t source_journal = pb_journal_create(
+    (const uint8_t []){ 8, 2, 16, 3 }, 4);
+  pb_message_t source = pb_message_create(&descriptor, &source_journal);
+
+  /* Merge message and assert last occurrence wins */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_merge(&message, &source));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 8, 2, 16, 3 },
+    pb_journal_data(&journal), 6));
+  uint32_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 1, &value));
+  ck_assert_uint_eq(2, value);
+
+  /* Assert journal size */
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&source);
+  pb_journal_destroy(&source_journal);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Merge a message into a submessage.
+ */
+START_TEST(test_merge_nested) {
+  const uint8_t data[] = { 90, 2, 8, 1, 104, 5 };
+  const size_t  size   = 6;
+
+  /* Create journals, messages and submessage */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+  pb_journal_t source_journal = pb_journal_create(
+    (const uint8_t []){ 8, 2, 16, 3 }, 4);
+  pb_message_t source = pb_message_create(&descriptor, &source_journal);
+
+  /* Merge message and assert length prefix and sibling */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_merge(&submessage, &source));
+  fail_if(memcmp((const uint8_t []){ 90, 6, 8, 1, 8, 2, 16, 3, 104, 5 },
+    pb_journal_data(&journal), 10));
+  uint32_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 13, &value));
+  ck_assert_uint_eq(5, value);
+
+  /* Align submessage to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage));
+  ck_assert_uint_eq(6, pb_message_size(&submessage));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&source);
+  pb_journal_destroy(&source_journal);
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Merge an empty message into another message.
+ */
+START_TEST(test_merge_empty) {
+  const uint8_t data[] = { 8, 1 };
+  const size_t  size   = 2;
+
+  /* Create journals and messages */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_journal_t source_journal = pb_journal_create_empty();
+  pb_message_t source = pb_message_create(&descriptor, &source_journal);
+
+  /* Merge message and assert journal */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_merge(&message, &source));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&source);
+  pb_journal_destroy(&source_journal);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Merge an invalid message into another message.
+ */
+START_TEST(test_merge_invalid) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t invalid = pb_message_create_invalid();
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&invalid));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&invalid));
+
+  /* Merge messages */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_merge(&message, &invalid));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_merge(&invalid, &message));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&invalid);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Merge a message of another type into a message.
+ */
+START_TEST(test_merge_invalid_descriptor) {
+  const uint8_t data[] = { 8, 1 };
+  const size_t  size   = 2;
+
+  /* Create journals and messages */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_journal_t source_journal = pb_journal_create(
+    (const uint8_t []){ 8, 2, 16, 3 }, 4);
+  pb_message_t source = pb_message_create(
+    &descriptor_repeated, &source_journal);
+
+  /* Merge message and assert journal */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_merge(&message, &source));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&source);
+  pb_journal_destroy(&source_journal);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Merge a message into a submessage sharing the same journal.
+ */
+START_TEST(test_merge_invalid_journal) {
+  const uint8_t data[] = { 90, 2, 8, 1, 104, 5 };
+  const size_t  size   = 6;
+
+  /* Create journal, message and submessage */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+
+  /* Merge messages and assert journal */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_merge(&submessage, &message));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_merge(&message, &message));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Remove shadowed occurrences of non-repeated fields from a message.
+ */
+START_TEST(test_squash) {
+  const uint8_t data[] = { 8, 1, 16, 2, 8, 3, 32, 4, 8, 5 };
+  const size_t  size   = 10;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Squash message and assert last occurrence remains */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_squash(&message));
+  fail_if(memcmp((const uint8_t []){ 16, 2, 32, 4, 8, 5 },
+    pb_journal_data(&journal), 6));
+  uint32_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 1, &value));
+  ck_assert_uint_eq(5, value);
+
+  /* Assert journal size */
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Squash a message without shadowed occurrences.
+ */
+START_TEST(test_squash_unique) {
+  const uint8_t data[] = { 8, 1, 16, 2 };
+  const size_t  size   = 4;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Squash message and assert journal is untouched */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_squash(&message));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Squash a message with members of a oneof.
+ */
+START_TEST(test_squash_oneof) {
+  const uint8_t data[] = { 104, 1, 112, 2, 8, 1, 104, 3 };
+  const size_t  size   = 8;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Squash message and assert last member remains */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_squash(&message));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 104, 3 },
+    pb_journal_data(&journal), 4));
+  ck_assert_uint_eq(4, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Squash a message with repeated fields and submessages.
+ */
+START_TEST(test_squash_repeated) {
+  const uint8_t data[] = { 50, 0, 32, 1, 10, 1, 2, 50, 2, 32, 7, 32, 3 };
+  const size_t  size   = 13;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor_repeated, &journal);
+
+  /* Squash message and assert repeated fields remain */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_squash(&message));
+  fail_if(memcmp((const uint8_t []){ 32, 1, 10, 1, 2, 50, 2, 32, 7, 32, 3 },
+    pb_journal_data(&journal), 11));
+  ck_assert_uint_eq(11, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Squash a submessage.
+ */
+START_TEST(test_squash_nested) {
+  const uint8_t data[] = { 90, 6, 8, 1, 16, 2, 8, 3, 104, 5 };
+  const size_t  size   = 10;
+
+  /* Create journal, message and submessage */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+
+  /* Squash submessage and assert length prefix and sibling */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_squash(&submessage));
+  fail_if(memcmp((const uint8_t []){ 90, 4, 16, 2, 8, 3, 104, 5 },
+    pb_journal_data(&journal), 8));
+  uint32_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 13, &value));
+  ck_assert_uint_eq(5, value);
+
+  /* Align submessage to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage));
+  ck_assert_uint_eq(4, pb_message_size(&submessage));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Squash a message after merging another message into it.
+ */
+START_TEST(test_squash_merged) {
+  const uint8_t data[] = { 8, 1, 16, 2 };
+  const size_t  size   = 4;
+
+  /* Create journals and messages */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_journal_t source_journal = pb_journal_create(
+    (const uint8_t []){ 8, 3 }, 2);
+  pb_message_t source = pb_message_create(&descriptor, &source_journal);
+
+  /* Merge and squash message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_merge(&message, &source));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_squash(&message));
+  fail_if(memcmp((const uint8_t []){ 16, 2, 8, 3 },
+    pb_journal_data(&journal), 4));
+  ck_assert_uint_eq(4, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&source);
+  pb_journal_destroy(&source_journal);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Squash a message with an invalid wiretype.
+ */
+START_TEST(test_squash_wiretype) {
+  const uint8_t data[] = { 8, 1, 15, 1 };
+  const size_t  size   = 4;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Squash message and assert journal is untouched */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_squash(&message));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Squash an invalid message.
+ */
+START_TEST(test_squash_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+
+  /* Squash message */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_squash(&message));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
 /*
  * Ensure that a message is properly aligned.
  */
@@ -3104,7 +4525,7 @@ START_TEST(test_align) {
   /* Assert alignment */
   ck_assert_uint_eq(1, pb_message_version(&submessage2));
   ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage2));
-  fail_unless(pb_message_equals(&submessage1, &submessage2));
+  fail_unless(pb_message_same(&submessage1, &submessage2));
 
   /* Free all allocated memory */
   pb_message_destroy(&submessage2);
@@ -3185,6 +4606,7 @@ main(void) {
   /* Add tests to test case "get" */
   tcase = tcase_create("get");
   tcase_add_test(tcase, test_get);
+  tcase_add_test(tcase, test_get_shared);
   tcase_add_test(tcase, test_get_empty);
   tcase_add_test(tcase, test_get_merged);
   tcase_add_test(tcase, test_get_default_uint32);
@@ -3202,6 +4624,18 @@ main(void) {
   tcase_add_test(tcase, test_get_invalid);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "get_repeated" */
+  tcase = tcase_create("get_repeated");
+  tcase_add_test(tcase, test_get_repeated);
+  tcase_add_test(tcase, test_get_repeated_packed);
+  tcase_add_test(tcase, test_get_repeated_packed_zigzag);
+  tcase_add_test(tcase, test_get_repeated_packed_merged);
+  tcase_add_test(tcase, test_get_repeated_partial);
+  tcase_add_test(tcase, test_get_repeated_string);
+  tcase_add_test(tcase, test_get_repeated_invalid_varint);
+  tcase_add_test(tcase, test_get_repeated_invalid);
+  suite_add_tcase(suite, tcase);
+
   /* Add tests to test case "put" */
   tcase = tcase_create("put");
   tcase_add_test(tcase, test_put);
@@ -3217,9 +4651,53 @@ main(void) {
   tcase_add_test(tcase, test_put_oneof_existing);
   tcase_add_test(tcase, test_put_oneof_merged);
   tcase_add_test(tcase, test_put_unaligned);
+  tcase_add_test(tcase, test_put_shared_nested);
   tcase_add_test(tcase, test_put_invalid);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "put_repeated" */
+  tcase = tcase_create("put_repeated");
+  tcase_add_test(tcase, test_put_repeated);
+  tcase_add_test(tcase, test_put_repeated_packed);
+  tcase_add_test(tcase, test_put_repeated_packed_merged);
+  tcase_add_test(tcase, test_put_repeated_string);
+  tcase_add_test(tcase, test_put_repeated_nested);
+  tcase_add_test(tcase, test_put_repeated_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "equals" */
+  tcase = tcase_create("equals");
+  tcase_add_test(tcase, test_equals);
+  tcase_add_test(tcase, test_equals_repeated);
+  tcase_add_test(tcase, test_equals_nested);
+  tcase_add_test(tcase, test_equals_descriptor);
+  tcase_add_test(tcase, test_equals_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "hash" */
+  tcase = tcase_create("hash");
+  tcase_add_test(tcase, test_hash);
+  tcase_add_test(tcase, test_hash_malformed);
+  tcase_add_test(tcase, test_hash_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "diff" */
+  tcase = tcase_create("diff");
+  tcase_add_test(tcase, test_diff);
+  tcase_add_test(tcase, test_diff_equal);
+  tcase_add_test(tcase, test_diff_repeated);
+  tcase_add_test(tcase, test_diff_nested);
+  tcase_add_test(tcase, test_diff_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "patch" */
+  tcase = tcase_create("patch");
+  tcase_add_test(tcase, test_patch);
+  tcase_add_test(tcase, test_patch_nested);
+  tcase_add_test(tcase, test_patch_clear);
+  tcase_add_test(tcase, test_patch_invalid);
+  suite_add_tcase(suite, tcase);
+
   /* Add tests to test case "erase" */
   tcase = tcase_create("erase");
   tcase_add_test(tcase, test_erase);
@@ -3246,6 +4724,28 @@ main(void) {
   tcase_add_test(tcase, test_clear_invalid);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "merge" */
+  tcase = tcase_create("merge");
+  tcase_add_test(tcase, test_merge);
+  tcase_add_test(tcase, test_merge_nested);
+  tcase_add_test(tcase, test_merge_empty);
+  tcase_add_test(tcase, test_merge_invalid);
+  tcase_add_test(tcase, test_merge_invalid_descriptor);
+  tcase_add_test(tcase, test_merge_invalid_journal);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "squash" */
+  tcase = tcase_create("squash");
+  tcase_add_test(tcase, test_squash);
+  tcase_add_test(tcase, test_squash_unique);
+  tcase_add_test(tcase, test_squash_oneof);
+  tcase_add_test(tcase, test_squash_repeated);
+  tcase_add_test(tcase, test_squash_nested);
+  tcase_add_test(tcase, test_squash_merged);
+  tcase_add_test(tcase, test_squash_wiretype);
+  tcase_add_test(tcase, test_squash_invalid);
+  suite_add_tcase(suite, tcase);
+
   /* Add tests to test case "align" */
   tcase = tcase_create("align");
   tcase_add_test(tcase, test_align);
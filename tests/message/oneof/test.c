@@ -48,6 +48,17 @@ oneof_descriptor = {
       1, 2, 3
     }, 3 } };
 
+/* Oneof descriptor with member tag bitmap */
+static const pb_oneof_descriptor_t
+oneof_descriptor_bitmap = {
+  &descriptor, {
+    (const size_t []){
+      1, 2, 3
+    }, 3 }, {
+    (const uint8_t []){
+      0x07
+    }, 2, 3 } };
+
 /* Descriptor */
 static pb_descriptor_t
 descriptor = { {
@@ -225,6 +236,140 @@ START_TEST(test_case_message_merged) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Retrieve the active tag of a oneof using a member tag bitmap.
+ */
+START_TEST(test_case_bitmap) {
+  const uint8_t data[] = { 8, 127, 16, 127, 24, 127, 40, 127 };
+  const size_t  size   = 8;
+
+  /* Create journal, message and oneof */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_oneof_t   oneof   = pb_oneof_create(&oneof_descriptor_bitmap, &message);
+
+  /* Assert oneof validity and error */
+  fail_unless(pb_oneof_valid(&oneof));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_oneof_error(&oneof));
+
+  /* Assert active tag */
+  ck_assert_uint_eq(3, pb_oneof_case(&oneof));
+
+  /* Assert membership */
+  fail_if(pb_oneof_descriptor_member(&oneof_descriptor_bitmap, 1));
+  fail_unless(pb_oneof_descriptor_member(&oneof_descriptor_bitmap, 2));
+  fail_unless(pb_oneof_descriptor_member(&oneof_descriptor_bitmap, 4));
+  fail_if(pb_oneof_descriptor_member(&oneof_descriptor_bitmap, 5));
+  fail_if(pb_oneof_descriptor_member(&oneof_descriptor_bitmap, 100));
+
+  /* Free all allocated memory */
+  pb_oneof_destroy(&oneof);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Retrieve the cached active tag of a oneof on an altered message.
+ */
+START_TEST(test_case_cached) {
+  const uint8_t data[] = { 8, 127, 16, 127 };
+  const size_t  size   = 4;
+
+  /* Create journal, message and oneof */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_oneof_t   oneof   = pb_oneof_create(&oneof_descriptor, &message);
+
+  /* Assert active tag and cache */
+  ck_assert_uint_eq(2, pb_oneof_case(&oneof));
+  ck_assert_uint_eq(2, oneof.cache.tag);
+  ck_assert_uint_eq(pb_journal_revision(&journal), oneof.cache.revision);
+  ck_assert_uint_eq(2, pb_oneof_case(&oneof));
+
+  /* Write another member of the oneof */
+  const uint32_t value = 1000000;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 3, &value));
+
+  /* Assert active tag and cache */
+  ck_assert_uint_eq(3, pb_oneof_case(&oneof));
+  ck_assert_uint_eq(3, oneof.cache.tag);
+  ck_assert_uint_eq(pb_journal_revision(&journal), oneof.cache.revision);
+
+  /* Clear oneof */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_oneof_clear(&oneof));
+
+  /* Assert active tag */
+  ck_assert_uint_eq(0, pb_oneof_case(&oneof));
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_oneof_destroy(&oneof);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Retrieve the cached active tag of a oneof on a patched message.
+ */
+START_TEST(test_case_cached_patch) {
+  const uint8_t data[] = { 16, 127 };
+  const size_t  size   = 2;
+
+  /* Create journals, messages and oneof */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_oneof_t   oneof   = pb_oneof_create(&oneof_descriptor, &message);
+  pb_journal_t target_journal = pb_journal_create(
+    (const uint8_t []){ 24, 127 }, 2);
+  pb_message_t target = pb_message_create(&descriptor, &target_journal);
+
+  /* Assert active tag */
+  ck_assert_uint_eq(2, pb_oneof_case(&oneof));
+
+  /* Replace member of the oneof without changing the size of the message */
+  pb_buffer_t patch = pb_buffer_create_empty();
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_diff(&patch, &message, &target));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_patch(&message, &patch));
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+
+  /* Assert active tag */
+  ck_assert_uint_eq(3, pb_oneof_case(&oneof));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_message_destroy(&target);
+  pb_journal_destroy(&target_journal);
+  pb_oneof_destroy(&oneof);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Retrieve the active tag of a oneof on a truncated message.
+ */
+START_TEST(test_case_message_truncated) {
+  const uint8_t data[] = { 16, 127, 26, 5, 1 };
+  const size_t  size   = 5;
+
+  /* Create journal, message and oneof */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_oneof_t   oneof   = pb_oneof_create(&oneof_descriptor, &message);
+
+  /* Assert active tag */
+  ck_assert_uint_eq(2, pb_oneof_case(&oneof));
+
+  /* Assert oneof validity and error */
+  fail_if(pb_oneof_valid(&oneof));
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_oneof_error(&oneof));
+
+  /* Free all allocated memory */
+  pb_oneof_destroy(&oneof);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Retrieve the active tag of a oneof on an invalid message.
  */
@@ -429,6 +574,10 @@ main(void) {
   tcase_add_test(tcase, test_case);
   tcase_add_test(tcase, test_case_message_empty);
   tcase_add_test(tcase, test_case_message_merged);
+  tcase_add_test(tcase, test_case_message_truncated);
+  tcase_add_test(tcase, test_case_bitmap);
+  tcase_add_test(tcase, test_case_cached);
+  tcase_add_test(tcase, test_case_cached_patch);
   tcase_add_test(tcase, test_case_message_invalid);
   tcase_add_test(tcase, test_case_invalid);
   suite_add_tcase(suite, tcase);
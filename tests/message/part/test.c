@@ -701,6 +701,50 @@ START_TEST(test_write_string) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Write no data to a part, clearing its contents.
+ */
+START_TEST(test_write_empty) {
+  const uint8_t data[] = { 66, 0 };
+  const size_t  size   = 2;
+
+  /* Create journal, message and part */
+  pb_journal_t journal = pb_journal_create(
+    (const uint8_t []){ 66, 4, 68, 65, 84, 65 }, 6);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_part_t    part    = pb_part_create(&message, 8);
+
+  /* Assert part size and version */
+  fail_if(pb_part_empty(&part));
+  ck_assert_uint_eq(4, pb_part_size(&part));
+  ck_assert_uint_eq(0, pb_part_version(&part));
+
+  /* Write no data to part */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_part_write(&part, NULL, 0));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+
+  /* Assert part validity and error again */
+  fail_unless(pb_part_valid(&part));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_part_error(&part));
+
+  /* Assert part size and version */
+  fail_unless(pb_part_empty(&part));
+  ck_assert_uint_eq(0, pb_part_size(&part));
+  ck_assert_uint_eq(1, pb_part_version(&part));
+
+  /* Assert part offsets */
+  ck_assert_uint_eq(2, pb_part_start(&part));
+  ck_assert_uint_eq(2, pb_part_end(&part));
+
+  /* Assert journal size */
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_part_destroy(&part);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Write a long string value to a part.
  */
@@ -1093,6 +1137,7 @@ main(void) {
   tcase_add_test(tcase, test_write);
   tcase_add_test(tcase, test_write_string);
   tcase_add_test(tcase, test_write_string_long);
+  tcase_add_test(tcase, test_write_empty);
   tcase_add_test(tcase, test_write_invalid);
   tcase_add_test(tcase, test_write_invalid_resize);
   tcase_add_test(tcase, test_write_invalid_zero_copy);
@@ -0,0 +1,504 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/iovec.h"
+#include "util/decoder.h"
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/* Number of buffers in a batch */
+#define BATCH_SIZE 1000
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32, OPTIONAL }
+  }, 1 } };
+
+/* Envelope descriptor */
+static pb_descriptor_t
+descriptor_envelope = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F02", MESSAGE, REPEATED, &descriptor }
+  }, 2 } };
+
+/* ----------------------------------------------------------------------------
+ * Fixtures
+ * ------------------------------------------------------------------------- */
+
+/* Raw data */
+static uint8_t
+data[BATCH_SIZE][2];
+
+/* Buffers */
+static pb_buffer_t
+buffers[BATCH_SIZE];
+
+/* Raw data of envelope */
+static uint8_t
+envelope[2 + BATCH_SIZE * 4];
+
+/* Number of delivered submessages */
+static size_t
+delivered;
+
+/* Sum of delivered values */
+static uint64_t
+total;
+
+/*
+ * Create a batch of buffers, each holding a single value.
+ */
+static void
+setup(void) {
+  for (size_t b = 0; b < BATCH_SIZE; ++b) {
+    data[b][0] = 8;
+    data[b][1] = b % 100;
+    buffers[b] = pb_buffer_create_zero_copy(data[b], 2);
+  }
+
+  /* Create envelope holding all values as submessages */
+  envelope[0] = 8;
+  envelope[1] = 127;
+  for (size_t b = 0; b < BATCH_SIZE; ++b)
+    memcpy(&(envelope[2 + b * 4]), (uint8_t []){ 18, 2, 8, b % 100 }, 4);
+  delivered = 0;
+  total     = 0;
+}
+
+/*
+ * Destroy the batch of buffers.
+ */
+static void
+teardown(void) {
+  for (size_t b = 0; b < BATCH_SIZE; ++b)
+    pb_buffer_destroy(&(buffers[b]));
+}
+
+/* ----------------------------------------------------------------------------
+ * Decoder callback
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Sum up all values, counting the number of invocations.
+ */
+static pb_error_t
+handler(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  uint64_t *sum = user;
+  sum[0] += *(const uint32_t *)value;
+  sum[1]++;
+  return PB_ERROR_NONE;
+}
+
+/*
+ * Decode a submessage, summing up its values.
+ */
+static pb_error_t
+handler_nested(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  return pb_decoder_decode(value, handler, user);
+}
+
+/*
+ * Consume the values of a chunk, ensuring chunks are delivered in order.
+ */
+static pb_error_t
+deliver(size_t offset, size_t size, void *user) {
+  uint64_t *sum = user;
+  if (offset != delivered || size != sum[1])
+    return PB_ERROR_INVALID;
+  delivered += size;
+  total     += sum[0];
+  sum[0] = sum[1] = 0;
+  return PB_ERROR_NONE;
+}
+
+/*
+ * Sum up the results of all threads and check them against the batch.
+ */
+static void
+check(uint64_t sums[][2], size_t threads, size_t size) {
+  uint64_t sum = 0, count = 0, expected = 0;
+  for (size_t t = 0; t < threads; ++t) {
+    sum   += sums[t][0];
+    count += sums[t][1];
+  }
+  for (size_t b = 0; b < size; ++b)
+    expected += b % 100;
+  ck_assert_uint_eq(expected, sum);
+  ck_assert_uint_eq(size, count);
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Decode a batch of buffers in parallel.
+ */
+START_TEST(test_decode_batch) {
+  uint64_t   sums[4][2] = {};
+  void      *user[4]    = { sums[0], sums[1], sums[2], sums[3] };
+  pb_error_t errors[BATCH_SIZE];
+
+  /* Decode batch */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_decode_batch(&descriptor,
+    buffers, BATCH_SIZE, handler, user, 4, errors));
+  for (size_t b = 0; b < BATCH_SIZE; ++b)
+    ck_assert_uint_eq(PB_ERROR_NONE, errors[b]);
+  check(sums, 4, BATCH_SIZE);
+} END_TEST
+
+/*
+ * Decode a batch of buffers on the calling thread.
+ */
+START_TEST(test_decode_batch_single) {
+  uint64_t   sums[1][2] = {};
+  void      *user[1]    = { sums[0] };
+  pb_error_t errors[BATCH_SIZE];
+
+  /* Decode batch */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_decode_batch(&descriptor,
+    buffers, BATCH_SIZE, handler, user, 1, errors));
+  for (size_t b = 0; b < BATCH_SIZE; ++b)
+    ck_assert_uint_eq(PB_ERROR_NONE, errors[b]);
+  check(sums, 1, BATCH_SIZE);
+} END_TEST
+
+/*
+ * Decode a batch of buffers with more threads than buffers.
+ */
+START_TEST(test_decode_batch_threads) {
+  uint64_t   sums[8][2] = {};
+  void      *user[8]    = { sums[0], sums[1], sums[2], sums[3],
+                            sums[4], sums[5], sums[6], sums[7] };
+  pb_error_t errors[3];
+
+  /* Decode batch */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_decode_batch(&descriptor,
+    buffers, 3, handler, user, 8, errors));
+  for (size_t b = 0; b < 3; ++b)
+    ck_assert_uint_eq(PB_ERROR_NONE, errors[b]);
+  check(sums, 8, 3);
+} END_TEST
+
+/*
+ * Decode a batch of buffers with more threads than are ever used.
+ */
+START_TEST(test_decode_batch_threads_max) {
+  uint64_t   sums[64][2] = {};
+  void      *user[64];
+  pb_error_t errors[BATCH_SIZE];
+  for (size_t t = 0; t < 64; ++t)
+    user[t] = sums[t];
+
+  /* Decode batch */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_decode_batch(&descriptor,
+    buffers, BATCH_SIZE, handler, user, SIZE_MAX, errors));
+  for (size_t b = 0; b < BATCH_SIZE; ++b)
+    ck_assert_uint_eq(PB_ERROR_NONE, errors[b]);
+  check(sums, 64, BATCH_SIZE);
+} END_TEST
+
+/*
+ * Decode an empty batch.
+ */
+START_TEST(test_decode_batch_empty) {
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_decode_batch(&descriptor,
+    NULL, 0, handler, NULL, 4, NULL));
+} END_TEST
+
+/*
+ * Decode a batch of buffers containing invalid buffers.
+ */
+START_TEST(test_decode_batch_invalid) {
+  uint64_t   sums[4][2] = {};
+  void      *user[4]    = { sums[0], sums[1], sums[2], sums[3] };
+  pb_error_t errors[BATCH_SIZE];
+
+  /* Truncate the value of one buffer and invalidate another one */
+  data[300][1] = 128;
+  pb_buffer_destroy(&(buffers[700]));
+  buffers[700] = pb_buffer_create_invalid();
+
+  /* Decode batch, the first failed buffer determines the error code */
+  ck_assert_uint_eq(PB_ERROR_VARINT, pb_decoder_decode_batch(&descriptor,
+    buffers, BATCH_SIZE, handler, user, 4, errors));
+  for (size_t b = 0; b < BATCH_SIZE; ++b)
+    if (b != 300 && b != 700)
+      ck_assert_uint_eq(PB_ERROR_NONE, errors[b]);
+  ck_assert_uint_eq(PB_ERROR_VARINT,  errors[300]);
+  ck_assert_uint_eq(PB_ERROR_INVALID, errors[700]);
+
+  /* Decode batch without reporting errors per buffer */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_decoder_decode_batch(&descriptor,
+    &(buffers[500]), 500, handler, user, 4, NULL));
+} END_TEST
+
+/*
+ * Decode the submessages of a repeated field in parallel.
+ */
+START_TEST(test_decode_repeated) {
+  uint64_t sums[4][2] = {};
+  void    *user[4]    = { sums[0], sums[1], sums[2], sums[3] };
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create_zero_copy(
+    envelope, sizeof(envelope));
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Decode submessages in chunks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_decode_repeated(&decoder,
+    2, handler_nested, deliver, user, 4, 10));
+  ck_assert_uint_eq(BATCH_SIZE, delivered);
+  ck_assert_uint_eq(49500, total);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode the submessages of a repeated field from a segmented buffer.
+ */
+START_TEST(test_decode_repeated_iovec) {
+  uint64_t sums[4][2] = {};
+  void    *user[4]    = { sums[0], sums[1], sums[2], sums[3] };
+
+  /* Create segmented buffer and decoder, splitting submessages */
+  struct iovec segments[] = {
+    { envelope,       1001 },
+    { envelope + 1001, sizeof(envelope) - 1001 }
+  };
+  pb_iovec_t   iovec   = pb_iovec_create(segments, 2);
+  pb_decoder_t decoder = pb_decoder_create_from_iovec(
+    &descriptor_envelope, &iovec);
+
+  /* Decode submessages in chunks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_decode_repeated(&decoder,
+    2, handler_nested, deliver, user, 4, 7));
+  ck_assert_uint_eq(BATCH_SIZE, delivered);
+  ck_assert_uint_eq(49500, total);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_iovec_destroy(&iovec);
+} END_TEST
+
+/*
+ * Decode the submessages of a repeated field on the calling thread.
+ */
+START_TEST(test_decode_repeated_single) {
+  uint64_t sums[1][2] = {};
+  void    *user[1]    = { sums[0] };
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create_zero_copy(
+    envelope, sizeof(envelope));
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Decode submessages in a single chunk */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_decode_repeated(&decoder,
+    2, handler_nested, deliver, user, 1, BATCH_SIZE));
+  ck_assert_uint_eq(BATCH_SIZE, delivered);
+  ck_assert_uint_eq(49500, total);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode the submessages of a repeated field without occurrences.
+ */
+START_TEST(test_decode_repeated_empty) {
+  pb_buffer_t  buffer  = pb_buffer_create_zero_copy(envelope, 2);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Decode submessages */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_decode_repeated(&decoder,
+    2, handler_nested, deliver, NULL, 4, 10));
+  ck_assert_uint_eq(0, delivered);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode the submessages of a repeated field containing an invalid one.
+ */
+START_TEST(test_decode_repeated_invalid) {
+  uint64_t sums[4][2] = {};
+  void    *user[4]    = { sums[0], sums[1], sums[2], sums[3] };
+
+  /* Truncate the value of a submessage */
+  envelope[2 + 555 * 4 + 3] = 128;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create_zero_copy(
+    envelope, sizeof(envelope));
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Decode submessages, stopping delivery at the failed chunk */
+  ck_assert_uint_eq(PB_ERROR_VARINT, pb_decoder_decode_repeated(&decoder,
+    2, handler_nested, deliver, user, 4, 10));
+  ck_assert_uint_eq(550, delivered);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode the submessages of a field which is not a message field.
+ */
+START_TEST(test_decode_repeated_invalid_tag) {
+  pb_buffer_t  buffer  = pb_buffer_create_zero_copy(
+    envelope, sizeof(envelope));
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Decode submessages */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_decoder_decode_repeated(&decoder,
+    1, handler_nested, deliver, NULL, 4, 10));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_decoder_decode_repeated(&decoder,
+    3, handler_nested, deliver, NULL, 4, 10));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode the submessages of a repeated field in an envelope with a field of
+ * an invalid wiretype.
+ */
+START_TEST(test_decode_repeated_invalid_wiretype) {
+  /* Change wiretype of the first field */
+  envelope[0] = (1 << 3) | 6;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create_zero_copy(
+    envelope, sizeof(envelope));
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Decode submessages */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_decoder_decode_repeated(&decoder,
+    2, handler_nested, deliver, NULL, 4, 10));
+  ck_assert_uint_eq(0, delivered);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode the submessages of a repeated field with a truncated envelope.
+ */
+START_TEST(test_decode_repeated_invalid_length) {
+  pb_buffer_t  buffer  = pb_buffer_create_zero_copy(
+    envelope, sizeof(envelope) - 1);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Decode submessages */
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_decoder_decode_repeated(&decoder,
+    2, handler_nested, deliver, NULL, 4, 10));
+  ck_assert_uint_eq(0, delivered);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/decoder"),
+       *tcase = NULL;
+
+  /* Add tests to test case "batch" */
+  tcase = tcase_create("batch");
+  tcase_add_checked_fixture(tcase, setup, teardown);
+  tcase_add_test(tcase, test_decode_batch);
+  tcase_add_test(tcase, test_decode_batch_single);
+  tcase_add_test(tcase, test_decode_batch_threads);
+  tcase_add_test(tcase, test_decode_batch_threads_max);
+  tcase_add_test(tcase, test_decode_batch_empty);
+  tcase_add_test(tcase, test_decode_batch_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "repeated" */
+  tcase = tcase_create("repeated");
+  tcase_add_checked_fixture(tcase, setup, teardown);
+  tcase_add_test(tcase, test_decode_repeated);
+  tcase_add_test(tcase, test_decode_repeated_iovec);
+  tcase_add_test(tcase, test_decode_repeated_single);
+  tcase_add_test(tcase, test_decode_repeated_empty);
+  tcase_add_test(tcase, test_decode_repeated_invalid);
+  tcase_add_test(tcase, test_decode_repeated_invalid_tag);
+  tcase_add_test(tcase, test_decode_repeated_invalid_wiretype);
+  tcase_add_test(tcase, test_decode_repeated_invalid_length);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
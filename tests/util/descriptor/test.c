@@ -78,6 +78,26 @@ descriptor_extension_nested = { {
     { 30, "F30", MESSAGE, OPTIONAL, &descriptor }
   }, 1, } };
 
+/* Descriptor with generated name table */
+static pb_descriptor_t
+descriptor_hashed = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F02", UINT64,  OPTIONAL },
+    {  3, "F03", SINT32,  OPTIONAL },
+    {  4, "F04", SINT64,  OPTIONAL }
+  }, 4 },
+  .names = &(const pb_name_table_t){ 0, 8, (const uint32_t []){
+    0, 1, 4, 0, 2, 0, 0, 3 } } };
+
+/* Descriptor with duplicate names */
+static pb_descriptor_t
+descriptor_duplicate = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F01", UINT64,  OPTIONAL }
+  }, 2 } };
+
 /* ------------------------------------------------------------------------- */
 
 /* Enum descriptor */
@@ -89,6 +109,17 @@ enum_descriptor = { {
     {  2, "V02" }
   }, 3 } };
 
+/* Enum descriptor with generated name table */
+static pb_enum_descriptor_t
+enum_descriptor_hashed = { {
+  (const pb_enum_value_descriptor_t []){
+    {  0, "V00" },
+    {  1, "V01" },
+    {  2, "V02" }
+  }, 3 },
+  .names = &(const pb_name_table_t){ 0, 8, (const uint32_t []){
+    0, 3, 0, 1, 2, 0, 0, 0 } } };
+
 /* Empty enum descriptor */
 static pb_enum_descriptor_t
 enum_descriptor_empty = {};
@@ -200,6 +231,32 @@ START_TEST(test_field_by_name_extended) {
     pb_descriptor_field_by_name(&descriptor, "F30"));
 } END_TEST
 
+/*
+ * Retrieve the field descriptor for a given name using a generated table.
+ */
+START_TEST(test_field_by_name_hashed) {
+  for (size_t f = 1; f <= 4; f++) {
+    char name[5];
+    snprintf(name, 5, "F%02zd", f);
+
+    /* Assert field descriptor */
+    ck_assert_ptr_eq(&(descriptor_hashed.field.data[f - 1]),
+      pb_descriptor_field_by_name(&descriptor_hashed, name));
+  }
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_name(&descriptor_hashed, "F05"));
+} END_TEST
+
+/*
+ * Retrieve the field descriptor for a given name if no table can be built.
+ */
+START_TEST(test_field_by_name_duplicate) {
+  ck_assert_ptr_eq(&(descriptor_duplicate.field.data[0]),
+    pb_descriptor_field_by_name(&descriptor_duplicate, "F01"));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_name(&descriptor_duplicate, "F02"));
+} END_TEST
+
 /* ------------------------------------------------------------------------- */
 
 /*
@@ -216,6 +273,22 @@ START_TEST(test_enum_value_by_name) {
   }
 } END_TEST
 
+/*
+ * Retrieve the value for a given name using a generated table.
+ */
+START_TEST(test_enum_value_by_name_hashed) {
+  for (size_t v = 0; v < 3; v++) {
+    char name[5];
+    snprintf(name, 5, "V%02zd", v);
+
+    /* Assert value descriptor */
+    ck_assert_ptr_eq(&(enum_descriptor_hashed.value.data[v]),
+      pb_enum_descriptor_value_by_name(&enum_descriptor_hashed, name));
+  }
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_name(&enum_descriptor_hashed, "V03"));
+} END_TEST
+
 /*
  * Retrieve the value for an absent name from an enum descriptor.
  */
@@ -280,11 +353,14 @@ main(void) {
   tcase_add_test(tcase, test_field_by_name_scattered);
   tcase_add_test(tcase, test_field_by_name_scattered_absent);
   tcase_add_test(tcase, test_field_by_name_extended);
+  tcase_add_test(tcase, test_field_by_name_hashed);
+  tcase_add_test(tcase, test_field_by_name_duplicate);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "enum_value_by_name" */
   tcase = tcase_create("enum_value_by_name");
   tcase_add_test(tcase, test_enum_value_by_name);
+  tcase_add_test(tcase, test_enum_value_by_name_hashed);
   tcase_add_test(tcase, test_enum_value_by_name_absent);
   tcase_add_test(tcase, test_enum_value_by_name_empty);
   tcase_add_test(tcase, test_enum_value_by_name_scattered);
@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2013-2017 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "util/prune.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F02", STRING,  OPTIONAL },
+    {  3, "F03", MESSAGE, OPTIONAL, &descriptor },
+    {  4, "F04", MESSAGE, REPEATED, &descriptor },
+    {  5, "F05", FIXED32, OPTIONAL }
+  }, 5 } };
+
+/* ----------------------------------------------------------------------------
+ * Masks
+ * ------------------------------------------------------------------------- */
+
+/* Mask */
+static const pb_mask_t
+mask = { {
+  (const pb_mask_field_t []){
+    {  1 },
+    {  5 }
+  }, 2 } };
+
+/* Mask for submessages */
+static const pb_mask_t
+mask_nested = { {
+  (const pb_mask_field_t []){
+    {  1 },
+    {  3, &mask },
+    {  4, &mask }
+  }, 3 } };
+
+/* Mask for submessage of scalar field */
+static const pb_mask_t
+mask_invalid = { {
+  (const pb_mask_field_t []){
+    {  1, &mask }
+  }, 1 } };
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Prune a buffer.
+ */
+START_TEST(test_prune) {
+  const uint8_t data[] = { 8, 1, 18, 2, 72, 73, 45, 1, 2, 3, 4, 8, 2 };
+  const size_t  size   = 13;
+
+  /* Create buffers */
+  pb_buffer_t in  = pb_buffer_create(data, size);
+  pb_buffer_t out = pb_buffer_create_empty();
+
+  /* Prune buffer and assert selected fields */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_prune(&descriptor, &mask, &in, &out));
+  ck_assert_uint_eq(9, pb_buffer_size(&out));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 45, 1, 2, 3, 4, 8, 2 },
+    pb_buffer_data(&out), 9));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/*
+ * Prune a buffer with submessages.
+ */
+START_TEST(test_prune_nested) {
+  const uint8_t data[] = { 8, 1, 26, 5, 8, 2, 18, 1, 88,
+    34, 2, 8, 3, 34, 3, 18, 1, 89 };
+  const size_t  size   = 18;
+
+  /* Create buffers */
+  pb_buffer_t in  = pb_buffer_create(data, size);
+  pb_buffer_t out = pb_buffer_create_empty();
+
+  /* Prune buffer and assert pruned submessages */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_prune(&descriptor, &mask_nested, &in, &out));
+  ck_assert_uint_eq(12, pb_buffer_size(&out));
+  fail_if(memcmp((const uint8_t []){ 8, 1, 26, 2, 8, 2, 34, 2, 8, 3, 34, 0 },
+    pb_buffer_data(&out), 12));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/*
+ * Prune a buffer with a submessage shrinking its length prefix.
+ */
+START_TEST(test_prune_nested_prefix) {
+  uint8_t data[136] = { 26, 133, 1, 8, 1, 18, 128, 1 };
+  const size_t size = 136;
+  memset(&(data[8]), 65, 128);
+
+  /* Create buffers */
+  pb_buffer_t in  = pb_buffer_create(data, size);
+  pb_buffer_t out = pb_buffer_create_empty();
+
+  /* Prune buffer and assert minimal length prefix */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_prune(&descriptor, &mask_nested, &in, &out));
+  ck_assert_uint_eq(4, pb_buffer_size(&out));
+  fail_if(memcmp((const uint8_t []){ 26, 2, 8, 1 },
+    pb_buffer_data(&out), 4));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/*
+ * Prune a buffer and append it to a buffer with data.
+ */
+START_TEST(test_prune_append) {
+  const uint8_t data[] = { 18, 1, 72, 8, 1 };
+  const size_t  size   = 5;
+
+  /* Create buffers */
+  pb_buffer_t in  = pb_buffer_create(data, size);
+  pb_buffer_t out = pb_buffer_create((const uint8_t []){ 16, 127 }, 2);
+
+  /* Prune buffer and assert appended fields */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_prune(&descriptor, &mask, &in, &out));
+  ck_assert_uint_eq(4, pb_buffer_size(&out));
+  fail_if(memcmp((const uint8_t []){ 16, 127, 8, 1 },
+    pb_buffer_data(&out), 4));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/*
+ * Prune a buffer without selected fields.
+ */
+START_TEST(test_prune_empty) {
+  const uint8_t data[] = { 18, 1, 72 };
+  const size_t  size   = 3;
+
+  /* Create buffers */
+  pb_buffer_t in  = pb_buffer_create(data, size);
+  pb_buffer_t out = pb_buffer_create_empty();
+
+  /* Prune buffer and assert empty buffer */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_prune(&descriptor, &mask, &in, &out));
+  fail_unless(pb_buffer_empty(&out));
+  fail_unless(pb_buffer_valid(&out));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/*
+ * Prune an empty buffer.
+ */
+START_TEST(test_prune_empty_buffer) {
+  pb_buffer_t in  = pb_buffer_create_empty();
+  pb_buffer_t out = pb_buffer_create_empty();
+
+  /* Prune buffer and assert empty buffer */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_prune(&descriptor, &mask, &in, &out));
+  fail_unless(pb_buffer_empty(&out));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/*
+ * Prune a buffer with a mask for a submessage of a scalar field.
+ */
+START_TEST(test_prune_invalid_mask) {
+  const uint8_t data[] = { 8, 1 };
+  const size_t  size   = 2;
+
+  /* Create buffers */
+  pb_buffer_t in  = pb_buffer_create(data, size);
+  pb_buffer_t out = pb_buffer_create((const uint8_t []){ 16, 127 }, 2);
+
+  /* Prune buffer and assert unchanged buffer */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_prune(&descriptor, &mask_invalid, &in, &out));
+  ck_assert_uint_eq(2, pb_buffer_size(&out));
+  fail_if(memcmp((const uint8_t []){ 16, 127 }, pb_buffer_data(&out), 2));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/*
+ * Prune a buffer with an invalid wiretype.
+ */
+START_TEST(test_prune_invalid_wiretype) {
+  const uint8_t data[] = { 8, 1, 15 };
+  const size_t  size   = 3;
+
+  /* Create buffers */
+  pb_buffer_t in  = pb_buffer_create(data, size);
+  pb_buffer_t out = pb_buffer_create_empty();
+
+  /* Prune buffer */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_prune(&descriptor, &mask, &in, &out));
+  fail_unless(pb_buffer_empty(&out));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/*
+ * Prune a buffer with an invalid length prefix.
+ */
+START_TEST(test_prune_invalid_length) {
+  const uint8_t data[] = { 8, 1, 18, 5, 72 };
+  const size_t  size   = 5;
+
+  /* Create buffers */
+  pb_buffer_t in  = pb_buffer_create(data, size);
+  pb_buffer_t out = pb_buffer_create_empty();
+
+  /* Prune buffer */
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_prune(&descriptor, &mask, &in, &out));
+  fail_unless(pb_buffer_empty(&out));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/*
+ * Prune an invalid buffer.
+ */
+START_TEST(test_prune_invalid_buffer) {
+  pb_buffer_t in  = pb_buffer_create_invalid();
+  pb_buffer_t out = pb_buffer_create_empty();
+
+  /* Prune buffer */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_prune(&descriptor, &mask, &in, &out));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/*
+ * Prune a buffer into a zero-copy buffer.
+ */
+START_TEST(test_prune_invalid_zero_copy) {
+  uint8_t data[] = { 8, 1 };
+  size_t  size   = 2;
+
+  /* Create buffers */
+  pb_buffer_t in  = pb_buffer_create(data, size);
+  pb_buffer_t out = pb_buffer_create_zero_copy(data, size);
+
+  /* Prune buffer */
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_prune(&descriptor, &mask, &in, &out));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&out);
+  pb_buffer_destroy(&in);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/prune"),
+       *tcase = NULL;
+
+  /* Add tests to test case "prune" */
+  tcase = tcase_create("prune");
+  tcase_add_test(tcase, test_prune);
+  tcase_add_test(tcase, test_prune_nested);
+  tcase_add_test(tcase, test_prune_nested_prefix);
+  tcase_add_test(tcase, test_prune_append);
+  tcase_add_test(tcase, test_prune_empty);
+  tcase_add_test(tcase, test_prune_empty_buffer);
+  tcase_add_test(tcase, test_prune_invalid_mask);
+  tcase_add_test(tcase, test_prune_invalid_wiretype);
+  tcase_add_test(tcase, test_prune_invalid_length);
+  tcase_add_test(tcase, test_prune_invalid_buffer);
+  tcase_add_test(tcase, test_prune_invalid_zero_copy);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
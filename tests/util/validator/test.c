@@ -50,6 +50,45 @@ descriptor = { {
 static pb_descriptor_t
 descriptor_empty = {};
 
+/* Descriptor with more fields than fit into a word */
+static pb_descriptor_t
+descriptor_wide = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32, REQUIRED }, {  2, "F02", UINT32, OPTIONAL },
+    {  3, "F03", UINT32, OPTIONAL }, {  4, "F04", UINT32, OPTIONAL },
+    {  5, "F05", UINT32, OPTIONAL }, {  6, "F06", UINT32, OPTIONAL },
+    {  7, "F07", UINT32, OPTIONAL }, {  8, "F08", UINT32, OPTIONAL },
+    {  9, "F09", UINT32, OPTIONAL }, { 10, "F10", UINT32, OPTIONAL },
+    { 11, "F11", UINT32, OPTIONAL }, { 12, "F12", UINT32, OPTIONAL },
+    { 13, "F13", UINT32, OPTIONAL }, { 14, "F14", UINT32, OPTIONAL },
+    { 15, "F15", UINT32, OPTIONAL }, { 16, "F16", UINT32, OPTIONAL },
+    { 17, "F17", UINT32, OPTIONAL }, { 18, "F18", UINT32, OPTIONAL },
+    { 19, "F19", UINT32, OPTIONAL }, { 20, "F20", UINT32, OPTIONAL },
+    { 21, "F21", UINT32, OPTIONAL }, { 22, "F22", UINT32, OPTIONAL },
+    { 23, "F23", UINT32, OPTIONAL }, { 24, "F24", UINT32, OPTIONAL },
+    { 25, "F25", UINT32, OPTIONAL }, { 26, "F26", UINT32, OPTIONAL },
+    { 27, "F27", UINT32, OPTIONAL }, { 28, "F28", UINT32, OPTIONAL },
+    { 29, "F29", UINT32, OPTIONAL }, { 30, "F30", UINT32, OPTIONAL },
+    { 31, "F31", UINT32, OPTIONAL }, { 32, "F32", UINT32, OPTIONAL },
+    { 33, "F33", UINT32, OPTIONAL }, { 34, "F34", UINT32, OPTIONAL },
+    { 35, "F35", UINT32, OPTIONAL }, { 36, "F36", UINT32, OPTIONAL },
+    { 37, "F37", UINT32, OPTIONAL }, { 38, "F38", UINT32, OPTIONAL },
+    { 39, "F39", UINT32, OPTIONAL }, { 40, "F40", UINT32, OPTIONAL },
+    { 41, "F41", UINT32, OPTIONAL }, { 42, "F42", UINT32, OPTIONAL },
+    { 43, "F43", UINT32, OPTIONAL }, { 44, "F44", UINT32, OPTIONAL },
+    { 45, "F45", UINT32, OPTIONAL }, { 46, "F46", UINT32, OPTIONAL },
+    { 47, "F47", UINT32, OPTIONAL }, { 48, "F48", UINT32, OPTIONAL },
+    { 49, "F49", UINT32, OPTIONAL }, { 50, "F50", UINT32, OPTIONAL },
+    { 51, "F51", UINT32, OPTIONAL }, { 52, "F52", UINT32, OPTIONAL },
+    { 53, "F53", UINT32, OPTIONAL }, { 54, "F54", UINT32, OPTIONAL },
+    { 55, "F55", UINT32, OPTIONAL }, { 56, "F56", UINT32, OPTIONAL },
+    { 57, "F57", UINT32, OPTIONAL }, { 58, "F58", UINT32, OPTIONAL },
+    { 59, "F59", UINT32, OPTIONAL }, { 60, "F60", UINT32, OPTIONAL },
+    { 61, "F61", UINT32, OPTIONAL }, { 62, "F62", UINT32, OPTIONAL },
+    { 63, "F63", UINT32, OPTIONAL }, { 64, "F64", UINT32, OPTIONAL },
+    { 65, "F65", UINT32, OPTIONAL }, { 66, "F66", UINT32, REQUIRED }
+  }, 66 } };
+
 /* Extension descriptor */
 static pb_descriptor_t
 descriptor_extension = { {
@@ -302,6 +341,46 @@ START_TEST(test_check_multiple_required) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Validate a buffer with required fields spread across words.
+ */
+START_TEST(test_check_wide) {
+  const uint8_t data[] = { 8, 1, 144, 4, 1 };
+  const size_t  size   = 5;
+
+  /* Create validator and buffer */
+  pb_buffer_t    buffer    = pb_buffer_create(data, size);
+  pb_validator_t validator = pb_validator_create(&descriptor_wide);
+
+  /* Check buffer */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_validator_check(&validator, &buffer));
+
+  /* Free all allocated memory */
+  pb_validator_destroy(&validator);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Validate a buffer missing a required field in a later word.
+ */
+START_TEST(test_check_wide_absent) {
+  const uint8_t data[] = { 8, 1, 16, 1 };
+  const size_t  size   = 4;
+
+  /* Create validator and buffer */
+  pb_buffer_t    buffer    = pb_buffer_create(data, size);
+  pb_validator_t validator = pb_validator_create(&descriptor_wide);
+
+  /* Check buffer */
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_validator_check(&validator, &buffer));
+
+  /* Free all allocated memory */
+  pb_validator_destroy(&validator);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /*
  * Validate an invalid buffer.
  */
@@ -386,6 +465,8 @@ main(void) {
   tcase_add_test(tcase, test_check_extension_nested_empty);
   tcase_add_test(tcase, test_check_multiple_optional);
   tcase_add_test(tcase, test_check_multiple_required);
+  tcase_add_test(tcase, test_check_wide);
+  tcase_add_test(tcase, test_check_wide_absent);
   tcase_add_test(tcase, test_check_invalid);
   tcase_add_test(tcase, test_check_invalid_tag);
   tcase_add_test(tcase, test_check_invalid_length);